@@ -101,8 +101,15 @@ private:
 	void handleHideLeaderboardTracker(const rc_client_event_t *event);
 	void handleUpdateLeaderboardTracker(const rc_client_event_t *event);
 	static void emuEventCallback(Event event, void *arg);
+	void doFrame();
 
 	rc_client_t *rc_client = nullptr;
+	RamView ram;
+	struct {
+		u64 totalTime;
+		u64 maxTime;
+		u32 frames;
+	} frameStats {};
 	bool loggedOn = false;
 	std::atomic_bool loadingGame {};
 	bool active = false;
@@ -425,24 +432,27 @@ void Achievements::clientMessageCallback(const char* message, const rc_client_t*
 
 u32 Achievements::clientReadMemory(u32 address, u8* buffer, u32 num_bytes, rc_client_t* client)
 {
-	if (address + num_bytes > RAM_SIZE)
-		return 0;
-	address += 0x0C000000;
-	switch (num_bytes)
+	Achievements *achievements = (Achievements *)rc_client_get_userdata(client);
+	// Memory is also read while the game is loading, before the first frame.
+	// System RAM may have been reallocated since the last read.
+	achievements->ram.refresh();
+	return achievements->ram.read(address, buffer, num_bytes);
+}
+
+void Achievements::doFrame()
+{
+	u64 start = getTimeUs();
+	rc_client_do_frame(rc_client);
+	u64 duration = getTimeUs() - start;
+
+	frameStats.totalTime += duration;
+	frameStats.maxTime = std::max(frameStats.maxTime, duration);
+	if (++frameStats.frames == 3600)
 	{
-	case 1:
-    	*buffer = ReadMem8_nommu(address);
-    	break;
-	case 2:
-		*(u16 *)buffer = ReadMem16_nommu(address);
-		break;
-	case 4:
-		*(u32 *)buffer = ReadMem32_nommu(address);
-		break;
-	default:
-		return 0;
+		DEBUG_LOG(COMMON, "RA: frame evaluation avg %d us max %d us", (int)(frameStats.totalTime / frameStats.frames),
+				(int)frameStats.maxTime);
+		frameStats = {};
 	}
-	return num_bytes;
 }
 
 void Achievements::clientServerCall(const rc_api_request_t *request, rc_client_server_callback_t callback,
@@ -819,7 +829,7 @@ void Achievements::emuEventCallback(Event event, void *arg)
 		instance->unloadGame();
 		break;
 	case Event::VBlank:
-		rc_client_do_frame(instance->rc_client);
+		instance->doFrame();
 		break;
 	case Event::Pause:
 		instance->pauseGame();
@@ -854,6 +864,7 @@ void Achievements::loadGame()
 	{
 		// settings.raHardcoreMode is set before enabling cheats and loading the initial savestate
 		rc_client_set_hardcore_enabled(rc_client, settings.raHardcoreMode);
+		ram.refresh();
 		rc_client_begin_load_game(rc_client, gameHash.c_str(), [](int result, const char *error_message, rc_client_t *client, void *userdata) {
 				((Achievements *)userdata)->gameLoaded(result, error_message);
 			}, this);
@@ -42,8 +42,11 @@ class OboeBackend : AudioBackend
 		oboe::DataCallbackResult onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t numFrames) override
 		{
 			if (!backend->ringBuffer.read((u8 *)audioData, numFrames * 4))
+			{
 				// underrun
 				memset(audioData, 0, numFrames * 4);
+				backend->underruns++;
+			}
 			backend->pushWait.Set();
 
 			return oboe::DataCallbackResult::Continue;
@@ -148,6 +151,13 @@ public:
 		return 1;
 	}
 
+	bool getBufferState(u32& frames, u32& capacity) override
+	{
+		frames = ringBuffer.size() / 4;
+		capacity = ringBuffer.capacity() / 4;
+		return true;
+	}
+
 	void termRecord() override
 	{
 		if (recordStream != nullptr)
@@ -1,6 +1,10 @@
 #include "audiostream.h"
 #include "cfg/option.h"
 #include "emulator.h"
+#include "network/ggpo.h"
+#include "profiler/frame_tracer.h"
+
+#include <cmath>
 
 static void registerForEvents();
 
@@ -9,6 +13,55 @@ struct SoundFrame { s16 l; s16 r; };
 static SoundFrame Buffer[SAMPLE_COUNT];
 static u32 writePtr;  // next sample index
 
+// Dynamic rate control.
+// Instead of blocking the emulation in the audio backend, the generated audio is stretched or shrunk
+// by up to 0.5% so that the backend buffer stays half full. Emulation is then paced by vsync
+// or by the frame pacer.
+class RateControl
+{
+public:
+	static constexpr float MaxDeviation = 0.005f;
+
+	// Resamples the given frames and pushes them to the backend in SAMPLE_COUNT chunks
+	void push(AudioBackend *backend, const SoundFrame *in, u32 count, float fill)
+	{
+		// Output/input ratio: produce more frames when the buffer is running low, less when it's filling up
+		const float ratio = 1.f + MaxDeviation * (1.f - 2.f * std::clamp(fill, 0.f, 1.f));
+		const double step = 1.0 / ratio;
+		// Input frame -1 is the last frame of the previous chunk
+		for (; pos < count - 1; pos += step)
+		{
+			int i = (int)std::floor(pos);
+			const SoundFrame& f0 = i < 0 ? last : in[i];
+			const SoundFrame& f1 = in[i + 1];
+			const float t = (float)(pos - i);
+			SoundFrame& f = out[outCount++];
+			f.l = (s16)std::lround(f0.l + (f1.l - f0.l) * t);
+			f.r = (s16)std::lround(f0.r + (f1.r - f0.r) * t);
+			if (outCount == SAMPLE_COUNT)
+			{
+				backend->push(out, SAMPLE_COUNT, false);
+				outCount = 0;
+			}
+		}
+		pos -= count;
+		last = in[count - 1];
+	}
+
+	void reset() {
+		pos = 0;
+		outCount = 0;
+		last = {};
+	}
+
+private:
+	double pos = 0;		// position of the next output frame in the input chunk
+	SoundFrame last {};
+	SoundFrame out[SAMPLE_COUNT];
+	u32 outCount = 0;
+};
+static RateControl rateControl;
+
 static AudioBackend *currentBackend;
 std::vector<AudioBackend *> *AudioBackend::backends;
 
@@ -56,11 +109,31 @@ void WriteSample(s16 r, s16 l)
 	if (++writePtr == SAMPLE_COUNT)
 	{
 		if (currentBackend != nullptr)
-			currentBackend->push(Buffer, SAMPLE_COUNT, config::LimitFPS);
+		{
+			TRACE_SCOPE("Audio push");
+			u32 frames, capacity;
+			const bool framePacing = config::FramePacing && !settings.input.fastForwardMode && !ggpo::active();
+			if (((config::AudioRateControl && config::VSync) || framePacing)
+					&& currentBackend->getBufferState(frames, capacity) && capacity > 0)
+				rateControl.push(currentBackend, Buffer, SAMPLE_COUNT, (float)frames / capacity);
+			else
+				// Don't block when the frame pacer is in charge
+				currentBackend->push(Buffer, SAMPLE_COUNT, config::LimitFPS && !framePacing);
+		}
 		writePtr = 0;
 	}
 }
 
+bool GetAudioBufferState(float& fill, u32& underruns)
+{
+	u32 frames, capacity;
+	if (currentBackend == nullptr || !currentBackend->getBufferState(frames, capacity) || capacity == 0)
+		return false;
+	fill = (float)frames / capacity;
+	underruns = currentBackend->underruns;
+	return true;
+}
+
 void InitAudio()
 {
 	registerForEvents();
@@ -95,6 +168,8 @@ void InitAudio()
 		WARN_LOG(AUDIO, "Running without audio!");
 		return;
 	}
+	currentBackend->underruns = 0;
+	rateControl.reset();
 
 	if (audio_recording_started)
 	{
@@ -152,6 +227,7 @@ static void registerForEvents()
 	// Empty the audio buffer when loading a state or terminating the game
 	const auto& callback = [](Event, void *) {
 		writePtr = 0;
+		rateControl.reset();
 	};
 	EventManager::listen(Event::Terminate, callback);
 	EventManager::listen(Event::LoadState, callback);
@@ -30,6 +30,11 @@ public:
 		return nullptr;
 	}
 
+	// Number of frames queued in the output buffer and its capacity, used for dynamic rate control.
+	// Returns false if the backend doesn't know.
+	virtual bool getBufferState(u32& frames, u32& capacity) { return false; }
+	std::atomic<u32> underruns { 0 };
+
 	virtual bool initRecord(u32 sampling_freq) { return false; }
 	virtual u32 record(void *, u32) { return 0; }
 	virtual void termRecord() {}
@@ -62,6 +67,8 @@ private:
 void InitAudio();
 void TermAudio();
 void WriteSample(s16 right, s16 left);
+// Output buffer fill level (0 to 1) and underrun count of the current backend, for the OSD
+bool GetAudioBufferState(float& fill, u32& underruns);
 
 void StartAudioRecording(bool eight_khz);
 u32 RecordAudio(void *buffer, u32 samples);
@@ -69,25 +76,27 @@ void StopAudioRecording();
 
 constexpr u32 SAMPLE_COUNT = 512;	// AudioBackend::push() is always called with that many frames
 
+// Lock-free single producer/single consumer byte ring buffer
 class RingBuffer
 {
 	std::vector<u8> buffer;
-	std::atomic_int readCursor { 0 };
-	std::atomic_int writeCursor { 0 };
+	std::atomic<u32> readCursor { 0 };
+	std::atomic<u32> writeCursor { 0 };
 
-	u32 readSize() {
-		return (u32)((writeCursor - readCursor + buffer.size()) % buffer.size());
+	u32 readSize(u32 rc, u32 wc) const {
+		return (u32)((buffer.size() + wc - rc) % buffer.size());
 	}
-	u32 writeSize() {
-		return (u32)((readCursor - writeCursor + buffer.size() - 1) % buffer.size());
+	u32 writeSize(u32 rc, u32 wc) const {
+		return (u32)((buffer.size() + rc - wc - 1) % buffer.size());
 	}
 
 public:
+	// Producer side
 	bool write(const u8 *data, u32 size)
 	{
-		if (size > writeSize())
+		u32 wc = writeCursor.load(std::memory_order_relaxed);
+		if (buffer.empty() || size > writeSize(readCursor.load(std::memory_order_acquire), wc))
 			return false;
-		u32 wc = writeCursor;
 		u32 chunkSize = std::min<u32>(size, (u32)buffer.size() - wc);
 		memcpy(&buffer[wc], data, chunkSize);
 		wc = (wc + chunkSize) % buffer.size();
@@ -98,15 +107,16 @@ public:
 			memcpy(&buffer[wc], data, size);
 			wc = (wc + size) % buffer.size();
 		}
-		writeCursor = wc;
+		writeCursor.store(wc, std::memory_order_release);
 		return true;
 	}
 
+	// Consumer side
 	bool read(u8 *data, u32 size)
 	{
-		if (size > readSize())
+		u32 rc = readCursor.load(std::memory_order_relaxed);
+		if (buffer.empty() || size > readSize(rc, writeCursor.load(std::memory_order_acquire)))
 			return false;
-		u32 rc = readCursor;
 		u32 chunkSize = std::min<u32>(size, (u32)buffer.size() - rc);
 		memcpy(data, &buffer[rc], chunkSize);
 		rc = (rc + chunkSize) % buffer.size();
@@ -117,10 +127,24 @@ public:
 			memcpy(data, &buffer[rc], size);
 			rc = (rc + size) % buffer.size();
 		}
-		readCursor = rc;
+		readCursor.store(rc, std::memory_order_release);
 		return true;
 	}
 
+	// Bytes available for reading. Can be called from either side.
+	u32 size() const
+	{
+		if (buffer.empty())
+			return 0;
+		return readSize(readCursor.load(std::memory_order_acquire), writeCursor.load(std::memory_order_acquire));
+	}
+
+	// Maximum number of bytes that can be buffered
+	u32 capacity() const {
+		return buffer.empty() ? 0 : (u32)buffer.size() - 1;
+	}
+
+	// Must not be called while the producer or consumer is running
 	void setCapacity(size_t size)
 	{
 		std::fill(buffer.begin(), buffer.end(), 0);
@@ -21,6 +21,7 @@
 //FEAT_SHREC, FEAT_AREC, FEAT_DSPREC
 #define DYNAREC_NONE	0x40000001
 #define DYNAREC_JIT		0x40000002
+#define DYNAREC_VM		0x40000003
 
 //automatic
 
@@ -40,7 +41,7 @@
 #include "TargetConditionals.h"
 #if TARGET_OS_SIMULATOR
 // iOS simulator
-#define TARGET_NO_REC
+#define TARGET_NO_JIT
 #endif
 #if defined(TARGET_MAC) && HOST_CPU == CPU_ARM64
 #define TARGET_ARM_MAC
@@ -53,6 +54,12 @@
 #define FEAT_DSPREC DYNAREC_NONE
 #endif
 
+#if defined(TARGET_NO_JIT)
+#define FEAT_SHREC DYNAREC_VM
+#define FEAT_AREC DYNAREC_NONE
+#define FEAT_DSPREC DYNAREC_NONE
+#endif
+
 #if defined(TARGET_NO_AREC)
 #define FEAT_SHREC DYNAREC_JIT
 #define FEAT_AREC DYNAREC_NONE
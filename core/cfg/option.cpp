@@ -25,6 +25,7 @@ namespace config {
 // Dynarec
 
 Option<bool> DynarecEnabled("Dynarec.Enabled", true);
+Option<bool> CachedInterpreter("Dynarec.CachedInterpreter", true);
 Option<int> Sh4Clock("Sh4Clock", 200);
 
 // General
@@ -37,6 +38,7 @@ Option<bool> AutoLoadState("Dreamcast.AutoLoadState");
 Option<bool> AutoSaveState("Dreamcast.AutoSaveState");
 Option<int, false> SavestateSlot("Dreamcast.SavestateSlot");
 Option<bool> ForceFreePlay("ForceFreePlay", true);
+Option<int> RunAhead("RunAhead", 0);
 Option<bool, false> FetchBoxart("FetchBoxart", true);
 Option<bool, false> BoxartDisplayMode("BoxartDisplayMode", true);
 Option<int, false> UIScaling("UIScaling", 100);
@@ -56,6 +58,7 @@ Option<bool> AutoLatency("aica.AutoLatency",
 		false
 #endif
 		);
+Option<bool> AudioRateControl("aica.RateControl", false);
 
 OptionString AudioBackend("backend", "auto", "audio");
 AudioVolumeOption AudioVolume;
@@ -103,6 +106,8 @@ Option<int64_t> PixelBufferSize("rend.PixelBufferSize", 512_MB);
 Option<int> AnisotropicFiltering("rend.AnisotropicFiltering", 1);
 Option<int> TextureFiltering("rend.TextureFiltering", 0); // Default
 Option<bool> ThreadedRendering("rend.ThreadedRendering", true);
+Option<bool> FramePacing("rend.FramePacing", false);
+Option<bool> LateLatchInput("rend.LateLatchInput", false);
 Option<bool> DupeFrames("rend.DupeFrames", false);
 Option<int> PerPixelLayers("rend.PerPixelLayers", 32);
 #ifdef TARGET_UWP
@@ -140,12 +145,14 @@ Option<bool, false> DiscordPresence("DiscordPresence", true);
 Option<bool, false> UseSafFilePicker("UseSafFilePicker", true);
 #endif
 OptionString LogServer("LogServer", "", "log");
+Option<bool, false> LogAsync("Async", false, "log");
 
 // Profiler
 Option<bool> ProfilerEnabled("Profiler.Enabled");
 Option<bool> ProfilerDrawToGUI("Profiler.DrawGUI");
 Option<bool> ProfilerOutputTTY("Profiler.OutputTTY");
 Option<float> ProfilerFrameWarningTime("Profiler.FrameWarningTime", 1.0f / 55.0f);
+Option<bool> FrameTracer("Debug.FrameTracer");
 
 // Network
 
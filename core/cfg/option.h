@@ -350,6 +350,7 @@ using OptionString = Option<std::string>;
 // Dynarec
 
 extern Option<bool> DynarecEnabled;
+extern Option<bool> CachedInterpreter;
 #ifndef LIBRETRO
 extern Option<int> Sh4Clock;
 #endif
@@ -364,6 +365,7 @@ extern Option<bool> AutoLoadState;
 extern Option<bool> AutoSaveState;
 extern Option<int, false> SavestateSlot;
 extern Option<bool> ForceFreePlay;
+extern Option<int> RunAhead;		// number of frames emulated ahead. 0: disabled
 extern Option<bool, false> FetchBoxart;
 extern Option<bool, false> BoxartDisplayMode;
 extern Option<int, false> UIScaling;
@@ -374,6 +376,7 @@ constexpr bool LimitFPS = true;
 extern Option<bool> DSPEnabled;
 extern Option<int> AudioBufferSize;	//In samples ,*4 for bytes
 extern Option<bool> AutoLatency;
+extern Option<bool> AudioRateControl;
 
 extern OptionString AudioBackend;
 
@@ -464,6 +467,8 @@ extern Option<int64_t> PixelBufferSize;
 extern Option<int> AnisotropicFiltering;
 extern Option<int> TextureFiltering; // 0: default, 1: force nearest, 2: force linear
 extern Option<bool> ThreadedRendering;
+extern Option<bool> FramePacing;
+extern Option<bool> LateLatchInput;	// Poll input right before emulating a frame. Requires FramePacing
 extern Option<bool> DupeFrames;
 extern Option<bool> NativeDepthInterpolation;
 extern Option<bool> EmulateFramebuffer;
@@ -496,12 +501,14 @@ extern Option<bool, false> DiscordPresence;
 extern Option<bool, false> UseSafFilePicker;
 #endif
 extern OptionString LogServer;
+extern Option<bool, false> LogAsync;
 
 // Profiling
 extern Option<bool> ProfilerEnabled;
 extern Option<bool> ProfilerDrawToGUI;
 extern Option<bool> ProfilerOutputTTY;
 extern Option<float> ProfilerFrameWarningTime;
+extern Option<bool> FrameTracer;
 
 // Network
 
@@ -33,14 +33,17 @@
 #include "audio/audiostream.h"
 #include "debug/gdb_server.h"
 #include "hw/pvr/Renderer_if.h"
+#include "hw/pvr/frame_pacer.h"
 #include "hw/arm7/arm7_rec.h"
 #include "network/ggpo.h"
+#include "runahead.h"
 #include "hw/mem/mem_watch.h"
 #include "network/net_handshake.h"
 #include "network/naomi_network.h"
 #include "serialize.h"
 #include "hw/pvr/pvr.h"
 #include "profiler/fc_profiler.h"
+#include "oslib/oslib.h"
 #include "oslib/storage.h"
 #include "wsi/context.h"
 #include <chrono>
@@ -503,9 +506,14 @@ void Emulator::init()
 		INFO_LOG(DYNAREC, "Using Recompiler");
 	else
 #endif
+	if (config::CachedInterpreter)
+		INFO_LOG(INTERPRETER, "Using Cached Interpreter");
+	else
 		INFO_LOG(INTERPRETER, "Using Interpreter");
 	interpreter = Get_Sh4Interpreter();
 	interpreter->Init();
+	cachedInterpreter = Get_Sh4CachedInterpreter();
+	cachedInterpreter->Init();
 	state = Init;
 }
 
@@ -515,6 +523,12 @@ Sh4Executor *Emulator::getSh4Executor()
 	if(config::DynarecEnabled)
 		return recompiler;
 	else
+#endif
+#ifndef STRICT_MODE
+	// the cached interpreter doesn't emulate the instruction cache
+	if (config::CachedInterpreter)
+		return cachedInterpreter;
+	else
 #endif
 		return interpreter;
 }
@@ -758,6 +772,12 @@ void Emulator::term()
 			delete interpreter;
 			interpreter = nullptr;
 		}
+		if (cachedInterpreter != nullptr)
+		{
+			cachedInterpreter->Term();
+			delete cachedInterpreter;
+			cachedInterpreter = nullptr;
+		}
 		if (recompiler != nullptr)
 		{
 			recompiler->Term();
@@ -765,6 +785,7 @@ void Emulator::term()
 			recompiler = nullptr;
 		}
 		custom_texture.Terminate();	// lr: avoid deadlock on exit (win32)
+		texture_upscaler.Terminate();
 		reios_term();
 		aica::term();
 		pvr::term();
@@ -871,6 +892,7 @@ void Emulator::stepRange(u32 from, u32 to)
 void Emulator::loadstate(Deserializer& deser)
 {
 	custom_texture.Terminate();
+	texture_upscaler.Terminate();
 #if FEAT_AREC == DYNAREC_JIT
 	aica::arm::recompiler::flush();
 #endif
@@ -927,6 +949,17 @@ void EventManager::broadcastEvent(Event event)
 		pair.first(event, pair.second);
 }
 
+// Emulate until the next vblank. Only used with run-ahead.
+// Returns false if interrupted before the vblank.
+bool Emulator::emulateFrame()
+{
+	if (!restartCpu())
+		return false;
+	frameEnded = false;
+	runInternal();
+	return frameEnded;
+}
+
 void Emulator::run()
 {
 	verify(state == Running);
@@ -935,9 +968,23 @@ void Emulator::run()
 	if (!singleStep && stepRangeTo == 0)
 		getSh4Executor()->Start();
 	try {
-		runInternal();
-		if (ggpo::active())
-			ggpo::nextFrame();
+		if (runahead::active() && !singleStep && stepRangeTo == 0)
+		{
+			// A present stops the last frame ahead. Give up after 3 frames like vblank() does.
+			renderTimeout = true;
+			for (int i = 0; i < 3 && state == Running; i++)
+				if (!runahead::runFrame([this]() { return emulateFrame(); }))
+				{
+					renderTimeout = false;
+					break;
+				}
+		}
+		else
+		{
+			runInternal();
+			if (ggpo::active())
+				ggpo::nextFrame();
+		}
 	} catch (...) {
 		setNetworkState(false);
 		state = Error;
@@ -954,11 +1001,13 @@ void Emulator::start()
 	verify(state == Loaded);
 	state = Running;
 	SetMemoryHandlers();
+	framePacer.reset();
 	if (config::GGPOEnable && config::ThreadedRendering)
 		// Not supported with GGPO
 		config::EmulateFramebuffer.override(false);
 	setupPtyPipe();
 
+	runahead::init();
 	memwatch::protect();
 
 	if (config::ThreadedRendering)
@@ -974,6 +1023,11 @@ void Emulator::start()
 					{
 						startTime = sh4_sched_now64();
 						renderTimeout = false;
+						if (runahead::active() && !singleStep && stepRangeTo == 0)
+						{
+							runahead::runFrame([this]() { return emulateFrame(); });
+							continue;
+						}
 						runInternal();
 						if (!ggpo::nextFrame())
 							break;
@@ -1051,7 +1105,20 @@ bool Emulator::render()
 
 void Emulator::vblank()
 {
+	if (config::FramePacing && !settings.input.fastForwardMode && !ggpo::active()
+			&& !runahead::runningAhead()
+			&& framePacer.vblank(config::VSync)
+			&& config::LateLatchInput && !config::ThreadedRendering)
+		// Poll input as late as possible before emulating the next frame
+		os_UpdateInputState();
 	EventManager::event(Event::VBlank);
+	if (runahead::active())
+	{
+		// Run-ahead emulates one frame at a time
+		frameEnded = true;
+		getSh4Executor()->Stop();
+		return;
+	}
 	// Time out if a frame hasn't been rendered for 50 ms
 	if (sh4_sched_now64() - startTime <= 10000000)
 		return;
@@ -190,6 +190,7 @@ public:
 private:
 	bool checkStatus(bool wait = false);
 	void runInternal();
+	bool emulateFrame();
 	void diskChange();
 
 	enum State {
@@ -206,11 +207,13 @@ private:
 	bool singleStep = false;
 	u64 startTime = 0;
 	bool renderTimeout = false;
+	bool frameEnded = false;
 	u32 stepRangeFrom = 0;
 	u32 stepRangeTo = 0;
 	bool stopRequested = false;
 	std::mutex mutex;
 	Sh4Executor *interpreter = nullptr;
+	Sh4Executor *cachedInterpreter = nullptr;
 	Sh4Executor *recompiler = nullptr;
 };
 extern Emulator emu;
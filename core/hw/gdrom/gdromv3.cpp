@@ -28,6 +28,7 @@ static packet_cmd_t packet_cmd;
 static DmaBuffer dma_buff;
 static PioBuffer pio_buff;
 static u8 ata_command;
+static u32 readWaits;
 cdda_t cdda;
 
 static gd_states gd_state;
@@ -265,8 +266,8 @@ static void gd_set_state(gd_states state)
 			break;
 			
 		case gds_readsector_dma:
+			// The buffer is filled by the DMA once the sectors are available
 			dma_buff.clear();
- 			dma_buff.fill(read_params);
 			break;
 
 		case gds_pio_end:
@@ -762,6 +763,8 @@ static void gd_process_spi_cmd()
 			else
 				read_params.remaining_sectors = (readcmd.b[6] << 8) | readcmd.b[7];
 			read_params.sector_type = sector_type;//yeah i know , not really many types supported...
+			// Start reading the requested sectors in the background
+			libGDR_PrefetchSectors(read_params.start_sector, read_params.remaining_sectors, read_params.sector_type);
 
 			printf_spicmd("SPI_CD_READ - Sector=%d Size=%d/%d DMA=%d",read_params.start_sector,read_params.remaining_sectors,read_params.sector_type,Features.CDRead.DMA);
 			if (Features.CDRead.DMA == 1) {
@@ -1224,6 +1227,24 @@ static int getGDROMTicks()
 		return 0;
 }
 
+// Returns false if the next sectors to transfer aren't read from the host yet.
+// The DMA then stays busy and is retried later instead of blocking the emulation thread.
+// After MaxReadWaits attempts, the sectors are read synchronously.
+static bool sectorsReady(u32 count)
+{
+	constexpr u32 MaxReadWaits = 200;
+	// Netplay and run-ahead need deterministic transfer times
+	if (config::GGPOEnable || config::RunAhead != 0)
+		return true;
+	if (libGDR_SectorsReady(read_params.start_sector, count, read_params.sector_type)
+			|| ++readWaits > MaxReadWaits)
+	{
+		readWaits = 0;
+		return true;
+	}
+	return false;
+}
+
 //is this needed ?
 static int GDRomschd(int tag, int cycles, int jitter, void *arg)
 {
@@ -1267,11 +1288,33 @@ static int GDRomschd(int tag, int cycles, int jitter, void *arg)
 		INFO_LOG(GDROM, "GDROM: Len: %X, Abnormal Termination !", len);
 	}
 
+	if (1 == SB_GDDIR && dma_buff.isEmpty() && read_params.remaining_sectors > 0
+			&& !sectorsReady(std::min(len / read_params.sector_type + 1, read_params.remaining_sectors)))
+		// Drive busy: try again in 100 us
+		return SH4_MAIN_CLOCK / 10000;
+
 	u32 len_backup = len;
 	if(1 == SB_GDDIR) 
 	{
 		while (len)
 		{
+			if (dma_buff.isEmpty() && read_params.remaining_sectors > 0 && len >= read_params.sector_type)
+			{
+				// Read whole sectors straight into system RAM when possible
+				const u32 count = std::min(len / read_params.sector_type, read_params.remaining_sectors);
+				const u32 size = count * read_params.sector_type;
+				u8 *dst = GetRamDmaPtr(src, size);
+				if (dst != nullptr)
+				{
+					libGDR_ReadSector(dst, read_params.start_sector, count, read_params.sector_type);
+					ReleaseRamDmaPtr(src, size);
+					read_params.start_sector += count;
+					read_params.remaining_sectors -= count;
+					src += size;
+					len -= size;
+					continue;
+				}
+			}
 			dma_buff.fill(read_params);
 			// transfer up to len bytes
 			const u32 buff_size = std::min(dma_buff.getSize(), len);
@@ -1384,6 +1427,7 @@ void gdrom_reg_Reset(bool hard)
 	dma_buff.clear();
 	pio_buff.clear();
 	ata_command = 0;
+	readWaits = 0;
 	cdda = {};
 	gd_disk_type = NoDisk;
 
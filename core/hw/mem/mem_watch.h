@@ -25,6 +25,7 @@
 #include "hw/pvr/pvr_mem.h"
 #include "hw/pvr/elan.h"
 #include "rend/TexCache.h"
+#include "runahead.h"
 #include <unordered_map>
 
 namespace memwatch
@@ -45,6 +46,17 @@ class Watcher
 	bool started;
 	PageMap pages;
 
+	void savePage(u32 offset)
+	{
+	    auto rv = pages.emplace(offset, Page());
+	    if (!rv.second)
+	      // already saved
+	      return;
+	    Page& page = rv.first->second;
+	    memcpy(&page.data[0], static_cast<T&>(*this).getMemPage(offset), PAGE_SIZE);
+		static_cast<T&>(*this).unprotectMem(offset, PAGE_SIZE);
+	}
+
 public:
 	void protect()
 	{
@@ -76,22 +88,45 @@ public:
 		u32 offset = static_cast<T&>(*this).getMemOffset(addr);
 		if (offset == (u32)-1)
 			return false;
-		offset &= ~PAGE_MASK;
-	    auto rv = pages.emplace(offset, Page());
-	    if (!rv.second)
-	      // already saved
-	      return true;
-	    Page& page = rv.first->second;
-	    memcpy(&page.data[0], static_cast<T&>(*this).getMemPage(offset), PAGE_SIZE);
-		static_cast<T&>(*this).unprotectMem(offset, PAGE_SIZE);
+		savePage(offset & ~PAGE_MASK);
 		return true;
 	}
 
+	// Save and unprotect the pages in [offset, offset + size) before the host writes to them directly
+	void hit(u32 offset, u32 size)
+	{
+		for (u32 page = offset & ~PAGE_MASK; page < offset + size; page += PAGE_SIZE)
+			savePage(page);
+	}
+
 	void getPages(PageMap& other)
 	{
 		std::swap(pages, other);
 		pages = PageMap();
 	}
+
+	// Protect the pages written since the last call and forget their content
+	void checkpoint()
+	{
+		protect();
+		pages.clear();
+	}
+
+	// Copy the saved pages back and protect them again. Returns the number of pages restored.
+	size_t restore()
+	{
+		PageMap saved;
+		std::swap(pages, saved);
+		// Pages locked again since they were saved (code, textures) are hit here,
+		// which invalidates what depends on them
+		for (const auto& pair : saved)
+			memcpy(static_cast<T&>(*this).getMemPage(pair.first), &pair.second.data[0], PAGE_SIZE);
+		std::swap(pages, saved);
+		protect();
+		const size_t count = pages.size();
+		pages.clear();
+		return count;
+	}
 };
 
 class VramWatcher : public Watcher<VramWatcher>
@@ -185,9 +220,14 @@ extern RamWatcher ramWatcher;
 extern AicaRamWatcher aramWatcher;
 extern ElanRamWatcher elanWatcher;
 
+// Dirty page tracking is used by GGPO rollbacks and run-ahead
+inline static bool enabled() {
+	return config::GGPOEnable || runahead::active();
+}
+
 inline static bool writeAccess(void *p)
 {
-	if (!config::GGPOEnable)
+	if (!enabled())
 		return false;
 	if (ramWatcher.hit(p))
 	{
@@ -206,7 +246,7 @@ inline static bool writeAccess(void *p)
 
 inline static void protect()
 {
-	if (!config::GGPOEnable)
+	if (!enabled())
 		return;
 	vramWatcher.protect();
 	ramWatcher.protect();
@@ -230,4 +270,20 @@ inline static void reset()
 	elanWatcher.reset();
 }
 
+inline static void checkpoint()
+{
+	vramWatcher.checkpoint();
+	ramWatcher.checkpoint();
+	aramWatcher.checkpoint();
+	elanWatcher.checkpoint();
+}
+
+inline static size_t restore()
+{
+	return vramWatcher.restore()
+			+ ramWatcher.restore()
+			+ aramWatcher.restore()
+			+ elanWatcher.restore();
+}
+
 }
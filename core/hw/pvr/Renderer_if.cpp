@@ -1,5 +1,6 @@
 #include "Renderer_if.h"
 #include "spg.h"
+#include "ta_capture.h"
 #include "rend/texconv.h"
 #include "rend/transform_matrix.h"
 #include "cfg/option.h"
@@ -9,6 +10,7 @@
 #include "hw/sh4/sh4_if.h"
 #include "hw/sh4/sh4_core.h"
 #include "profiler/fc_profiler.h"
+#include "profiler/frame_tracer.h"
 #include "network/ggpo.h"
 
 #include <mutex>
@@ -193,8 +195,10 @@ private:
 #endif
 		{
 			FC_PROFILE_SCOPE_NAMED("Renderer::Process");
+			TRACE_SCOPE("Renderer::Process");
 			renderer->Process(_pvrrc);
 		}
+		tacapture::frameProcessed(_pvrrc);
 
 		if (renderToScreen)
 			// If rendering to texture or in full framebuffer emulation, continue locking until the frame is rendered
@@ -202,6 +206,7 @@ private:
 		rend_allow_rollback();
 		{
 			FC_PROFILE_SCOPE_NAMED("Renderer::Render");
+			TRACE_SCOPE("Renderer::Render");
 			renderer->Render();
 		}
 
@@ -230,6 +235,7 @@ private:
 	void present()
 	{
 		FC_PROFILE_SCOPE;
+		TRACE_SCOPE("Present");
 
 		if (renderer->Present())
 		{
@@ -270,11 +276,12 @@ Renderer* rend_OITVulkan();
 Renderer* rend_DirectX9();
 Renderer* rend_DirectX11();
 Renderer* rend_OITDirectX11();
+Renderer* rend_TileRenderer();
 
 static void rend_create_renderer()
 {
 #ifdef NO_REND
-	renderer	 = rend_norend();
+	renderer = rend_TileRenderer();
 #else
 	switch (config::RendererType)
 	{
@@ -414,6 +421,7 @@ void rend_start_render()
 		ggpo::endOfFrame();
 	}
 
+	tacapture::frameStart(ctx);
 	if (QueueRender(ctx))
 	{
 		palette_update();
@@ -422,6 +430,9 @@ void rend_start_render()
 		if (!config::DelayFrameSwapping && !ctx->rend.isRTT && !config::EmulateFramebuffer)
 			pvrQueue.enqueue(PvrMessageQueue::Present);
 	}
+	else
+		// the context has been recycled
+		tacapture::frameSkipped(ctx);
 }
 
 int rend_end_render(int tag, int cycles, int jitter, void *arg)
@@ -439,7 +450,10 @@ int rend_end_render(int tag, int cycles, int jitter, void *arg)
 		asic_RaiseInterrupt(holly_RENDER_DONE_vd);
 	}
 	if (pend_rend && config::ThreadedRendering)
+	{
+		TRACE_SCOPE("Wait render end");
 		renderEnd.Wait();
+	}
 
 	return 0;
 }
@@ -462,6 +476,7 @@ void rend_vblank()
 	}
 	render_called = false;
 	check_framebuffer_write();
+	tracer::frameMark();
 	emu.vblank();
 }
 
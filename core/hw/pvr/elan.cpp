@@ -60,8 +60,11 @@
 #include "hw/sh4/sh4_sched.h"
 #include "serialize.h"
 #include "elan_struct.h"
+#include "elan_batch.h"
+#include "elan_capture.h"
 #include "network/ggpo.h"
 #include "cfg/option.h"
+#include "oslib/oslib.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -85,6 +88,13 @@ static u32 elanCmd[32 / 4];
 
 static int schedId = -1;
 
+// Elan frame capture
+static struct {
+	enum { Off, Armed, Recording } status = Off;
+	std::string path;
+	capture::Frame frame;
+} recorder;
+
 static u32 DYNACALL read_elanreg(u32 paddr)
 {
 	u32 addr = paddr & 0x01ffffff;
@@ -580,21 +590,31 @@ static void SetEnvMapUV(Vertex& vtx)
 		vtx.u1 = state.envMapUOffset;
 		vtx.v1 = state.envMapVOffset;
 	}
+	else
+	{
+		vtx.u = 0.f;
+		vtx.v = 0.f;
+		vtx.u1 = 0.f;
+		vtx.v1 = 0.f;
+	}
 }
 
+// Positions, normals and near plane distances of the current vertex list
+static batch::Vertices vertexBatch;
+// Converted vertices of the current list
+static std::vector<Vertex> taVertices;
+
 template<typename T>
-static glm::vec3 getNormal(const T& vtx)
+static void unpackVertices(const T *vtx, u32 count)
 {
-	return { (int8_t)vtx.header.nx / 127.f, (int8_t)vtx.header.ny / 127.f, (int8_t)vtx.header.nz / 127.f };
+	batch::get().unpack((const u8 *)vtx, sizeof(T), count, vertexBatch);
 }
 
-template<typename T>
-static void setNormal(Vertex& vd, const T& vs)
+static void setNormal(Vertex& vd, u32 index)
 {
-	glm::vec3 normal = getNormal(vs);
-	vd.nx = normal.x;
-	vd.ny = normal.y;
-	vd.nz = normal.z;
+	vd.nx = vertexBatch.nx[index];
+	vd.ny = vertexBatch.ny[index];
+	vd.nz = vertexBatch.nz[index];
 }
 
 static void setModelColors(glm::vec4& baseCol0, glm::vec4& offsetCol0, glm::vec4& baseCol1, glm::vec4& offsetCol1)
@@ -611,91 +631,106 @@ static void setModelColors(glm::vec4& baseCol0, glm::vec4& offsetCol0, glm::vec4
 		offsetCol1 = gmpSpecularColor1;
 }
 
-template <typename T>
-static void convertVertex(const T& vs, Vertex& vd);
-
-template<>
-void convertVertex(const N2_VERTEX& vs, Vertex& vd)
+// Packed colors of the current list
+static struct {
+	u32 col;
+	u32 spc;
+	u32 col1;
+	u32 spc1;
+	// base colors are taken from the vertex if present
+	bool vertexCol0;
+	bool vertexCol1;
+} listColors;
+
+static void setListColors()
 {
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	SetEnvMapUV(vd);
 	glm::vec4 baseCol0(1);
 	glm::vec4 offsetCol0(0);
 	glm::vec4 baseCol1(1);
 	glm::vec4 offsetCol1(0);
 	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
+	listColors.col = packColor(baseCol0);
+	listColors.spc = packColor(offsetCol0);
+	listColors.col1 = packColor(baseCol1);
+	listColors.spc1 = packColor(offsetCol1);
+	listColors.vertexCol0 = curGmp == nullptr || !curGmp->paramSelect.d0;
+	listColors.vertexCol1 = curGmp == nullptr || !curGmp->paramSelect.d1;
+}
 
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+// Same as packColor(unpackColor(argb)): the float round trip is exact for 8-bit channels
+static u32 vertexColor(u32 argb)
+{
+	if (packColor == packColorBGRA)
+		return argb;
+	else
+		return (argb & 0xff00ff00) | ((argb >> 16) & 0xff) | ((argb & 0xff) << 16);
 }
 
+static void setColors(Vertex& vd)
+{
+	*(u32 *)vd.col = listColors.col;
+	*(u32 *)vd.spc = listColors.spc;
+	*(u32 *)vd.col1 = listColors.col1;
+	*(u32 *)vd.spc1 = listColors.spc1;
+}
+
+static void setColors(Vertex& vd, const PackedRGB& rgb)
+{
+	*(u32 *)vd.col = listColors.vertexCol0 ? vertexColor(rgb.argb0) : listColors.col;
+	*(u32 *)vd.spc = listColors.spc;
+	*(u32 *)vd.col1 = listColors.vertexCol1 ? vertexColor(rgb.argb1) : listColors.col1;
+	*(u32 *)vd.spc1 = listColors.spc1;
+}
+
+// Convert the vertex at the given index of the current list.
+// setListColors() must be called first.
+template <typename T>
+static void convertVertex(const T& vs, u32 index, Vertex& vd);
+
 template<>
-void convertVertex(const N2_VERTEX_VR& vs, Vertex& vd)
+void convertVertex(const N2_VERTEX& vs, u32 index, Vertex& vd)
 {
 	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
+	setNormal(vd, index);
 	SetEnvMapUV(vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	setColors(vd);
+}
+
+template<>
+void convertVertex(const N2_VERTEX_VR& vs, u32 index, Vertex& vd)
+{
+	setCoords(vd, vs.x, vs.y, vs.z);
+	setNormal(vd, index);
+	SetEnvMapUV(vd);
+	setColors(vd, vs.rgb);
 }
 
 template<>
-void convertVertex(const N2_VERTEX_VU& vs, Vertex& vd)
+void convertVertex(const N2_VERTEX_VU& vs, u32 index, Vertex& vd)
 {
 	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
+	setNormal(vd, index);
 	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	setColors(vd);
 }
 
 template<>
-void convertVertex(const N2_VERTEX_VUR& vs, Vertex& vd)
+void convertVertex(const N2_VERTEX_VUR& vs, u32 index, Vertex& vd)
 {
 	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
+	setNormal(vd, index);
 	setUV(vs, vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	setColors(vd, vs.rgb);
 }
 
 template<>
-void convertVertex(const N2_VERTEX_VUB& vs, Vertex& vd)
+void convertVertex(const N2_VERTEX_VUB& vs, u32 index, Vertex& vd)
 {
 	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
+	setNormal(vd, index);
 	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
+	*(u32 *)vd.col = listColors.col;
+	*(u32 *)vd.col1 = listColors.col1;
 	// Stuff the bump map normals and parameters in the specular colors
 	vd.spc[0] = vs.bump.tangent.x;
 	vd.spc[1] = vs.bump.tangent.y;
@@ -717,17 +752,11 @@ void convertVertex(const N2_VERTEX_VUB& vs, Vertex& vd)
 //			);
 }
 
-template <typename T>
-static void boundingBox(const T* vertices, u32 count, glm::vec3& min, glm::vec3& max)
+// Bounding box of the current list, in view space
+static void boundingBox(glm::vec3& min, glm::vec3& max)
 {
-	min = { 1e38f, 1e38f, 1e38f };
-	max = { -1e38f, -1e38f, -1e38f };
-	for (u32 i = 0; i < count; i++)
-	{
-		glm::vec3 pos{ vertices[i].x, vertices[i].y, vertices[i].z };
-		min = glm::min(min, pos);
-		max = glm::max(max, pos);
-	}
+	min = glm::make_vec3(vertexBatch.min);
+	max = glm::make_vec3(vertexBatch.max);
 	glm::vec4 center((min + max) / 2.f, 1);
 	glm::vec4 extents(max - glm::vec3(center), 0);
 	// transform
@@ -742,12 +771,11 @@ static void boundingBox(const T* vertices, u32 count, glm::vec3& min, glm::vec3&
 	max = glm::vec3(center) + newExtent;
 }
 
-template <typename T>
-static bool isBetweenNearAndFar(const T* vertices, u32 count, bool& needNearClipping)
+static bool isBetweenNearAndFar(bool& needNearClipping)
 {
 	glm::vec3 min;
 	glm::vec3 max;
-	boundingBox(vertices, count, min, max);
+	boundingBox(min, max);
 	if (min.z > -nearPlane || max.z < -farPlane)
 		return false;
 
@@ -761,23 +789,32 @@ static bool isBetweenNearAndFar(const T* vertices, u32 count, bool& needNearClip
 	return true;
 }
 
+// Coefficients of the view space z of a vertex: the near plane distance is -z - nearPlane
+static void nearPlaneEquation(float plane[4])
+{
+	plane[0] = curMatrix[0][2];
+	plane[1] = curMatrix[1][2];
+	plane[2] = curMatrix[2][2];
+	plane[3] = curMatrix[3][2];
+}
+
 class TriangleStripClipper
 {
 public:
-	TriangleStripClipper(bool enabled) : enabled(enabled) {}
+	// distances is null if clipping isn't needed
+	TriangleStripClipper(const Vertex *vertices, const float *distances)
+		: vertices(vertices), distances(distances) {}
 
-	void add(const Vertex& vtx)
+	void add(u32 index)
 	{
-		if (enabled)
+		if (distances != nullptr)
 		{
-			float z = vtx.x * curMatrix[0][2] + vtx.y * curMatrix[1][2] + vtx.z * curMatrix[2][2] + curMatrix[3][2];
-			float dist = -z - nearPlane;
-			clip(vtx, dist);
+			clip(vertices[index], distances[index]);
 			count++;
 		}
 		else
 		{
-			ta_add_vertex(vtx);
+			ta_add_vertex(vertices[index]);
 		}
 	}
 
@@ -800,16 +837,16 @@ private:
 		{
 			switch (clipCode >> 1) {
 			case 0: // Q and R inside
-				sendVertex(q);
+				sendVertex(*q);
 				sendVertex(r);
 				break;
 			case 1: // Q outside, R inside
-				sendVertex(interpolate(q, qDist, r, rDist));
+				sendVertex(interpolate(*q, qDist, r, rDist));
 				sendVertex(r);
 				break;
 			case 2: // Q inside, R outside
-				sendVertex(q);
-				sendVertex(interpolate(q, qDist, r, rDist));
+				sendVertex(*q);
+				sendVertex(interpolate(*q, qDist, r, rDist));
 				break;
 			case 3: // Q and R outside
 				break;
@@ -823,36 +860,36 @@ private:
 				sendVertex(r);
 				break;
 			case 1: // P outside, Q and R inside
-				sendVertex(interpolate(r, rDist, p, pDist));
-				sendVertex(q);
+				sendVertex(interpolate(r, rDist, *p, pDist));
+				sendVertex(*q);
 				sendVertex(r);
 				break;
 			case 2: // P inside, Q outside and R inside
 				sendVertex(r);
-				sendVertex(interpolate(q, qDist, r, rDist));
+				sendVertex(interpolate(*q, qDist, r, rDist));
 				sendVertex(r);
 				break;
 			case 3: // P and Q outside, R inside
 				{
-					Vertex tmp = interpolate(r, rDist, p, pDist);
+					Vertex tmp = interpolate(r, rDist, *p, pDist);
 					sendVertex(tmp);
 					sendVertex(tmp);
 					sendVertex(tmp); // One more to preserve strip swap order
-					sendVertex(interpolate(q, qDist, r, rDist));
+					sendVertex(interpolate(*q, qDist, r, rDist));
 					sendVertex(r);
 				}
 				break;
 			case 4: // P and Q inside, R outside
-				sendVertex(interpolate(r, rDist, p, pDist));
-				sendVertex(q);
-				sendVertex(interpolate(q, qDist, r, rDist));
+				sendVertex(interpolate(r, rDist, *p, pDist));
+				sendVertex(*q);
+				sendVertex(interpolate(*q, qDist, r, rDist));
 				break;
 			case 5: // P outside, Q inside, R outside
-				sendVertex(interpolate(q, qDist, r, rDist));
+				sendVertex(interpolate(*q, qDist, r, rDist));
 				break;
 			case 6: // P inside, Q and R outside
 				{
-					Vertex tmp = interpolate(r, rDist, p, pDist);
+					Vertex tmp = interpolate(r, rDist, *p, pDist);
 					sendVertex(tmp);
 					sendVertex(tmp);
 					sendVertex(tmp); // One more to preserve strip swap order
@@ -865,7 +902,7 @@ private:
 		}
 		p = q;
 		pDist = qDist;
-		q = r;
+		q = &r;
 		qDist = rDist;
 	}
 
@@ -897,12 +934,13 @@ private:
 		return v;
 	}
 
-	bool enabled;
+	const Vertex *vertices;
+	const float *distances;
 	int count = 0;
 	int clipCode = 0;
-	Vertex p;
+	const Vertex *p = nullptr;
 	float pDist = 0;
-	Vertex q;
+	const Vertex *q = nullptr;
 	float qDist = 0;
 	bool dupeNext = false;
 };
@@ -910,39 +948,57 @@ private:
 template <typename T>
 static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 {
-	Vertex taVtx;
 	verify(list->vertexSize() > 0);
+	const u32 count = list->vtxCount;
+
+	setListColors();
+	if (taVertices.size() < count)
+		taVertices.resize(count);
+	for (u32 i = 0; i < count; i++)
+		convertVertex(vtx[i], i, taVertices[i]);
+
+	const float *distances = nullptr;
+	if (needClipping)
+	{
+		float plane[4];
+		nearPlaneEquation(plane);
+		batch::ClipTest clipTest = batch::get().nearDistances(vertexBatch, plane, nearPlane);
+		if (clipTest.allOutside)
+			// fully clipped
+			return;
+		// a lone vertex isn't sent by the clipper
+		if (clipTest.anyOutside || count == 1)
+			distances = vertexBatch.dist.data();
+	}
 
-	Vertex fanCenterVtx{};
-	Vertex fanLastVtx{};
+	u32 fanCenterVtx = 0;
+	u32 fanLastVtx = 0;
 	bool stripStart = true;
 	int outStripIndex = 0;
-	TriangleStripClipper clipper(needClipping);
+	TriangleStripClipper clipper(taVertices.data(), distances);
 
-	for (u32 i = 0; i < list->vtxCount; i++)
+	for (u32 i = 0; i < count; i++)
 	{
-		convertVertex(*vtx, taVtx);
-
 		if (stripStart)
 		{
 			// Center vertex if triangle fan
 			//verify(vtx->header.isFirstOrSecond()); This fails for some strips: strip=1 fan=0 (soul surfer)
-			fanCenterVtx = taVtx;
+			fanCenterVtx = i;
 			if (outStripIndex > 0)
 			{
 				// use degenerate triangles to link strips
 				clipper.add(fanLastVtx);
-				clipper.add(taVtx);
+				clipper.add(i);
 				outStripIndex += 2;
 				if (outStripIndex & 1)
 				{
-					clipper.add(taVtx);
+					clipper.add(i);
 					outStripIndex++;
 				}
 			}
 			stripStart = false;
 		}
-		else if (vtx->header.isFan())
+		else if (vtx[i].header.isFan())
 		{
 			// use degenerate triangles to link strips
 			clipper.add(fanLastVtx);
@@ -958,31 +1014,26 @@ static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 			clipper.add(fanLastVtx);
 			outStripIndex += 2;
 		}
-		clipper.add(taVtx);
+		clipper.add(i);
 		outStripIndex++;
-		fanLastVtx = taVtx;
-		if (vtx->header.endOfStrip)
+		fanLastVtx = i;
+		if (vtx[i].header.endOfStrip)
 			stripStart = true;
-
-		vtx++;
 	}
 }
 
 class ModifierVolumeClipper
 {
 public:
-	ModifierVolumeClipper(bool enabled) : enabled(enabled) {}
+	// distances is null if clipping isn't needed
+	ModifierVolumeClipper(const float *distances) : distances(distances) {}
 
-	void add(ModTriangle& tri)
+	// i0, i1 and i2 are the indices of the triangle vertices in the list
+	void add(ModTriangle& tri, u32 i0, u32 i1, u32 i2)
 	{
-		if (enabled)
+		if (distances != nullptr)
 		{
-			glm::vec3 dist{
-				tri.x0 * curMatrix[0][2] + tri.y0 * curMatrix[1][2] + tri.z0 * curMatrix[2][2] + curMatrix[3][2],
-				tri.x1 * curMatrix[0][2] + tri.y1 * curMatrix[1][2] + tri.z1 * curMatrix[2][2] + curMatrix[3][2],
-				tri.x2 * curMatrix[0][2] + tri.y2 * curMatrix[1][2] + tri.z2 * curMatrix[2][2] + curMatrix[3][2]
-			};
-			dist = -dist - nearPlane;
+			glm::vec3 dist(distances[i0], distances[i1], distances[i2]);
 			ModTriangle newTri[2];
 			int n = sutherlandHodgmanClip(dist, tri, newTri);
 			switch (n)
@@ -1091,7 +1142,7 @@ private:
 		return 5;
 	}
 
-	bool enabled;
+	const float *distances;
 };
 
 template <typename T>
@@ -1107,50 +1158,46 @@ static void sendMVPolygon(ICHList *list, const T *vtx, bool needClipping)
 	mvp.projMatrix = state.getProjectionMatrixIndex();
 	ta_add_poly(list->pcw.listType, mvp);
 
-	ModifierVolumeClipper clipper(needClipping);
-	glm::vec3 vtx0{};
-	glm::vec3 vtx1{};
+	const float *distances = nullptr;
+	if (needClipping)
+	{
+		float plane[4];
+		nearPlaneEquation(plane);
+		batch::ClipTest clipTest = batch::get().nearDistances(vertexBatch, plane, nearPlane);
+		// Triangles entirely on one side are left alone
+		if (clipTest.anyInside && !clipTest.allInside)
+			distances = vertexBatch.dist.data();
+	}
+	ModifierVolumeClipper clipper(distances);
 	u32 stripStart = 0;
 
 	for (u32 i = 0; i < list->vtxCount; i++)
 	{
-		glm::vec3 v(vtx->x, vtx->y, vtx->z);
 		u32 triIdx = i - stripStart;
 		if (triIdx >= 2)
 		{
 			ModTriangle tri;
-
+			// previous vertices
+			u32 i0 = i - 2;
+			u32 i1 = i - 1;
 			if (triIdx & 1)
-			{
-				tri.x1 = vtx0.x;
-				tri.y1 = vtx0.y;
-				tri.z1 = vtx0.z;
+				std::swap(i0, i1);
+			tri.x0 = vtx[i0].x;
+			tri.y0 = vtx[i0].y;
+			tri.z0 = vtx[i0].z;
 
-				tri.x0 = vtx1.x;
-				tri.y0 = vtx1.y;
-				tri.z0 = vtx1.z;
-			}
-			else
-			{
-				tri.x0 = vtx0.x;
-				tri.y0 = vtx0.y;
-				tri.z0 = vtx0.z;
+			tri.x1 = vtx[i1].x;
+			tri.y1 = vtx[i1].y;
+			tri.z1 = vtx[i1].z;
 
-				tri.x1 = vtx1.x;
-				tri.y1 = vtx1.y;
-				tri.z1 = vtx1.z;
-			}
-			tri.x2 = v.x;
-			tri.y2 = v.y;
-			tri.z2 = v.z;
+			tri.x2 = vtx[i].x;
+			tri.y2 = vtx[i].y;
+			tri.z2 = vtx[i].z;
 
-			clipper.add(tri);
+			clipper.add(tri, i0, i1, i);
 		}
-		if (vtx->header.endOfStrip)
+		if (vtx[i].header.endOfStrip)
 			stripStart = i + 1;
-		vtx0 = vtx1;
-		vtx1 = v;
-		vtx++;
 	}
 }
 
@@ -1320,6 +1367,7 @@ static void sendPolygon(ICHList *list)
 	case ICHList::VTX_TYPE_V:
 		{
 			N2_VERTEX *vtx = (N2_VERTEX *)((u8 *)list + sizeof(ICHList));
+			unpackVertices(vtx, list->vtxCount);
 			int listType = ta_get_list_type();
 			if (listType == -1)
 				listType = list->pcw.listType;
@@ -1327,7 +1375,7 @@ static void sendPolygon(ICHList *list)
 				sendMVPolygon(list, vtx, true);
 			else
 			{
-				if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+				if (!isBetweenNearAndFar(needClipping))
 					break;
 				PolyParam pp{};
 				pp.pcw.Shadow = list->pcw.shadow;
@@ -1349,6 +1397,7 @@ static void sendPolygon(ICHList *list)
 	case ICHList::VTX_TYPE_VU:
 		{
 			N2_VERTEX_VU *vtx = (N2_VERTEX_VU *)((u8 *)list + sizeof(ICHList));
+			unpackVertices(vtx, list->vtxCount);
 			int listType = ta_get_list_type();
 			if (listType == -1)
 				listType = list->pcw.listType;
@@ -1356,7 +1405,7 @@ static void sendPolygon(ICHList *list)
 				sendMVPolygon(list, vtx, true);
 			else
 			{
-				if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+				if (!isBetweenNearAndFar(needClipping))
 					break;
 				PolyParam pp{};
 				pp.pcw.Shadow = list->pcw.shadow;
@@ -1380,7 +1429,8 @@ static void sendPolygon(ICHList *list)
 	case ICHList::VTX_TYPE_VUR:
 		{
 			N2_VERTEX_VUR *vtx = (N2_VERTEX_VUR *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			unpackVertices(vtx, list->vtxCount);
+			if (!isBetweenNearAndFar(needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1403,7 +1453,8 @@ static void sendPolygon(ICHList *list)
 	case ICHList::VTX_TYPE_VR:
 		{
 			N2_VERTEX_VR *vtx = (N2_VERTEX_VR *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			unpackVertices(vtx, list->vtxCount);
+			if (!isBetweenNearAndFar(needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1426,7 +1477,8 @@ static void sendPolygon(ICHList *list)
 			// TODO
 			//printf("BUMP MAP fmt %d filter %d src select %d dst %d\n", list->tcw0.PixelFmt, list->tsp0.FilterMode, list->tsp0.SrcSelect, list->tsp0.DstSelect);
 			N2_VERTEX_VUB *vtx = (N2_VERTEX_VUB *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			unpackVertices(vtx, list->vtxCount);
+			if (!isBetweenNearAndFar(needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1746,6 +1798,13 @@ static void DYNACALL write_elancmd(u32 addr, u32 data)
 
 	if (addr == 7)
 	{
+		if (recorder.status == recorder.Recording && !ggpo::rollbacking())
+		{
+			capture::Event& event = recorder.frame.events.emplace_back();
+			event.type = capture::Command;
+			event.reserved = 0;
+			memcpy(event.data, elanCmd, sizeof(elanCmd));
+		}
 		try {
 			if (!ggpo::rollbacking())
 				executeCommand<true>((u8 *)elanCmd, sizeof(elanCmd));
@@ -1818,6 +1877,114 @@ void vmem_map(u32 base)
 	addrspace::mapBlock(RAM, base | 0xA, base | 0xB, ELAN_RAM_MASK);
 }
 
+void startCapture(const std::string& path)
+{
+	recorder.path = path;
+	recorder.frame = {};
+	recorder.status = recorder.Armed;
+	NOTICE_LOG(PVR, "Elan capture armed: %s", path.c_str());
+}
+
+void listInit(bool continuation)
+{
+	switch (recorder.status)
+	{
+	case recorder.Off:
+		break;
+
+	case recorder.Armed:
+		if (continuation)
+			break;
+		recorder.frame.pvrRegs.assign(pvr_regs, pvr_regs + pvr_RegSize);
+		recorder.frame.ram.assign(RAM, RAM + ERAM_SIZE);
+		{
+			Serializer dryrun;
+			state.serialize(dryrun);
+			recorder.frame.state.resize(dryrun.size());
+			Serializer ser(recorder.frame.state.data(), recorder.frame.state.size());
+			state.serialize(ser);
+		}
+		recorder.status = recorder.Recording;
+		break;
+
+	case recorder.Recording:
+		if (continuation)
+		{
+			capture::Event& event = recorder.frame.events.emplace_back();
+			event = {};
+			event.type = capture::ListContinuation;
+		}
+		else
+		{
+			// The frame is complete
+			INFO_LOG(PVR, "Elan capture: %d events", (int)recorder.frame.events.size());
+			if (recorder.frame.save(recorder.path))
+				os_notify("Elan frame captured", 2000, recorder.path.c_str());
+			else
+				os_notify("Elan capture failed", 2000);
+			recorder.frame = {};
+			recorder.status = recorder.Off;
+		}
+		break;
+	}
+}
+
+TA_context *replay(const capture::Frame& frame)
+{
+	verify(frame.pvrRegs.size() == pvr_RegSize);
+	verify(frame.ram.size() == ERAM_SIZE_MAX);
+	// Run as a Naomi 2 with the captured registers and Elan RAM
+	const auto system = settings.platform.system;
+	u8 * const savedRam = RAM;
+	const u32 savedRamSize = ERAM_SIZE;
+	std::vector<u8> savedRegs(pvr_regs, pvr_regs + pvr_RegSize);
+	settings.platform.system = DC_PLATFORM_NAOMI2;
+	RAM = const_cast<u8 *>(frame.ram.data());
+	ERAM_SIZE = ERAM_SIZE_MAX;
+	memcpy(pvr_regs, frame.pvrRegs.data(), pvr_RegSize);
+
+	// Start with a new context
+	TA_context *ctx = tactx_Pop(TA_OL_BASE);
+	delete ctx;
+	ta_vtx_ListInit(false);
+	if (frame.state.empty())
+	{
+		state.reset();
+		state.resetProjectionMatrix();
+	}
+	else
+	{
+		Deserializer deser(frame.state.data(), frame.state.size());
+		state.deserialize(deser);
+	}
+
+	u32 cmd[8];
+	for (const capture::Event& event : frame.events)
+	{
+		if (event.type == capture::ListContinuation)
+		{
+			ta_vtx_ListInit(true);
+			continue;
+		}
+		memcpy(cmd, event.data, sizeof(cmd));
+		try {
+			executeCommand<true>((u8 *)cmd, sizeof(cmd));
+		} catch (const TAParserException& e) {
+		}
+	}
+	ctx = tactx_Pop(TA_OL_BASE);
+
+	// Nothing must point into the captured RAM
+	state.reset();
+	state.resetProjectionMatrix();
+	settings.platform.system = system;
+	RAM = savedRam;
+	ERAM_SIZE = savedRamSize;
+	memcpy(pvr_regs, savedRegs.data(), pvr_RegSize);
+
+	return ctx;
+}
+
 void serialize(Serializer& ser)
 {
 	if (!settings.platform.isNaomi2())
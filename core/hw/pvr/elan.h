@@ -18,9 +18,16 @@
  */
 #pragma once
 #include "types.h"
+#include <string>
+
+struct TA_context;
 
 namespace elan {
 
+namespace capture {
+struct Frame;
+}
+
 void init();
 void reset(bool hard);
 void term();
@@ -31,6 +38,14 @@ void vmem_map(u32 base);
 void serialize(Serializer& ser);
 void deserialize(Deserializer& deser);
 
+// Record the Elan commands of the next frame to the given file. See elan_capture.h
+void startCapture(const std::string& path);
+// Called by the TA when a display list is initialized
+void listInit(bool continuation);
+// Execute the commands of a captured frame into a new TA context, which is returned.
+// The caller owns the context. Not to be used while a game is running.
+TA_context *replay(const capture::Frame& frame);
+
 extern u8 *RAM;
 extern u32 ERAM_SIZE;
 constexpr u32 ERAM_SIZE_MAX = 32_MB;
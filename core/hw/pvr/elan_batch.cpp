@@ -0,0 +1,358 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "elan_batch.h"
+#include "build.h"
+#include <cstring>
+
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+#include <emmintrin.h>
+#define ELAN_SSE2
+#elif HOST_CPU == CPU_ARM64
+// 32-bit NEON has no division and isn't IEEE compliant
+#include <arm_neon.h>
+#define ELAN_NEON
+#endif
+
+namespace elan::batch
+{
+
+namespace portable
+{
+
+static inline void bound(float v, float& min, float& max)
+{
+	// Same as glm::min and glm::max
+	if (v < min)
+		min = v;
+	if (max < v)
+		max = v;
+}
+
+// Merge the bounds of a SIMD lane
+static inline void reduce(float laneMin, float laneMax, float& min, float& max)
+{
+	if (laneMin < min)
+		min = laneMin;
+	if (max < laneMax)
+		max = laneMax;
+}
+
+static inline void unpackVertex(const u8 *p, Vertices& out, u32 i)
+{
+	u32 header;
+	float pos[3];
+	memcpy(&header, p, sizeof(header));
+	memcpy(pos, p + sizeof(header), sizeof(pos));
+	out.x[i] = pos[0];
+	out.y[i] = pos[1];
+	out.z[i] = pos[2];
+	out.nx[i] = (int8_t)(header & 0xff) / 127.f;
+	out.ny[i] = (int8_t)((header >> 8) & 0xff) / 127.f;
+	out.nz[i] = (int8_t)((header >> 16) & 0xff) / 127.f;
+	bound(pos[0], out.min[0], out.max[0]);
+	bound(pos[1], out.min[1], out.max[1]);
+	bound(pos[2], out.min[2], out.max[2]);
+}
+
+static inline void initBounds(Vertices& out)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		out.min[i] = 1e38f;
+		out.max[i] = -1e38f;
+	}
+}
+
+static void unpack(const u8 *vertices, u32 stride, u32 count, Vertices& out)
+{
+	out.resize(count);
+	initBounds(out);
+	for (u32 i = 0; i < count; i++)
+		unpackVertex(vertices + i * stride, out, i);
+}
+
+static inline float nearDistance(float x, float y, float z, const float plane[4], float nearPlane)
+{
+	float d = x * plane[0] + y * plane[1] + z * plane[2] + plane[3];
+	return -d - nearPlane;
+}
+
+static inline void clipTest(float dist, ClipTest& test)
+{
+	const bool inside = dist >= 0;
+	const bool outside = dist < 0;
+	test.anyInside |= inside;
+	test.allInside &= inside;
+	test.anyOutside |= outside;
+	test.allOutside &= outside;
+}
+
+static void nearDistances(Vertices& v, u32 from, const float plane[4], float nearPlane, ClipTest& test)
+{
+	for (u32 i = from; i < v.count; i++)
+	{
+		v.dist[i] = nearDistance(v.x[i], v.y[i], v.z[i], plane, nearPlane);
+		clipTest(v.dist[i], test);
+	}
+}
+
+static ClipTest nearDistances(Vertices& v, const float plane[4], float nearPlane)
+{
+	ClipTest test { false, true, false, true };
+	nearDistances(v, 0, plane, nearPlane, test);
+	return test;
+}
+
+}	// namespace portable
+
+const Functions scalar {
+	portable::unpack,
+	portable::nearDistances,
+};
+
+#if defined(ELAN_SSE2)
+
+namespace sse2
+{
+
+static void unpack(const u8 *vertices, u32 stride, u32 count, Vertices& out)
+{
+	out.resize(count);
+	const __m128 scale = _mm_set1_ps(127.f);
+	__m128 minX = _mm_set1_ps(1e38f);
+	__m128 minY = minX;
+	__m128 minZ = minX;
+	__m128 maxX = _mm_set1_ps(-1e38f);
+	__m128 maxY = maxX;
+	__m128 maxZ = maxX;
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const u8 *p = vertices + i * stride;
+		__m128 h = _mm_loadu_ps((const float *)p);
+		__m128 x = _mm_loadu_ps((const float *)(p + stride));
+		__m128 y = _mm_loadu_ps((const float *)(p + stride * 2));
+		__m128 z = _mm_loadu_ps((const float *)(p + stride * 3));
+		_MM_TRANSPOSE4_PS(h, x, y, z);
+		_mm_storeu_ps(&out.x[i], x);
+		_mm_storeu_ps(&out.y[i], y);
+		_mm_storeu_ps(&out.z[i], z);
+
+		// sign-extend each normal component
+		__m128i n = _mm_castps_si128(h);
+		_mm_storeu_ps(&out.nx[i], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(n, 24), 24)), scale));
+		_mm_storeu_ps(&out.ny[i], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(n, 16), 24)), scale));
+		_mm_storeu_ps(&out.nz[i], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(n, 8), 24)), scale));
+
+		// minps and maxps return the second operand if either is NaN, like glm
+		minX = _mm_min_ps(x, minX);
+		minY = _mm_min_ps(y, minY);
+		minZ = _mm_min_ps(z, minZ);
+		maxX = _mm_max_ps(x, maxX);
+		maxY = _mm_max_ps(y, maxY);
+		maxZ = _mm_max_ps(z, maxZ);
+	}
+	alignas(16) float lanes[6][4];
+	_mm_store_ps(lanes[0], minX);
+	_mm_store_ps(lanes[1], minY);
+	_mm_store_ps(lanes[2], minZ);
+	_mm_store_ps(lanes[3], maxX);
+	_mm_store_ps(lanes[4], maxY);
+	_mm_store_ps(lanes[5], maxZ);
+	portable::initBounds(out);
+	for (int l = 0; l < 4; l++)
+		for (int c = 0; c < 3; c++)
+			portable::reduce(lanes[c][l], lanes[c + 3][l], out.min[c], out.max[c]);
+
+	for (; i < count; i++)
+		portable::unpackVertex(vertices + i * stride, out, i);
+}
+
+static ClipTest nearDistances(Vertices& v, const float plane[4], float nearPlane)
+{
+	const __m128 a = _mm_set1_ps(plane[0]);
+	const __m128 b = _mm_set1_ps(plane[1]);
+	const __m128 c = _mm_set1_ps(plane[2]);
+	const __m128 d = _mm_set1_ps(plane[3]);
+	const __m128 zNear = _mm_set1_ps(nearPlane);
+	const __m128 sign = _mm_set1_ps(-0.f);
+	const __m128 zero = _mm_setzero_ps();
+	int anyInside = 0;
+	int allInside = 0xf;
+	int anyOutside = 0;
+	int allOutside = 0xf;
+	u32 i = 0;
+	for (; i + 4 <= v.count; i += 4)
+	{
+		__m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_loadu_ps(&v.x[i]), a),
+				_mm_mul_ps(_mm_loadu_ps(&v.y[i]), b)),
+				_mm_mul_ps(_mm_loadu_ps(&v.z[i]), c)),
+				d);
+		dist = _mm_sub_ps(_mm_xor_ps(dist, sign), zNear);
+		_mm_storeu_ps(&v.dist[i], dist);
+
+		const int inside = _mm_movemask_ps(_mm_cmpge_ps(dist, zero));
+		const int outside = _mm_movemask_ps(_mm_cmplt_ps(dist, zero));
+		anyInside |= inside;
+		allInside &= inside;
+		anyOutside |= outside;
+		allOutside &= outside;
+	}
+	ClipTest test { anyInside != 0, allInside == 0xf, anyOutside != 0, allOutside == 0xf };
+	portable::nearDistances(v, i, plane, nearPlane, test);
+
+	return test;
+}
+
+}	// namespace sse2
+
+const Functions simd {
+	sse2::unpack,
+	sse2::nearDistances,
+};
+
+#elif defined(ELAN_NEON)
+
+namespace neon
+{
+
+// Same as glm::min and glm::max, including NaN handling
+static inline float32x4_t min(float32x4_t v, float32x4_t m) {
+	return vbslq_f32(vcltq_f32(v, m), v, m);
+}
+static inline float32x4_t max(float32x4_t v, float32x4_t m) {
+	return vbslq_f32(vcltq_f32(m, v), v, m);
+}
+
+static void unpack(const u8 *vertices, u32 stride, u32 count, Vertices& out)
+{
+	out.resize(count);
+	const float32x4_t scale = vdupq_n_f32(127.f);
+	float32x4_t minX = vdupq_n_f32(1e38f);
+	float32x4_t minY = minX;
+	float32x4_t minZ = minX;
+	float32x4_t maxX = vdupq_n_f32(-1e38f);
+	float32x4_t maxY = maxX;
+	float32x4_t maxZ = maxX;
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const u8 *p = vertices + i * stride;
+		float32x4x2_t t0 = vtrnq_f32(vld1q_f32((const float *)p), vld1q_f32((const float *)(p + stride)));
+		float32x4x2_t t1 = vtrnq_f32(vld1q_f32((const float *)(p + stride * 2)), vld1q_f32((const float *)(p + stride * 3)));
+		float32x4_t h = vcombine_f32(vget_low_f32(t0.val[0]), vget_low_f32(t1.val[0]));
+		float32x4_t x = vcombine_f32(vget_low_f32(t0.val[1]), vget_low_f32(t1.val[1]));
+		float32x4_t y = vcombine_f32(vget_high_f32(t0.val[0]), vget_high_f32(t1.val[0]));
+		float32x4_t z = vcombine_f32(vget_high_f32(t0.val[1]), vget_high_f32(t1.val[1]));
+		vst1q_f32(&out.x[i], x);
+		vst1q_f32(&out.y[i], y);
+		vst1q_f32(&out.z[i], z);
+
+		// sign-extend each normal component
+		int32x4_t n = vreinterpretq_s32_f32(h);
+		vst1q_f32(&out.nx[i], vdivq_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(n, 24), 24)), scale));
+		vst1q_f32(&out.ny[i], vdivq_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(n, 16), 24)), scale));
+		vst1q_f32(&out.nz[i], vdivq_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(n, 8), 24)), scale));
+
+		minX = min(x, minX);
+		minY = min(y, minY);
+		minZ = min(z, minZ);
+		maxX = max(x, maxX);
+		maxY = max(y, maxY);
+		maxZ = max(z, maxZ);
+	}
+	float lanes[6][4];
+	vst1q_f32(lanes[0], minX);
+	vst1q_f32(lanes[1], minY);
+	vst1q_f32(lanes[2], minZ);
+	vst1q_f32(lanes[3], maxX);
+	vst1q_f32(lanes[4], maxY);
+	vst1q_f32(lanes[5], maxZ);
+	portable::initBounds(out);
+	for (int l = 0; l < 4; l++)
+		for (int c = 0; c < 3; c++)
+			portable::reduce(lanes[c][l], lanes[c + 3][l], out.min[c], out.max[c]);
+
+	for (; i < count; i++)
+		portable::unpackVertex(vertices + i * stride, out, i);
+}
+
+static ClipTest nearDistances(Vertices& v, const float plane[4], float nearPlane)
+{
+	const float32x4_t a = vdupq_n_f32(plane[0]);
+	const float32x4_t b = vdupq_n_f32(plane[1]);
+	const float32x4_t c = vdupq_n_f32(plane[2]);
+	const float32x4_t d = vdupq_n_f32(plane[3]);
+	const float32x4_t zNear = vdupq_n_f32(nearPlane);
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	uint32x4_t anyInside = vdupq_n_u32(0);
+	uint32x4_t allInside = vdupq_n_u32(~0u);
+	uint32x4_t anyOutside = vdupq_n_u32(0);
+	uint32x4_t allOutside = vdupq_n_u32(~0u);
+	u32 i = 0;
+	for (; i + 4 <= v.count; i += 4)
+	{
+		float32x4_t dist = vaddq_f32(vaddq_f32(vaddq_f32(
+				vmulq_f32(vld1q_f32(&v.x[i]), a),
+				vmulq_f32(vld1q_f32(&v.y[i]), b)),
+				vmulq_f32(vld1q_f32(&v.z[i]), c)),
+				d);
+		dist = vsubq_f32(vnegq_f32(dist), zNear);
+		vst1q_f32(&v.dist[i], dist);
+
+		const uint32x4_t inside = vcgeq_f32(dist, zero);
+		const uint32x4_t outside = vcltq_f32(dist, zero);
+		anyInside = vorrq_u32(anyInside, inside);
+		allInside = vandq_u32(allInside, inside);
+		anyOutside = vorrq_u32(anyOutside, outside);
+		allOutside = vandq_u32(allOutside, outside);
+	}
+	ClipTest test {
+		vmaxvq_u32(anyInside) != 0, vminvq_u32(allInside) != 0,
+		vmaxvq_u32(anyOutside) != 0, vminvq_u32(allOutside) != 0
+	};
+	portable::nearDistances(v, i, plane, nearPlane, test);
+
+	return test;
+}
+
+}	// namespace neon
+
+const Functions simd {
+	neon::unpack,
+	neon::nearDistances,
+};
+
+#else
+
+const Functions simd = scalar;
+
+#endif
+
+const Functions& get()
+{
+#if HOST_CPU == CPU_X86 && (defined(__GNUC__) || defined(__clang__))
+	// 32-bit x86 builds don't require SSE2
+	static const Functions& functions = __builtin_cpu_supports("sse2") ? simd : scalar;
+	return functions;
+#else
+	return simd;
+#endif
+}
+
+}
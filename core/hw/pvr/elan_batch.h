@@ -0,0 +1,84 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <vector>
+
+//
+// Batched processing of Naomi 2 ICH vertex lists.
+// All N2 vertex formats start with the same 16 bytes (header with packed normal, x, y, z),
+// which are extracted for the whole list into a structure of arrays.
+// The SIMD implementations give the same results as the scalar one, bit for bit, except for
+// the sign of zero bounds in the bounding box, which doesn't affect the clipping decisions.
+//
+namespace elan::batch
+{
+
+struct Vertices
+{
+	void resize(u32 count)
+	{
+		this->count = count;
+		if (x.size() < count)
+		{
+			x.resize(count);
+			y.resize(count);
+			z.resize(count);
+			nx.resize(count);
+			ny.resize(count);
+			nz.resize(count);
+			dist.resize(count);
+		}
+	}
+
+	u32 count = 0;
+	std::vector<float> x, y, z;
+	std::vector<float> nx, ny, nz;
+	// Distance to the near plane, negative if the vertex is clipped
+	std::vector<float> dist;
+	// Bounding box of the positions
+	float min[3];
+	float max[3];
+};
+
+struct ClipTest
+{
+	bool anyInside;		// dist >= 0
+	bool allInside;
+	bool anyOutside;	// dist < 0
+	bool allOutside;
+};
+
+struct Functions
+{
+	// Extract the positions and normals of count N2 vertices, and compute their bounding box.
+	// stride is the size of a vertex in bytes.
+	void (*unpack)(const u8 *vertices, u32 stride, u32 count, Vertices& out);
+	// Compute the distance of each vertex to the near plane:
+	// -(x * plane[0] + y * plane[1] + z * plane[2] + plane[3]) - nearPlane
+	ClipTest (*nearDistances)(Vertices& v, const float plane[4], float nearPlane);
+};
+
+// Portable implementation
+extern const Functions scalar;
+// SSE2 or NEON (arm64) implementation if supported by the host, scalar otherwise
+extern const Functions simd;
+
+// Functions used by the emulator
+const Functions& get();
+
+}
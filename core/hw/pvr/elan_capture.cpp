@@ -0,0 +1,103 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "elan_capture.h"
+#include "elan.h"
+#include "pvr_regs.h"
+
+#include <algorithm>
+
+namespace elan::capture
+{
+
+bool Frame::save(const std::string& path) const
+{
+	// Only save the RAM up to the last non-zero byte
+	size_t ramSize = ram.size();
+	while (ramSize > 0 && ram[ramSize - 1] == 0)
+		ramSize--;
+	ramSize = (ramSize + 31) & ~31;
+	ramSize = std::min(ramSize, ram.size());
+
+	FILE *f = nowide::fopen(path.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(PVR, "Can't create Elan capture %s", path.c_str());
+		return false;
+	}
+	Header header{};
+	header.magic = Magic;
+	header.version = Version;
+	header.pvrRegsSize = (u32)pvrRegs.size();
+	header.stateSize = (u32)state.size();
+	header.ramSize = (u32)ramSize;
+	header.eventCount = (u32)events.size();
+	bool success = std::fwrite(&header, sizeof(header), 1, f) == 1
+			&& std::fwrite(pvrRegs.data(), 1, pvrRegs.size(), f) == pvrRegs.size()
+			&& std::fwrite(state.data(), 1, state.size(), f) == state.size()
+			&& std::fwrite(ram.data(), 1, ramSize, f) == ramSize
+			&& std::fwrite(events.data(), sizeof(Event), events.size(), f) == events.size();
+	success = std::fclose(f) == 0 && success;
+	if (!success)
+		WARN_LOG(PVR, "Error writing Elan capture %s", path.c_str());
+
+	return success;
+}
+
+bool Frame::load(const std::string& path)
+{
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	if (f == nullptr)
+	{
+		WARN_LOG(PVR, "Can't open Elan capture %s", path.c_str());
+		return false;
+	}
+	std::fseek(f, 0, SEEK_END);
+	const u64 fileSize = std::ftell(f);
+	std::fseek(f, 0, SEEK_SET);
+	Header header;
+	bool success = std::fread(&header, sizeof(header), 1, f) == 1
+			&& header.magic == Magic
+			&& header.version == Version
+			&& header.pvrRegsSize == pvr_RegSize
+			&& header.ramSize <= ERAM_SIZE_MAX
+			// Don't trust the sizes of a truncated or corrupted file
+			&& sizeof(header) + (u64)header.pvrRegsSize + header.stateSize + header.ramSize
+				+ (u64)header.eventCount * sizeof(Event) <= fileSize;
+	if (success)
+	{
+		pvrRegs.resize(header.pvrRegsSize);
+		state.resize(header.stateSize);
+		ram.assign(ERAM_SIZE_MAX, 0);
+		events.resize(header.eventCount);
+		success = std::fread(pvrRegs.data(), 1, pvrRegs.size(), f) == pvrRegs.size()
+				&& std::fread(state.data(), 1, state.size(), f) == state.size()
+				&& std::fread(ram.data(), 1, header.ramSize, f) == header.ramSize
+				&& std::fread(events.data(), sizeof(Event), events.size(), f) == events.size();
+	}
+	std::fclose(f);
+	if (!success)
+	{
+		WARN_LOG(PVR, "Invalid Elan capture %s", path.c_str());
+		*this = {};
+	}
+
+	return success;
+}
+
+}
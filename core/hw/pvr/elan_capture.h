@@ -0,0 +1,86 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Naomi 2 Elan frame capture.
+	Holds everything needed to replay the Elan commands of a frame without the game:
+	the PVR registers, Elan state and Elan RAM at the start of the frame (TA list init),
+	and the 32-byte command blocks written by the SH4 until the next frame.
+
+	File layout (little endian):
+		Header
+		PVR registers [pvrRegsSize]
+		serialized Elan state [stateSize]
+		Elan RAM [ramSize], the rest of the RAM is zero
+		Event[eventCount]
+
+	Texture DMAs from system RAM and TA data sent directly to the TA FIFO aren't captured.
+*/
+#pragma once
+#include "types.h"
+
+#include <string>
+#include <vector>
+
+namespace elan::capture
+{
+
+constexpr u32 Magic = 0x4e414c45;	// "ELAN"
+constexpr u32 Version = 1;
+
+enum EventType : u32 {
+	Command = 0,			// 32-byte command block written to the Elan command register
+	ListContinuation = 1,	// TA_LIST_CONT
+};
+
+#pragma pack(push, 1)
+struct Header
+{
+	u32 magic;
+	u32 version;
+	u32 pvrRegsSize;
+	u32 stateSize;
+	u32 ramSize;
+	u32 eventCount;
+	u64 reserved;
+};
+static_assert(sizeof(Header) == 32, "Invalid header size");
+
+struct Event
+{
+	u32 type;
+	u32 reserved;
+	u32 data[8];
+};
+static_assert(sizeof(Event) == 40, "Invalid event size");
+#pragma pack(pop)
+
+struct Frame
+{
+	std::vector<u8> pvrRegs;
+	// Serialized Elan state. Replayed from the reset state if empty
+	std::vector<u8> state;
+	// Elan RAM, ERAM_SIZE_MAX bytes once loaded
+	std::vector<u8> ram;
+	std::vector<Event> events;
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+};
+
+}
@@ -0,0 +1,187 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+
+class SystemClock : public FramePacer::Clock
+{
+public:
+	u64 now() override {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void sleepUntil(u64 time) override
+	{
+		// The OS sleep granularity can be as coarse as 1 or 2 ms so sleep until shortly
+		// before the deadline, then yield until it's reached.
+		constexpr u64 SpinTime = 2'000'000;
+		for (u64 t = now(); t < time; t = now())
+		{
+			if (time - t > SpinTime)
+				std::this_thread::sleep_for(std::chrono::nanoseconds(time - t - SpinTime));
+			else
+				std::this_thread::yield();
+		}
+	}
+};
+SystemClock systemClock;
+
+}
+
+FramePacer framePacer;
+
+FramePacer::FramePacer(Clock *clock)
+	: clock(clock != nullptr ? clock : &systemClock), framePeriod((u64)(1e9 / 59.94))
+{
+}
+
+void FramePacer::reset()
+{
+	deadline = 0;
+	lastVblank = 0;
+	lastPresent = 0;
+	rejectedPresents = 0;
+	displayPeriod = 0;
+}
+
+void FramePacer::setFrameRate(double fps)
+{
+	if (fps > 0)
+		framePeriod = (u64)std::llround(1e9 / fps);
+}
+
+void FramePacer::presented()
+{
+	const u64 now = clock->now();
+	const u64 last = lastPresent;
+	lastPresent = now;
+	if (last == 0)
+		return;
+	const u64 interval = now - last;
+	// Ignore long pauses
+	if (interval > 100'000'000)
+		return;
+	const u64 period = displayPeriod;
+	if (period != 0 && (interval < period * 3 / 4 || interval > period * 3 / 2))
+	{
+		// Skipped refresh or late frame. Restart the estimate if it keeps happening.
+		if (++rejectedPresents < 8)
+			return;
+		displayPeriod = interval;
+	}
+	else if (period == 0)
+		displayPeriod = interval;
+	else
+		displayPeriod = period + ((s64)interval - (s64)period) / 32;
+	rejectedPresents = 0;
+}
+
+bool FramePacer::isDisplayLocked(bool vsync) const
+{
+	const u64 display = displayPeriod;
+	if (!vsync || display == 0)
+		return false;
+	const double period = (double)framePeriod;
+	return std::abs((double)display - period) <= period * LockTolerance;
+}
+
+bool FramePacer::vblank(bool vsync)
+{
+	const u64 period = framePeriod;
+	u64 now = clock->now();
+	bool waited = false;
+	if (isDisplayLocked(vsync))
+	{
+		// Paced by the display
+		deadline = 0;
+	}
+	else if (deadline == 0 || now > deadline + MaxLateFrames * period)
+	{
+		// First frame or too late to catch up
+		if (deadline != 0)
+		{
+			std::lock_guard<std::mutex> _(statsMutex);
+			lateFrames++;
+		}
+		deadline = now + period;
+	}
+	else
+	{
+		if (now < deadline)
+		{
+			clock->sleepUntil(deadline);
+			now = clock->now();
+			waited = true;
+		}
+		else if (now - deadline > period / 4)
+		{
+			std::lock_guard<std::mutex> _(statsMutex);
+			lateFrames++;
+		}
+		// Keep the long term rate exact by catching up on late frames
+		deadline += period;
+	}
+	if (lastVblank != 0)
+		addFrameTime(now - lastVblank);
+	lastVblank = now;
+
+	return waited;
+}
+
+void FramePacer::addFrameTime(u64 frameTime)
+{
+	std::lock_guard<std::mutex> _(statsMutex);
+	// Welford's online variance
+	frames++;
+	const double delta = frameTime - mean;
+	mean += delta / frames;
+	m2 += delta * (frameTime - mean);
+	maxFrameTime = std::max(maxFrameTime, frameTime);
+}
+
+FramePacer::Stats FramePacer::getStats() const
+{
+	std::lock_guard<std::mutex> _(statsMutex);
+	Stats stats {};
+	stats.frames = frames;
+	stats.lateFrames = lateFrames;
+	stats.meanMs = mean / 1e6;
+	stats.stdDevMs = frames > 1 ? std::sqrt(m2 / (frames - 1)) / 1e6 : 0.0;
+	stats.maxMs = maxFrameTime / 1e6;
+
+	return stats;
+}
+
+void FramePacer::resetStats()
+{
+	std::lock_guard<std::mutex> _(statsMutex);
+	frames = 0;
+	lateFrames = 0;
+	mean = 0;
+	m2 = 0;
+	maxFrameTime = 0;
+}
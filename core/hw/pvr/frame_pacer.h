@@ -0,0 +1,103 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+
+#include <atomic>
+#include <mutex>
+
+// Real-time pacing of the emulated vblanks.
+// Each emulated vblank is held until its deadline, derived from the emulated frame rate,
+// so that frames are produced at a steady rate instead of in bursts released by the audio
+// backend or the swap chain.
+// The host present times are measured: when vsync is on and the display refresh rate is within 1%
+// of the emulated frame rate (59.94 Hz content on a 60 Hz display for example), the display drives
+// the emulation and audio dynamic rate control absorbs the difference.
+class FramePacer
+{
+public:
+	// Time source, in nanoseconds
+	class Clock
+	{
+	public:
+		virtual ~Clock() = default;
+		virtual u64 now() = 0;
+		virtual void sleepUntil(u64 time) = 0;
+	};
+
+	struct Stats
+	{
+		u32 frames;
+		u32 lateFrames;		// frames that missed their deadline
+		double meanMs;		// mean frame time
+		double stdDevMs;	// frame time standard deviation
+		double maxMs;		// longest frame time
+	};
+
+	static constexpr double LockTolerance = 0.01;
+	// Resynchronize instead of catching up when this many frames behind
+	static constexpr int MaxLateFrames = 2;
+
+	// Uses the system steady clock if clock is null
+	FramePacer(Clock *clock = nullptr);
+
+	// Forget the current deadline and display timing. Frame time stats are kept.
+	void reset();
+	void setFrameRate(double fps);
+	double getFrameRate() const {
+		return 1e9 / framePeriod.load();
+	}
+
+	// To be called by the UI thread after each host present
+	void presented();
+	// Estimated display refresh period in ns, 0 if unknown
+	u64 getDisplayPeriod() const {
+		return displayPeriod;
+	}
+	// True if emulation is currently paced by the display
+	bool isDisplayLocked(bool vsync) const;
+
+	// To be called at each emulated vblank. Waits until the frame deadline.
+	// Returns true if it waited, in which case input can be polled before emulating the next frame.
+	bool vblank(bool vsync);
+
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	void addFrameTime(u64 frameTime);
+
+	Clock *clock;
+	std::atomic<u64> framePeriod;
+	u64 deadline = 0;
+	u64 lastVblank = 0;
+
+	std::atomic<u64> displayPeriod { 0 };
+	u64 lastPresent = 0;
+	int rejectedPresents = 0;
+
+	mutable std::mutex statsMutex;
+	u32 frames = 0;
+	u32 lateFrames = 0;
+	double mean = 0;
+	double m2 = 0;
+	u64 maxFrameTime = 0;
+};
+
+extern FramePacer framePacer;
@@ -11,8 +11,6 @@
 #include "hw/holly/holly_intc.h"
 #include "serialize.h"
 
-static u32 pvr_map32(u32 offset32);
-
 RamRegion vram;
 
 // YUV converter code
@@ -241,6 +239,36 @@ template void pvr_write32p<u16, true>(u32 addr, u16 data);
 template void pvr_write32p<u32, false>(u32 addr, u32 data);
 template void pvr_write32p<u32, true>(u32 addr, u32 data);
 
+void pvr_read32_block(u32 addr, void *dst, u32 size)
+{
+	u8 *p = (u8 *)dst;
+	while (size != 0)
+	{
+		// each 32-bit word is in a different bank
+		u32 n = std::min(4 - (addr & 3), size);
+		memcpy(p, &vram[pvr_map32(addr)], n);
+		p += n;
+		addr += n;
+		size -= n;
+	}
+}
+
+void pvr_write32_block(u32 addr, const void *src, u32 size)
+{
+	const u8 *p = (const u8 *)src;
+	while (size != 0)
+	{
+		u32 n = std::min(4 - (addr & 3), size);
+		u32 vaddr = addr & VRAM_MASK;
+		if (vaddr >= fb_watch_addr_start && vaddr < fb_watch_addr_end)
+			fb_dirty = true;
+		memcpy(&vram[pvr_map32(addr)], p, n);
+		p += n;
+		addr += n;
+		size -= n;
+	}
+}
+
 void DYNACALL TAWrite(u32 address, const SQBuffer *data, u32 count)
 {
 	if ((address & 0x800000) == 0)
@@ -288,7 +316,7 @@ void DYNACALL TAWriteSQ(u32 address, const SQBuffer *sqb)
 
 #define VRAM_BANK_BIT 0x400000
 
-static u32 pvr_map32(u32 offset32)
+u32 pvr_map32(u32 offset32)
 {
 	//64b wide bus is achieved by interleaving the banks every 32 bits
 	const u32 static_bits = VRAM_MASK - (VRAM_BANK_BIT * 2 - 1) + 3;
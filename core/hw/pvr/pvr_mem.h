@@ -19,8 +19,13 @@ void YUV_deserialize(Deserializer& deser);
 void YUV_reset();
 
 // 32-bit vram path handlers
+// Offset in vram of a 32-bit path address
+u32 pvr_map32(u32 offset32);
 template<typename T> T DYNACALL pvr_read32p(u32 addr);
 template<typename T, bool Internal = false> void DYNACALL pvr_write32p(u32 addr, T data);
+// Copy a linear block of bytes from/to the 32-bit vram path
+void pvr_read32_block(u32 addr, void *dst, u32 size);
+void pvr_write32_block(u32 addr, const void *src, u32 size);
 // Area 4 handlers
 template<typename T, bool upper> T DYNACALL pvr_read_area4(u32 addr);
 template<typename T, bool upper> void DYNACALL pvr_write_area4(u32 addr, T data);
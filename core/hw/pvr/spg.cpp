@@ -6,6 +6,7 @@
 #include "serialize.h"
 #include "network/ggpo.h"
 #include "hw/pvr/Renderer_if.h"
+#include "frame_pacer.h"
 #include "stdclass.h"
 #include <array>
 
@@ -54,6 +55,7 @@ void CalculateSync()
 		Line_Cycles /= 2;
 
 	Frame_Cycles = pvr_numscanlines * Line_Cycles;
+	framePacer.setFrameRate((double)SH4_MAIN_CLOCK / Frame_Cycles);
 	prv_cur_scanline = 0;
 	clc_pvr_scanline = 0;
 
@@ -2,6 +2,7 @@
 #include "ta_ctx.h"
 #include "hw/holly/holly_intc.h"
 #include "pvr_mem.h"
+#include "elan.h"
 
 /*
 	Threaded TA Implementation
@@ -516,7 +517,10 @@ void ta_vtx_ListInit(bool continuation)
 	ta_cur_state = TAS_NS;
 	ta_fsm_cl = 7;
 	if (settings.platform.isNaomi2())
+	{
 		ta_parse_reset();
+		elan::listInit(continuation);
+	}
 }
 
 void ta_vtx_SoftReset()
@@ -571,25 +575,43 @@ void DYNACALL ta_vtx_data32(const SQBuffer *data)
 	ta_thd_data32_i((const simd256_t *)data);
 }
 
+// Bulk path used by DMA transfers.
+// All the data is copied at once, then the state machine runs over the copy.
+// List end interrupts are raised in the same order as when writing 32 bytes at a time.
 void ta_vtx_data(const SQBuffer *data, u32 size)
 {
-	while (size >= 4)
+	if (ta_ctx == NULL)
 	{
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		size -= 4;
+		INFO_LOG(PVR, "Warning: data sent to TA prior to ListInit. Ignored");
+		return;
 	}
+	u32 count = 0;
+	if (ta_tad.End() - ta_tad.thd_root < (ptrdiff_t)TA_DATA_SIZE)
+		count = std::min<u32>(size, (TA_DATA_SIZE - (ta_tad.thd_data - ta_tad.thd_root)) / sizeof(SQBuffer));
+
+	u8 *base = ta_tad.thd_data;
+	memcpy(base, data, count * sizeof(SQBuffer));
 
-	while (size > 0)
+	u32 state = ta_cur_state;
+	for (u32 i = 0; i < count; i++)
 	{
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		size--;
+		const PCW pcw = *(const PCW *)&base[i * sizeof(SQBuffer)];
+		const u32 trans = ta_fsm[(state << 8) | (pcw.ParaType << 5) | ((pcw.obj_ctrl >> 2) & 31)];
+		state = trans;
+		if (unlikely(trans & 0xF0))
+		{
+			// ta_handle_cmd expects the current parameter to be the last one written
+			ta_tad.thd_data = base + (i + 1) * sizeof(SQBuffer);
+			ta_handle_cmd(trans);
+			state = ta_cur_state;
+		}
+	}
+	ta_cur_state = state;
+	ta_tad.thd_data = base + count * sizeof(SQBuffer);
+
+	if (count < size)
+	{
+		INFO_LOG(PVR, "Warning: TA data buffer overflow");
+		asic_RaiseInterrupt(holly_MATR_NOMEM);
 	}
 }
@@ -0,0 +1,379 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ta_capture.h"
+#include "ta_ctx.h"
+#include "pvr_mem.h"
+#include "pvr_regs.h"
+#include "rend/TexCache.h"
+#include "rend/texconv.h"
+#include "oslib/oslib.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+extern bool pal_needs_update;
+
+namespace tacapture
+{
+
+bool Frame::save(const std::string& path) const
+{
+	FILE *f = nowide::fopen(path.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(PVR, "Can't create TA capture %s", path.c_str());
+		return false;
+	}
+	Header header{};
+	header.magic = Magic;
+	header.version = Version;
+	header.vramSize = vramSize;
+	header.pvrRegsSize = (u32)pvrRegs.size();
+	header.passCount = (u32)passes.size();
+	header.pageCount = (u32)pageOffsets.size();
+	bool success = std::fwrite(&header, sizeof(header), 1, f) == 1
+			&& std::fwrite(&settings, sizeof(settings), 1, f) == 1
+			&& std::fwrite(pvrRegs.data(), 1, pvrRegs.size(), f) == pvrRegs.size();
+	for (const std::vector<u8>& pass : passes)
+	{
+		const u32 size = (u32)pass.size();
+		success = success
+				&& std::fwrite(&size, sizeof(size), 1, f) == 1
+				&& std::fwrite(pass.data(), 1, size, f) == size;
+	}
+	success = success
+			&& std::fwrite(pageOffsets.data(), sizeof(u32), pageOffsets.size(), f) == pageOffsets.size()
+			&& std::fwrite(pages.data(), 1, pages.size(), f) == pages.size();
+	success = std::fclose(f) == 0 && success;
+	if (!success)
+		WARN_LOG(PVR, "Error writing TA capture %s", path.c_str());
+
+	return success;
+}
+
+bool Frame::load(const std::string& path)
+{
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	if (f == nullptr)
+	{
+		WARN_LOG(PVR, "Can't open TA capture %s", path.c_str());
+		return false;
+	}
+	Header header;
+	bool success = std::fread(&header, sizeof(header), 1, f) == 1
+			&& header.magic == Magic
+			&& header.version == Version
+			&& header.pvrRegsSize == pvr_RegSize
+			&& header.passCount > 0 && header.passCount <= MAX_PASSES
+			&& header.vramSize <= VRAM_SIZE_MAX
+			&& header.pageCount <= header.vramSize / PageSize
+			&& std::fread(&settings, sizeof(settings), 1, f) == 1;
+	if (success)
+	{
+		vramSize = header.vramSize;
+		pvrRegs.resize(header.pvrRegsSize);
+		success = std::fread(pvrRegs.data(), 1, pvrRegs.size(), f) == pvrRegs.size();
+		passes.resize(header.passCount);
+		for (std::vector<u8>& pass : passes)
+		{
+			u32 size;
+			success = success
+					&& std::fread(&size, sizeof(size), 1, f) == 1
+					&& size <= TA_DATA_SIZE;
+			if (!success)
+				break;
+			pass.resize(size);
+			success = std::fread(pass.data(), 1, size, f) == size;
+		}
+		pageOffsets.resize(header.pageCount);
+		pages.resize(header.pageCount * PageSize);
+		success = success
+				&& std::fread(pageOffsets.data(), sizeof(u32), pageOffsets.size(), f) == pageOffsets.size()
+				&& std::fread(pages.data(), 1, pages.size(), f) == pages.size();
+		for (u32 offset : pageOffsets)
+			success = success && offset % PageSize == 0 && offset < vramSize;
+	}
+	std::fclose(f);
+	if (!success)
+	{
+		WARN_LOG(PVR, "Invalid TA capture %s", path.c_str());
+		*this = {};
+	}
+
+	return success;
+}
+
+// Only used to compute the vram range of a texture
+class TextureRange final : public BaseTextureCacheData
+{
+public:
+	TextureRange(TSP tsp, TCW tcw) : BaseTextureCacheData(tsp, tcw) {}
+
+	std::string GetId() override {
+		return "";
+	}
+	void UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded) override {
+	}
+
+	u32 begin() const {
+		return startAddress;
+	}
+	u32 end() const {
+		return mmStartAddress + size;
+	}
+};
+
+static std::mutex mutex;
+// Set when a capture is armed or in progress
+static std::atomic<bool> active;
+static struct {
+	std::string path;
+	// Frame being captured, if any
+	TA_context *ctx = nullptr;
+	Frame frame;
+	// Whole vram when the frame was queued
+	std::vector<u8> vram;
+	// vram pages to keep
+	std::vector<bool> usedPages;
+} recorder;
+
+// Mark the pages of a range of the 64-bit vram path
+static void markRange64(u32 begin, u32 end)
+{
+	end = std::min<u32>(end, recorder.usedPages.size() * PageSize);
+	for (u32 page = begin / PageSize; page * PageSize < end; page++)
+		recorder.usedPages[page] = true;
+}
+
+// Mark the pages of a range of the 32-bit vram path
+static void markRange32(u32 begin, u32 end)
+{
+	for (u32 addr = begin & ~3; addr < end; addr += 4)
+		recorder.usedPages[(pvr_map32(addr) & VRAM_MASK) / PageSize] = true;
+}
+
+static void markTexture(TSP tsp, TCW tcw)
+{
+	TextureRange texture(tsp, tcw);
+	markRange64(texture.begin(), texture.end());
+}
+
+void start(const std::string& path)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	recorder.path = path;
+	recorder.ctx = nullptr;
+	recorder.frame = {};
+	recorder.vram.clear();
+	active = true;
+	NOTICE_LOG(PVR, "TA capture armed: %s", path.c_str());
+}
+
+void frameStart(TA_context *ctx)
+{
+	if (!active)
+		return;
+	std::lock_guard<std::mutex> _(mutex);
+	if (recorder.ctx != nullptr)
+		// previous frame not processed yet
+		return;
+	if (settings.platform.isNaomi2())
+	{
+		WARN_LOG(PVR, "TA capture isn't supported on Naomi 2");
+		os_notify("TA capture isn't supported on Naomi 2", 2000);
+		active = false;
+		return;
+	}
+	Frame& frame = recorder.frame;
+	frame.vramSize = VRAM_SIZE;
+	frame.pvrRegs.assign(pvr_regs, pvr_regs + pvr_RegSize);
+	frame.passes.clear();
+	for (TA_context *c = ctx; c != nullptr; c = c->nextContext)
+		frame.passes.emplace_back(c->getTADataBegin(), c->getTADataEnd());
+
+	const rend_context& rend = ctx->rend;
+	RenderSettings& renderSettings = frame.settings;
+	renderSettings = {};
+	renderSettings.isRTT = rend.isRTT;
+	renderSettings.clearFramebuffer = rend.clearFramebuffer;
+	renderSettings.taGlobTileClip = rend.ta_GLOB_TILE_CLIP.full;
+	renderSettings.scalerCtl = rend.scaler_ctl.full;
+	renderSettings.fbXClip = rend.fb_X_CLIP.full;
+	renderSettings.fbYClip = rend.fb_Y_CLIP.full;
+	renderSettings.fbWLinestride = rend.fb_W_LINESTRIDE;
+	renderSettings.fbWSof1 = rend.fb_W_SOF1;
+	renderSettings.fbWCtrl = rend.fb_W_CTRL.full;
+	renderSettings.fogClampMin = rend.fog_clamp_min.full;
+	renderSettings.fogClampMax = rend.fog_clamp_max.full;
+
+	recorder.vram.assign(&vram[0], &vram[0] + VRAM_SIZE);
+	recorder.usedPages.assign(VRAM_SIZE / PageSize, false);
+
+	// Region array
+	u32 addr;
+	u32 tileSize;
+	getRegionTileAddrAndSize(addr, tileSize);
+	RegionArrayTile tile;
+	int maxTiles = 3000;
+	do {
+		tile.full = pvr_read32p<u32>(addr);
+		addr += tileSize;
+	} while (!tile.LastRegion && --maxTiles >= 0);
+	markRange32(REGION_BASE, addr);
+
+	// Background polygon, same as FillBGP()
+	const u32 stripBase = ((PARAM_BASE & 0xF00000) + ISP_BACKGND_T.tag_address * 4) & VRAM_MASK;
+	u32 stripVs = 3 + ISP_BACKGND_T.skip;
+	if (FPU_SHAD_SCALE.intensity_shadow == 1 && ISP_BACKGND_T.shadow == 1)
+		stripVs += ISP_BACKGND_T.skip;
+	stripVs *= 4;
+	markRange32(stripBase, stripBase + 3 * 4 + (ISP_BACKGND_T.tag_offset + 3) * stripVs);
+
+	recorder.ctx = ctx;
+}
+
+void frameSkipped(TA_context *ctx)
+{
+	if (!active)
+		return;
+	std::lock_guard<std::mutex> _(mutex);
+	if (recorder.ctx == ctx)
+	{
+		// try again with the next frame
+		recorder.ctx = nullptr;
+		recorder.vram.clear();
+	}
+}
+
+void frameProcessed(TA_context *ctx)
+{
+	if (!active)
+		return;
+	std::lock_guard<std::mutex> _(mutex);
+	if (recorder.ctx == nullptr || recorder.ctx != ctx)
+		return;
+	Frame& frame = recorder.frame;
+	frame.settings.framebufferWidth = ctx->rend.framebufferWidth;
+	frame.settings.framebufferHeight = ctx->rend.framebufferHeight;
+
+	// Textures used by the frame
+	for (TA_context *c = ctx; c != nullptr; c = c->nextContext)
+		for (const auto *polys : { &c->rend.global_param_op, &c->rend.global_param_pt, &c->rend.global_param_tr })
+			for (const PolyParam& pp : *polys)
+			{
+				if (!pp.pcw.Texture)
+					continue;
+				markTexture(pp.tsp, pp.tcw);
+				if (pp.tcw1.full != (u32)-1)
+					markTexture(pp.tsp1, pp.tcw1);
+			}
+
+	frame.pageOffsets.clear();
+	frame.pages.clear();
+	for (u32 page = 0; page < recorder.usedPages.size(); page++)
+	{
+		if (!recorder.usedPages[page])
+			continue;
+		frame.pageOffsets.push_back(page * PageSize);
+		frame.pages.insert(frame.pages.end(), &recorder.vram[page * PageSize], &recorder.vram[(page + 1) * PageSize]);
+	}
+	INFO_LOG(PVR, "TA capture: %d passes, %d vram pages", (int)frame.passes.size(), (int)frame.pageOffsets.size());
+	if (frame.save(recorder.path))
+		os_notify("TA frame captured", 2000, recorder.path.c_str());
+	else
+		os_notify("TA capture failed", 2000);
+
+	recorder.ctx = nullptr;
+	recorder.frame = {};
+	recorder.vram = {};
+	recorder.usedPages = {};
+	active = false;
+}
+
+TA_context *prepare(const Frame& frame)
+{
+	if (frame.vramSize > VRAM_SIZE)
+	{
+		WARN_LOG(PVR, "TA capture needs %d MB of vram", frame.vramSize / (u32)1_MB);
+		return nullptr;
+	}
+	verify(frame.pvrRegs.size() == pvr_RegSize);
+	memcpy(pvr_regs, frame.pvrRegs.data(), pvr_RegSize);
+	for (size_t i = 0; i < frame.pageOffsets.size(); i++)
+	{
+		const u32 offset = frame.pageOffsets[i];
+		// Invalidate the textures using this page and unprotect it
+		VramLockedWriteOffset(offset);
+		memcpy(&vram[offset], &frame.pages[i * PageSize], PageSize);
+	}
+	pal_needs_update = true;
+	palette_update();
+
+	TA_context *ctx = nullptr;
+	TA_context *last = nullptr;
+	for (const std::vector<u8>& pass : frame.passes)
+	{
+		TA_context *c = tactx_Alloc();
+		c->Reset();
+		memcpy(c->tad.thd_root, pass.data(), pass.size());
+		c->tad.thd_data = c->tad.thd_root + pass.size();
+		if (last == nullptr)
+			ctx = c;
+		else
+			last->nextContext = c;
+		last = c;
+	}
+	if (ctx == nullptr)
+		return nullptr;
+
+	FillBGP(ctx);
+	rend_context& rend = ctx->rend;
+	const RenderSettings& renderSettings = frame.settings;
+	rend.isRTT = renderSettings.isRTT;
+	rend.clearFramebuffer = renderSettings.clearFramebuffer;
+	rend.ta_GLOB_TILE_CLIP.full = renderSettings.taGlobTileClip;
+	rend.scaler_ctl.full = renderSettings.scalerCtl;
+	rend.fb_X_CLIP.full = renderSettings.fbXClip;
+	rend.fb_Y_CLIP.full = renderSettings.fbYClip;
+	rend.fb_W_LINESTRIDE = renderSettings.fbWLinestride;
+	rend.fb_W_SOF1 = renderSettings.fbWSof1;
+	rend.fb_W_CTRL.full = renderSettings.fbWCtrl;
+	rend.fog_clamp_min.full = renderSettings.fogClampMin;
+	rend.fog_clamp_max.full = renderSettings.fogClampMax;
+	if (!rend.isRTT)
+	{
+		rend.framebufferWidth = renderSettings.framebufferWidth;
+		rend.framebufferHeight = renderSettings.framebufferHeight;
+	}
+
+	return ctx;
+}
+
+void release(TA_context *ctx)
+{
+	while (ctx != nullptr)
+	{
+		TA_context *next = ctx->nextContext;
+		delete ctx;
+		ctx = next;
+	}
+}
+
+}
@@ -0,0 +1,119 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	TA frame capture.
+	Records what a renderer needs to process and render a frame without the game:
+	the TA data of each render pass, the render settings of the context, the PVR registers
+	(which include the palette and fog tables) and the VRAM pages read by the renderer:
+	region array, background polygon and textures.
+
+	The registers, TA data and VRAM are saved when the frame is sent to the renderer.
+	The pages to keep are known once the renderer has parsed the TA data.
+
+	File layout (little endian):
+		Header
+		RenderSettings
+		PVR registers [pvrRegsSize]
+		for each pass: u32 size, TA data [size]
+		VRAM page offsets: u32 [pageCount]
+		VRAM pages [pageCount][PageSize]
+
+	Naomi 2 frames aren't supported: their geometry doesn't go through the TA data.
+*/
+#pragma once
+#include "types.h"
+
+#include <string>
+#include <vector>
+
+struct TA_context;
+
+namespace tacapture
+{
+
+constexpr u32 Magic = 0x46434154;	// "TACF"
+constexpr u32 Version = 1;
+constexpr u32 PageSize = 4_KB;
+
+#pragma pack(push, 1)
+struct Header
+{
+	u32 magic;
+	u32 version;
+	u32 vramSize;
+	u32 pvrRegsSize;
+	u32 passCount;
+	u32 pageCount;
+	u64 reserved;
+};
+static_assert(sizeof(Header) == 32, "Invalid header size");
+
+// rend_context settings
+struct RenderSettings
+{
+	u32 isRTT;
+	u32 clearFramebuffer;
+	u32 taGlobTileClip;
+	u32 scalerCtl;
+	u32 fbXClip;
+	u32 fbYClip;
+	u32 fbWLinestride;
+	u32 fbWSof1;
+	u32 fbWCtrl;
+	u32 fogClampMin;
+	u32 fogClampMax;
+	u32 framebufferWidth;
+	u32 framebufferHeight;
+	u32 reserved[3];
+};
+static_assert(sizeof(RenderSettings) == 64, "Invalid render settings size");
+#pragma pack(pop)
+
+struct Frame
+{
+	u32 vramSize = 0;
+	RenderSettings settings {};
+	std::vector<u8> pvrRegs;
+	// TA data of each render pass
+	std::vector<std::vector<u8>> passes;
+	std::vector<u32> pageOffsets;
+	// pageOffsets.size() * PageSize bytes
+	std::vector<u8> pages;
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+};
+
+// Capture the next rendered frame to the given file
+void start(const std::string& path);
+// Called when a frame is about to be queued for rendering
+void frameStart(TA_context *ctx);
+// Called when the frame isn't rendered (frame skipping)
+void frameSkipped(TA_context *ctx);
+// Called by the render thread once the renderer has processed the frame
+void frameProcessed(TA_context *ctx);
+
+// Restore the PVR registers and VRAM pages of a frame and create its TA context,
+// to be processed and rendered by a renderer like a frame sent by the emulator.
+// Returns nullptr if the frame can't be replayed.
+TA_context *prepare(const Frame& frame);
+// Free a context created by prepare()
+void release(TA_context *ctx);
+
+}
@@ -9,6 +9,7 @@
 #include "pvr_mem.h"
 #include "Renderer_if.h"
 #include "cfg/option.h"
+#include "profiler/frame_tracer.h"
 
 #include <algorithm>
 #include <utility>
@@ -1159,7 +1160,9 @@ static void parseRenderPass(RenderPass& pass, const RenderPass& previousPass, re
 {
 	const bool perPixel = config::RendererType == RenderType::OpenGL_OIT
 			|| config::RendererType == RenderType::DirectX11_OIT
-			|| config::RendererType == RenderType::Vulkan_OIT;
+			|| config::RendererType == RenderType::Vulkan_OIT
+			// the tile renderer sorts translucent triangles per tile
+			|| config::RendererType == RenderType::Software;
 	const bool mergeTranslucent = config::PerStripSorting || perPixel;
 
 	if (config::RenderResolution > 480 && !config::EmulateFramebuffer && config::FixUpscaleBleedingEdge)
@@ -1316,6 +1319,7 @@ static void ta_parse_naomi2(TA_context* ctx, bool primRestart)
 
 void ta_parse(TA_context *ctx, bool primRestart)
 {
+	TRACE_SCOPE("TA parse");
 	if (settings.platform.isNaomi2())
 		ta_parse_naomi2(ctx, primRestart);
 	else
@@ -33,12 +33,25 @@ static bm_Set all_temp_blocks;
 static bm_List del_blocks;
 
 bool unprotected_pages[RAM_SIZE_MAX/PAGE_SIZE];
-static std::set<RuntimeBlockInfo*> blocks_per_page[RAM_SIZE_MAX/PAGE_SIZE];
+// Interval index of the blocks in RAM, keyed by the RAM offset of their first instruction
+static std::multimap<u32, RuntimeBlockInfo*> ram_blocks;
+// Size of the largest indexed block: blocks starting before addr - max_block_size can't overlap addr
+static u32 max_block_size;
+static u32 protected_per_page[RAM_SIZE_MAX/PAGE_SIZE];
+// Write faults on protected pages that modified code
+static u8 code_write_faults[RAM_SIZE_MAX/PAGE_SIZE];
+// Pages with blocks in a 256-byte sub-page that is written to are unprotected
+constexpr u32 SUBPAGE_SIZE = 256;
+// Max code write faults before a page is unprotected
+constexpr u8 MAX_CODE_WRITE_FAULTS = 4;
 
 static bm_Map blkmap;
+static void (*ramWriteListener)(u32 addr);
 // Stats
 u32 protected_blocks;
 u32 unprotected_blocks;
+static u32 discarded_blocks;
+static u32 discard_rate;
 
 #define FPCA(x) ((DynarecCodeEntryPtr&)p_sh4rcb->fpcb[(x>>1)&FPCB_MASK])
 
@@ -163,6 +176,85 @@ RuntimeBlockInfoPtr bm_GetStaleBlock(void* dynarec_code)
 	return NULL;
 }
 
+static void indexBlock(RuntimeBlockInfo *block)
+{
+	if (!IsOnRam(block->addr))
+		return;
+	ram_blocks.emplace(block->addr & RAM_MASK, block);
+	max_block_size = std::max(max_block_size, block->sh4_code_size);
+	if (block->read_only)
+	{
+		for (u32 addr = block->addr & ~PAGE_MASK; addr < block->addr + block->sh4_code_size; addr += PAGE_SIZE)
+			if (protected_per_page[(addr & RAM_MASK) / PAGE_SIZE]++ == 0)
+				bm_LockPage(addr);
+	}
+}
+
+static void unindexBlock(RuntimeBlockInfo *block)
+{
+	if (!IsOnRam(block->addr))
+		return;
+	auto range = ram_blocks.equal_range(block->addr & RAM_MASK);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == block)
+		{
+			ram_blocks.erase(it);
+			if (block->read_only)
+			{
+				for (u32 addr = block->addr & ~PAGE_MASK; addr < block->addr + block->sh4_code_size; addr += PAGE_SIZE)
+					protected_per_page[(addr & RAM_MASK) / PAGE_SIZE]--;
+			}
+			break;
+		}
+	}
+}
+
+// Returns the blocks overlapping the RAM offsets [start, end)
+static std::vector<RuntimeBlockInfo*> findBlocks(u32 start, u32 end, bool protectedOnly)
+{
+	std::vector<RuntimeBlockInfo*> blocks;
+	auto it = ram_blocks.lower_bound(start >= max_block_size ? start - max_block_size : 0);
+	for (; it != ram_blocks.end() && it->first < end; ++it)
+	{
+		RuntimeBlockInfo *block = it->second;
+		if (it->first + block->sh4_code_size > start && (block->read_only || !protectedOnly))
+			blocks.push_back(block);
+	}
+	return blocks;
+}
+
+static void discardBlocks(const std::vector<RuntimeBlockInfo*>& blocks)
+{
+	for (RuntimeBlockInfo *block : blocks)
+		bm_DiscardBlock(block);
+}
+
+void bm_DiscardRange(u32 addr, u32 size)
+{
+	addr &= RAM_MASK;
+	discardBlocks(findBlocks(addr, addr + size, false));
+}
+
+void bm_DiscardCode(void *code, u32 size)
+{
+	std::vector<RuntimeBlockInfo*> blocks;
+	u8 *end = (u8 *)code + size;
+	auto it = blkmap.lower_bound(code);
+	// The previous block may extend into the range
+	if (it != blkmap.begin() && std::prev(it)->second->containsCode(code))
+		--it;
+	for (; it != blkmap.end() && it->first < end; ++it)
+		if (!it->second->temp_block)
+			blocks.push_back(it->second.get());
+	discardBlocks(blocks);
+}
+
+u32 bm_GetDiscardRate()
+{
+	return discard_rate;
+}
+
 void bm_AddBlock(RuntimeBlockInfo* blk)
 {
 	RuntimeBlockInfoPtr block(blk);
@@ -174,6 +266,7 @@ void bm_AddBlock(RuntimeBlockInfo* blk)
 		die("Duplicated block");
 	}
 	blkmap[(void*)block->code] = block;
+	indexBlock(blk);
 
 	verify((void*)bm_GetCode(block->addr) == (void*)ngen_FailedToFindBlock);
 	FPCA(block->addr) = (DynarecCodeEntryPtr)CC_RW2RX(block->code);
@@ -216,11 +309,16 @@ void bm_DiscardBlock(RuntimeBlockInfo* block)
 
 	del_blocks.push_back(block_ptr);
 	block_ptr->Discard();
+	discarded_blocks++;
 }
 
 void bm_Periodical_1s()
 {
 	bm_CleanupDeletedBlocks();
+	discard_rate = discarded_blocks;
+	discarded_blocks = 0;
+	if (discard_rate != 0)
+		DEBUG_LOG(DYNAREC, "%d blocks discarded, %zd in RAM", discard_rate, ram_blocks.size());
 }
 
 void bm_vmem_pagefill(void** ptr, u32 size_bytes)
@@ -302,9 +400,10 @@ void bm_ResetCache()
 	// blkmap includes temp blocks as well
 	all_temp_blocks.clear();
 
-	for (auto& block_list : blocks_per_page)
-		block_list.clear();
-
+	ram_blocks.clear();
+	max_block_size = 0;
+	memset(protected_per_page, 0, sizeof(protected_per_page));
+	memset(code_write_faults, 0, sizeof(code_write_faults));
 	memset(unprotected_pages, 0, sizeof(unprotected_pages));
 
 #ifdef DYNA_OPROF
@@ -329,6 +428,7 @@ void bm_ResetTempCache(bool full)
 		{
 			FPCA(block->addr) = ngen_FailedToFindBlock;
 			blkmap.erase((void*)block->code);
+			unindexBlock(block.get());
 		}
 	}
 	del_blocks.insert(del_blocks.begin(),all_temp_blocks.begin(),all_temp_blocks.end());
@@ -418,15 +518,7 @@ void RuntimeBlockInfo::Discard()
 	}
 	pre_refs.clear();
 
-	if (read_only)
-	{
-		// Remove this block from the per-page block lists
-		for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + this->sh4_code_size; addr += PAGE_SIZE)
-		{
-			auto& block_list = blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE];
-			block_list.erase(this);
-		}
-	}
+	unindexBlock(this);
 }
 
 void RuntimeBlockInfo::SetProtectedFlags()
@@ -449,36 +541,69 @@ void RuntimeBlockInfo::SetProtectedFlags()
 	}
 	this->read_only = true;
 	protected_blocks++;
-	for (u32 addr = this->addr & ~PAGE_MASK; addr < this->addr + sh4_code_size; addr += PAGE_SIZE)
-	{
-		auto& block_list = blocks_per_page[(addr & RAM_MASK) / PAGE_SIZE];
-		if (block_list.empty())
-			bm_LockPage(addr);
-		block_list.insert(this);
-	}
 }
 
 void bm_RamWriteAccess(u32 addr)
 {
 	addr &= RAM_MASK;
-	if (unprotected_pages[addr / PAGE_SIZE])
+	const u32 page = addr / PAGE_SIZE;
+	if (unprotected_pages[page])
 		return;
 
-	unprotected_pages[addr / PAGE_SIZE] = true;
+	// The page must be unlocked so all its protected blocks go
 	bm_UnlockPage(addr);
-	std::set<RuntimeBlockInfo*>& block_list = blocks_per_page[addr / PAGE_SIZE];
-	if (!block_list.empty())
+	std::vector<RuntimeBlockInfo*> blocks = findBlocks(page * PAGE_SIZE, (page + 1) * PAGE_SIZE, true);
+	if (!blocks.empty())
+		DEBUG_LOG(DYNAREC, "bm_RamWriteAccess write access to %08x pc %08x", addr, Sh4cntx.pc);
+	// If the write hit code, the page is likely being loaded with new code and can be protected again.
+	// Otherwise it holds both code and data being written to so its blocks are checked instead.
+	const u32 subpage = addr & ~(SUBPAGE_SIZE - 1);
+	bool codeWritten = false;
+	for (RuntimeBlockInfo *block : blocks)
+		if ((block->addr & RAM_MASK) < subpage + SUBPAGE_SIZE && (block->addr & RAM_MASK) + block->sh4_code_size > subpage)
+			codeWritten = true;
+	if (!codeWritten || ++code_write_faults[page] >= MAX_CODE_WRITE_FAULTS)
+		unprotected_pages[page] = true;
+	discardBlocks(blocks);
+	verify(protected_per_page[page] == 0);
+
+	if (ramWriteListener != nullptr)
+		ramWriteListener(addr);
+}
+
+void bm_RamWriteAccess(u32 addr, u32 size)
+{
+	if (size == 0)
+		return;
+	addr &= RAM_MASK;
+	const u32 end = std::min(addr + size, RAM_SIZE);
+	discardBlocks(findBlocks(addr, end, false));
+	for (u32 page = addr / PAGE_SIZE; page * PAGE_SIZE < end; page++)
 	{
-		std::vector<RuntimeBlockInfo*> list_copy;
-		list_copy.insert(list_copy.begin(), block_list.begin(), block_list.end());
-		if (!list_copy.empty())
-			DEBUG_LOG(DYNAREC, "bm_RamWriteAccess write access to %08x pc %08x", addr, Sh4cntx.pc);
-		for (auto& block : list_copy)
-			bm_DiscardBlock(block);
-		verify(block_list.empty());
+		if (unprotected_pages[page])
+			continue;
+		bm_UnlockPage(page * PAGE_SIZE);
+		if (ramWriteListener != nullptr)
+			ramWriteListener(page * PAGE_SIZE);
 	}
 }
 
+void bm_RamWriteDone(u32 addr, u32 size)
+{
+	if (size == 0)
+		return;
+	addr &= RAM_MASK;
+	const u32 end = std::min(addr + size, RAM_SIZE);
+	for (u32 page = addr / PAGE_SIZE; page * PAGE_SIZE < end; page++)
+		if (!unprotected_pages[page] && protected_per_page[page] != 0)
+			bm_LockPage(page * PAGE_SIZE);
+}
+
+void bm_SetRamWriteListener(void (*listener)(u32 addr))
+{
+	ramWriteListener = listener;
+}
+
 u32 bm_getRamOffset(void *p)
 {
 #ifndef __SWITCH__
@@ -75,6 +75,12 @@ RuntimeBlockInfoPtr DYNACALL bm_GetBlock(u32 addr);
 
 void bm_AddBlock(RuntimeBlockInfo* blk);
 void bm_DiscardBlock(RuntimeBlockInfo* block);
+// Discard the blocks in RAM overlapping [addr, addr + size)
+void bm_DiscardRange(u32 addr, u32 size);
+// Discard the blocks whose host code overlaps [code, code + size)
+void bm_DiscardCode(void *code, u32 size);
+// Number of blocks discarded during the last second
+u32 bm_GetDiscardRate();
 void bm_Reset();
 void bm_ResetCache();
 void bm_ResetTempCache(bool full);
@@ -95,9 +101,15 @@ static inline bool bm_IsRamPageProtected(u32 addr)
 
 bool bm_RamWriteAccess(void *p);
 void bm_RamWriteAccess(u32 addr);
+// Discard the blocks in the RAM range [addr, addr + size) and unlock its pages so that the host can write to it.
+// bm_RamWriteDone() must be called once written to protect the remaining blocks again.
+void bm_RamWriteAccess(u32 addr, u32 size);
+void bm_RamWriteDone(u32 addr, u32 size);
 void bm_LockPage(u32 addr, u32 size = PAGE_SIZE);
 void bm_UnlockPage(u32 addr, u32 size = PAGE_SIZE);
 u32 bm_getRamOffset(void *p);
+// Called with the RAM offset when a protected page is written to
+void bm_SetRamWriteListener(void (*listener)(u32 addr));
 
 #else
 
@@ -105,10 +117,13 @@ inline static bool bm_RamWriteAccess(void *p) {
 	return false;
 }
 inline static void bm_RamWriteAccess(u32 addr) {}
+inline static void bm_RamWriteAccess(u32 addr, u32 size) {}
+inline static void bm_RamWriteDone(u32 addr, u32 size) {}
 inline static void bm_LockPage(u32 addr, u32 size = PAGE_SIZE) {}
 inline static void bm_UnlockPage(u32 addr, u32 size = PAGE_SIZE) {}
 inline static u32 bm_getRamOffset(void *p) {
 	return 0;
 }
+inline static void bm_SetRamWriteListener(void (*listener)(u32 addr)) {}
 
 #endif
@@ -12,12 +12,19 @@
 #include "ngen.h"
 #include "decoder.h"
 #include "oslib/virtmem.h"
+#include "oslib/oslib.h"
 
 #if FEAT_SHREC != DYNAREC_NONE
 
 constexpr u32 CODE_SIZE = 10_MB;
 constexpr u32 TEMP_CODE_SIZE = 1_MB;
 constexpr u32 FULL_SIZE = CODE_SIZE + TEMP_CODE_SIZE;
+// Free space needed to compile the largest block
+#if FEAT_SHREC == DYNAREC_VM
+constexpr u32 MIN_FREE_SPACE = 64_KB;
+#else
+constexpr u32 MIN_FREE_SPACE = 32_KB;
+#endif
 
 #if defined(_WIN32) || FEAT_SHREC != DYNAREC_JIT || defined(TARGET_IPHONE) || defined(TARGET_ARM_MAC)
 static u8 *SH4_TCB;
@@ -38,6 +45,25 @@ static u8* CodeCache;
 static u8* TempCodeCache;
 ptrdiff_t cc_rx_offset;
 
+// Once full, the code cache is split into regions that are evicted in allocation order,
+// oldest first. Hot code evicted with a region is recompiled into the newest one.
+constexpr u32 CODE_REGIONS = 8;
+// Left untouched at the end of the code cache (x64 unwind info)
+constexpr u32 CODE_TAIL_SIZE = 4_KB;
+// Offset of the first block, after the code emitted by the backend on reset
+static u32 codeStart;
+// End of the current region
+static u32 codeEnd = CODE_SIZE;
+static int codeRegion = -1;
+
+static struct {
+	u64 periodStart;
+	u64 compileTime;	// microseconds
+	u32 blocks;
+	u32 flushes;
+	u32 evictions;
+} cacheStats;
+
 static std::unordered_set<u32> smc_hotspots;
 
 static Sh4CodeBuffer codeBuffer;
@@ -62,7 +88,7 @@ u32 Sh4CodeBuffer::getFreeSpace()
 	if (tempBuffer)
 		return TEMP_CODE_SIZE - tempLastAddr;
 	else
-		return CODE_SIZE - lastAddr;
+		return codeEnd - lastAddr;
 }
 
 void *Sh4CodeBuffer::getBase()
@@ -78,9 +104,33 @@ u32 Sh4CodeBuffer::getSize()
 void Sh4CodeBuffer::reset(bool temporary)
 {
 	if (temporary)
+	{
 		tempLastAddr = 0;
+	}
 	else
+	{
 		lastAddr = 0;
+		codeEnd = CODE_SIZE;
+		codeRegion = -1;
+	}
+}
+
+void Sh4CodeBuffer::setRegion(u32 start, u32 end)
+{
+	lastAddr = start;
+	codeEnd = end;
+}
+
+// Evict the oldest region of the code cache and emit new code there
+static void evictCodeRegion()
+{
+	const u32 regionSize = ((CODE_SIZE - CODE_TAIL_SIZE - codeStart) / CODE_REGIONS) & ~63;
+	codeRegion = (codeRegion + 1) % CODE_REGIONS;
+	const u32 start = codeStart + codeRegion * regionSize;
+	DEBUG_LOG(DYNAREC, "Evicting code region %d", codeRegion);
+	bm_DiscardCode(&CodeCache[start], regionSize);
+	codeBuffer.setRegion(start, start + regionSize);
+	cacheStats.evictions++;
 }
 
 void Sh4Recompiler::clear_temp_cache(bool full)
@@ -95,8 +145,10 @@ void Sh4Recompiler::ResetCache()
 	INFO_LOG(DYNAREC, "recSh4:Dynarec Cache clear at %08X free space %d", getContext()->pc, codeBuffer.getFreeSpace());
 	codeBuffer.reset(false);
 	bm_ResetCache();
+	codeStart = (u8 *)codeBuffer.get() - CodeCache;
 	smc_hotspots.clear();
 	clear_temp_cache(true);
+	cacheStats.flushes++;
 }
 
 void Sh4Recompiler::Run()
@@ -171,8 +223,10 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 {
 	const u32 pc = Sh4cntx.pc;
 
-	if (codeBuffer.getFreeSpace() < 32_KB || pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300)
+	if (pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300)
 		Sh4Recompiler::Instance->ResetCache();
+	else if (codeBuffer.getFreeSpace() < MIN_FREE_SPACE)
+		evictCodeRegion();
 
 	RuntimeBlockInfo* rbi = sh4Dynarec->allocateBlock();
 
@@ -185,7 +239,7 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 	if (smc_hotspots.find(rbi->addr) != smc_hotspots.end())
 	{
 		codeBuffer.useTempBuffer(true);
-		if (codeBuffer.getFreeSpace() < 32_KB)
+		if (codeBuffer.getFreeSpace() < MIN_FREE_SPACE)
 			Sh4Recompiler::Instance->clear_temp_cache(false);
 		rbi->temp_block = true;
 		if (rbi->read_only)
@@ -193,6 +247,7 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 	}
 	bool do_opts = !rbi->temp_block;
 	bool block_check = !rbi->read_only;
+	const u64 startTime = getTimeUs();
 	sh4Dynarec->compile(rbi, block_check, do_opts);
 	verify(rbi->code != nullptr);
 
@@ -200,6 +255,18 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 
 	codeBuffer.useTempBuffer(false);
 
+	const u64 now = getTimeUs();
+	cacheStats.compileTime += now - startTime;
+	cacheStats.blocks++;
+	if (now - cacheStats.periodStart >= 60'000'000)
+	{
+		if (cacheStats.periodStart != 0)
+			INFO_LOG(DYNAREC, "Last minute: %d blocks compiled in %d ms, %d cache flushes, %d region evictions",
+					cacheStats.blocks, (int)(cacheStats.compileTime / 1000), cacheStats.flushes, cacheStats.evictions);
+		cacheStats = {};
+		cacheStats.periodStart = now;
+	}
+
 	return rbi->code;
 }
 
@@ -231,22 +298,23 @@ DynarecCodeEntryPtr DYNACALL rdv_BlockCheckFail(u32 addr)
 {
 	DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail @ %08x", addr);
 	u32 blockcheck_failures = 0;
-	if (mmu_enabled())
+	RuntimeBlockInfoPtr block = bm_GetBlock(addr);
+	if (block)
 	{
-		RuntimeBlockInfoPtr block = bm_GetBlock(addr);
-		if (block)
+		blockcheck_failures = block->blockcheck_failures + 1;
+		if (blockcheck_failures > 5)
 		{
-			blockcheck_failures = block->blockcheck_failures + 1;
-			if (blockcheck_failures > 5)
-			{
-				bool inserted = smc_hotspots.insert(addr).second;
-				if (inserted)
-					DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail SMC hotspot @ %08x fails %d", addr, blockcheck_failures);
-			}
-			bm_DiscardBlock(block.get());
+			bool inserted = smc_hotspots.insert(addr).second;
+			if (inserted)
+				DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail SMC hotspot @ %08x fails %d", addr, blockcheck_failures);
 		}
+		if (!mmu_enabled() && IsOnRam(block->addr))
+			// Other blocks overlapping the modified code are stale too
+			bm_DiscardRange(block->addr, block->sh4_code_size);
+		else
+			bm_DiscardBlock(block.get());
 	}
-	else
+	else if (!mmu_enabled())
 	{
 		Sh4cntx.pc = addr;
 		Sh4Recompiler::Instance->ResetCache();
@@ -299,6 +367,9 @@ void* DYNACALL rdv_LinkBlock(u8* code,u32 dpc)
 	}
 
 	DynarecCodeEntryPtr rv = rdv_FindOrCompile();  // Returns rx ptr
+	// The block may have been evicted and its code overwritten
+	if (!stale_block && bm_GetBlock(code) != rbi)
+		stale_block = true;
 
 	if (!mmu_enabled() && !stale_block)
 	{
@@ -358,12 +429,18 @@ void Sh4Recompiler::Init()
 	if (addrspace::virtmemEnabled())
 		verify(&mem_b[0] == ((u8*)getContext()->sq_buffer + sizeof(Sh4Context) + 0x0C000000));
 
+#if FEAT_SHREC == DYNAREC_VM
+	// Bytecode doesn't need executable pages
+	CodeCache = (u8 *)allocAligned(PAGE_SIZE, FULL_SIZE);
+	bool rc = CodeCache != nullptr;
+#else
 	// Call the platform-specific magic to make the pages RWX
 	CodeCache = nullptr;
 #ifdef FEAT_NO_RWX_PAGES
 	bool rc = virtmem::prepare_jit_block(SH4_TCB, FULL_SIZE, (void**)&CodeCache, &cc_rx_offset);
 #else
 	bool rc = virtmem::prepare_jit_block(SH4_TCB, FULL_SIZE, (void**)&CodeCache);
+#endif
 #endif
 	verify(rc);
 	// Ensure the pointer returned is non-null
@@ -372,12 +449,16 @@ void Sh4Recompiler::Init()
 	TempCodeCache = CodeCache + CODE_SIZE;
 	sh4Dynarec->init(*getContext(), codeBuffer);
 	bm_ResetCache();
+	codeStart = (u8 *)codeBuffer.get() - CodeCache;
 }
 
 void Sh4Recompiler::Term()
 {
 	INFO_LOG(DYNAREC, "Sh4Recompiler::Term");
-#ifdef FEAT_NO_RWX_PAGES
+#if FEAT_SHREC == DYNAREC_VM
+	if (CodeCache != nullptr)
+		freeAligned(CodeCache);
+#elif defined(FEAT_NO_RWX_PAGES)
 	if (CodeCache != nullptr)
 		virtmem::release_jit_block(CodeCache, (u8 *)CodeCache + cc_rx_offset, FULL_SIZE);
 #else
@@ -75,6 +75,8 @@ public:
 	void useTempBuffer(bool enable) { tempBuffer = enable; }
 	// Reset main or temp code buffer position to 0 (internal use)
 	void reset(bool temporary);
+	// Restrict the main code buffer to [start, end) and set its position to start (internal use)
+	void setRegion(u32 start, u32 end);
 
 private:
 	u32 lastAddr = 0;
@@ -0,0 +1,290 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+	Cached interpreter.
+	Basic blocks are decoded once into arrays of opcode handlers, then executed without
+	fetching and decoding each instruction. Blocks in RAM are invalidated by the block manager
+	page protection, or checked against memory before each execution if their page isn't protected.
+	Address translation isn't cached so the plain interpreter is used when the MMU is enabled.
+*/
+#include "types.h"
+#include "../sh4_interpreter.h"
+#include "../sh4_core.h"
+#include "../sh4_interrupts.h"
+#include "../sh4_sched.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "debug/gdb_server.h"
+
+static Sh4CachedInterpreter *cachedInterpreter;
+
+static void ramWriteListener(u32 addr)
+{
+	if (cachedInterpreter != nullptr)
+		cachedInterpreter->ramPageWritten(addr);
+}
+
+// Boot ROM is never written to
+static bool isRom(u32 addr) {
+	return (addr & 0x1FE00000) == 0;
+}
+
+// RAM pages that can be write-protected. Like the dynarec, don't protect the first 64 KB (BIOS and IP.BIN)
+static bool isProtectable(u32 addr)
+{
+#if FEAT_SHREC != DYNAREC_NONE
+	return IsOnRam(addr) && (addr & 0x1FFF0000) != 0x0c000000 && bm_IsRamPageProtected(addr);
+#else
+	return false;
+#endif
+}
+
+std::unique_ptr<Sh4CachedInterpreter::Block> Sh4CachedInterpreter::buildBlock(u32 pc)
+{
+	std::unique_ptr<Block> block = std::make_unique<Block>();
+	block->addr = pc;
+	u32 addr = pc;
+	// Blocks never cross a page boundary
+	do {
+		u16 op = IReadMem16(addr);
+		const sh4_opcodelistentry *desc = OpDesc[op];
+		block->code.push_back({ OpPtr[op], op, desc->IsFloatingPoint() });
+		addr += 2;
+		if (desc->type & WritesPC)
+			break;
+	} while (block->code.size() < MaxBlockSize && (addr & PAGE_MASK) != 0);
+
+	if (isRom(pc))
+	{
+		block->checked = false;
+	}
+	else if (isProtectable(pc))
+	{
+		block->checked = false;
+		std::vector<u32>& list = pageBlocks[(pc & RAM_MASK) / PAGE_SIZE];
+		if (list.empty())
+			bm_LockPage(pc);
+		list.push_back(pc);
+	}
+	else
+	{
+		block->checked = true;
+	}
+	stats.blocks++;
+
+	return block;
+}
+
+bool Sh4CachedInterpreter::checkBlock(const Block& block)
+{
+	const u32 size = block.code.size() * 2;
+	if (IsOnRam(block.addr))
+	{
+		const u16 *p = (const u16 *)GetMemPtr(block.addr, size);
+		if (p != nullptr)
+		{
+			for (const Instruction& insn : block.code)
+				if (insn.op != *p++)
+					return false;
+			return true;
+		}
+	}
+	u32 addr = block.addr;
+	for (const Instruction& insn : block.code)
+	{
+		if (insn.op != IReadMem16(addr))
+			return false;
+		addr += 2;
+	}
+	return true;
+}
+
+void Sh4CachedInterpreter::discardBlock(u32 pc)
+{
+	Block *&entry = lookup[(pc >> 1) & (LookupSize - 1)];
+	if (entry != nullptr && entry->addr == pc)
+		entry = nullptr;
+	blocks.erase(pc);
+}
+
+void Sh4CachedInterpreter::ramPageWritten(u32 addr)
+{
+	// Called from the fault handler: just record the page
+	if (writtenPageCount < MaxWrittenPages)
+		writtenPages[writtenPageCount] = addr / PAGE_SIZE;
+	writtenPageCount++;
+	pagesWritten = true;
+}
+
+void Sh4CachedInterpreter::discardWrittenPages()
+{
+	pagesWritten = false;
+	if (writtenPageCount > MaxWrittenPages)
+	{
+		// Too many pages written to remember them all
+		writtenPageCount = 0;
+		for (std::vector<u32>& list : pageBlocks)
+		{
+			for (u32 pc : list)
+				discardBlock(pc);
+			if (!list.empty())
+			{
+				stats.invalidations++;
+				list.clear();
+			}
+		}
+		return;
+	}
+	for (u32 i = 0; i < writtenPageCount; i++)
+	{
+		std::vector<u32>& list = pageBlocks[writtenPages[i]];
+		for (u32 pc : list)
+			discardBlock(pc);
+		if (!list.empty())
+		{
+			stats.invalidations++;
+			list.clear();
+		}
+	}
+	writtenPageCount = 0;
+}
+
+const Sh4CachedInterpreter::Block& Sh4CachedInterpreter::getBlock(u32 pc)
+{
+	if (pagesWritten)
+		discardWrittenPages();
+
+	Block *&entry = lookup[(pc >> 1) & (LookupSize - 1)];
+	if (entry == nullptr || entry->addr != pc)
+	{
+		if (pc & 1)
+			// address error
+			throw SH4ThrownException(pc, Sh4Ex_AddressErrorRead);
+		std::unique_ptr<Block>& block = blocks[pc];
+		if (block == nullptr)
+			block = buildBlock(pc);
+		entry = block.get();
+	}
+	else if (entry->checked && !checkBlock(*entry))
+	{
+		// Code has been modified
+		stats.checkFailures++;
+		std::unique_ptr<Block>& block = blocks[pc];
+		block = buildBlock(pc);
+		entry = block.get();
+	}
+	return *entry;
+}
+
+void Sh4CachedInterpreter::executeBlock(const Block& block)
+{
+	u32 pc = block.addr;
+	for (const Instruction& insn : block.code)
+	{
+		pc += 2;
+		ctx->pc = pc;
+		if (insn.fpu && ctx->sr.FD == 1)
+			throw SH4ThrownException(pc - 2, Sh4Ex_FpuDisabled);
+		insn.handler(ctx, insn.op);
+		sh4cycles.executeCycles(insn.op);
+		// Exit on branch, end of timeslice, code modification or if the MMU has been enabled
+		if (ctx->pc != pc || ctx->cycle_counter <= 0 || pagesWritten || mmu_enabled())
+			break;
+	}
+}
+
+void Sh4CachedInterpreter::Run()
+{
+	Instance = this;
+	ctx->restoreHostRoundingMode();
+
+	try {
+		do
+		{
+			try {
+				do
+				{
+					if (mmu_enabled())
+					{
+						u32 op = ReadNexOp();
+						ExecuteOpcode(op);
+					}
+					else
+					{
+						executeBlock(getBlock(ctx->pc));
+					}
+				} while (ctx->cycle_counter > 0);
+				ctx->cycle_counter += SH4_TIMESLICE;
+				UpdateSystem_INTC();
+			} catch (const SH4ThrownException& ex) {
+				Do_Exception(ex.epc, ex.expEvn);
+				// an exception requires the instruction pipeline to drain, so approx 5 cycles
+				sh4cycles.addCycles(5 * CPU_RATIO);
+			}
+		} while (ctx->CpuRunning);
+	} catch (const debugger::Stop&) {
+	}
+
+	ctx->CpuRunning = false;
+	Instance = nullptr;
+}
+
+void Sh4CachedInterpreter::ResetCache()
+{
+	for (std::vector<u32>& list : pageBlocks)
+	{
+		if (!list.empty())
+		{
+			bm_UnlockPage(list.front());
+			list.clear();
+		}
+	}
+	blocks.clear();
+	lookup.fill(nullptr);
+	writtenPageCount = 0;
+	pagesWritten = false;
+}
+
+void Sh4CachedInterpreter::Reset(bool hard)
+{
+	super::Reset(hard);
+	ResetCache();
+}
+
+void Sh4CachedInterpreter::Init()
+{
+	super::Init();
+	pageBlocks.resize(RAM_SIZE_MAX / PAGE_SIZE);
+	cachedInterpreter = this;
+	bm_SetRamWriteListener(ramWriteListener);
+}
+
+void Sh4CachedInterpreter::Term()
+{
+	INFO_LOG(INTERPRETER, "Cached interpreter: %d blocks built, %d modified, %d pages invalidated",
+			stats.blocks, stats.checkFailures, stats.invalidations);
+	ResetCache();
+	bm_SetRamWriteListener(nullptr);
+	cachedInterpreter = nullptr;
+	super::Term();
+}
+
+Sh4Executor *Get_Sh4CachedInterpreter()
+{
+	return new Sh4CachedInterpreter();
+}
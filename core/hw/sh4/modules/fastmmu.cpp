@@ -47,6 +47,40 @@ static TLB_LinkedEntry full_table[65536];
 static u32 full_table_size;
 static TLB_LinkedEntry *entry_buckets[NBUCKETS];
 
+// Direct-mapped cache of the translations found in the table, indexed by a hash of the 4k virtual page number
+// so that the same pages of different WinCE process slots don't collide.
+// Entries are tagged with the full page number and the ASID in effect when they were filled.
+struct TLB_CacheEntry {
+	u32 tag;		// see tlb_cache_tag(). 0 if invalid
+	u32 paddr;		// physical address of the 4k page
+};
+#define TLB_CACHE_BITS 13
+static TLB_CacheEntry tlb_cache[1 << TLB_CACHE_BITS];
+
+static inline TLB_CacheEntry& tlb_cache_entry(u32 va)
+{
+	return tlb_cache[((va >> 12) * 0x9E3779B1) >> (32 - TLB_CACHE_BITS)];
+}
+
+static inline u32 tlb_cache_tag(u32 va)
+{
+	return 0x80000000 | (CCN_PTEH.ASID << 20) | (va >> 12);
+}
+
+static void tlb_cache_flush()
+{
+	memset(tlb_cache, 0, sizeof(tlb_cache));
+}
+
+// Invalidate the cached translations of the pages covered by a new entry
+static void tlb_cache_invalidate(u32 address, u32 mask)
+{
+	const u32 pages = (~mask >> 12) + 1;
+	address &= mask;
+	for (u32 i = 0; i < pages; i++)
+		tlb_cache_entry(address + i * 4096).tag = 0;
+}
+
 static u16 bucket_index(u32 address, int size, u32 asid)
 {
 	return ((address >> 20) ^ (address >> 12) ^ (address | asid | (size << 8))) & (NBUCKETS - 1);
@@ -54,8 +88,6 @@ static u16 bucket_index(u32 address, int size, u32 asid)
 
 static void cache_entry(const TLB_Entry &entry)
 {
-	if (entry.Data.SZ0 == 0 && entry.Data.SZ1 == 0)
-		return;
 	if (full_table_size >= std::size(full_table))
 		return;
 
@@ -71,6 +103,7 @@ static void flush_cache()
 {
 	full_table_size = 0;
 	memset(entry_buckets, 0, sizeof(entry_buckets));
+	tlb_cache_flush();
 }
 
 template<u32 size>
@@ -109,6 +142,9 @@ static bool find_entry(u32 address, const TLB_Entry **ret_entry)
 	// 1m
 	if (find_entry_by_page_size<3>(address, ret_entry))
 		return true;
+	// 1k
+	if (find_entry_by_page_size<0>(address, ret_entry))
+		return true;
 	return false;
 }
 
@@ -189,6 +225,7 @@ bool UTLB_Sync(u32 entry)
 	lru_address = tlb_entry.Address.VPN << 10;
 
 	cache_entry(tlb_entry);
+	tlb_cache_invalidate(lru_address, lru_mask);
 
 	if (!mmu_enabled() && (tlb_entry.Address.VPN & (0xFC000000 >> 10)) == (0xE0000000 >> 10))
 	{
@@ -222,6 +259,12 @@ MmuError mmu_full_lookup(u32 va, const TLB_Entry** tlb_entry_ret, u32& rv)
 			return MmuError::NONE;
 		}
 	}
+	TLB_CacheEntry& cached = tlb_cache_entry(va);
+	if (tlb_entry_ret == nullptr && cached.tag == tlb_cache_tag(va))
+	{
+		rv = cached.paddr | (va & 0xfff);
+		return MmuError::NONE;
+	}
 	const TLB_Entry *localEntry;
 	if (tlb_entry_ret == nullptr)
 		tlb_entry_ret = &localEntry;
@@ -234,6 +277,13 @@ MmuError mmu_full_lookup(u32 va, const TLB_Entry** tlb_entry_ret, u32& rv)
 		lru_mask = mask;
 		lru_address = ((*tlb_entry_ret)->Address.VPN << 10);
 
+		// 1k pages can't be cached as 4k translations
+		if ((mask & 0xfff) == 0)
+		{
+			cached.tag = tlb_cache_tag(va);
+			cached.paddr = rv & ~0xfff;
+		}
+
 		return MmuError::NONE;
 	}
 
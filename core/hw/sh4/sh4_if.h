@@ -239,6 +239,7 @@ extern Sh4RCB* p_sh4rcb;
 
 //Get an interface to sh4 interpreter
 Sh4Executor *Get_Sh4Interpreter();
+Sh4Executor *Get_Sh4CachedInterpreter();
 Sh4Executor *Get_Sh4Recompiler();
 
 enum Sh4ExceptionCode : u16
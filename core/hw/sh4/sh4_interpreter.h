@@ -1,6 +1,11 @@
 #pragma once
 #include "types.h"
 #include "sh4_cycles.h"
+#include "sh4_opcode_list.h"
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 class Sh4Interpreter : public Sh4Executor
 {
@@ -23,7 +28,6 @@ public:
 protected:
 	Sh4Context *ctx = nullptr;
 
-private:
 	void ExecuteOpcode(u16 op);
 	u16 ReadNexOp();
 
@@ -35,3 +39,61 @@ private:
 	static constexpr int CPU_RATIO = 8;
 #endif
 };
+
+// Interpreter executing predecoded basic blocks.
+// Used when dynamic recompilation isn't available or allowed.
+class Sh4CachedInterpreter : public Sh4Interpreter
+{
+	using super = Sh4Interpreter;
+
+public:
+	void Run() override;
+	void ResetCache() override;
+	void Reset(bool hard) override;
+	void Init() override;
+	void Term() override;
+
+	// Called when a write-protected RAM page containing code is written to
+	void ramPageWritten(u32 addr);
+
+private:
+	struct Instruction
+	{
+		OpCallFP *handler;
+		u16 op;
+		bool fpu;
+	};
+	struct Block
+	{
+		u32 addr;
+		// Opcodes must be compared with memory before executing
+		bool checked;
+		std::vector<Instruction> code;
+	};
+
+	const Block& getBlock(u32 pc);
+	std::unique_ptr<Block> buildBlock(u32 pc);
+	bool checkBlock(const Block& block);
+	void executeBlock(const Block& block);
+	void discardBlock(u32 pc);
+	void discardWrittenPages();
+
+	static constexpr u32 MaxBlockSize = 64;		// instructions
+	static constexpr u32 LookupSize = 4096;
+	static constexpr u32 MaxWrittenPages = 64;
+
+	std::unordered_map<u32, std::unique_ptr<Block>> blocks;
+	std::array<Block *, LookupSize> lookup {};
+	// Blocks in each write-protected RAM page
+	std::vector<std::vector<u32>> pageBlocks;
+	// Set from the fault handler
+	std::array<u32, MaxWrittenPages> writtenPages {};
+	u32 writtenPageCount = 0;
+	bool pagesWritten = false;
+
+	struct {
+		u32 blocks;
+		u32 checkFailures;
+		u32 invalidations;
+	} stats {};
+};
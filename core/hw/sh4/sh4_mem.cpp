@@ -11,6 +11,8 @@
 #include "hw/pvr/pvr_mem.h"
 #include "hw/mem/addrspace.h"
 #include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/mem/mem_watch.h"
 #include "cfg/option.h"
 
 #ifdef STRICT_MODE
@@ -225,6 +227,13 @@ void WriteMemBlock_nommu_dma(u32 dst, u32 src, u32 size)
 
 void WriteMemBlock_nommu_ptr(u32 dst, const u32 *src, u32 size)
 {
+	u8 *ram = GetRamDmaPtr(dst, size);
+	if (ram != nullptr)
+	{
+		memcpy(ram, src, size);
+		ReleaseRamDmaPtr(dst, size);
+		return;
+	}
 	bool dst_ismem;
 
 	void* dst_ptr = addrspace::writeConst(dst, dst_ismem, 4);
@@ -272,6 +281,20 @@ void WriteMemBlock_nommu_sq(u32 dst, const SQBuffer *src)
 	}
 }
 
+void ReadMemBlock_nommu(u32 src, u8 *dst, u32 size)
+{
+	const u8 *psrc = GetMemPtr(src, size);
+	if (psrc != nullptr)
+	{
+		memcpy(dst, psrc, size);
+	}
+	else
+	{
+		for (u32 i = 0; i < size; i++)
+			dst[i] = ReadMem8_nommu(src + i);
+	}
+}
+
 //Get pointer to ram area , nullptr if error
 //For debugger(gdb) - dynarec
 u8* GetMemPtr(u32 addr, u32 size)
@@ -290,6 +313,27 @@ u8* GetMemPtr(u32 addr, u32 size)
 	return nullptr;
 }
 
+u8 *GetRamDmaPtr(u32 addr, u32 size)
+{
+	if (size == 0 || !IsOnRam(addr))
+		return nullptr;
+	u8 *p = GetMemPtr(addr, size);
+	if (p != nullptr)
+	{
+		// Dirty pages must be saved before they're unlocked
+		if (memwatch::enabled())
+			memwatch::ramWatcher.hit(addr & RAM_MASK, size);
+		// Unlock the pages beforehand instead of taking a write fault for each of them
+		bm_RamWriteAccess(addr, size);
+	}
+	return p;
+}
+
+void ReleaseRamDmaPtr(u32 addr, u32 size)
+{
+	bm_RamWriteDone(addr, size);
+}
+
 void SetMemoryHandlers()
 {
 #ifdef STRICT_MODE
@@ -52,6 +52,7 @@ extern WriteMem64Func WriteMem64;
 void WriteMemBlock_nommu_ptr(u32 dst, const u32 *src, u32 size);
 void WriteMemBlock_nommu_sq(u32 dst, const SQBuffer *src);
 void WriteMemBlock_nommu_dma(u32 dst, u32 src, u32 size);
+void ReadMemBlock_nommu(u32 src, u8 *dst, u32 size);
 
 //Init/Res/Term
 void mem_Init();
@@ -62,6 +63,58 @@ void mem_map_default();
 //Get pointer to ram area , 0 if error
 //For debugger(gdb) - dynarec
 u8* GetMemPtr(u32 Addr,u32 size);
+// Get a pointer to system RAM for a DMA transfer of size bytes, nullptr if not in RAM.
+// Code blocks in the destination range are invalidated so the caller can write to it directly.
+// ReleaseRamDmaPtr() must be called once the transfer is done.
+u8 *GetRamDmaPtr(u32 addr, u32 size);
+void ReleaseRamDmaPtr(u32 addr, u32 size);
+
+// Read-only view of main system RAM that bypasses the memory handlers.
+// Offsets are relative to the start of system RAM.
+// Used by the achievements frontend to read guest memory at no cost.
+class RamView
+{
+public:
+	RamView() {
+		refresh();
+	}
+
+	// System RAM may be reallocated when the platform changes
+	void refresh()
+	{
+		data = &mem_b[0];
+		size = data != nullptr ? RAM_SIZE : 0;
+	}
+
+	bool contains(u32 offset, u32 len) const {
+		return offset <= size && len <= size - offset;
+	}
+
+	const u8 *ptr(u32 offset) const {
+		return data + offset;
+	}
+
+	// Returns the number of bytes read, or 0 if the range isn't entirely in system RAM
+	u32 read(u32 offset, void *dst, u32 len) const
+	{
+		if (!contains(offset, len))
+			return 0;
+		memcpy(dst, data + offset, len);
+		return len;
+	}
+
+	template<typename T>
+	T read(u32 offset) const
+	{
+		T v{};
+		read(offset, &v, sizeof(T));
+		return v;
+	}
+
+private:
+	const u8 *data = nullptr;
+	u32 size = 0;
+};
 
 static inline bool IsOnRam(u32 addr)
 {
@@ -125,7 +125,7 @@ Disc* cdi_parse(const char* file, std::vector<u8> *digest)
 						WARN_LOG(GDROM, "Cannot re-open file '%s' errno %d", file, errno);
 						throw FlycastException("Cannot re-open CDI file");
 					}
-					t.file = new RawTrackFile(trackFile, track.position + track.pregap_length * track.sector_size, t.StartFAD, track.sector_size);
+					t.file = createRawTrackFile(trackFile, track.position + track.pregap_length * track.sector_size, t.StartFAD, t.EndFAD, track.sector_size);
 
 					rv->tracks.push_back(t);
 
@@ -4,6 +4,20 @@
 #include "stdclass.h"
 #include "hw/sh4/sh4_sched.h"
 #include "serialize.h"
+#include "sector_prefetch.h"
+#include "profiler/frame_tracer.h"
+#if !defined(_WIN32) && !defined(__SWITCH__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#else
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+#define HAVE_MMAP_TRACKS
+#endif
 
 Disc* chd_parse(const char* file, std::vector<u8> *digest);
 Disc* gdi_parse(const char* file, std::vector<u8> *digest);
@@ -28,16 +42,18 @@ constexpr Disc* (*drivers[])(const char* path, std::vector<u8> *digest)
 
 static u8 q_subchannel[96];
 
-static bool convertSector(u8* in_buff , u8* out_buff , int from , int to,int sector)
+static SectorPrefetcher prefetcher;
+
+static bool convertSector(const u8* in_buff , u8* out_buff , int from , int to, u8 *subcode)
 {
 	//get subchannel data, if any
 	if (from == 2448)
 	{
-		memcpy(q_subchannel, in_buff + 2352, 96);
+		memcpy(subcode, in_buff + 2352, 96);
 		from -= 96;
 	}
 	else
-		memset(q_subchannel, 0, sizeof(q_subchannel));
+		memset(subcode, 0, 96);
 
 	//if no conversion
 	if (to == from)
@@ -83,6 +99,145 @@ static bool convertSector(u8* in_buff , u8* out_buff , int from , int to,int sec
 	return true;
 }
 
+#ifdef HAVE_MMAP_TRACKS
+// Returns true if the file is on a local file system.
+// A mapped file that is truncated or becomes unavailable raises SIGBUS on access,
+// which is much more likely to happen with network and FUSE file systems.
+static bool isLocalFile(int fd)
+{
+#ifdef __linux__
+	struct statfs fs;
+	if (fstatfs(fd, &fs) != 0)
+		return false;
+	switch ((u32)fs.f_type)
+	{
+	case 0x6969:		// NFS
+	case 0x517B:		// SMB
+	case 0xFF534D42:	// CIFS
+	case 0xFE534D42:	// SMB2
+	case 0x65735546:	// FUSE
+	case 0x01021997:	// 9P
+	case 0x73757245:	// Coda
+	case 0x5346414F:	// AFS
+	case 0x00C36400:	// Ceph
+		return false;
+	default:
+		return true;
+	}
+#elif defined(MNT_LOCAL)
+	struct statfs fs;
+	return fstatfs(fd, &fs) == 0 && (fs.f_flags & MNT_LOCAL) != 0;
+#else
+	return false;
+#endif
+}
+
+// Raw track file mapped in memory
+class MappedTrackFile : public TrackFile
+{
+public:
+	static MappedTrackFile *create(FILE *file, u32 file_offs, u32 first_fad, u32 last_fad, u32 secfmt)
+	{
+		if (last_fad < first_fad)
+			return nullptr;
+		struct stat st;
+		if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode) || !isLocalFile(fileno(file)))
+			return nullptr;
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		const size_t mapStart = file_offs & ~(pageSize - 1);
+		// Only map the track extent, not the rest of the file
+		const u64 trackEnd = std::min<u64>((u64)file_offs + ((u64)(last_fad - first_fad) + 1) * secfmt, st.st_size);
+		if (trackEnd <= mapStart)
+			return nullptr;
+		const size_t length = trackEnd - mapStart;
+		void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fileno(file), mapStart);
+		if (base == MAP_FAILED)
+		{
+			// Likely out of address space on 32-bit platforms
+			DEBUG_LOG(GDROM, "Track mmap failed: errno %d", errno);
+			return nullptr;
+		}
+		madvise(base, length, MADV_SEQUENTIAL);
+
+		return new MappedTrackFile(file, (u8 *)base, length, file_offs - mapStart, first_fad, secfmt);
+	}
+
+	~MappedTrackFile() override
+	{
+		munmap(base, length);
+		std::fclose(file);
+	}
+
+	bool Read(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type) override
+	{
+		u32 count = 1;
+		const u8 *p = map(FAD, count, sector_type);
+		if (p == nullptr)
+		{
+			WARN_LOG(GDROM, "Failed or truncated GD-Rom read");
+			return false;
+		}
+		memcpy(dst, p, fmt);
+		return true;
+	}
+
+	const u8 *map(u32 FAD, u32& count, SectorFormat *sector_type) override
+	{
+		if (!getRawSectorFormat(fmt, sector_type) || FAD < firstFad)
+			return nullptr;
+		const size_t pos = dataOffset + (size_t)(FAD - firstFad) * fmt;
+		if (pos + fmt > length)
+			return nullptr;
+		count = std::min<u32>(count, (length - pos) / fmt);
+		willNeed(FAD, count);
+		return base + pos;
+	}
+
+private:
+	MappedTrackFile(FILE *file, u8 *base, size_t length, size_t dataOffset, u32 firstFad, u32 fmt)
+		: file(file), base(base), length(length), dataOffset(dataOffset), firstFad(firstFad), fmt(fmt) {
+	}
+
+	// Ask the kernel to read the next sectors when access is sequential
+	void willNeed(u32 FAD, u32 count)
+	{
+		const bool sequential = FAD == nextFad;
+		nextFad = FAD + count;
+		if (!sequential || nextFad + ReadAhead / 2 < hintEnd)
+			return;
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		size_t start = dataOffset + (size_t)(std::max(nextFad, hintEnd) - firstFad) * fmt;
+		size_t end = std::min(dataOffset + (size_t)(nextFad + ReadAhead - firstFad) * fmt, length);
+		start &= ~(pageSize - 1);
+		if (start < end)
+			madvise(base + start, end - start, MADV_WILLNEED);
+		hintEnd = nextFad + ReadAhead;
+	}
+
+	static constexpr u32 ReadAhead = 128;	// sectors
+
+	FILE *file;
+	u8 *base;
+	size_t length;
+	size_t dataOffset;
+	u32 firstFad;
+	u32 fmt;
+	u32 nextFad = 0;
+	u32 hintEnd = 0;
+};
+#endif
+
+TrackFile *createRawTrackFile(FILE *file, u32 file_offs, u32 first_fad, u32 last_fad, u32 secfmt)
+{
+	verify(file != nullptr);
+#ifdef HAVE_MMAP_TRACKS
+	TrackFile *track = MappedTrackFile::create(file, file_offs, first_fad, last_fad, secfmt);
+	if (track != nullptr)
+		return track;
+#endif
+	return new RawTrackFile(file, file_offs, first_fad, secfmt);
+}
+
 Disc* OpenDisc(const std::string& path, std::vector<u8> *digest)
 {
 	for (auto driver : drivers)
@@ -108,6 +263,7 @@ static bool loadDisk(const std::string& path)
 
 	if (disc != NULL)
 	{
+		prefetcher.init(disc);
 		if (config::GGPOEnable)
 			MD5Sum().add(digest)
 					.getDigest(settings.network.md5.game);
@@ -171,6 +327,7 @@ static bool doDiscSwap(const std::string& path)
 void termDrive()
 {
 	sh4_sched_request(schedId, -1);
+	prefetcher.term();
 	delete disc;
 	disc = nullptr;
 }
@@ -207,14 +364,28 @@ static u32 createTrackInfoFirstLast(const Track& track, u32 tracknum)
 
 u32 libGDR_ReadSector(u8 *buff, u32 startSector, u32 sectorCount, u32 sectorSize, bool stopOnMiss)
 {
+	TRACE_SCOPE("GD-ROM read");
 	if (disc != nullptr)
-		return disc->ReadSectors(startSector, sectorCount, buff, sectorSize, stopOnMiss);
+		return prefetcher.read(startSector, sectorCount, buff, sectorSize, stopOnMiss, q_subchannel);
 	if (stopOnMiss)
 		return 0;
 	memset(buff, 0, sectorCount * sectorSize);
 	return sectorCount;
 }
 
+void libGDR_PrefetchSectors(u32 startSector, u32 sectorCount, u32 sectorSize)
+{
+	if (disc != nullptr)
+		prefetcher.prefetch(startSector, sectorCount, sectorSize);
+}
+
+bool libGDR_SectorsReady(u32 startSector, u32 sectorCount, u32 sectorSize)
+{
+	if (disc != nullptr)
+		return prefetcher.ready(startSector, sectorCount, sectorSize);
+	return true;
+}
+
 void libGDR_GetToc(u32* to, DiskArea area)
 {
 	memset(to, 0xFF, 102 * 4);
@@ -280,9 +451,48 @@ bool Disc::readSector(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode,
 	return false;
 }
 
-u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, LoadProgress *progress)
+// Copy sectors from a memory-mapped track without intermediate buffer.
+// Returns the number of sectors read, or 0 if not supported.
+u32 Disc::readMappedSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, u8 *subcode)
+{
+	for (size_t i = tracks.size(); i-- > 0; )
+	{
+		Track& track = tracks[i];
+		if (!track.contains(FAD))
+			continue;
+		if (track.EndFAD != 0)
+			count = std::min(count, track.EndFAD - FAD + 1);
+		SectorFormat secfmt;
+		const u8 *src = track.file->map(FAD, count, &secfmt);
+		if (src == nullptr)
+			return 0;
+		if ((secfmt == SECFMT_2352 && fmt == 2352)
+				|| (fmt == 2048 && (secfmt == SECFMT_2048_MODE1 || secfmt == SECFMT_2048_MODE2_FORM1)))
+		{
+			memcpy(dst, src, count * fmt);
+			if (secfmt == SECFMT_2352)
+				memset(subcode, 0, 96);
+		}
+		else if (secfmt == SECFMT_2352 && fmt == 2048)
+		{
+			for (u32 j = 0; j < count; j++)
+				convertSector(src + j * 2352, dst + j * 2048, 2352, 2048, subcode);
+		}
+		else
+		{
+			return 0;
+		}
+		return count;
+	}
+	return 0;
+}
+
+u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, LoadProgress *progress, u8 *subcode)
 {
 	u8 temp[2448];
+	u8 localSubcode[96];
+	if (subcode == nullptr)
+		subcode = localSubcode;
 	SectorFormat secfmt;
 	SubcodeFormat subfmt;
 
@@ -295,7 +505,18 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 			progress->label = "Loading...";
 			progress->progress = (float)i / count;
 		}
-		if (!readSector(FAD, temp, &secfmt, q_subchannel, &subfmt))
+		else
+		{
+			u32 mapped = readMappedSectors(FAD, count - i, dst, fmt, subcode);
+			if (mapped != 0)
+			{
+				i += mapped - 1;
+				dst += mapped * fmt;
+				FAD += mapped;
+				continue;
+			}
+		}
+		if (!readSector(FAD, temp, &secfmt, subcode, &subfmt))
 		{
 			WARN_LOG(GDROM, "Sector Read miss FAD: %d", FAD);
 			if (stopOnMiss)
@@ -306,7 +527,7 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 
 		//TODO: Proper sector conversions
 		if (secfmt == SECFMT_2352) {
-			convertSector(temp, dst, 2352, fmt, FAD);
+			convertSector(temp, dst, 2352, fmt, subcode);
 		}
 		else if (fmt == 2048 && secfmt == SECFMT_2336_MODE2) {
 			memcpy(dst, temp + 8, 2048);
@@ -320,7 +541,7 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 		}
 		else if (fmt == 2048 && secfmt == SECFMT_2448_MODE2) {
 			// Pier Solar and the Great Architects
-			convertSector(temp, dst, 2448, fmt, FAD);
+			convertSector(temp, dst, 2448, fmt, subcode);
 		}
 		else {
 			WARN_LOG(GDROM, "ERROR: UNABLE TO CONVERT SECTOR. THIS IS FATAL. Format: %d Sector format: %d", fmt, secfmt);
@@ -80,6 +80,11 @@ struct Session
 struct TrackFile
 {
 	virtual bool Read(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type) = 0;
+	// Return a pointer to the raw sector data in memory if available, and the number of contiguous sectors in count.
+	// count must be set to the maximum number of sectors wanted on entry.
+	virtual const u8 *map(u32 FAD, u32& count, SectorFormat *sector_type) {
+		return nullptr;
+	}
 	virtual ~TrackFile() = default;
 };
 
@@ -92,9 +97,13 @@ struct Track
 	u8 ADR = 0;
 	std::string isrc;
 
+	bool contains(u32 FAD) const {
+		return FAD >= StartFAD && (FAD <= EndFAD || EndFAD == 0) && file != nullptr;
+	}
+
 	bool Read(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type)
 	{
-		if (FAD >= StartFAD && (FAD <= EndFAD || EndFAD == 0) && file != nullptr)
+		if (contains(FAD))
 			return file->Read(FAD, dst, sector_type, subcode, subcode_type);
 		else
 			return false;
@@ -118,7 +127,8 @@ struct Disc
 	DiscType type;
 	std::string catalog;
 
-	u32 ReadSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, bool stopOnMiss = false, LoadProgress *progress = nullptr);
+	u32 ReadSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, bool stopOnMiss = false, LoadProgress *progress = nullptr,
+			u8 *subcode = nullptr);
 
 	virtual ~Disc() 
 	{
@@ -208,10 +218,30 @@ struct Disc
 
 private:
 	bool readSector(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type);
+	u32 readMappedSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, u8 *subcode);
 };
 
 Disc* OpenDisc(const std::string& path, std::vector<u8> *digest = nullptr);
 
+static inline bool getRawSectorFormat(u32 fmt, SectorFormat *sector_type)
+{
+	//for now hackish
+	if (fmt==2352)
+		*sector_type=SECFMT_2352;
+	else if (fmt==2048)
+		*sector_type=SECFMT_2048_MODE2_FORM1;
+	else if (fmt==2336)
+		*sector_type=SECFMT_2336_MODE2;
+	else if (fmt==2448)
+		*sector_type=SECFMT_2448_MODE2;
+	else
+	{
+		WARN_LOG(GDROM, "Unsupported sector size %d", fmt);
+		return false;
+	}
+	return true;
+}
+
 struct RawTrackFile : TrackFile
 {
 	FILE *file;
@@ -228,20 +258,8 @@ struct RawTrackFile : TrackFile
 
 	bool Read(u32 FAD,u8* dst,SectorFormat* sector_type,u8* subcode,SubcodeFormat* subcode_type) override
 	{
-		//for now hackish
-		if (fmt==2352)
-			*sector_type=SECFMT_2352;
-		else if (fmt==2048)
-			*sector_type=SECFMT_2048_MODE2_FORM1;
-		else if (fmt==2336)
-			*sector_type=SECFMT_2336_MODE2;
-		else if (fmt==2448)
-			*sector_type=SECFMT_2448_MODE2;
-		else
-		{
-			WARN_LOG(GDROM, "Unsupported sector size %d", fmt);
+		if (!getRawSectorFormat(fmt, sector_type))
 			return false;
-		}
 
 		std::fseek(file, offset + FAD * fmt, SEEK_SET);
 		if (std::fread(dst, 1, fmt, file) != fmt)
@@ -258,10 +276,19 @@ struct RawTrackFile : TrackFile
 	}
 };
 
+// Returns a memory-mapped track file if supported, or a RawTrackFile otherwise.
+// Only the sectors from first_fad to last_fad are mapped. Files on network or FUSE
+// file systems are always read with stdio.
+// The track file takes ownership of the passed FILE.
+TrackFile *createRawTrackFile(FILE *file, u32 file_offs, u32 first_fad, u32 last_fad, u32 secfmt);
+
 DiscType GuessDiscType(bool m1, bool m2, bool da);
 
 //IO
 u32 libGDR_ReadSector(u8 * buff, u32 StartSector, u32 SectorCount, u32 secsz, bool stopOnMiss = false);
+void libGDR_PrefetchSectors(u32 startSector, u32 sectorCount, u32 sectorSize);
+// Returns false if reading the given sectors would block on host I/O. They are then read in the background.
+bool libGDR_SectorsReady(u32 startSector, u32 sectorCount, u32 sectorSize);
 void libGDR_ReadSubChannel(u8 * buff, u32 len);
 void libGDR_GetToc(u32 *toc, DiskArea area);
 u32 libGDR_GetDiscType();
@@ -197,7 +197,7 @@ Disc* cue_parse(const char* file, std::vector<u8> *digest)
 						session_number, track_type.c_str(), t.StartFAD, t.EndFAD, t.isrc.empty() ? "" : ("ISRC " + t.isrc).c_str());
 				if (digest != nullptr)
 					md5.add(track_file);
-				t.file = new RawTrackFile(track_file, 0, t.StartFAD, sector_size);
+				t.file = createRawTrackFile(track_file, 0, t.StartFAD, t.EndFAD, sector_size);
 				disc->tracks.push_back(t);
 				
 				track_number = -1;
@@ -95,11 +95,11 @@ Disc* load_gdi(const char* file, std::vector<u8> *digest)
 			}
 			if (digest != nullptr)
 				md5.add(file);
-			t.file = new RawTrackFile(file, OFFSET, t.StartFAD, SSIZE);
 			hostfs::FileInfo fileInfo = hostfs::storage().getFileInfo(path);
 			if ((fileInfo.size - OFFSET) % SSIZE != 0)
 				WARN_LOG(GDROM, "Warning: Size of track %s is not multiple of sector size %d", track_filename.c_str(), SSIZE);
 			t.EndFAD = t.StartFAD + (u32)(fileInfo.size - OFFSET) / SSIZE - 1;
+			t.file = createRawTrackFile(file, OFFSET, t.StartFAD, t.EndFAD, SSIZE);
 		}
 		disc->tracks.push_back(t);
 	}
@@ -29,15 +29,21 @@ static u32 decode_iso733(iso733_t v)
 			| ((v >> 8) & 0xFF000000);
 }
 
-IsoFs::IsoFs(Disc *disc) : disc(disc)
+IsoFs::IsoFs(Disc *disc)
+	: IsoFs(disc->GetBaseFAD(), [disc](u32 fad, u32 count, u8 *dst) {
+		disc->ReadSectors(fad, count, dst, 2048);
+	})
+{
+}
+
+IsoFs::IsoFs(u32 baseFad, const SectorReader& reader) : readSectors(reader), baseFad(baseFad)
 {
-	baseFad = disc->GetBaseFAD();
 }
 
 IsoFs::Directory *IsoFs::getRoot()
 {
 	u8 temp[2048];
-	disc->ReadSectors(baseFad + 16, 1, temp, 2048);
+	readSectors(baseFad + 16, 1, temp);
 	// Primary Volume Descriptor
 	const iso9660_pvd_t *pvd = (const iso9660_pvd_t *)temp;
 
@@ -51,7 +57,7 @@ IsoFs::Directory *IsoFs::getRoot()
 		root->data.resize(len);
 
 		DEBUG_LOG(GDROM, "iso9660 root directory FAD: %d, len: %d", 150 + lba, len);
-		disc->ReadSectors(150 + lba, len / 2048, root->data.data(), 2048);
+		readSectors(150 + lba, len / 2048, root->data.data());
 	}
 	else {
 		WARN_LOG(GDROM, "iso9660 PVD NOT found");
@@ -67,7 +73,7 @@ void IsoFs::Directory::reset()
 	if (data.empty() && len != 0)
 	{
 		data.resize(len);
-		fs->disc->ReadSectors(startFad, len / 2048, data.data(), 2048);
+		fs->readSectors(startFad, len / 2048, data.data());
 	}
 }
 
@@ -130,12 +136,12 @@ u32 IsoFs::File::read(u8 *buf, u32 size, u32 offset) const
 {
 	size = std::min(size, len - offset);
 	u32 sectors = size / 2048;
-	fs->disc->ReadSectors(startFad + offset / 2048, sectors, buf, 2048);
+	fs->readSectors(startFad + offset / 2048, sectors, buf);
 	size -= sectors * 2048;
 	if (size > 0)
 	{
 		u8 temp[2048];
-		fs->disc->ReadSectors(startFad + offset / 2048 + sectors, 1, temp, 2048);
+		fs->readSectors(startFad + offset / 2048 + sectors, 1, temp);
 		memcpy(buf + sectors * 2048, temp, size);
 	}
 	return sectors * 2048 + size;
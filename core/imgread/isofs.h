@@ -18,6 +18,7 @@
  */
 #pragma once
 #include "common.h"
+#include <functional>
 
 class IsoFs
 {
@@ -71,10 +72,16 @@ public:
 		friend class IsoFs;
 	};
 
+	// Reads count 2048-byte sectors starting at fad
+	using SectorReader = std::function<void(u32 fad, u32 count, u8 *dst)>;
+
+	// Reads the disc directly. Not to be used on the disc loaded in the GD-ROM drive,
+	// which must be read through libGDR_ReadSector.
 	IsoFs(Disc *disc);
+	IsoFs(u32 baseFad, const SectorReader& reader);
 	Directory *getRoot();
 
 private:
-	Disc *disc;
+	SectorReader readSectors;
 	u32 baseFad;
 };
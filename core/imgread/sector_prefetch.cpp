@@ -0,0 +1,247 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "sector_prefetch.h"
+#include "common.h"
+#include "stdclass.h"
+#include "oslib/oslib.h"
+
+void SectorPrefetcher::init(Disc *disc)
+{
+	term();
+	this->disc = disc;
+	buffer.resize(Capacity * SlotSize);
+	start = filledEnd = targetEnd = 0;
+	format = 0;
+	atEnd = false;
+	running = true;
+	thread = std::thread([this]() { run(); });
+}
+
+void SectorPrefetcher::term()
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		running = false;
+		generation++;
+		cond.notify_all();
+	}
+	if (thread.joinable())
+		thread.join();
+	if (stats.reads != 0)
+		logStats(true);
+	stats = {};
+	disc = nullptr;
+	buffer.clear();
+	buffer.shrink_to_fit();
+}
+
+void SectorPrefetcher::reset(u32 fad, u32 fmt, u32 end)
+{
+	start = filledEnd = fad;
+	targetEnd = end;
+	format = fmt;
+	atEnd = false;
+	generation++;
+	cond.notify_all();
+}
+
+u32 SectorPrefetcher::readDisc(u32 fad, u32 count, u8 *dst, u32 fmt, bool stopOnMiss, u8 *subcode)
+{
+	std::lock_guard<std::mutex> _(discMutex);
+	return disc->ReadSectors(fad, count, dst, fmt, stopOnMiss, nullptr, subcode);
+}
+
+u32 SectorPrefetcher::read(u32 fad, u32 count, u8 *dst, u32 fmt, bool stopOnMiss, u8 *subcode)
+{
+	const u64 startTime = getTimeUs();
+	u32 done = 0;
+	bool waited = false;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (running && fmt == format && fad >= start && fad < targetEnd)
+		{
+			while (done < count && running)
+			{
+				const u32 curFad = fad + done;
+				if (curFad >= targetEnd)
+					break;
+				// Previous sectors aren't needed anymore
+				start = curFad;
+				if (curFad >= filledEnd)
+				{
+					// Being read by the I/O thread
+					waited = true;
+					cond.notify_all();
+					cond.wait(lock);
+					continue;
+				}
+				const u32 n = std::min(count - done, filledEnd - curFad);
+				for (u32 i = 0; i < n; i++)
+					memcpy(dst + (done + i) * fmt, slotData(curFad + i), fmt);
+				memcpy(subcode, slotData(curFad + n - 1) + 2448, SubcodeSize);
+				done += n;
+			}
+			start = fad + done;
+		}
+	}
+	const bool hit = done == count;
+	if (!hit)
+		done += readDisc(fad + done, count - done, dst + done * fmt, fmt, stopOnMiss, subcode);
+	{
+		// Schedule the next sectors
+		std::lock_guard<std::mutex> _(mutex);
+		if (running && done == count)
+		{
+			const u32 end = fad + done + ReadAhead;
+			if (hit)
+			{
+				targetEnd = std::max(targetEnd, end);
+				cond.notify_all();
+			}
+			// Don't interrupt another read ahead in a different format (cdda vs. data)
+			else if (fmt == format || filledEnd >= targetEnd)
+			{
+				reset(fad + done, fmt, end);
+			}
+		}
+	}
+
+	const u64 latency = getTimeUs() - startTime;
+	int bucket = 0;
+	for (u64 l = latency / 4; l != 0 && bucket < Buckets - 1; l /= 4)
+		bucket++;
+	stats.latency[bucket]++;
+	stats.reads++;
+	if (!hit)
+		stats.misses++;
+	else if (waited)
+		stats.waits++;
+	else
+		stats.hits++;
+	if (stats.reads % 4096 == 0)
+		logStats(false);
+
+	return done;
+}
+
+void SectorPrefetcher::prefetch(u32 fad, u32 count, u32 fmt)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	if (!running || count == 0)
+		return;
+	if (fmt == format && fad >= start && fad <= filledEnd)
+	{
+		targetEnd = std::max(targetEnd, fad + count);
+		cond.notify_all();
+	}
+	else
+	{
+		reset(fad, fmt, fad + count);
+	}
+}
+
+bool SectorPrefetcher::ready(u32 fad, u32 count, u32 fmt)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	if (!running || count == 0)
+		return true;
+	if (fmt == format && fad >= start && (fad < targetEnd || fad == filledEnd))
+	{
+		// Previous sectors aren't needed anymore
+		start = fad;
+		if (fad + count <= filledEnd || atEnd)
+			// Available, or past the end of the track: the read returns what's there
+			return true;
+		targetEnd = std::max(targetEnd, fad + count);
+		cond.notify_all();
+		return false;
+	}
+	// Don't interrupt another read ahead in a different format (cdda vs. data)
+	if (fmt != format && filledEnd < targetEnd)
+		return true;
+	reset(fad, fmt, fad + count + ReadAhead);
+	return false;
+}
+
+void SectorPrefetcher::run()
+{
+	ThreadName _("GDROM-IO");
+	std::vector<u8> chunk(Chunk * SlotSize);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running)
+	{
+		if (filledEnd < start)
+			// Sectors skipped by the reader
+			filledEnd = start;
+		const u32 space = Capacity - (filledEnd - start);
+		if (filledEnd >= targetEnd || space == 0)
+		{
+			cond.wait(lock);
+			continue;
+		}
+		const u32 fad = filledEnd;
+		const u32 count = std::min({ Chunk, targetEnd - filledEnd, space });
+		const u32 fmt = format;
+		const u32 gen = generation;
+		lock.unlock();
+
+		u32 read = 0;
+		for (; read < count; read++)
+		{
+			u8 *slot = &chunk[read * SlotSize];
+			if (readDisc(fad + read, 1, slot, fmt, true, slot + 2448) != 1)
+				break;
+		}
+
+		lock.lock();
+		if (gen != generation)
+			// Reset while reading
+			continue;
+		for (u32 i = 0; i < read; i++)
+			memcpy(slotData(fad + i), &chunk[i * SlotSize], SlotSize);
+		filledEnd = fad + read;
+		if (read < count)
+		{
+			// End of track or disc
+			targetEnd = filledEnd;
+			atEnd = true;
+		}
+		cond.notify_all();
+	}
+}
+
+void SectorPrefetcher::logStats(bool final)
+{
+	std::string histo;
+	u32 limit = 4;
+	for (int i = 0; i < Buckets; i++, limit *= 4)
+	{
+		if (i == Buckets - 1)
+			histo += " >=" + std::to_string(limit / 4) + "us:";
+		else
+			histo += " <" + std::to_string(limit) + "us:";
+		histo += std::to_string(stats.latency[i]);
+	}
+	if (final)
+		INFO_LOG(GDROM, "GD-ROM reads: %d (hits %d waits %d misses %d) latency%s",
+				stats.reads, stats.hits, stats.waits, stats.misses, histo.c_str());
+	else
+		DEBUG_LOG(GDROM, "GD-ROM reads: %d (hits %d waits %d misses %d) latency%s",
+				stats.reads, stats.hits, stats.waits, stats.misses, histo.c_str());
+}
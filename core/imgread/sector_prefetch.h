@@ -0,0 +1,92 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Disc;
+
+// Reads the sectors following the last GD-ROM read on an I/O thread so that
+// sequential reads are served from memory and the emulation thread doesn't wait on host I/O.
+// When the sectors aren't available yet, the GD-ROM DMA reports the drive as busy (see ready()).
+class SectorPrefetcher
+{
+public:
+	~SectorPrefetcher() {
+		term();
+	}
+	void init(Disc *disc);
+	void term();
+
+	// Read sectors from the prefetch buffer, or from the disc if not available.
+	// The subchannel data of the last sector read is copied into subcode (96 bytes).
+	u32 read(u32 fad, u32 count, u8 *dst, u32 fmt, bool stopOnMiss, u8 *subcode);
+	// Start reading the given range in the background
+	void prefetch(u32 fad, u32 count, u32 fmt);
+	// Returns false if reading the given sectors now would wait for the I/O thread or the disc.
+	// Their read is then started in the background.
+	bool ready(u32 fad, u32 count, u32 fmt);
+
+private:
+	void run();
+	void reset(u32 fad, u32 fmt, u32 end);
+	u32 readDisc(u32 fad, u32 count, u8 *dst, u32 fmt, bool stopOnMiss, u8 *subcode);
+	void logStats(bool final);
+
+	u8 *slotData(u32 fad) {
+		return &buffer[(fad % Capacity) * SlotSize];
+	}
+
+	static constexpr u32 Capacity = 256;		// sectors
+	static constexpr u32 ReadAhead = 64;		// sectors
+	static constexpr u32 Chunk = 16;			// sectors
+	static constexpr u32 SubcodeSize = 96;
+	static constexpr u32 SlotSize = 2448 + SubcodeSize;
+
+	Disc *disc = nullptr;
+	std::mutex discMutex;		// serializes access to the disc
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::thread thread;
+	bool running = false;
+	std::vector<u8> buffer;
+
+	// Valid sectors are [start, filledEnd). The I/O thread reads up to targetEnd.
+	u32 start = 0;
+	u32 filledEnd = 0;
+	u32 targetEnd = 0;
+	u32 format = 0;
+	u32 generation = 0;
+	bool atEnd = false;		// the I/O thread stopped at filledEnd (end of track or disc)
+
+	// Read latency histogram, in powers of 4 microseconds
+	static constexpr int Buckets = 8;
+	struct {
+		std::array<u32, Buckets> latency;
+		u32 reads;
+		u32 hits;
+		u32 waits;
+		u32 misses;
+	} stats {};
+};
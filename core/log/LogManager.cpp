@@ -21,9 +21,32 @@
 #include "cfg/cfg.h"
 #include "oslib/oslib.h"
 #include "stdclass.h"
+#include "util/byte_ring.h"
+#include "util/thread_local_pool.h"
 
 constexpr size_t MAX_MSGLEN = 1024;
 
+// Async logging.
+// Each thread queues its messages in its own ring buffer, drained by the log thread.
+struct LogRecord
+{
+	u64 time;
+	const char *file;
+	int line;
+	u8 level;
+	u8 type;
+	u16 length;		// message length including the terminating nul, follows the record
+};
+
+struct ThreadLogBuffer
+{
+	ByteRing<64_KB> ring;
+	std::atomic<u64> dropped { 0 };
+};
+
+// Thread buffers are reused when their thread exits.
+static ThreadLocalPool<ThreadLogBuffer> threadBuffers;
+
 template <typename T>
 void OpenFStream(T& fstream, const std::string& filename, std::ios_base::openmode openmode)
 {
@@ -177,13 +200,18 @@ void LogManager::UpdateConfig()
 		RegisterListener(LogListener::NETWORK_LISTENER, new NetworkListener(logServer));
 		EnableListener(LogListener::NETWORK_LISTENER, !logServer.empty());
 	}
+	SetAsync(cfgLoadBool("log", "Async", false));
+}
+
+LogManager::~LogManager()
+{
+	SetAsync(false);
 }
 
 // Return the current time formatted as Minutes:Seconds:Milliseconds
 // in the form 00:00:000.
-static std::string GetTimeFormatted()
+static std::string GetTimeFormatted(u64 now)
 {
-	u64 now = getTimeMs();
 	u32 ms = (u32)(now % 1000);
 	now /= 1000;
 	u32 seconds = (u32)(now % 60);
@@ -203,19 +231,146 @@ void LogManager::LogWithFullPath(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE
 {
 	if (!IsEnabled(type, level) || !static_cast<bool>(m_listener_ids))
 		return;
+	// Notices and errors are written immediately so they aren't lost if the emulator crashes
+	if (m_async && level > LogTypes::LERROR)
+	{
+		LogAsync(level, type, file, line, format, args);
+		return;
+	}
 
 	char temp[MAX_MSGLEN];
 	CharArrayFromFormatV(temp, MAX_MSGLEN, format, args);
+	Dispatch(level, type, getTimeMs(), file, line, temp);
+}
 
+void LogManager::Dispatch(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, u64 time,
+		const char* file, int line, const char* text)
+{
 	std::string msg =
-			StringFromFormat("%s %s:%u %c[%s]: %s\n", GetTimeFormatted().c_str(), file,
-					line, LogTypes::LOG_LEVEL_TO_CHAR[(int)level], GetShortName(type), temp);
+			StringFromFormat("%s %s:%u %c[%s]: %s\n", GetTimeFormatted(time).c_str(), file,
+					line, LogTypes::LOG_LEVEL_TO_CHAR[(int)level], GetShortName(type), text);
 
 	for (auto listener_id : m_listener_ids)
 		if (m_listeners[listener_id])
 			m_listeners[listener_id]->Log(level, msg.c_str());
 }
 
+void LogManager::LogAsync(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file,
+		int line, const char* format, va_list args)
+{
+	// The message is formatted by the caller since args can't be kept.
+	// The rest of the line is built by the log thread.
+	u8 data[sizeof(LogRecord) + MAX_MSGLEN];
+	char *text = (char *)&data[sizeof(LogRecord)];
+	CharArrayFromFormatV(text, MAX_MSGLEN, format, args);
+	LogRecord record;
+	record.time = getTimeMs();
+	record.file = file;
+	record.line = line;
+	record.level = (u8)level;
+	record.type = (u8)type;
+	record.length = (u16)(strlen(text) + 1);
+	memcpy(data, &record, sizeof(record));
+
+	ThreadLogBuffer *buffer = threadBuffers.get();
+	const size_t size = sizeof(LogRecord) + record.length;
+	// Only this thread writes to the buffer so the record will fit
+	if (buffer->ring.capacity() - buffer->ring.size() < size)
+		buffer->dropped++;
+	else
+		buffer->ring.write(data, size);
+}
+
+void LogManager::DrainAsync()
+{
+	const std::vector<ThreadLogBuffer *> buffers = threadBuffers.objects();
+	std::lock_guard<std::mutex> _(m_listener_lock);
+	char text[MAX_MSGLEN];
+	u64 dropped = 0;
+	for (ThreadLogBuffer *buffer : buffers)
+	{
+		// Records are written atomically so a complete record is available if its header is
+		while (buffer->ring.size() >= sizeof(LogRecord))
+		{
+			LogRecord record;
+			buffer->ring.read((u8 *)&record, sizeof(record));
+			buffer->ring.read((u8 *)text, record.length);
+			Dispatch((LogTypes::LOG_LEVELS)record.level, (LogTypes::LOG_TYPE)record.type, record.time,
+					record.file, record.line, text);
+		}
+		dropped += buffer->dropped;
+	}
+	if (dropped != m_dropped_reported)
+	{
+		std::string msg = StringFromFormat("%d log messages dropped", (int)(dropped - m_dropped_reported));
+		Dispatch(LogTypes::LWARNING, LogTypes::COMMON, getTimeMs(), __FILE__ + m_path_cutoff_point, __LINE__, msg.c_str());
+		m_dropped_reported = dropped;
+	}
+}
+
+void LogManager::AsyncThreadMain()
+{
+	ThreadName _("LogWriter");
+	std::unique_lock<std::mutex> lock(m_async_mutex);
+	while (true)
+	{
+		const u64 request = m_flush_request;
+		const bool stop = m_async_stop;
+		lock.unlock();
+		DrainAsync();
+		lock.lock();
+		m_flush_done = request;
+		m_flush_cv.notify_all();
+		if (stop)
+			break;
+		m_async_cv.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+			return m_async_stop || m_flush_request != request;
+		});
+	}
+}
+
+void LogManager::SetAsync(bool async)
+{
+	if (async == m_async)
+		return;
+	if (async)
+	{
+		m_async_stop = false;
+		m_dropped_reported = GetDroppedCount();
+		m_async_thread = std::thread(&LogManager::AsyncThreadMain, this);
+		m_async = true;
+	}
+	else
+	{
+		m_async = false;
+		{
+			std::lock_guard<std::mutex> _(m_async_mutex);
+			m_async_stop = true;
+		}
+		m_async_cv.notify_one();
+		// The thread drains the buffers one last time before exiting
+		m_async_thread.join();
+	}
+}
+
+void LogManager::Flush()
+{
+	if (!m_async)
+		return;
+	std::unique_lock<std::mutex> lock(m_async_mutex);
+	const u64 request = ++m_flush_request;
+	m_async_cv.notify_one();
+	m_flush_cv.wait(lock, [&]() { return m_flush_done >= request; });
+}
+
+u64 LogManager::GetDroppedCount() const
+{
+	u64 dropped = 0;
+	for (const ThreadLogBuffer *buffer : threadBuffers.objects())
+		dropped += buffer->dropped;
+	return dropped;
+}
+
 LogTypes::LOG_LEVELS LogManager::GetLogLevel() const
 {
 	return m_level;
@@ -249,6 +404,7 @@ const char* LogManager::GetFullName(LogTypes::LOG_TYPE type) const
 
 void LogManager::RegisterListener(LogListener::LISTENER id, LogListener* listener)
 {
+	std::lock_guard<std::mutex> _(m_listener_lock);
 	m_listeners[id] = std::unique_ptr<LogListener>(listener);
 }
 
@@ -5,8 +5,13 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "BitSet.h"
 #include "Log.h"
@@ -56,6 +61,17 @@ public:
   bool IsListenerEnabled(LogListener::LISTENER id) const;
   void UpdateConfig();
 
+  // In async mode, warning, info and debug messages are queued in per-thread lock-free buffers
+  // and written to the listeners by a background thread.
+  void SetAsync(bool async);
+  bool IsAsync() const { return m_async; }
+  // Wait until all queued messages have been written
+  void Flush();
+  // Number of messages dropped because a thread buffer was full
+  uint64_t GetDroppedCount() const;
+
+  ~LogManager();
+
 private:
   struct LogContainer
   {
@@ -70,6 +86,13 @@ private:
 
   LogManager();
 
+  void LogAsync(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file, int line,
+                const char* format, va_list args);
+  void Dispatch(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, uint64_t time, const char* file,
+                int line, const char* text);
+  void AsyncThreadMain();
+  void DrainAsync();
+
   LogManager(const LogManager&) = delete;
   LogManager& operator=(const LogManager&) = delete;
   LogManager(LogManager&&) = delete;
@@ -81,4 +104,16 @@ private:
   BitSet32 m_listener_ids;
   size_t m_path_cutoff_point = 0;
   std::string logServer;
+
+  std::atomic<bool> m_async{false};
+  std::thread m_async_thread;
+  std::mutex m_async_mutex;
+  std::condition_variable m_async_cv;
+  std::condition_variable m_flush_cv;
+  bool m_async_stop = false;
+  uint64_t m_flush_request = 0;
+  uint64_t m_flush_done = 0;
+  uint64_t m_dropped_reported = 0;
+  // Held by the async thread while writing to the listeners
+  std::mutex m_listener_lock;
 };
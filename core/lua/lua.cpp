@@ -24,6 +24,7 @@
 #include "ui/gui.h"
 #include "ui/gui_util.h"
 #include "hw/mem/addrspace.h"
+#include "hw/sh4/sh4_mem.h"
 #include "cfg/option.h"
 #include "emulator.h"
 #include "input/gamepad_device.h"
@@ -108,11 +109,24 @@ void overlay()
 template<typename T>
 static LuaRef readMemoryTable(u32 address, int count, lua_State* L)
 {
+	// Can't be larger than system RAM
+	if (count > 0 && (size_t)count > RAM_SIZE / sizeof(T))
+		return LuaRef(L);
 	LuaRef t(L);
 	t = newTable(L);
+	const u8 *p = count > 0 ? GetMemPtr(address, (u32)((size_t)count * sizeof(T))) : nullptr;
 	while (count > 0)
 	{
-		t[address] = addrspace::readt<T>(address);
+		if (p != nullptr)
+		{
+			T v;
+			memcpy(&v, p, sizeof(T));
+			t[address] = v;
+			p += sizeof(T);
+		}
+		else {
+			t[address] = addrspace::readt<T>(address);
+		}
 		address += sizeof(T);
 		count--;
 	}
@@ -120,6 +134,16 @@ static LuaRef readMemoryTable(u32 address, int count, lua_State* L)
 	return t;
 }
 
+// Returns a binary string of the given length read from address, or nil if larger than system RAM
+static LuaRef readMemory(u32 address, int length, lua_State* L)
+{
+	if (length > 0 && (u32)length > RAM_SIZE)
+		return LuaRef(L);
+	std::string data(std::max(length, 0), '\0');
+	ReadMemBlock_nommu(address, (u8 *)data.data(), data.size());
+	return LuaRef(L, data);
+}
+
 #define CONFIG_ACCESSORS(Config) 	\
 template<typename T>				\
 static T get ## Config() {			\
@@ -548,6 +572,7 @@ static void luaRegister(lua_State *L)
 				.addFunction("readTable16", readMemoryTable<u16>)
 				.addFunction("readTable32", readMemoryTable<u32>)
 				.addFunction("readTable64", readMemoryTable<u64>)
+				.addFunction("readMemory", readMemory)
 				.addFunction("write8", addrspace::writet<u8>)
 				.addFunction("write16", addrspace::writet<u16>)
 				.addFunction("write32", addrspace::writet<u32>)
@@ -19,7 +19,7 @@
 #include "types.h"
 #include <asio.hpp>
 #include "netservice.h"
-#include "util/tsqueue.h"
+#include "util/byte_ring.h"
 #include "oslib/oslib.h"
 #include "emulator.h"
 #include "hw/bba/bba.h"
@@ -33,6 +33,7 @@
 #include <memory>
 #include <array>
 #include <chrono>
+#include <atomic>
 #ifndef __ANDROID__
 //#define WIRESHARK_DUMP 1
 #endif
@@ -40,7 +41,10 @@
 namespace net::modbba
 {
 
-static TsQueue<u8> toModem;
+// DCNet thread -> emulated modem
+static ByteRing<8192> toModem;
+// emulated modem -> DCNet thread
+static ByteRing<2048> fromModem;
 
 class DCNetService : public Service
 {
@@ -61,7 +65,7 @@ class PPPSocket
 public:
 	PPPSocket(asio::io_context& io_context, const typename SocketT::endpoint_type& endpoint,
 			const std::string& endpointName = "")
-		: socket(io_context)
+		: socket(io_context), timer(io_context)
 	{
 		asio::error_code ec;
 		socket.connect(endpoint, ec);
@@ -76,14 +80,12 @@ public:
 			fclose(dumpfp);
 	}
 
-	void send(u8 b)
+	// Send the bytes written by the modem
+	void send()
 	{
-		if (sendBufSize == sendBuffer.size()) {
-			WARN_LOG(NETWORK, "PPP output buffer overflow");
-			return;
-		}
-		sendBuffer[sendBufSize++] = b;
-		doSend();
+		sendBufSize += fromModem.read(&sendBuffer[sendBufSize], sendBuffer.size() - sendBufSize);
+		if (sendBufSize > 0)
+			doSend();
 	}
 
 private:
@@ -100,12 +102,28 @@ private:
 					return;
 				}
 				pppdump(recvBuffer.data(), len, false);
-				for (size_t i = 0; i < len; i++)
-					toModem.push(recvBuffer[i]);
-				receive();
+				recvPos = 0;
+				recvSize = len;
+				deliver();
 			});
 	}
 
+	void deliver()
+	{
+		recvPos += toModem.write(&recvBuffer[recvPos], recvSize - recvPos);
+		if (recvPos == recvSize)
+		{
+			receive();
+			return;
+		}
+		// The modem buffer is full. Try again later.
+		timer.expires_after(std::chrono::milliseconds(5));
+		timer.async_wait([this](const std::error_code& ec) {
+			if (!ec)
+				deliver();
+		});
+	}
+
 	void doSend()
 	{
 		if (sending)
@@ -123,16 +141,16 @@ private:
 				}
 				sending = false;
 				sendBufSize -= len;
-				if (sendBufSize > 0) {
+				if (sendBufSize > 0)
 					memmove(&sendBuffer[0], &sendBuffer[len], sendBufSize);
-					doSend();
-				}
+				send();
 			});
 	}
 
 	void close() {
 		std::error_code ignored;
 		socket.close(ignored);
+		timer.cancel(ignored);
 	}
 
 	void pppdump(uint8_t *buf, int len, bool egress)
@@ -173,7 +191,10 @@ private:
 	}
 
 	SocketT socket;
+	asio::steady_timer timer;
 	std::array<u8, 1542> recvBuffer;
+	size_t recvPos = 0;
+	size_t recvSize = 0;
 	std::array<u8, 1542> sendBuffer;
 	u32 sendBufSize = 0;
 	bool sending = false;
@@ -564,6 +585,9 @@ public:
 	{
 		if (thread.joinable())
 			return;
+		toModem.clear();
+		fromModem.clear();
+		sendPending = false;
 		io_context = std::make_unique<asio::io_context>();
 		thread = std::thread(&DCNetThread::run, this);
 	}
@@ -584,9 +608,16 @@ public:
 	{
 		if (io_context == nullptr || pppSocket == nullptr)
 			return;
-		io_context->post([this, v]() {
-			pppSocket->send(v);
-		});
+		if (!fromModem.push(v)) {
+			WARN_LOG(NETWORK, "PPP output buffer overflow");
+			return;
+		}
+		// Only wake up the network thread if it isn't already going to read the buffer
+		if (!sendPending.exchange(true))
+			io_context->post([this]() {
+				sendPending = false;
+				pppSocket->send();
+			});
 	}
 	void sendEthFrame(const u8 *frame, u32 len)
 	{
@@ -610,6 +641,7 @@ private:
 	std::thread thread;
 	std::unique_ptr<asio::io_context> io_context;
 	std::unique_ptr<PPPTcpSocket> pppSocket;
+	std::atomic<bool> sendPending { false };
 	std::unique_ptr<EthSocket> ethSocket;
 
 	static constexpr uint16_t PPP_PORT = 7654;
@@ -634,12 +666,8 @@ void DCNetService::writeModem(u8 b) {
 	thread.sendModem(b);
 }
 
-int DCNetService::readModem()
-{
-	if (toModem.empty())
-		return -1;
-	else
-		return toModem.pop();
+int DCNetService::readModem() {
+	return toModem.pop();
 }
 
 int DCNetService::modemAvailable() {
@@ -712,7 +740,6 @@ void DCNetThread::connect(const asio::ip::address& address, const std::string& a
 
 void DCNetThread::run()
 {
-	toModem.clear();
 	try {
 		std::string hostname;
 #ifndef LIBRETRO
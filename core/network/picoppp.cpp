@@ -49,7 +49,7 @@ extern "C" {
 #include "cfg/option.h"
 #include "emulator.h"
 #include "oslib/oslib.h"
-#include "util/tsqueue.h"
+#include "util/byte_ring.h"
 #include "util/shared_this.h"
 #include "hw/bba/bba.h"
 
@@ -64,8 +64,10 @@ extern "C" {
 constexpr int PICO_TICK_MS = 5;
 static pico_device *pico_dev;
 
-static TsQueue<u8> in_buffer;
-static TsQueue<u8> out_buffer;
+// pico -> modem
+static ByteRing<1024> in_buffer;
+// modem -> pico
+static ByteRing<4096> out_buffer;
 
 static pico_ip4 dcaddr;
 static pico_ip4 dnsaddr;
@@ -177,42 +179,38 @@ pico_ip4 parseDnsResponsePacket(const void *buf, size_t len);
 
 static int modem_read(pico_device *dev, void *data, int len)
 {
-	u8 *p = (u8 *)data;
-	int count = 0;
-	for (; !out_buffer.empty() && count < len; count++)
-		*p++ = out_buffer.pop();
-
-    return count;
+	return (int)out_buffer.read((u8 *)data, len);
 }
 
 static int modem_write(pico_device *dev, const void *data, int len)
 {
-	u8 *p = (u8 *)data;
+	const u8 *p = (const u8 *)data;
+	size_t remaining = len;
 
-	for (int i = 0; i < len; i++)
+	// Wait until the emulated modem has read everything
+	while (true)
 	{
-		while (in_buffer.size() > 1024)
-		{
-			if (!pico_thread_running)
-				return 0;
-			PICO_IDLE();
-		}
-		in_buffer.push(*p++);
+		size_t count = in_buffer.write(p, remaining);
+		p += count;
+		remaining -= count;
+		if (remaining == 0)
+			break;
+		if (!pico_thread_running)
+			return 0;
+		PICO_IDLE();
 	}
 
     return len;
 }
 
-static void write_pico(u8 b) {
-	out_buffer.push(b);
+static void write_pico(u8 b)
+{
+	if (!out_buffer.push(b))
+		WARN_LOG(MODEM, "PPP output buffer overflow");
 }
 
-static int read_pico()
-{
-	if (in_buffer.empty())
-		return -1;
-	else
-		return in_buffer.pop();
+static int read_pico() {
+	return in_buffer.pop();
 }
 
 static int pico_available() {
@@ -1258,10 +1256,6 @@ void PicoThread::run()
 			}));
 	}
 
-	// Empty queues
-	in_buffer.clear();
-	out_buffer.clear();
-
     // Find DNS ip address
 	{
 		std::string dnsName = config::DNS;
@@ -1427,6 +1421,9 @@ static bool start_pico()
 	if (pico_thread_running)
 		return false;
 	pico_thread_running = true;
+	// Empty queues before the pico thread starts using them
+	in_buffer.clear();
+	out_buffer.clear();
 	pico_thread.start();
 
     return true;
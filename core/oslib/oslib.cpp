@@ -199,6 +199,11 @@ std::string getTextureDumpPath()
 	return get_writable_data_path("texdump/");
 }
 
+std::string getTextureCachePath()
+{
+	return get_writable_data_path("texcache/");
+}
+
 #if defined(__unix__) && !defined(__ANDROID__)
 
 static std::string runCommand(const std::string& cmd)
@@ -1,5 +1,6 @@
 #pragma once
 #include "types.h"
+#include "profiler/frame_tracer.h"
 #include <vector>
 #if defined(__SWITCH__)
 #include <malloc.h>
@@ -23,6 +24,7 @@ class ThreadName
 public:
 	ThreadName(const char *name) {
 		os_SetThreadName(name);
+		tracer::setThreadName(name);
 	}
 	~ThreadName() {
 		// default name
@@ -59,6 +61,7 @@ namespace hostfs
 
 	std::string getTextureLoadPath(const std::string& gameId);
 	std::string getTextureDumpPath();
+	std::string getTextureCachePath();
 
 	std::string getShaderCachePath(const std::string& filename);
 	void saveScreenshot(const std::string& name, const std::vector<u8>& data);
@@ -0,0 +1,177 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "frame_tracer.h"
+#include "cfg/option.h"
+#include "util/thread_local_pool.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace tracer
+{
+
+std::atomic<bool> recording;
+
+namespace
+{
+
+struct Event
+{
+	const char *name;
+	u64 start;
+	u64 end;
+};
+
+// Per-thread ring buffer. Only written by its owner thread.
+struct ThreadRing
+{
+	static constexpr u32 Size = 64 * 1024;
+
+	std::array<Event, Size> events;
+	// Number of events written so far
+	std::atomic<u64> count { 0 };
+	char name[32] {};
+	u32 id = 0;
+};
+
+// Rings are reused by new threads, keeping the previous events.
+ThreadLocalPool<ThreadRing> ringPool;
+u32 ringCount;
+
+constexpr u32 FrameHistory = 1024;
+std::array<u64, FrameHistory> frameTicks;
+std::atomic<u64> frameCount;
+u64 lastFrame;
+std::atomic<bool> saving;
+
+// Reference points to convert ticks to microseconds
+u64 startTicks;
+std::chrono::steady_clock::time_point startTime;
+
+thread_local char threadName[32];
+
+}
+
+void record(const char *name, u64 start, u64 end)
+{
+	ThreadRing *ring = ringPool.get([](ThreadRing& ring, bool created) {
+		if (created)
+			ring.id = ++ringCount;
+		strcpy(ring.name, threadName);
+	});
+	const u64 n = ring->count.load(std::memory_order_relaxed);
+	ring->events[n & (ThreadRing::Size - 1)] = { name, start, end };
+	ring->count.store(n + 1, std::memory_order_release);
+}
+
+void setThreadName(const char *name)
+{
+	strncpy(threadName, name, sizeof(threadName) - 1);
+	ThreadRing *ring = ringPool.current();
+	if (ring != nullptr)
+	{
+		auto lock = ringPool.lock();
+		strcpy(ring->name, threadName);
+	}
+}
+
+void frameMark()
+{
+	if (saving)
+		return;
+	if (config::FrameTracer != enabled())
+	{
+		if (config::FrameTracer)
+		{
+			frameCount = 0;
+			lastFrame = 0;
+			startTicks = ticks();
+			startTime = std::chrono::steady_clock::now();
+		}
+		recording = config::FrameTracer;
+	}
+	if (!enabled())
+		return;
+	const u64 now = ticks();
+	if (lastFrame != 0)
+		record("Emulated frame", lastFrame, now);
+	lastFrame = now;
+	const u64 n = frameCount.load(std::memory_order_relaxed);
+	frameTicks[n % FrameHistory] = now;
+	frameCount.store(n + 1, std::memory_order_release);
+}
+
+bool save(const std::string& path, int frames)
+{
+	const u64 frameNum = frameCount.load(std::memory_order_acquire);
+	if (!enabled() || frameNum < 2)
+		return false;
+	// Stop recording while the rings are read
+	saving = true;
+	recording = false;
+
+	const double usPerTick = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count()
+			/ std::max<u64>(ticks() - startTicks, 1);
+	frames = std::min<u64>({ (u64)frames, frameNum - 1, FrameHistory - 1 });
+	const u64 windowStart = frameTicks[(frameNum - 1 - frames) % FrameHistory];
+
+	bool success = false;
+	FILE *f = nowide::fopen(path.c_str(), "wt");
+	if (f != nullptr)
+	{
+		fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Flycast\"}}");
+		const std::vector<ThreadRing *> rings = ringPool.objects();
+		auto lock = ringPool.lock();
+		for (const ThreadRing *ring : rings)
+		{
+			const u64 count = ring->count.load(std::memory_order_acquire);
+			if (count == 0)
+				continue;
+			if (ring->name[0] != '\0')
+				fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", ring->id, ring->name);
+			for (u64 i = count > ThreadRing::Size ? count - ThreadRing::Size : 0; i < count; i++)
+			{
+				const Event& event = ring->events[i & (ThreadRing::Size - 1)];
+				if (event.start < windowStart || event.end < event.start)
+					continue;
+				fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.name, ring->id,
+						(event.start - windowStart) * usPerTick, (event.end - event.start) * usPerTick);
+			}
+		}
+		for (u64 i = frameNum - 1 - frames; i < frameNum; i++)
+			fprintf(f, ",\n{\"name\":\"vblank\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+					(frameTicks[i % FrameHistory] - windowStart) * usPerTick);
+		fprintf(f, "\n]}\n");
+		success = !ferror(f);
+		fclose(f);
+	}
+	recording = true;
+	saving = false;
+	if (!success)
+		WARN_LOG(COMMON, "Can't write trace file %s", path.c_str());
+	else
+		NOTICE_LOG(COMMON, "Saved %d frames trace to %s", frames, path.c_str());
+
+	return success;
+}
+
+}
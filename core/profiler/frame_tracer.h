@@ -0,0 +1,94 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Frame timeline tracer.
+	When enabled, scopes are recorded into fixed-size per-thread ring buffers using the cpu
+	timestamp counter. The last frames can then be saved in the Chrome trace event format,
+	which can be opened with chrome://tracing or https://ui.perfetto.dev
+*/
+#pragma once
+#include "types.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace tracer
+{
+
+extern std::atomic<bool> recording;
+
+static inline bool enabled() {
+	return recording.load(std::memory_order_relaxed);
+}
+
+// Raw timestamp. Units are converted when the trace is saved.
+static inline u64 ticks()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	u64 v;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+	return v;
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Record a complete event. name must be a string literal.
+void record(const char *name, u64 start, u64 end);
+
+class Scope
+{
+public:
+	Scope(const char *name)
+	{
+		if (enabled())
+		{
+			this->name = name;
+			start = ticks();
+		}
+	}
+	~Scope() {
+		if (name != nullptr)
+			record(name, start, ticks());
+	}
+
+private:
+	const char *name = nullptr;
+	u64 start = 0;
+};
+
+// Name the events of the calling thread
+void setThreadName(const char *name);
+// Must be called once per emulated frame by the emulation thread.
+// Records the SH4 frame span and starts or stops recording according to the settings.
+void frameMark();
+// Save the last frames to the given file. Returns false if nothing has been recorded or on i/o error.
+bool save(const std::string& path, int frames = 120);
+
+}
+
+#define TRACE_SCOPE(name) tracer::Scope __trace_scope(name)
@@ -0,0 +1,868 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+	Portable dynarec backend.
+	The optimized shil opcodes of each block are translated into a compact bytecode stored in
+	the code buffer. Operands are resolved at compile time to pointers into the Sh4Context
+	register file or to a per-block constant pool, so executing an instruction is a single
+	indirect jump (computed goto if the compiler supports it) plus the operation itself.
+	Blocks are linked like native blocks: an exit returns the bytecode of the next block
+	without going through the block manager.
+*/
+#include "build.h"
+
+#if FEAT_SHREC == DYNAREC_VM
+
+#include "types.h"
+#include "hw/sh4/sh4_opcode_list.h"
+#include "hw/sh4/dyna/ngen.h"
+#include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/sh4_interrupts.h"
+#include "hw/sh4/sh4_core.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_rom.h"
+
+#define SHIL_MODE 1
+#include "hw/sh4/dyna/shil_canonical.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO
+#endif
+
+#define VM_OPCODES(X) \
+	/* block entry */ \
+	X(check_pc) X(check_block) X(check_fpu) X(cycles) \
+	/* moves and interpreter fallback */ \
+	X(mov32) X(mov64) X(jdyn) X(ifb) X(ifb_pc) \
+	/* memory */ \
+	X(readm8) X(readm16) X(readm32) X(readm64) \
+	X(readm8_ram) X(readm16_ram) X(readm32_ram) X(readm64_ram) \
+	X(writem8) X(writem16) X(writem32) X(writem64) \
+	X(writem8_ram) X(writem16_ram) X(writem32_ram) X(writem64_ram) \
+	/* integer */ \
+	X(sync_sr) X(sync_fpscr) X(and) X(or) X(xor) X(not) X(add) X(sub) X(neg) \
+	X(shl) X(shr) X(sar) X(adc) X(sbc) X(negc) X(ror) X(rocl) X(rocr) X(swaplb) X(shld) X(shad) \
+	X(ext_s8) X(ext_s16) X(mul_u16) X(mul_s16) X(mul_i32) X(mul_u64) X(mul_s64) \
+	X(div32u) X(div32s) X(div32p2) X(div1) X(debug_3) X(debug_1) \
+	X(cvt_f2i_t) X(cvt_i2f_n) X(cvt_i2f_z) X(pref) \
+	X(test) X(seteq) X(setge) X(setgt) X(setae) X(setab) X(setpeq) X(xtrct) X(illegal) \
+	/* floating point */ \
+	X(fadd) X(fsub) X(fmul) X(fdiv) X(fabs) X(fneg) X(fsqrt) X(fipr) X(ftrv) X(fmac) X(fsrra) X(fsca) \
+	X(fseteq) X(fsetgt) X(frswap) \
+	/* block exit */ \
+	X(exit_static) X(exit_cond) X(exit_dynamic) X(exit_intr)
+
+enum VmOp : u16
+{
+#define VM_ENUM(name) vm_##name,
+	VM_OPCODES(VM_ENUM)
+#undef VM_ENUM
+};
+
+struct VmInsn
+{
+	u16 op;
+	u16 imm;		// interpreter opcode, branch condition or checked code size
+	u32 pc;			// guest pc, odd for delay slots
+	u32 *rd;
+	u32 *rd2;
+	const u32 *rs1;
+	const u32 *rs2;
+	const u32 *rs3;
+};
+
+// Block header, followed by the instructions then the constant pool
+struct alignas(16) VmCode
+{
+	RuntimeBlockInfo *block;
+
+	const VmInsn *insns() const {
+		return reinterpret_cast<const VmInsn *>(this + 1);
+	}
+};
+
+class VmCompiler
+{
+public:
+	VmCompiler(Sh4Context& ctx, Sh4CodeBuffer& codeBuffer) : ctx(ctx), codeBuffer(codeBuffer) {}
+
+	void compile(RuntimeBlockInfo *block, bool smcChecks)
+	{
+		code = (VmCode *)codeBuffer.get();
+		code->block = block;
+		// one instruction per shil op, plus block entry and exit
+		const u32 maxInsns = block->oplist.size() + 5;
+		insn = const_cast<VmInsn *>(code->insns());
+		pool = reinterpret_cast<u32 *>(insn + maxInsns);
+		// scratch space for unused destinations
+		scratch = pool;
+		pool += 2;
+		zero = constant(0);
+
+		if (mmu_enabled())
+			emit(vm_check_pc, block->vaddr);
+		if (smcChecks)
+			genCheckBlock(block);
+		if (mmu_enabled() && block->has_fpu_op)
+			emit(vm_check_fpu, block->vaddr);
+		emit(vm_cycles, block->vaddr).rs1 = constant(block->guest_cycles);
+
+		for (const shil_opcode& op : block->oplist)
+			genOpcode(block, op);
+
+		genBlockExit(block);
+
+		const u32 size = roundUp((u8 *)pool - (u8 *)code);
+		verify(size <= codeBuffer.getFreeSpace());
+		block->code = reinterpret_cast<DynarecCodeEntryPtr>(code);
+		block->host_code_size = size;
+		block->host_opcodes = insn - code->insns();
+		block->relink_data = 0;
+		codeBuffer.advance(size);
+	}
+
+private:
+	static u32 roundUp(size_t size) {
+		return (size + alignof(VmCode) - 1) & ~(alignof(VmCode) - 1);
+	}
+
+	VmInsn& emit(VmOp op, u32 pc)
+	{
+		VmInsn& i = *insn++;
+		i.op = op;
+		i.imm = 0;
+		i.pc = pc;
+		i.rd = scratch;
+		i.rd2 = scratch;
+		i.rs1 = zero;
+		i.rs2 = zero;
+		i.rs3 = zero;
+		return i;
+	}
+
+	u32 *constant(u32 value)
+	{
+		*pool = value;
+		return pool++;
+	}
+
+	const u32 *src(const shil_param& param)
+	{
+		if (param.is_null())
+			return zero;
+		if (param.is_imm())
+			return constant(param._imm);
+		return param.reg_ptr(ctx);
+	}
+
+	u32 *dst(const shil_param& param)
+	{
+		if (param.is_null())
+			return scratch;
+		return param.reg_ptr(ctx);
+	}
+
+	void genCheckBlock(RuntimeBlockInfo *block)
+	{
+		const u32 size = block->sh4_code_size;
+		const u32 *mem = (const u32 *)GetMemPtr(block->addr, size);
+		if (mem == nullptr)
+			return;
+		VmInsn& i = emit(vm_check_block, block->vaddr);
+		verify(size <= 0xffff);
+		i.imm = size;
+		i.rs1 = mem;
+		i.rs2 = pool;
+		memcpy(pool, mem, size);
+		pool += (size + 3) / 4;
+	}
+
+	void genOpcode(RuntimeBlockInfo *block, const shil_opcode& op)
+	{
+		const u32 pc = block->vaddr + op.guest_offs - (op.delay_slot ? 1 : 0);
+		VmInsn *i;
+		switch (op.op)
+		{
+		case shop_mov32:
+			i = &emit(vm_mov32, pc);
+			break;
+		case shop_mov64:
+			verify(op.rd.is_r64f() && op.rs1.is_r64f());
+			i = &emit(vm_mov64, pc);
+			break;
+		case shop_jdyn:
+		case shop_jcond:
+			i = &emit(vm_jdyn, pc);
+			break;
+
+		case shop_ifb:
+			i = &emit(op.rs1._imm ? vm_ifb_pc : vm_ifb, pc);
+			i->imm = op.rs3._imm;
+			if (op.rs1._imm)
+				i->rs1 = constant(op.rs2._imm);
+			return;
+
+		case shop_readm:
+			genReadMem(block, op, pc);
+			return;
+		case shop_writem:
+			genWriteMem(block, op, pc);
+			return;
+
+#define SHIL_OP(name) case shop_##name: i = &emit(vm_##name, pc); break;
+		SHIL_OP(sync_sr) SHIL_OP(sync_fpscr) SHIL_OP(and) SHIL_OP(or) SHIL_OP(xor) SHIL_OP(not)
+		SHIL_OP(add) SHIL_OP(sub) SHIL_OP(neg) SHIL_OP(shl) SHIL_OP(shr) SHIL_OP(sar) SHIL_OP(adc)
+		SHIL_OP(sbc) SHIL_OP(negc) SHIL_OP(ror) SHIL_OP(rocl) SHIL_OP(rocr) SHIL_OP(swaplb) SHIL_OP(shld)
+		SHIL_OP(shad) SHIL_OP(ext_s8) SHIL_OP(ext_s16) SHIL_OP(mul_u16) SHIL_OP(mul_s16) SHIL_OP(mul_i32)
+		SHIL_OP(mul_u64) SHIL_OP(mul_s64) SHIL_OP(div32u) SHIL_OP(div32s) SHIL_OP(div32p2) SHIL_OP(div1)
+		SHIL_OP(debug_3) SHIL_OP(debug_1) SHIL_OP(cvt_f2i_t) SHIL_OP(cvt_i2f_n) SHIL_OP(cvt_i2f_z)
+		SHIL_OP(pref) SHIL_OP(test) SHIL_OP(seteq) SHIL_OP(setge) SHIL_OP(setgt) SHIL_OP(setae)
+		SHIL_OP(setab) SHIL_OP(setpeq) SHIL_OP(xtrct) SHIL_OP(illegal)
+		SHIL_OP(fadd) SHIL_OP(fsub) SHIL_OP(fmul) SHIL_OP(fdiv) SHIL_OP(fabs) SHIL_OP(fneg) SHIL_OP(fsqrt)
+		SHIL_OP(fipr) SHIL_OP(ftrv) SHIL_OP(fmac) SHIL_OP(fsrra) SHIL_OP(fsca) SHIL_OP(fseteq)
+		SHIL_OP(fsetgt) SHIL_OP(frswap)
+#undef SHIL_OP
+
+		default:
+			ERROR_LOG(DYNAREC, "Unsupported shil opcode %s", shil_opcode_name(op.op));
+			die("Unsupported shil opcode");
+			return;
+		}
+		i->rd = dst(op.rd);
+		i->rd2 = dst(op.rd2);
+		i->rs1 = src(op.rs1);
+		i->rs2 = src(op.rs2);
+		i->rs3 = src(op.rs3);
+	}
+
+	static VmOp memOp(VmOp op8, u32 size)
+	{
+		switch (size)
+		{
+		case 1: return op8;
+		case 2: return (VmOp)(op8 + 1);
+		case 4: return (VmOp)(op8 + 2);
+		case 8: return (VmOp)(op8 + 3);
+		default:
+			die("Invalid memory access size");
+			return op8;
+		}
+	}
+
+	void genReadMem(RuntimeBlockInfo *block, const shil_opcode& op, u32 pc)
+	{
+		void *ptr;
+		bool isRam;
+		u32 addr;
+		if (op.rs1.is_imm() && rdv_readMemImmediate(op.rs1._imm, op.size, ptr, isRam, addr, block) && isRam)
+		{
+			// Immediate address in RAM: read the host memory directly
+			VmInsn& i = emit(memOp(vm_readm8_ram, op.size), pc);
+			i.rd = dst(op.rd);
+			i.rs1 = (const u32 *)ptr;
+		}
+		else
+		{
+			VmInsn& i = emit(memOp(vm_readm8, op.size), pc);
+			i.rd = dst(op.rd);
+			i.rs1 = src(op.rs1);
+			i.rs3 = src(op.rs3);
+		}
+	}
+
+	void genWriteMem(RuntimeBlockInfo *block, const shil_opcode& op, u32 pc)
+	{
+		void *ptr;
+		bool isRam;
+		u32 addr;
+		if (op.rs1.is_imm() && rdv_writeMemImmediate(op.rs1._imm, op.size, ptr, isRam, addr, block) && isRam)
+		{
+			VmInsn& i = emit(memOp(vm_writem8_ram, op.size), pc);
+			i.rd = (u32 *)ptr;
+			i.rs2 = src(op.rs2);
+		}
+		else
+		{
+			VmInsn& i = emit(memOp(vm_writem8, op.size), pc);
+			i.rs1 = src(op.rs1);
+			i.rs2 = src(op.rs2);
+			i.rs3 = src(op.rs3);
+		}
+	}
+
+	void genBlockExit(RuntimeBlockInfo *block)
+	{
+		switch (block->BlockType)
+		{
+		case BET_StaticJump:
+		case BET_StaticCall:
+			emit(vm_exit_static, block->vaddr).rs1 = constant(block->BranchBlock);
+			break;
+
+		case BET_Cond_0:
+		case BET_Cond_1:
+			{
+				VmInsn& i = emit(vm_exit_cond, block->vaddr);
+				i.rs1 = block->has_jcond ? &ctx.jdyn : &ctx.sr.T;
+				i.imm = block->BlockType & 1;
+			}
+			break;
+
+		case BET_DynamicJump:
+		case BET_DynamicCall:
+		case BET_DynamicRet:
+			emit(vm_exit_dynamic, block->vaddr);
+			break;
+
+		case BET_DynamicIntr:
+			emit(vm_exit_intr, block->vaddr).rs1 = &ctx.jdyn;
+			break;
+		case BET_StaticIntr:
+			emit(vm_exit_intr, block->vaddr).rs1 = constant(block->NextBlock);
+			break;
+
+		default:
+			die("Invalid block end type");
+		}
+	}
+
+	Sh4Context& ctx;
+	Sh4CodeBuffer& codeBuffer;
+	VmCode *code = nullptr;
+	VmInsn *insn = nullptr;
+	u32 *pool = nullptr;
+	u32 *scratch = nullptr;
+	const u32 *zero = nullptr;
+};
+
+class VmDynarec : public Sh4Dynarec
+{
+public:
+	VmDynarec() {
+		sh4Dynarec = this;
+	}
+
+	void init(Sh4Context& sh4ctx, Sh4CodeBuffer& codeBuffer) override
+	{
+		this->ctx = &sh4ctx;
+		this->codeBuffer = &codeBuffer;
+	}
+
+	void compile(RuntimeBlockInfo* block, bool smc_checks, bool optimise) override
+	{
+		VmCompiler compiler(*ctx, *codeBuffer);
+		compiler.compile(block, smc_checks);
+	}
+
+	void mainloop(void *) override
+	{
+		try {
+			while (ctx->CpuRunning)
+			{
+				const VmCode *next = nullptr;
+				do {
+					const VmCode *code = next != nullptr ? next : lookup();
+					next = code != nullptr ? execute(code) : nullptr;
+				} while (ctx->cycle_counter > 0);
+
+				ctx->cycle_counter += SH4_TIMESLICE;
+				UpdateSystem_INTC();
+			}
+		} catch (const SH4ThrownException& ex) {
+			ERROR_LOG(DYNAREC, "SH4ThrownException in mainloop code %x", ex.expEvn);
+			throw FlycastException("Fatal: Unhandled SH4 exception");
+		}
+	}
+
+	void handleException(host_context_t& context) override {
+		die("Not supported");
+	}
+
+	bool rewrite(host_context_t& context, void *faultAddress) override {
+		// no fast memory access to rewrite
+		return false;
+	}
+
+	void canonStart(const shil_opcode *op) override {
+		die("Not supported");
+	}
+	void canonParam(const shil_opcode *op, const shil_param *param, CanonicalParamType paramType) override {
+		die("Not supported");
+	}
+	void canonCall(const shil_opcode *op, void *function) override {
+		die("Not supported");
+	}
+	void canonFinish(const shil_opcode *op) override {
+		die("Not supported");
+	}
+
+private:
+	const VmCode *lookup()
+	{
+		DynarecCodeEntryPtr code = bm_GetCodeByVAddr(ctx->pc);
+		if (code == ngen_FailedToFindBlock)
+		{
+			code = rdv_FailedToFindBlock(ctx->pc);
+			if (code == ngen_FailedToFindBlock)
+				// an exception occurred
+				return nullptr;
+		}
+		return reinterpret_cast<const VmCode *>(code);
+	}
+
+	// Called when the exit of a block isn't linked yet: find the next block and link it if possible,
+	// as rdv_LinkBlock() does for native blocks.
+	const VmCode *link(RuntimeBlockInfo *block, bool dynamic)
+	{
+		if (mmu_enabled() || (dynamic && block->relink_data != 0))
+			return lookup();
+		RuntimeBlockInfoPtr from = bm_GetBlock((void *)block->code);
+		const VmCode *next = lookup();
+		// Don't link stale blocks, or if the cache has been reset
+		if (next == nullptr || from.get() != block || bm_GetBlock((void *)block->code) != from)
+			return next;
+
+		RuntimeBlockInfo *nextBlock = next->block;
+		if (dynamic)
+		{
+			if (block->pBranchBlock != nullptr)
+			{
+				// More than one target: leave it unlinked
+				block->pBranchBlock->RemRef(from);
+				block->pBranchBlock = nullptr;
+				block->relink_data = 1;
+			}
+			else
+			{
+				block->pBranchBlock = nextBlock;
+				nextBlock->AddRef(from);
+			}
+		}
+		else if (nextBlock->vaddr == ctx->pc)
+		{
+			if (block->BranchBlock == ctx->pc)
+				block->pBranchBlock = nextBlock;
+			if (block->NextBlock == ctx->pc)
+				block->pNextBlock = nextBlock;
+			nextBlock->AddRef(from);
+		}
+		return next;
+	}
+
+	static void setU64(const VmInsn *insn, u64 v)
+	{
+		*insn->rd = (u32)v;
+		*insn->rd2 = (u32)(v >> 32);
+	}
+
+	// Execute a block and return the next one if it's linked
+	const VmCode *execute(const VmCode *code);
+
+	Sh4Context *ctx = nullptr;
+	Sh4CodeBuffer *codeBuffer = nullptr;
+};
+
+const VmCode *VmDynarec::execute(const VmCode *code)
+{
+	Sh4Context& ctx = *this->ctx;
+	RuntimeBlockInfo *block = code->block;
+	const VmInsn *insn = code->insns();
+
+#define RS1 (*insn->rs1)
+#define RS2 (*insn->rs2)
+#define RS3 (*insn->rs3)
+#define RD (*insn->rd)
+#define FS1 (*(const f32 *)insn->rs1)
+#define FS2 (*(const f32 *)insn->rs2)
+#define FS3 (*(const f32 *)insn->rs3)
+#define FRD (*(f32 *)insn->rd)
+#define CANON(name) shil_opcl_##name::f1::impl
+
+#ifdef VM_COMPUTED_GOTO
+#define VM_LABEL(name) &&op_##name,
+	static const void * const labels[] = { VM_OPCODES(VM_LABEL) };
+#undef VM_LABEL
+#define VM_DISPATCH() goto *labels[insn->op]
+#define VM_OP(name) op_##name:
+#else
+#define VM_DISPATCH() goto dispatch
+#define VM_OP(name) case vm_##name:
+#endif
+#define VM_NEXT() do { insn++; VM_DISPATCH(); } while (false)
+
+	try {
+#ifdef VM_COMPUTED_GOTO
+		VM_DISPATCH();
+#else
+	dispatch:
+		switch (insn->op)
+		{
+#endif
+		VM_OP(check_pc)
+			if (ctx.pc != block->vaddr)
+			{
+				rdv_BlockCheckFail(block->addr);
+				return nullptr;
+			}
+			VM_NEXT();
+		VM_OP(check_block)
+			if (memcmp(insn->rs1, insn->rs2, insn->imm) != 0)
+			{
+				rdv_BlockCheckFail(block->addr);
+				return nullptr;
+			}
+			VM_NEXT();
+		VM_OP(check_fpu)
+			if (ctx.sr.FD == 1)
+			{
+				Do_Exception(block->vaddr, Sh4Ex_FpuDisabled);
+				return nullptr;
+			}
+			VM_NEXT();
+		VM_OP(cycles)
+			ctx.cycle_counter -= RS1;
+			VM_NEXT();
+
+		VM_OP(mov32)
+			RD = RS1;
+			VM_NEXT();
+		VM_OP(mov64)
+			*(u64 *)insn->rd = *(const u64 *)insn->rs1;
+			VM_NEXT();
+		VM_OP(jdyn)
+			RD = RS1 + RS2;
+			VM_NEXT();
+		VM_OP(ifb_pc)
+			ctx.pc = RS1;
+			OpPtr[insn->imm](&ctx, insn->imm);
+			VM_NEXT();
+		VM_OP(ifb)
+			OpPtr[insn->imm](&ctx, insn->imm);
+			VM_NEXT();
+
+		VM_OP(readm8)
+			RD = (s32)(s8)ReadMem8(RS1 + RS3);
+			VM_NEXT();
+		VM_OP(readm16)
+			RD = (s32)(s16)ReadMem16(RS1 + RS3);
+			VM_NEXT();
+		VM_OP(readm32)
+			RD = ReadMem32(RS1 + RS3);
+			VM_NEXT();
+		VM_OP(readm64)
+			*(u64 *)insn->rd = ReadMem64(RS1 + RS3);
+			VM_NEXT();
+		VM_OP(readm8_ram)
+			RD = (s32)*(const s8 *)insn->rs1;
+			VM_NEXT();
+		VM_OP(readm16_ram)
+			RD = (s32)*(const s16 *)insn->rs1;
+			VM_NEXT();
+		VM_OP(readm32_ram)
+			RD = RS1;
+			VM_NEXT();
+		VM_OP(readm64_ram)
+			*(u64 *)insn->rd = *(const u64 *)insn->rs1;
+			VM_NEXT();
+		VM_OP(writem8)
+			WriteMem8(RS1 + RS3, (u8)RS2);
+			VM_NEXT();
+		VM_OP(writem16)
+			WriteMem16(RS1 + RS3, (u16)RS2);
+			VM_NEXT();
+		VM_OP(writem32)
+			WriteMem32(RS1 + RS3, RS2);
+			VM_NEXT();
+		VM_OP(writem64)
+			WriteMem64(RS1 + RS3, *(const u64 *)insn->rs2);
+			VM_NEXT();
+		VM_OP(writem8_ram)
+			*(u8 *)insn->rd = (u8)RS2;
+			VM_NEXT();
+		VM_OP(writem16_ram)
+			*(u16 *)insn->rd = (u16)RS2;
+			VM_NEXT();
+		VM_OP(writem32_ram)
+			RD = RS2;
+			VM_NEXT();
+		VM_OP(writem64_ram)
+			*(u64 *)insn->rd = *(const u64 *)insn->rs2;
+			VM_NEXT();
+
+		VM_OP(sync_sr)
+			CANON(sync_sr)();
+			VM_NEXT();
+		VM_OP(sync_fpscr)
+			CANON(sync_fpscr)(&ctx);
+			VM_NEXT();
+		VM_OP(and)
+			RD = RS1 & RS2;
+			VM_NEXT();
+		VM_OP(or)
+			RD = RS1 | RS2;
+			VM_NEXT();
+		VM_OP(xor)
+			RD = RS1 ^ RS2;
+			VM_NEXT();
+		VM_OP(not)
+			RD = ~RS1;
+			VM_NEXT();
+		VM_OP(add)
+			RD = RS1 + RS2;
+			VM_NEXT();
+		VM_OP(sub)
+			RD = RS1 - RS2;
+			VM_NEXT();
+		VM_OP(neg)
+			RD = -RS1;
+			VM_NEXT();
+		VM_OP(shl)
+			RD = CANON(shl)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(shr)
+			RD = CANON(shr)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(sar)
+			RD = CANON(sar)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(adc)
+			setU64(insn, CANON(adc)(RS1, RS2, RS3));
+			VM_NEXT();
+		VM_OP(sbc)
+			setU64(insn, CANON(sbc)(RS1, RS2, RS3));
+			VM_NEXT();
+		VM_OP(negc)
+			setU64(insn, CANON(negc)(RS1, RS2));
+			VM_NEXT();
+		VM_OP(ror)
+			RD = CANON(ror)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(rocl)
+			setU64(insn, CANON(rocl)(RS1, RS2));
+			VM_NEXT();
+		VM_OP(rocr)
+			setU64(insn, CANON(rocr)(RS1, RS2));
+			VM_NEXT();
+		VM_OP(swaplb)
+			RD = CANON(swaplb)(RS1);
+			VM_NEXT();
+		VM_OP(shld)
+			RD = CANON(shld)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(shad)
+			RD = CANON(shad)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(ext_s8)
+			RD = (s32)(s8)RS1;
+			VM_NEXT();
+		VM_OP(ext_s16)
+			RD = (s32)(s16)RS1;
+			VM_NEXT();
+		VM_OP(mul_u16)
+			RD = CANON(mul_u16)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(mul_s16)
+			RD = CANON(mul_s16)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(mul_i32)
+			RD = RS1 * RS2;
+			VM_NEXT();
+		VM_OP(mul_u64)
+			setU64(insn, CANON(mul_u64)(RS1, RS2));
+			VM_NEXT();
+		VM_OP(mul_s64)
+			setU64(insn, CANON(mul_s64)(RS1, RS2));
+			VM_NEXT();
+		VM_OP(div32u)
+			setU64(insn, CANON(div32u)(RS1, RS2, RS3));
+			VM_NEXT();
+		VM_OP(div32s)
+			setU64(insn, CANON(div32s)(RS1, RS2, RS3));
+			VM_NEXT();
+		VM_OP(div32p2)
+			RD = CANON(div32p2)(RS1, RS2, RS3);
+			VM_NEXT();
+		VM_OP(div1)
+			setU64(insn, CANON(div1)(RS1, RS2, RS3, &ctx));
+			VM_NEXT();
+		VM_OP(debug_3)
+			CANON(debug_3)(RS1, RS2, RS3);
+			VM_NEXT();
+		VM_OP(debug_1)
+			CANON(debug_1)(RS1);
+			VM_NEXT();
+		VM_OP(cvt_f2i_t)
+			RD = CANON(cvt_f2i_t)(FS1);
+			VM_NEXT();
+		VM_OP(cvt_i2f_n)
+			FRD = CANON(cvt_i2f_n)(RS1);
+			VM_NEXT();
+		VM_OP(cvt_i2f_z)
+			FRD = CANON(cvt_i2f_z)(RS1);
+			VM_NEXT();
+		VM_OP(pref)
+			CANON(pref)(RS1, &ctx);
+			VM_NEXT();
+		VM_OP(test)
+			RD = (RS1 & RS2) == 0;
+			VM_NEXT();
+		VM_OP(seteq)
+			RD = RS1 == RS2;
+			VM_NEXT();
+		VM_OP(setge)
+			RD = (s32)RS1 >= (s32)RS2;
+			VM_NEXT();
+		VM_OP(setgt)
+			RD = (s32)RS1 > (s32)RS2;
+			VM_NEXT();
+		VM_OP(setae)
+			RD = RS1 >= RS2;
+			VM_NEXT();
+		VM_OP(setab)
+			RD = RS1 > RS2;
+			VM_NEXT();
+		VM_OP(setpeq)
+			RD = CANON(setpeq)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(xtrct)
+			RD = CANON(xtrct)(RS1, RS2);
+			VM_NEXT();
+		VM_OP(illegal)
+			CANON(illegal)(RS1, RS2);
+			VM_NEXT();
+
+		VM_OP(fadd)
+			FRD = CANON(fadd)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(fsub)
+			FRD = CANON(fsub)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(fmul)
+			FRD = CANON(fmul)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(fdiv)
+			FRD = CANON(fdiv)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(fabs)
+			FRD = CANON(fabs)(FS1);
+			VM_NEXT();
+		VM_OP(fneg)
+			FRD = CANON(fneg)(FS1);
+			VM_NEXT();
+		VM_OP(fsqrt)
+			FRD = CANON(fsqrt)(FS1);
+			VM_NEXT();
+		VM_OP(fipr)
+			FRD = CANON(fipr)((const f32 *)insn->rs1, (const f32 *)insn->rs2);
+			VM_NEXT();
+		VM_OP(ftrv)
+			CANON(ftrv)((f32 *)insn->rd, (const f32 *)insn->rs1, (const f32 *)insn->rs2);
+			VM_NEXT();
+		VM_OP(fmac)
+			FRD = CANON(fmac)(FS1, FS2, FS3);
+			VM_NEXT();
+		VM_OP(fsrra)
+			FRD = CANON(fsrra)(FS1);
+			VM_NEXT();
+		VM_OP(fsca)
+			shil_opcl_fsca::fsca_table::impl((f32 *)insn->rd, RS1);
+			VM_NEXT();
+		VM_OP(fseteq)
+			RD = CANON(fseteq)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(fsetgt)
+			RD = CANON(fsetgt)(FS1, FS2);
+			VM_NEXT();
+		VM_OP(frswap)
+			CANON(frswap)((u64 *)insn->rd2, (u64 *)insn->rd, (const u64 *)insn->rs1, (const u64 *)insn->rs2);
+			VM_NEXT();
+
+		VM_OP(exit_static)
+			{
+				ctx.pc = RS1;
+				RuntimeBlockInfo *next = ctx.pc == block->BranchBlock ? block->pBranchBlock : block->pNextBlock;
+				if (next != nullptr)
+					return reinterpret_cast<const VmCode *>(next->code);
+				return link(block, false);
+			}
+		VM_OP(exit_cond)
+			{
+				RuntimeBlockInfo *next;
+				if (RS1 == insn->imm)
+				{
+					ctx.pc = block->BranchBlock;
+					next = block->pBranchBlock;
+				}
+				else
+				{
+					ctx.pc = block->NextBlock;
+					next = block->pNextBlock;
+				}
+				if (next != nullptr)
+					return reinterpret_cast<const VmCode *>(next->code);
+				return link(block, false);
+			}
+		VM_OP(exit_dynamic)
+			{
+				ctx.pc = ctx.jdyn;
+				RuntimeBlockInfo *next = block->pBranchBlock;
+				if (next != nullptr && next->vaddr == ctx.pc)
+					return reinterpret_cast<const VmCode *>(next->code);
+				return link(block, true);
+			}
+		VM_OP(exit_intr)
+			ctx.pc = RS1;
+			UpdateINTC();
+			return nullptr;
+#ifndef VM_COMPUTED_GOTO
+		default:
+			die("Invalid vm opcode");
+			return nullptr;
+		}
+#endif
+	} catch (SH4ThrownException& ex) {
+		u32 pc = insn->pc;
+		if (pc & 1)
+		{
+			// Delay slot
+			AdjustDelaySlotException(ex);
+			pc--;
+		}
+		Do_Exception(pc, ex.expEvn);
+		ctx.cycle_counter += 4;	// probably more is needed
+		return nullptr;
+	}
+
+#undef VM_NEXT
+#undef VM_OP
+#undef VM_DISPATCH
+#undef CANON
+#undef FRD
+#undef FS3
+#undef FS2
+#undef FS1
+#undef RD
+#undef RS3
+#undef RS2
+#undef RS1
+}
+
+static VmDynarec instance;
+
+#endif	// FEAT_SHREC == DYNAREC_VM
@@ -72,7 +72,10 @@ static bool reios_locate_bootfile(const char* bootfile)
 	// Load IP.BIN bootstrap
 	libGDR_ReadSector(GetMemPtr(0x8c008000, 0), base_fad, 16, 2048);
 
-	IsoFs isofs(disc);
+	// The drive's disc is also read by the prefetch thread
+	IsoFs isofs(base_fad, [](u32 fad, u32 count, u8 *dst) {
+		libGDR_ReadSector(dst, fad, count, 2048);
+	});
 	std::unique_ptr<IsoFs::Directory> root(isofs.getRoot());
 	if (root == nullptr)
 	{
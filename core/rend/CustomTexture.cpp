@@ -25,7 +25,9 @@
 #include "stdclass.h"
 #include "util/worker_thread.h"
 
+#include <algorithm>
 #include <sstream>
+#include <thread>
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ONLY_JPEG
 #define STBI_ONLY_PNG
@@ -43,16 +45,19 @@ void CustomTexture::loadTexture(BaseTextureCacheData *texture)
 	}
 	if (!texture->dirty)
 	{
+		mapLoaded.wait();
 		int width, height;
-		u8 *image_data = loadTexture(texture->texture_hash, width, height);
+		bool mipmaps;
+		u8 *image_data = loadTexture(texture->texture_hash, width, height, mipmaps);
 		if (image_data == nullptr && texture->old_vqtexture_hash != 0)
-			image_data = loadTexture(texture->old_vqtexture_hash, width, height);
+			image_data = loadTexture(texture->old_vqtexture_hash, width, height, mipmaps);
 		if (image_data == nullptr)
-			image_data = loadTexture(texture->old_texture_hash, width, height);
+			image_data = loadTexture(texture->old_texture_hash, width, height, mipmaps);
 		if (image_data != nullptr)
 		{
 			texture->custom_width = width;
 			texture->custom_height = height;
+			texture->custom_mipmaps = mipmaps;
 			texture->custom_image_data = image_data;
 		}
 	}
@@ -89,9 +94,16 @@ bool CustomTexture::init()
 					{
 						NOTICE_LOG(RENDERER, "Found custom textures directory: %s", textures_path.c_str());
 						custom_textures_available = true;
-						loaderThread = std::make_unique<WorkerThread>("CustomTexLoader");
-						loaderThread->run([this]() {
+						pack.open(textures_path + texpack::FileName);
+						// Loading from a texture pack is mostly I/O bound but decompression and png decoding aren't
+						const int threadCount = std::clamp<int>(std::thread::hardware_concurrency() / 2, 1, 4);
+						for (int i = 0; i < threadCount; i++)
+							loaderThreads.push_back(std::make_unique<WorkerThread>("CustomTexLoader"));
+						auto promise = std::make_shared<std::promise<void>>();
+						mapLoaded = promise->get_future().share();
+						loaderThreads[0]->run([this, promise]() {
 							loadMap();
+							promise->set_value();
 						});
 					}
 				} catch (const FlycastException& e) {
@@ -108,26 +120,89 @@ CustomTexture::~CustomTexture() {
 
 void CustomTexture::Terminate()
 {
-	if (loaderThread)
-		loaderThread->stop();
-	loaderThread.reset();
+	for (auto& thread : loaderThreads)
+		thread->stop();
+	loaderThreads.clear();
 	texture_map.clear();
+	pack.close();
+	cache.clear();
+	cacheMap.clear();
+	cacheSize = 0;
 	initialized = false;
 }
 
-u8* CustomTexture::loadTexture(u32 hash, int& width, int& height)
+u8 *CustomTexture::getCachedImage(u32 hash, int& width, int& height, bool& mipmaps)
 {
-	auto it = texture_map.find(hash);
-	if (it == texture_map.end())
+	std::lock_guard<std::mutex> _(cacheMutex);
+	auto it = cacheMap.find(hash);
+	if (it == cacheMap.end())
+		return nullptr;
+	cache.splice(cache.begin(), cache, it->second);
+	const CachedImage& image = *it->second;
+	u8 *data = (u8 *)malloc(image.data.size());
+	if (data == nullptr)
 		return nullptr;
+	memcpy(data, image.data.data(), image.data.size());
+	width = image.width;
+	height = image.height;
+	mipmaps = image.mipmaps;
+	return data;
+}
 
-	FILE *file = hostfs::storage().openFile(it->second, "rb");
-	if (file == nullptr)
+void CustomTexture::addCachedImage(u32 hash, int width, int height, bool mipmaps, const u8 *data, size_t size)
+{
+	if (size > CacheBudget / 4)
+		return;
+	std::lock_guard<std::mutex> _(cacheMutex);
+	if (cacheMap.count(hash) != 0)
+		return;
+	while (cacheSize + size > CacheBudget)
+	{
+		// evict the least recently used images
+		cacheSize -= cache.back().data.size();
+		cacheMap.erase(cache.back().hash);
+		cache.pop_back();
+	}
+	cache.push_front({ hash, width, height, mipmaps, std::vector<u8>(data, data + size) });
+	cacheMap[hash] = cache.begin();
+	cacheSize += size;
+}
+
+u8* CustomTexture::loadTexture(u32 hash, int& width, int& height, bool& mipmaps)
+{
+	u8 *imgData = getCachedImage(hash, width, height, mipmaps);
+	if (imgData != nullptr)
+		return imgData;
+
+	// Loose image files override the texture pack
+	auto it = texture_map.find(hash);
+	if (it != texture_map.end())
+	{
+		FILE *file = hostfs::storage().openFile(it->second, "rb");
+		if (file == nullptr)
+			return nullptr;
+		int n;
+		stbi_set_flip_vertically_on_load_thread(1);
+		imgData = stbi_load_from_file(file, &width, &height, &n, STBI_rgb_alpha);
+		std::fclose(file);
+		mipmaps = false;
+		if (imgData != nullptr)
+			addCachedImage(hash, width, height, mipmaps, imgData, width * height * 4);
+		return imgData;
+	}
+	const texpack::IndexEntry *entry = pack.find(hash);
+	if (entry == nullptr)
 		return nullptr;
-	int n;
-	stbi_set_flip_vertically_on_load(1);
-	u8 *imgData = stbi_load_from_file(file, &width, &height, &n, STBI_rgb_alpha);
-	std::fclose(file);
+	imgData = pack.load(*entry);
+	if (imgData == nullptr)
+		return nullptr;
+	width = entry->width;
+	height = entry->height;
+	mipmaps = entry->levels > 1;
+	// Uncompressed images are read from the memory-mapped file at no cost
+	if (entry->compression != texpack::Compression::None)
+		addCachedImage(hash, width, height, mipmaps, imgData, entry->rawSize);
+
 	return imgData;
 }
 
@@ -137,7 +212,7 @@ void CustomTexture::LoadCustomTextureAsync(BaseTextureCacheData *texture_data)
 		return;
 
 	texture_data->custom_load_in_progress++;
-	loaderThread->run([this, texture_data]() {
+	loaderThreads[nextLoader++ % loaderThreads.size()]->run([this, texture_data]() {
 		loadTexture(texture_data);
 	});
 }
@@ -294,5 +369,5 @@ void CustomTexture::loadMap()
 		}
 		texture_map[hash] = item.path;
 	}
-	custom_textures_available = !texture_map.empty();
+	custom_textures_available = !texture_map.empty() || pack.isOpen();
 }
@@ -18,9 +18,16 @@
  */
 #pragma once
 #include "texconv.h"
+#include "texture_pack.h"
+#include <atomic>
+#include <future>
+#include <list>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 class BaseTextureCacheData;
 class WorkerThread;
@@ -34,17 +41,38 @@ public:
 	void Terminate();
 
 private:
+	// Decoded images kept in memory to avoid decoding them again when a texture is reloaded
+	struct CachedImage
+	{
+		u32 hash;
+		int width;
+		int height;
+		bool mipmaps;
+		std::vector<u8> data;
+	};
+	static constexpr size_t CacheBudget = 256_MB;
+
 	bool init();
-	u8* loadTexture(u32 hash, int& width, int& height);
+	u8* loadTexture(u32 hash, int& width, int& height, bool& mipmaps);
 	void loadTexture(BaseTextureCacheData *texture);
 	std::string getGameId();
 	void loadMap();
+	u8 *getCachedImage(u32 hash, int& width, int& height, bool& mipmaps);
+	void addCachedImage(u32 hash, int width, int height, bool mipmaps, const u8 *data, size_t size);
 	
 	bool initialized = false;
 	bool custom_textures_available = false;
 	std::string textures_path;
 	std::map<u32, std::string> texture_map;
-	std::unique_ptr<WorkerThread> loaderThread;
+	std::shared_future<void> mapLoaded;
+	texpack::TexturePack pack;
+	std::vector<std::unique_ptr<WorkerThread>> loaderThreads;
+	std::atomic<u32> nextLoader {};
+
+	std::list<CachedImage> cache;	// most recently used first
+	std::unordered_map<u32, std::list<CachedImage>::iterator> cacheMap;
+	size_t cacheSize = 0;
+	std::mutex cacheMutex;
 };
 
 extern CustomTexture custom_texture;
@@ -16,8 +16,10 @@
 */
 #include "TexCache.h"
 #include "deps/xbrz/xbrz.h"
+#include "fbconv.h"
 #include "hw/pvr/pvr_mem.h"
 #include "hw/mem/addrspace.h"
+#include "profiler/frame_tracer.h"
 
 #include <mutex>
 #include <xxhash.h>
@@ -303,6 +305,7 @@ BaseTextureCacheData::BaseTextureCacheData(TSP tsp, TCW tcw)
 	dirty = FrameCount;
 	lock_block = nullptr;
 	custom_image_data = nullptr;
+	custom_mipmaps = false;
 	custom_load_in_progress = 0;
 	gpuPalette = false;
 
@@ -428,6 +431,7 @@ void BaseTextureCacheData::ComputeHash()
 
 bool BaseTextureCacheData::Update()
 {
+	TRACE_SCOPE("Texture update");
 	//texture state tracking stuff
 	Updates++;
 	dirty = 0;
@@ -583,16 +587,24 @@ bool BaseTextureCacheData::Update()
 			// xBRZ scaling
 			if (textureUpscaling)
 			{
-				PixelBuffer<u32> tmp_buf;
-				tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
-
 				if (tcw.PixelFmt == Pixel1555 || tcw.PixelFmt == Pixel4444)
 					// Alpha channel formats. Palettes with alpha are already handled
 					has_alpha = true;
-				UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
-				pb32.steal_data(tmp_buf);
-				upscaled_w *= config::TextureUpscale;
-				upscaled_h *= config::TextureUpscale;
+				if (!config::CustomTextures)
+				{
+					// Upload the native texture now. The upscaled one replaces it when ready.
+					texture_upscaler.upscaleAsync(this, pb32.data(), width, height, config::TextureUpscale, has_alpha);
+				}
+				else
+				{
+					// The custom texture loader also uses custom_image_data
+					PixelBuffer<u32> tmp_buf;
+					tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
+					UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
+					pb32.steal_data(tmp_buf);
+					upscaled_w *= config::TextureUpscale;
+					upscaled_h *= config::TextureUpscale;
+				}
 			}
 		}
 		temp_tex_buffer = pb32.data();
@@ -684,7 +696,13 @@ void BaseTextureCacheData::CheckCustomTexture()
 	{
 		tex_type = TextureType::_8888;
 		gpuPalette = false;
-		UploadToGPU(custom_width, custom_height, custom_image_data, IsMipmapped(), false);
+		if (!custom_mipmaps)
+			UploadToGPU(custom_width, custom_height, custom_image_data, IsMipmapped(), false);
+		else if (IsMipmapped())
+			UploadToGPU(custom_width, custom_height, custom_image_data, true, true);
+		else
+			// the largest level is last
+			UploadToGPU(custom_width, custom_height, custom_image_data + texpack::mipmapChainSize(custom_width), false, false);
 		free(custom_image_data);
 		custom_image_data = nullptr;
 	}
@@ -743,77 +761,48 @@ void ReadFramebuffer(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& wid
 	pb.init(width, height);
 	u32 *dst = (u32 *)pb.data();
 	const u32 fb_concat = info.fb_r_ctrl.fb_concat;
+	constexpr bool bgra = std::is_same_v<Packer, BGRAPacker>;
+	const fbconv::Converters& conv = fbconv::get();
+	std::vector<u8> line;
 
 	switch (info.fb_r_ctrl.fb_depth)
 	{
 		case fbde_0555:    // 555 RGB
+		case fbde_565:     // 565 RGB
+			line.resize(width * 2);
 			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i++)
-				{
-					u16 src = pvr_read32p<u16>(addr);
-					*dst++ = Packer::pack(
-							(((src >> 10) & 0x1F) << 3) | fb_concat,
-							(((src >> 5) & 0x1F) << 3) | fb_concat,
-							(((src >> 0) & 0x1F) << 3) | fb_concat,
-							0xff);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
-			}
-			break;
-
-		case fbde_565:    // 565 RGB
-			for (int y = 0; y < height; y++)
-			{
-				for (int i = 0; i < width; i++)
-				{
-					u16 src = pvr_read32p<u16>(addr);
-					*dst++ = Packer::pack(
-							(((src >> 11) & 0x1F) << 3) | fb_concat,
-							(((src >> 5) & 0x3F) << 2) | (fb_concat & 3),
-							(((src >> 0) & 0x1F) << 3) | fb_concat,
-							0xFF);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
+				pvr_read32_block(addr & ~1, line.data(), width * 2);
+				if (info.fb_r_ctrl.fb_depth == fbde_0555)
+					conv.read0555((const u16 *)line.data(), dst, width, fb_concat, bgra);
+				else
+					conv.read565((const u16 *)line.data(), dst, width, fb_concat, bgra);
+				dst += width;
+				addr += (width + modulus) * bpp;
 			}
 			break;
 		case fbde_888:		// 888 RGB
-			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i += 4)
+				// 3 words for 4 pixels
+				const u32 lineSize = ((width / 4) * 3 + width % 4) * 4;
+				line.resize(lineSize);
+				for (int y = 0; y < height; y++)
 				{
-					u32 src = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src >> 16, src >> 8, src, 0xff);
-					addr += 4;
-					if (i + 1 >= width)
-						break;
-					u32 src2 = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src2 >> 8, src2, src >> 24, 0xff);
-					addr += 4;
-					if (i + 2 >= width)
-						break;
-					u32 src3 = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src3, src2 >> 24, src2 >> 16, 0xff);
-					addr += 4;
-					if (i + 3 >= width)
-						break;
-					*dst++ = Packer::pack(src3 >> 24, src3 >> 16, src3 >> 8, 0xff);
+					pvr_read32_block(addr & ~3, line.data(), lineSize);
+					conv.read888(line.data(), dst, width, bgra);
+					dst += width;
+					addr += lineSize + modulus * bpp;
 				}
-				addr += modulus * bpp;
 			}
 			break;
 		case fbde_C888:     // 0888 RGB
+			line.resize(width * 4);
 			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i++)
-				{
-					u32 src = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src >> 16, src >> 8, src, 0xff);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
+				pvr_read32_block(addr & ~3, line.data(), width * 4);
+				conv.readC888((const u32 *)line.data(), dst, width, bgra);
+				dst += width;
+				addr += (width + modulus) * bpp;
 			}
 			break;
 	}
@@ -821,330 +810,86 @@ void ReadFramebuffer(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& wid
 template void ReadFramebuffer<RGBAPacker>(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& width, int& height);
 template void ReadFramebuffer<BGRAPacker>(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& width, int& height);
 
-template<int bits>
-static inline u8 roundColor(u8 in)
-{
-	u8 out = in >> (8 - bits);
-	if (out != 0xffu >> (8 - bits))
-		out += (in >> (8 - bits - 1)) & 1;
-	return out;
-}
-
-// write to 32-bit vram area (framebuffer)
-class FBPixelWriter
-{
-public:
-	FBPixelWriter(u32 dstAddr) : dstAddr(dstAddr) {}
-
-	template<typename T>
-	void write(T pixel) {
-		pvr_write32p<T, true>(dstAddr, pixel);
-		dstAddr += sizeof(T);
-	}
-
-	void advance(int bytes) {
-		dstAddr += bytes;
-	}
-
-private:
-	u32 dstAddr;
-};
-
-// write to 64-bit vram area (render to texture)
-class TexPixelWriter
-{
-public:
-	TexPixelWriter(u16 *dest) : dest(dest) {}
-
-	void write(u16 pixel) {
-		*dest++ = pixel;
-	}
-
-	void advance(int bytes) {
-		(u8 *&)dest += bytes;
-	}
-
-private:
-	u16 *dest;
-};
-
-// 0555 KRGB 16 bit  (default)	Bit 15 is the value of fb_kval[7].
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter, bool Round = false>
-class FBLineWriter0555
-{
-public:
-	FBLineWriter0555(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {
-		kval_bit = (fb_w_ctrl.fb_kval & 0x80) << 8;
-	}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
-	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<5>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 3;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 10) | (green << 5) | blue | kval_bit));
-			pixel += 4;
-		}
-	}
-
-	static constexpr int BytesPerPixel = 2;
-
-private:
-	u16 kval_bit;
-	PixelWriter& pixWriter;
-};
-
-// 565 RGB 16 bit
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter, bool Round = false>
-class FBLineWriter565
-{
-public:
-	FBLineWriter565(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
-	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<6>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 2;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 11) | (green << 5) | blue));
-			pixel += 4;
-		}
-	}
-
-	static constexpr int BytesPerPixel = 2;
-
-private:
-	PixelWriter& pixWriter;
-};
-
-// 4444 ARGB 16 bit
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter, bool Round = false>
-class FBLineWriter4444
-{
-public:
-	FBLineWriter4444(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
-	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue, alpha;
-			if constexpr (Round)
-			{
-				red = roundColor<4>(pixel[Red]);
-				green = roundColor<4>(pixel[Green]);
-				blue = roundColor<4>(pixel[Blue]);
-				alpha = roundColor<4>(pixel[Alpha]);
-			}
-			else
-			{
-				red = pixel[Red] >> 4;
-				green = pixel[Green] >> 4;
-				blue = pixel[Blue] >> 4;
-				alpha = pixel[Alpha] >> 4;
-			}
-			pixWriter.write((u16)((red << 8) | (green << 4) | blue | (alpha << 12)));
-			pixel += 4;
-		}
-	}
-
-	static constexpr int BytesPerPixel = 2;
-
-private:
-	PixelWriter& pixWriter;
-};
-
-// 1555 ARGB 16 bit    The alpha value is determined by comparison with the value of fb_alpha_threshold.
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter, bool Round = false>
-class FBLineWriter1555
-{
-public:
-	FBLineWriter1555(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {
-		fb_alpha_threshold = fb_w_ctrl.fb_alpha_threshold;
-	}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
-	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<5>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 3;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 10) | (green << 5) | blue
-					| (pixel[Alpha] >= fb_alpha_threshold ? 0x8000 : 0)));
-			pixel += 4;
-		}
-	}
-
-	static constexpr int BytesPerPixel = 2;
-
-private:
-	PixelWriter& pixWriter;
-	u8 fb_alpha_threshold;
-};
-
-// 888 RGB 24 bit packed
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter>
-class FBLineWriter888
+static int fbBytesPerPixel(u32 packmode)
 {
-public:
-	FBLineWriter888(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
+	switch (packmode)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write(pixel[Blue]);
-			pixWriter.write(pixel[Green]);
-			pixWriter.write(pixel[Red]);
-			pixel += 4;
-		}
+	case 4:
+		return 3;
+	case 5:
+	case 6:
+		return 4;
+	default:
+		return 2;
 	}
+}
 
-	static constexpr int BytesPerPixel = 3;
-
-private:
-	PixelWriter& pixWriter;
-};
-
-// 0888 KRGB 32 bit (K is the value of fb_kval.)
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter>
-class FBLineWriter0888
+// Convert a line of host pixels to the given pixel format
+static void convertFramebufferLine(const u8 *src, u8 *dst, int count, FB_W_CTRL_type fb_w_ctrl, bool round, bool bgra)
 {
-public:
-	FBLineWriter0888(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {
-		fb_kval = fb_w_ctrl.fb_kval << 24;
-	}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
+	const fbconv::Converters& conv = fbconv::get();
+	switch (fb_w_ctrl.fb_packmode)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write((u32)((pixel[Red] << 16) | (pixel[Green] << 8) | pixel[Blue] | fb_kval));
-			pixel += 4;
-		}
+	case 0: // 0555 KRGB 16 bit  (default)	Bit 15 is the value of fb_kval[7].
+		conv.write0555(src, (u16 *)dst, count, round, (fb_w_ctrl.fb_kval & 0x80) << 8, bgra);
+		break;
+	case 1: // 565 RGB 16 bit
+		conv.write565(src, (u16 *)dst, count, round, bgra);
+		break;
+	case 2: // 4444 ARGB 16 bit
+		conv.write4444(src, (u16 *)dst, count, round, bgra);
+		break;
+	case 3: // 1555 ARGB 16 bit    The alpha value is determined by comparison with the value of fb_alpha_threshold.
+		conv.write1555(src, (u16 *)dst, count, round, fb_w_ctrl.fb_alpha_threshold, bgra);
+		break;
+	case 4: // 888 RGB 24 bit packed
+		conv.write888(src, dst, count, bgra);
+		break;
+	case 5: // 0888 KRGB 32 bit (K is the value of fb_kval.)
+		conv.write0888(src, (u32 *)dst, count, fb_w_ctrl.fb_kval << 24, bgra);
+		break;
+	case 6: // 8888 ARGB 32 bit
+		conv.write8888(src, (u32 *)dst, count, bgra);
+		break;
+	default:
+		die("Invalid framebuffer format");
+		break;
 	}
+}
 
-	static constexpr int BytesPerPixel = 4;
-
-private:
-	u32 fb_kval;
-	PixelWriter& pixWriter;
-};
-
-// 8888 ARGB 32 bit
-template<int Red, int Green, int Blue, int Alpha, typename PixelWriter>
-class FBLineWriter8888
+template<int Red, int Green, int Blue, int Alpha>
+void WriteTextureToVRam(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride)
 {
-public:
-	FBLineWriter8888(FB_W_CTRL_type fb_w_ctrl, PixelWriter& pixWriter) : pixWriter(pixWriter) {}
-
-	void write(int xmin, int xmax, const u8 *& pixel, int y)
-	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write((u32)((pixel[Red] << 16) | (pixel[Green] << 8) | pixel[Blue] | (pixel[Alpha] << 24)));
-			pixel += 4;
-		}
-	}
-
-	static constexpr int BytesPerPixel = 4;
-
-private:
-	PixelWriter& pixWriter;
-};
+	// Only 16-bit formats are supported
+	if (fb_w_ctrl.fb_packmode > 3)
+		return;
+	const bool round = !(fb_w_ctrl.fb_dither && config::EmulateFramebuffer);
 
-template<typename FBLineWriter>
-static void writeTexture(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride)
-{
 	u32 padding = linestride;
 	if (padding > width * 2)
 		padding = padding - width * 2;
 	else
 		padding = 0;
 
-	TexPixelWriter pixWriter(dst);
-	FBLineWriter lineWriter(fb_w_ctrl, pixWriter);
-
-	for (u32 l = 0; l < height; l++) {
-		lineWriter.write(0, width, data, l);
-		pixWriter.advance(padding);
-	}
-}
-
-template<int Red, int Green, int Blue, int Alpha>
-void WriteTextureToVRam(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride)
-{
-	bool dither = fb_w_ctrl.fb_dither && config::EmulateFramebuffer;
-	switch (fb_w_ctrl.fb_packmode)
+	u8 *p = (u8 *)dst;
+	for (u32 l = 0; l < height; l++)
 	{
-	case 0: // 0555 KRGB 16 bit  (default)
-		if (dither)
-			writeTexture<FBLineWriter0555<Red, Green, Blue, Alpha, TexPixelWriter, false>>(width, height, data, dst, fb_w_ctrl, linestride);
-		else
-			writeTexture<FBLineWriter0555<Red, Green, Blue, Alpha, TexPixelWriter, true>>(width, height, data, dst, fb_w_ctrl, linestride);
-		break;
-	case 1: // 565 RGB 16 bit
-		if (dither)
-			writeTexture<FBLineWriter565<Red, Green, Blue, Alpha, TexPixelWriter, false>>(width, height, data, dst, fb_w_ctrl, linestride);
-		else
-			writeTexture<FBLineWriter565<Red, Green, Blue, Alpha, TexPixelWriter, true>>(width, height, data, dst, fb_w_ctrl, linestride);
-		break;
-	case 2: // 4444 ARGB 16 bit
-		if (dither)
-			writeTexture<FBLineWriter4444<Red, Green, Blue, Alpha, TexPixelWriter, false>>(width, height, data, dst, fb_w_ctrl, linestride);
-		else
-			writeTexture<FBLineWriter4444<Red, Green, Blue, Alpha, TexPixelWriter, true>>(width, height, data, dst, fb_w_ctrl, linestride);
-		break;
-	case 3: // 1555 ARGB 16 bit
-		if (dither)
-			writeTexture<FBLineWriter1555<Red, Green, Blue, Alpha, TexPixelWriter, false>>(width, height, data, dst, fb_w_ctrl, linestride);
-		else
-			writeTexture<FBLineWriter1555<Red, Green, Blue, Alpha, TexPixelWriter, true>>(width, height, data, dst, fb_w_ctrl, linestride);
-		break;
+		convertFramebufferLine(data, p, width, fb_w_ctrl, round, Red == 2);
+		data += width * 4;
+		p += width * 2 + padding;
 	}
 }
 template void WriteTextureToVRam<0, 1, 2, 3>(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride);
 template void WriteTextureToVRam<2, 1, 0, 3>(u32 width, u32 height, const u8 *data, u16 *dst, FB_W_CTRL_type fb_w_ctrl, u32 linestride);
 
-template<typename FBLineWriter>
-static void writeFramebufferLW(u32 width, u32 height, const u8 *data, u32 dstAddr, FB_W_CTRL_type fb_w_ctrl, u32 linestride, FB_X_CLIP_type xclip, FB_Y_CLIP_type yclip)
+template<int Red, int Green, int Blue, int Alpha>
+void WriteFramebuffer(u32 width, u32 height, const u8 *data, u32 dstAddr, FB_W_CTRL_type fb_w_ctrl, u32 linestride, FB_X_CLIP_type xclip, FB_Y_CLIP_type yclip)
 {
-	int bpp = FBLineWriter::BytesPerPixel;
+	if (fb_w_ctrl.fb_packmode > 6)
+		die("Invalid framebuffer format");
+	const int bpp = fbBytesPerPixel(fb_w_ctrl.fb_packmode);
+	// vram is written with 8-bit accesses for 24-bit pixels and bpp-sized accesses otherwise
+	const u32 alignMask = bpp == 3 ? ~0u : ~(bpp - 1u);
 
 	u32 padding = linestride;
 	if (padding > width * bpp)
@@ -1157,53 +902,26 @@ static void writeFramebufferLW(u32 width, u32 height, const u8 *data, u32 dstAdd
 
 	const u32 clipWidth = std::min(width, xclip.max + 1u);
 	height = std::min(height, yclip.max + 1u);
-
-	FBPixelWriter pixWriter(dstAddr);
-	FBLineWriter lineWriter(fb_w_ctrl, pixWriter);
+	const int count = std::max((int)clipWidth - (int)xclip.min, 0);
+	std::vector<u8> line(count * bpp);
 
 	for (u32 l = yclip.min; l < height; l++)
 	{
 		p += 4 * xclip.min;
-		pixWriter.advance(bpp * xclip.min);
+		dstAddr += bpp * xclip.min;
 
-		lineWriter.write(xclip.min, clipWidth, p, l);
+		if (count > 0)
+		{
+			convertFramebufferLine(p, line.data(), count, fb_w_ctrl, false, Red == 2);
+			pvr_write32_block(dstAddr & alignMask, line.data(), count * bpp);
+			p += 4 * count;
+			dstAddr += bpp * count;
+		}
 
-		pixWriter.advance(padding + (width - xclip.max - 1) * bpp);
+		dstAddr += padding + (width - xclip.max - 1) * bpp;
 		p += (width - xclip.max - 1) * 4;
 	}
 }
-
-template<int Red, int Green, int Blue, int Alpha>
-void WriteFramebuffer(u32 width, u32 height, const u8 *data, u32 dstAddr, FB_W_CTRL_type fb_w_ctrl, u32 linestride, FB_X_CLIP_type xclip, FB_Y_CLIP_type yclip)
-{
-	switch (fb_w_ctrl.fb_packmode)
-	{
-	case 0: // 0555 KRGB 16 bit
-		writeFramebufferLW<FBLineWriter0555<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 1: // 565 RGB 16 bit
-		writeFramebufferLW<FBLineWriter565<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 2: // 4444 ARGB 16 bit
-		writeFramebufferLW<FBLineWriter4444<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 3: // 1555 ARGB 16 bit
-		writeFramebufferLW<FBLineWriter1555<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 4: // 888 RGB 24 bit packed
-		writeFramebufferLW<FBLineWriter888<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 5: // 0888 KRGB 32 bit
-		writeFramebufferLW<FBLineWriter0888<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	case 6: // 8888 ARGB 32 bit
-		writeFramebufferLW<FBLineWriter8888<Red, Green, Blue, Alpha, FBPixelWriter>>(width, height, data, dstAddr, fb_w_ctrl, linestride, xclip, yclip);
-		break;
-	default:
-		die("Invalid framebuffer format");
-		break;
-	}
-}
 template void WriteFramebuffer<0, 1, 2, 3>(u32 width, u32 height, const u8 *data, u32 dstAddr, FB_W_CTRL_type fb_w_ctrl,
 		u32 linestride, FB_X_CLIP_type xclip, FB_Y_CLIP_type yclip);
 template void WriteFramebuffer<2, 1, 0, 3>(u32 width, u32 height, const u8 *data, u32 dstAddr, FB_W_CTRL_type fb_w_ctrl,
@@ -20,6 +20,7 @@
 #include "cfg/option.h"
 #include "texconv.h"
 #include "CustomTexture.h"
+#include "texture_upscaler.h"
 
 #include <algorithm>
 #include <array>
@@ -74,6 +75,7 @@ public:
 		std::swap(custom_image_data, other.custom_image_data);
 		custom_width = other.custom_width;
 		custom_height = other.custom_height;
+		custom_mipmaps = other.custom_mipmaps;
 		custom_load_in_progress = 0;
 		gpuPalette = other.gpuPalette;
 	}
@@ -107,6 +109,7 @@ public:
 	u8* custom_image_data;		// loaded custom image data
 	u32 custom_width;
 	u32 custom_height;
+	bool custom_mipmaps;		// custom image data includes the mipmap chain, smallest level first
 	std::atomic_int custom_load_in_progress;
 	bool gpuPalette;
 
@@ -259,6 +262,7 @@ public:
 	void Clear()
 	{
 		custom_texture.Terminate();
+		texture_upscaler.Terminate();
 		for (auto& [id, texture] : cache)
 			texture.Delete();
 
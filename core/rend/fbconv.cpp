@@ -0,0 +1,609 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "fbconv.h"
+#include "build.h"
+
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+#include <emmintrin.h>
+#define FBCONV_SSE2
+#elif (HOST_CPU == CPU_ARM && defined(__ARM_NEON__)) || HOST_CPU == CPU_ARM64
+#include <arm_neon.h>
+#define FBCONV_NEON
+#endif
+
+namespace fbconv
+{
+
+static inline u32 packHost(u8 r, u8 g, u8 b, bool bgra)
+{
+	return bgra ? (b | (g << 8) | (r << 16) | 0xff000000)
+				: (r | (g << 8) | (b << 16) | 0xff000000);
+}
+
+template<int bits>
+static inline u8 roundColor(u8 in)
+{
+	u8 out = in >> (8 - bits);
+	if (out != 0xffu >> (8 - bits))
+		out += (in >> (8 - bits - 1)) & 1;
+	return out;
+}
+
+template<int bits>
+static inline u8 reduceColor(u8 in, bool round)
+{
+	return round ? roundColor<bits>(in) : in >> (8 - bits);
+}
+
+namespace portable
+{
+
+static void read0555(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	for (int i = 0; i < count; i++)
+	{
+		u16 s = src[i];
+		dst[i] = packHost((((s >> 10) & 0x1F) << 3) | concat,
+				(((s >> 5) & 0x1F) << 3) | concat,
+				(((s >> 0) & 0x1F) << 3) | concat,
+				bgra);
+	}
+}
+
+static void read565(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	for (int i = 0; i < count; i++)
+	{
+		u16 s = src[i];
+		dst[i] = packHost((((s >> 11) & 0x1F) << 3) | concat,
+				(((s >> 5) & 0x3F) << 2) | (concat & 3),
+				(((s >> 0) & 0x1F) << 3) | concat,
+				bgra);
+	}
+}
+
+// packed BGR byte stream
+static void read888(const u8 *src, u32 *dst, int count, bool bgra)
+{
+	for (int i = 0; i < count; i++, src += 3)
+		dst[i] = packHost(src[2], src[1], src[0], bgra);
+}
+
+static void readC888(const u32 *src, u32 *dst, int count, bool bgra)
+{
+	for (int i = 0; i < count; i++)
+	{
+		u32 s = src[i];
+		dst[i] = packHost(s >> 16, s >> 8, s, bgra);
+	}
+}
+
+static void write0555(const u8 *src, u16 *dst, int count, bool round, u16 kval, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (reduceColor<5>(src[r], round) << 10) | (reduceColor<5>(src[1], round) << 5)
+				| reduceColor<5>(src[b], round) | kval;
+}
+
+static void write565(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (reduceColor<5>(src[r], round) << 11) | (reduceColor<6>(src[1], round) << 5)
+				| reduceColor<5>(src[b], round);
+}
+
+static void write4444(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (reduceColor<4>(src[r], round) << 8) | (reduceColor<4>(src[1], round) << 4)
+				| reduceColor<4>(src[b], round) | (reduceColor<4>(src[3], round) << 12);
+}
+
+static void write1555(const u8 *src, u16 *dst, int count, bool round, u8 alphaThreshold, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (reduceColor<5>(src[r], round) << 10) | (reduceColor<5>(src[1], round) << 5)
+				| reduceColor<5>(src[b], round) | (src[3] >= alphaThreshold ? 0x8000 : 0);
+}
+
+static void write888(const u8 *src, u8 *dst, int count, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+	{
+		*dst++ = src[b];
+		*dst++ = src[1];
+		*dst++ = src[r];
+	}
+}
+
+static void write0888(const u8 *src, u32 *dst, int count, u32 kval, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (src[r] << 16) | (src[1] << 8) | src[b] | kval;
+}
+
+static void write8888(const u8 *src, u32 *dst, int count, bool bgra)
+{
+	const int r = bgra ? 2 : 0;
+	const int b = 2 - r;
+	for (int i = 0; i < count; i++, src += 4)
+		dst[i] = (src[r] << 16) | (src[1] << 8) | src[b] | (src[3] << 24);
+}
+
+}	// namespace portable
+
+const Converters scalar {
+	portable::read0555,
+	portable::read565,
+	portable::read888,
+	portable::readC888,
+	portable::write0555,
+	portable::write565,
+	portable::write4444,
+	portable::write1555,
+	portable::write888,
+	portable::write0888,
+	portable::write8888,
+};
+
+#if defined(FBCONV_SSE2)
+
+namespace sse2
+{
+
+// 4 x 32-bit host pixels -> 8-bit channel in each 32-bit lane
+template<int byte>
+static inline __m128i channel(__m128i px)
+{
+	if constexpr (byte == 3)
+		return _mm_srli_epi32(px, 24);
+	else
+		return _mm_and_si128(_mm_srli_epi32(px, byte * 8), _mm_set1_epi32(0xff));
+}
+
+// Same as roundColor<bits> or in >> (8 - bits)
+template<int bits>
+static inline __m128i reduce(__m128i c, bool round)
+{
+	if (round)
+		return _mm_min_epi16(_mm_srli_epi32(_mm_add_epi32(c, _mm_set1_epi32(1 << (7 - bits))), 8 - bits),
+				_mm_set1_epi32((1 << bits) - 1));
+	else
+		return _mm_srli_epi32(c, 8 - bits);
+}
+
+// Pack two vectors of 4 x 16-bit values in 32-bit lanes into 8 x 16-bit values
+static inline __m128i pack32to16(__m128i lo, __m128i hi)
+{
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+// Expand 8 x 16-bit channels into 8 host pixels
+static inline void store8(u32 *dst, __m128i r, __m128i g, __m128i b, bool bgra)
+{
+	__m128i lo = _mm_or_si128(bgra ? b : r, _mm_slli_epi16(g, 8));
+	__m128i hi = _mm_or_si128(bgra ? r : b, _mm_set1_epi16((s16)0xff00));
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo, hi));
+	_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(lo, hi));
+}
+
+static void read0555(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	const __m128i mask = _mm_set1_epi16(0x1f << 3);
+	const __m128i cc = _mm_set1_epi16(concat);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+		__m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(s, 7), mask), cc);
+		__m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(s, 2), mask), cc);
+		__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(s, 3), mask), cc);
+		store8(&dst[i], r, g, b, bgra);
+	}
+	portable::read0555(&src[i], &dst[i], count - i, concat, bgra);
+}
+
+static void read565(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1f << 3);
+	const __m128i mask6 = _mm_set1_epi16(0x3f << 2);
+	const __m128i cc = _mm_set1_epi16(concat);
+	const __m128i cc2 = _mm_set1_epi16(concat & 3);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+		__m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(s, 8), mask5), cc);
+		__m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(s, 3), mask6), cc2);
+		__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(s, 3), mask5), cc);
+		store8(&dst[i], r, g, b, bgra);
+	}
+	portable::read565(&src[i], &dst[i], count - i, concat, bgra);
+}
+
+static void readC888(const u32 *src, u32 *dst, int count, bool bgra)
+{
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+		__m128i d;
+		if (bgra)
+			d = _mm_or_si128(s, alpha);
+		else
+			// swap bytes 0 and 2
+			d = _mm_or_si128(_mm_or_si128(_mm_and_si128(s, _mm_set1_epi32(0x0000ff00)), alpha),
+					_mm_or_si128(_mm_srli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x00ff0000)), 16),
+							_mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x000000ff)), 16)));
+		_mm_storeu_si128((__m128i *)&dst[i], d);
+	}
+	portable::readC888(&src[i], &dst[i], count - i, bgra);
+}
+
+// Loads 4 host pixels and returns the red, green, blue and alpha channels in 32-bit lanes
+struct Channels
+{
+	Channels(const u8 *src, bool bgra)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i *)src);
+		r = bgra ? channel<2>(px) : channel<0>(px);
+		g = channel<1>(px);
+		b = bgra ? channel<0>(px) : channel<2>(px);
+		a = channel<3>(px);
+	}
+	__m128i r, g, b, a;
+};
+
+template<typename Pack>
+static inline int write16(const u8 *src, u16 *dst, int count, bool bgra, Pack pack)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8, src += 32)
+	{
+		__m128i lo = pack(Channels(src, bgra));
+		__m128i hi = pack(Channels(src + 16, bgra));
+		_mm_storeu_si128((__m128i *)&dst[i], pack32to16(lo, hi));
+	}
+	return i;
+}
+
+static void write0555(const u8 *src, u16 *dst, int count, bool round, u16 kval, bool bgra)
+{
+	const __m128i k = _mm_set1_epi32(kval);
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(reduce<5>(c.r, round), 10), _mm_slli_epi32(reduce<5>(c.g, round), 5)),
+				_mm_or_si128(reduce<5>(c.b, round), k));
+	});
+	portable::write0555(src + i * 4, &dst[i], count - i, round, kval, bgra);
+}
+
+static void write565(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(reduce<5>(c.r, round), 11), _mm_slli_epi32(reduce<6>(c.g, round), 5)),
+				reduce<5>(c.b, round));
+	});
+	portable::write565(src + i * 4, &dst[i], count - i, round, bgra);
+}
+
+static void write4444(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(reduce<4>(c.r, round), 8), _mm_slli_epi32(reduce<4>(c.g, round), 4)),
+				_mm_or_si128(reduce<4>(c.b, round), _mm_slli_epi32(reduce<4>(c.a, round), 12)));
+	});
+	portable::write4444(src + i * 4, &dst[i], count - i, round, bgra);
+}
+
+static void write1555(const u8 *src, u16 *dst, int count, bool round, u8 alphaThreshold, bool bgra)
+{
+	const __m128i threshold = _mm_set1_epi32((int)alphaThreshold - 1);
+	const __m128i alphaBit = _mm_set1_epi32(0x8000);
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi32(c.a, threshold), alphaBit);
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(reduce<5>(c.r, round), 10), _mm_slli_epi32(reduce<5>(c.g, round), 5)),
+				_mm_or_si128(reduce<5>(c.b, round), alpha));
+	});
+	portable::write1555(src + i * 4, &dst[i], count - i, round, alphaThreshold, bgra);
+}
+
+template<bool Alpha>
+static inline int write32(const u8 *src, u32 *dst, int count, u32 kval, bool bgra)
+{
+	const __m128i k = _mm_set1_epi32(kval);
+	const __m128i mask = _mm_set1_epi32(Alpha ? 0xffffffff : 0x00ffffff);
+	int i = 0;
+	for (; i + 4 <= count; i += 4, src += 16)
+	{
+		__m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i *)src), mask);
+		if (!bgra)
+			s = _mm_or_si128(_mm_and_si128(s, _mm_set1_epi32(0xff00ff00)),
+					_mm_or_si128(_mm_srli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x00ff0000)), 16),
+							_mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x000000ff)), 16)));
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(s, k));
+	}
+	return i;
+}
+
+static void write0888(const u8 *src, u32 *dst, int count, u32 kval, bool bgra)
+{
+	int i = write32<false>(src, dst, count, kval, bgra);
+	portable::write0888(src + i * 4, &dst[i], count - i, kval, bgra);
+}
+
+static void write8888(const u8 *src, u32 *dst, int count, bool bgra)
+{
+	int i = write32<true>(src, dst, count, 0, bgra);
+	portable::write8888(src + i * 4, &dst[i], count - i, bgra);
+}
+
+}	// namespace sse2
+
+// SSE2 has no byte shuffle so 24-bit formats use the portable versions
+const Converters simd {
+	sse2::read0555,
+	sse2::read565,
+	portable::read888,
+	sse2::readC888,
+	sse2::write0555,
+	sse2::write565,
+	sse2::write4444,
+	sse2::write1555,
+	portable::write888,
+	sse2::write0888,
+	sse2::write8888,
+};
+
+#elif defined(FBCONV_NEON)
+
+namespace neon
+{
+
+// Same as roundColor<bits> or in >> (8 - bits)
+template<int bits>
+static inline uint16x8_t reduce(uint8x8_t c, bool round)
+{
+	uint16x8_t w = vmovl_u8(c);
+	if (round)
+		return vminq_u16(vshrq_n_u16(vaddq_u16(w, vdupq_n_u16(1 << (7 - bits))), 8 - bits),
+				vdupq_n_u16((1 << bits) - 1));
+	else
+		return vshrq_n_u16(w, 8 - bits);
+}
+
+static inline void store8(u32 *dst, uint8x8_t r, uint8x8_t g, uint8x8_t b, bool bgra)
+{
+	uint8x8x4_t px;
+	px.val[0] = bgra ? b : r;
+	px.val[1] = g;
+	px.val[2] = bgra ? r : b;
+	px.val[3] = vdup_n_u8(0xff);
+	vst4_u8((u8 *)dst, px);
+}
+
+static void read0555(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	const uint16x8_t mask = vdupq_n_u16(0x1f << 3);
+	const uint8x8_t cc = vdup_n_u8(concat);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint16x8_t s = vld1q_u16(&src[i]);
+		uint8x8_t r = vorr_u8(vmovn_u16(vandq_u16(vshrq_n_u16(s, 7), mask)), cc);
+		uint8x8_t g = vorr_u8(vmovn_u16(vandq_u16(vshrq_n_u16(s, 2), mask)), cc);
+		uint8x8_t b = vorr_u8(vmovn_u16(vandq_u16(vshlq_n_u16(s, 3), mask)), cc);
+		store8(&dst[i], r, g, b, bgra);
+	}
+	portable::read0555(&src[i], &dst[i], count - i, concat, bgra);
+}
+
+static void read565(const u16 *src, u32 *dst, int count, u32 concat, bool bgra)
+{
+	const uint16x8_t mask5 = vdupq_n_u16(0x1f << 3);
+	const uint16x8_t mask6 = vdupq_n_u16(0x3f << 2);
+	const uint8x8_t cc = vdup_n_u8(concat);
+	const uint8x8_t cc2 = vdup_n_u8(concat & 3);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint16x8_t s = vld1q_u16(&src[i]);
+		uint8x8_t r = vorr_u8(vmovn_u16(vandq_u16(vshrq_n_u16(s, 8), mask5)), cc);
+		uint8x8_t g = vorr_u8(vmovn_u16(vandq_u16(vshrq_n_u16(s, 3), mask6)), cc2);
+		uint8x8_t b = vorr_u8(vmovn_u16(vandq_u16(vshlq_n_u16(s, 3), mask5)), cc);
+		store8(&dst[i], r, g, b, bgra);
+	}
+	portable::read565(&src[i], &dst[i], count - i, concat, bgra);
+}
+
+static void read888(const u8 *src, u32 *dst, int count, bool bgra)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8, src += 24)
+	{
+		uint8x8x3_t s = vld3_u8(src);
+		store8(&dst[i], s.val[2], s.val[1], s.val[0], bgra);
+	}
+	portable::read888(src, &dst[i], count - i, bgra);
+}
+
+static void readC888(const u32 *src, u32 *dst, int count, bool bgra)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t s = vld4_u8((const u8 *)&src[i]);
+		store8(&dst[i], s.val[2], s.val[1], s.val[0], bgra);
+	}
+	portable::readC888(&src[i], &dst[i], count - i, bgra);
+}
+
+// Loads 8 host pixels and returns the red, green, blue and alpha channels
+struct Channels
+{
+	Channels(const u8 *src, bool bgra)
+	{
+		uint8x8x4_t px = vld4_u8(src);
+		r = px.val[bgra ? 2 : 0];
+		g = px.val[1];
+		b = px.val[bgra ? 0 : 2];
+		a = px.val[3];
+	}
+	uint8x8_t r, g, b, a;
+};
+
+template<typename Pack>
+static inline int write16(const u8 *src, u16 *dst, int count, bool bgra, Pack pack)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8, src += 32)
+		vst1q_u16(&dst[i], pack(Channels(src, bgra)));
+	return i;
+}
+
+static void write0555(const u8 *src, u16 *dst, int count, bool round, u16 kval, bool bgra)
+{
+	const uint16x8_t k = vdupq_n_u16(kval);
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return vorrq_u16(vorrq_u16(vshlq_n_u16(reduce<5>(c.r, round), 10), vshlq_n_u16(reduce<5>(c.g, round), 5)),
+				vorrq_u16(reduce<5>(c.b, round), k));
+	});
+	portable::write0555(src + i * 4, &dst[i], count - i, round, kval, bgra);
+}
+
+static void write565(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return vorrq_u16(vorrq_u16(vshlq_n_u16(reduce<5>(c.r, round), 11), vshlq_n_u16(reduce<6>(c.g, round), 5)),
+				reduce<5>(c.b, round));
+	});
+	portable::write565(src + i * 4, &dst[i], count - i, round, bgra);
+}
+
+static void write4444(const u8 *src, u16 *dst, int count, bool round, bool bgra)
+{
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		return vorrq_u16(vorrq_u16(vshlq_n_u16(reduce<4>(c.r, round), 8), vshlq_n_u16(reduce<4>(c.g, round), 4)),
+				vorrq_u16(reduce<4>(c.b, round), vshlq_n_u16(reduce<4>(c.a, round), 12)));
+	});
+	portable::write4444(src + i * 4, &dst[i], count - i, round, bgra);
+}
+
+static void write1555(const u8 *src, u16 *dst, int count, bool round, u8 alphaThreshold, bool bgra)
+{
+	const uint8x8_t threshold = vdup_n_u8(alphaThreshold);
+	const uint16x8_t alphaBit = vdupq_n_u16(0x8000);
+	int i = write16(src, dst, count, bgra, [&](const Channels& c) {
+		uint16x8_t alpha = vandq_u16(vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vcge_u8(c.a, threshold)))), alphaBit);
+		return vorrq_u16(vorrq_u16(vshlq_n_u16(reduce<5>(c.r, round), 10), vshlq_n_u16(reduce<5>(c.g, round), 5)),
+				vorrq_u16(reduce<5>(c.b, round), alpha));
+	});
+	portable::write1555(src + i * 4, &dst[i], count - i, round, alphaThreshold, bgra);
+}
+
+static void write888(const u8 *src, u8 *dst, int count, bool bgra)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8, src += 32, dst += 24)
+	{
+		Channels c(src, bgra);
+		uint8x8x3_t d;
+		d.val[0] = c.b;
+		d.val[1] = c.g;
+		d.val[2] = c.r;
+		vst3_u8(dst, d);
+	}
+	portable::write888(src, dst, count - i, bgra);
+}
+
+template<bool Alpha>
+static inline int write32(const u8 *src, u32 *dst, int count, u32 kval, bool bgra)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8, src += 32)
+	{
+		Channels c(src, bgra);
+		uint8x8x4_t d;
+		d.val[0] = c.b;
+		d.val[1] = c.g;
+		d.val[2] = c.r;
+		d.val[3] = Alpha ? c.a : vdup_n_u8(kval >> 24);
+		vst4_u8((u8 *)&dst[i], d);
+	}
+	return i;
+}
+
+static void write0888(const u8 *src, u32 *dst, int count, u32 kval, bool bgra)
+{
+	int i = write32<false>(src, dst, count, kval, bgra);
+	portable::write0888(src + i * 4, &dst[i], count - i, kval, bgra);
+}
+
+static void write8888(const u8 *src, u32 *dst, int count, bool bgra)
+{
+	int i = write32<true>(src, dst, count, 0, bgra);
+	portable::write8888(src + i * 4, &dst[i], count - i, bgra);
+}
+
+}	// namespace neon
+
+const Converters simd {
+	neon::read0555,
+	neon::read565,
+	neon::read888,
+	neon::readC888,
+	neon::write0555,
+	neon::write565,
+	neon::write4444,
+	neon::write1555,
+	neon::write888,
+	neon::write0888,
+	neon::write8888,
+};
+
+#else
+
+const Converters simd = scalar;
+
+#endif
+
+const Converters& get()
+{
+#if HOST_CPU == CPU_X86 && (defined(__GNUC__) || defined(__clang__))
+	// 32-bit x86 builds don't require SSE2
+	static const Converters& converters = __builtin_cpu_supports("sse2") ? simd : scalar;
+	return converters;
+#else
+	return simd;
+#endif
+}
+
+}
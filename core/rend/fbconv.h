@@ -0,0 +1,54 @@
+/*
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+
+//
+// Framebuffer line converters.
+// Source and destination are linear buffers: reading and writing vram is left to the caller.
+// bgra selects the host pixel order: BGRA (directx) if true, RGBA (opengl) otherwise.
+// round selects rounding to nearest instead of truncation when reducing the color depth.
+//
+namespace fbconv
+{
+
+struct Converters
+{
+	// vram -> host
+	void (*read0555)(const u16 *src, u32 *dst, int count, u32 concat, bool bgra);
+	void (*read565)(const u16 *src, u32 *dst, int count, u32 concat, bool bgra);
+	void (*read888)(const u8 *src, u32 *dst, int count, bool bgra);
+	void (*readC888)(const u32 *src, u32 *dst, int count, bool bgra);
+	// host -> vram
+	void (*write0555)(const u8 *src, u16 *dst, int count, bool round, u16 kval, bool bgra);
+	void (*write565)(const u8 *src, u16 *dst, int count, bool round, bool bgra);
+	void (*write4444)(const u8 *src, u16 *dst, int count, bool round, bool bgra);
+	void (*write1555)(const u8 *src, u16 *dst, int count, bool round, u8 alphaThreshold, bool bgra);
+	void (*write888)(const u8 *src, u8 *dst, int count, bool bgra);
+	void (*write0888)(const u8 *src, u32 *dst, int count, u32 kval, bool bgra);
+	void (*write8888)(const u8 *src, u32 *dst, int count, bool bgra);
+};
+
+// Portable implementation
+extern const Converters scalar;
+// SSE2 or NEON implementation if supported by the host, scalar otherwise
+extern const Converters simd;
+
+// Converters used by the emulator
+const Converters& get();
+
+}
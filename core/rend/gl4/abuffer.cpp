@@ -18,12 +18,16 @@
 */
 #include "gl4.h"
 #include "rend/gles/glcache.h"
+#include "rend/pixel_buffer_sizer.h"
 
 #include <memory>
 
 static GLuint pixels_buffer;
 static GLuint pixels_pointers;
 static GLuint atomic_buffer;
+static GLuint counterReadback;
+static GLsync readbackFence;
+static PixelBufferSizer pixelBufferSizer;
 static gl4PipelineShader g_abuffer_final_shader[2];
 static gl4PipelineShader g_abuffer_clear_shader;
 static gl4PipelineShader g_abuffer_tr_modvol_shaders[ModeCount];
@@ -328,6 +332,19 @@ static void compileFinalAndModVolShaders()
 	}
 }
 
+static void allocatePixelBuffer()
+{
+	// Create the buffer
+	if (pixels_buffer == 0)
+		glGenBuffers(1, &pixels_buffer);
+	// Bind it
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixels_buffer);
+	// Declare storage
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)pixelBufferSizer.getSize(), NULL, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pixels_buffer);
+	glCheck();
+}
+
 static void makePixelBuffer()
 {
 	if (pixels_buffer == 0 || pixelBufferSize != config::PixelBufferSize)
@@ -336,17 +353,9 @@ static void makePixelBuffer()
 		GLint64 maxSize;
 		glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxSize);
 		pixelBufferSize = config::PixelBufferSize;
-		GLsizeiptr pixel_buffer_size = std::min<int64_t>(pixelBufferSize, maxSize);
-
-		// Create the buffer
-		if (pixels_buffer == 0)
-			glGenBuffers(1, &pixels_buffer);
-		// Bind it
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixels_buffer);
-		// Declare storage
-		glBufferData(GL_SHADER_STORAGE_BUFFER, pixel_buffer_size, NULL, GL_DYNAMIC_COPY);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pixels_buffer);
-		glCheck();
+		// The configured size is the maximum. The actual size depends on the fragments used.
+		pixelBufferSizer.reset(std::min<int64_t>(pixelBufferSize, maxSize));
+		allocatePixelBuffer();
 	}
 }
 
@@ -380,6 +389,13 @@ void initABuffer()
 		glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLint), &zero);
 		glCheck();
 	}
+	if (counterReadback == 0)
+	{
+		glGenBuffers(1, &counterReadback);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, counterReadback);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+		glCheck();
+	}
 
 	compileFinalAndModVolShaders();
 	if (g_abuffer_clear_shader.program == 0)
@@ -445,6 +461,17 @@ void termABuffer()
 		glDeleteBuffers(1, &atomic_buffer);
 		atomic_buffer = 0;
 	}
+	if (readbackFence != nullptr)
+	{
+		glDeleteSync(readbackFence);
+		readbackFence = nullptr;
+	}
+	if (counterReadback != 0)
+	{
+		glDeleteBuffers(1, &counterReadback);
+		counterReadback = 0;
+	}
+	pixelBufferStats.bufferSize = 0;
 	g_quadVertexArray.term();
 	g_quadBuffer.reset();
 	g_quadIndexBuffer.reset();
@@ -551,31 +578,40 @@ void DrawTranslucentModVols(int first, int count, bool useOpaqueGeom)
 
 void checkOverflowAndReset()
 {
-	// Using atomic counter
-	GLuint max_pixel_index = 0;
-//	glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &max_pixel_index);
-////	printf("ABUFFER %d pixels used\n", max_pixel_index);
-//	if ((max_pixel_index + 1) * 32 - 1 >= pixel_buffer_size)
-//	{
-//		GLint64 size;
-//		glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &size);
-//		if (pixel_buffer_size == size)
-//			printf("A-buffer overflow: %d pixels. Buffer size already maxed out\n", max_pixel_index);
-//		else
-//		{
-//			pixel_buffer_size = (GLuint)min(2 * (GLint64)pixel_buffer_size, size);
-//
-//			printf("A-buffer overflow: %d pixels. Resizing buffer to %d MB\n", max_pixel_index, pixel_buffer_size / 1024 / 1024);
-//
-//			glBindBuffer(GL_SHADER_STORAGE_BUFFER, pixels_buffer);
-//			glBufferData(GL_SHADER_STORAGE_BUFFER, pixel_buffer_size, NULL, GL_DYNAMIC_COPY);
-//			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pixels_buffer);
-//			glCheck();
-//		}
-//	}
+	// Read the fragment count of a previous frame once the copy is done, without stalling
+	if (readbackFence != nullptr)
+	{
+		GLenum status = glClientWaitSync(readbackFence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync(readbackFence);
+			readbackFence = nullptr;
+			glBindBuffer(GL_COPY_WRITE_BUFFER, counterReadback);
+			const GLuint *p = (const GLuint *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+			if (p != nullptr)
+			{
+				const GLuint fragments = *p;
+				glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+				if (pixelBufferSizer.update(fragments))
+				{
+					INFO_LOG(RENDERER, "A-buffer: %d fragments. Resizing buffer to %d MB", fragments, (int)(pixelBufferSizer.getSize() / 1_MB));
+					allocatePixelBuffer();
+				}
+			}
+		}
+	}
+	if (readbackFence == nullptr)
+	{
+		// Copy the fragment count of the last frame
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, counterReadback);
+		glCopyBufferSubData(GL_ATOMIC_COUNTER_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint));
+		readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
 	// Reset counter
-	max_pixel_index = 0;
- 	glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0 , sizeof(GLuint), &max_pixel_index);
+	GLuint zero = 0;
+	glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+	glCheck();
 }
 
 void renderABuffer(bool lastPass)
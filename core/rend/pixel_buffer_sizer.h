@@ -0,0 +1,110 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Per-pixel renderer statistics shown in the OSD
+struct PixelBufferStats
+{
+	std::atomic<u32> peakFragments;		// highest fragment count per frame since last reset
+	std::atomic<u64> bufferSize;		// current pixel buffer size in bytes. 0 if not in use
+
+	void addFrame(u32 fragments)
+	{
+		if (fragments > peakFragments.load(std::memory_order_relaxed))
+			peakFragments.store(fragments, std::memory_order_relaxed);
+	}
+};
+inline PixelBufferStats pixelBufferStats;
+
+// Adaptive sizing of the per-pixel (OIT) fragment buffer.
+// The renderers read back the fragment counter of each frame, usually a few frames late,
+// and resize the buffer when asked to.
+// The buffer grows as soon as a frame uses most of it, and only shrinks when it's been
+// mostly unused for a while.
+class PixelBufferSizer
+{
+public:
+	static constexpr u64 FragmentSize = 16;		// sizeof(Pixel) in the shaders
+	static constexpr u64 MinSize = 64_MB;
+	static constexpr u64 InitialSize = 128_MB;
+	static constexpr u64 Granularity = 16_MB;
+	static constexpr int ShrinkDelay = 600;		// frames
+
+	// maxSize is the configured pixel buffer size, clamped to the device limits
+	void reset(u64 maxSize)
+	{
+		this->maxSize = maxSize;
+		size = std::min(InitialSize, maxSize);
+		windowPeak = 0;
+		windowFrames = 0;
+		pixelBufferStats.bufferSize = size;
+	}
+
+	// Update with the number of fragments allocated during a frame, including those that didn't fit.
+	// Returns true if the buffer must be resized to getSize().
+	bool update(u64 fragments)
+	{
+		pixelBufferStats.addFrame((u32)std::min<u64>(fragments, UINT32_MAX));
+		const u64 required = fragments * FragmentSize;
+		u64 newSize = size;
+		windowPeak = std::max(windowPeak, required);
+		if (required > size / 8 * 7)
+		{
+			// grow immediately, with some margin
+			newSize = std::min(roundUp(required / 2 * 3), maxSize);
+		}
+		else if (++windowFrames >= ShrinkDelay)
+		{
+			// shrink if less than a third was used over the whole period
+			if (windowPeak < size / 3)
+				newSize = std::max(std::min(MinSize, maxSize), roundUp(windowPeak / 2 * 3));
+			windowPeak = 0;
+			windowFrames = 0;
+		}
+		if (newSize == size)
+			return false;
+		size = newSize;
+		windowPeak = 0;
+		windowFrames = 0;
+		pixelBufferStats.bufferSize = size;
+
+		return true;
+	}
+
+	u64 getSize() const {
+		return size;
+	}
+	u64 getMaxSize() const {
+		return maxSize;
+	}
+
+private:
+	static u64 roundUp(u64 v) {
+		return std::max<u64>((v + Granularity - 1) / Granularity * Granularity, Granularity);
+	}
+
+	u64 maxSize = 0;
+	u64 size = 0;
+	u64 windowPeak = 0;
+	int windowFrames = 0;
+};
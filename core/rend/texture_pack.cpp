@@ -0,0 +1,195 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "texture_pack.h"
+#include "oslib/storage.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#if !defined(_WIN32) && !defined(__SWITCH__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_MMAP_TEXPACK
+#endif
+
+namespace texpack
+{
+
+static bool validEntry(const IndexEntry& entry, size_t length)
+{
+	if (entry.width == 0 || entry.height == 0)
+		return false;
+	u64 rawSize = (u64)entry.width * entry.height * 4;
+	if (entry.levels > 1)
+	{
+		// Only square power-of-two images have mipmaps
+		if (entry.width != entry.height || (entry.width & (entry.width - 1)) != 0)
+			return false;
+		rawSize += mipmapChainSize(entry.width);
+	}
+	return entry.rawSize == rawSize
+			&& entry.offset <= length
+			&& entry.size <= length - entry.offset;
+}
+
+bool TexturePack::open(const std::string& path)
+{
+	close();
+	try {
+		file = hostfs::storage().openFile(path, "rb");
+	} catch (const FlycastException& e) {
+		file = nullptr;
+	}
+	if (file == nullptr)
+		return false;
+	std::fseek(file, 0, SEEK_END);
+	length = std::ftell(file);
+	std::fseek(file, 0, SEEK_SET);
+#ifdef HAVE_MMAP_TEXPACK
+	void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fileno(file), 0);
+	if (p != MAP_FAILED)
+		base = (u8 *)p;
+	else
+		// Likely out of address space on 32-bit platforms
+		DEBUG_LOG(RENDERER, "Texture pack mmap failed: errno %d", errno);
+#endif
+	Header header;
+	if (!read(0, &header, sizeof(header))
+			|| header.magic != Magic
+			|| header.version != Version
+			|| header.indexOffset > length
+			|| (u64)header.entryCount * sizeof(IndexEntry) > length - header.indexOffset)
+	{
+		WARN_LOG(RENDERER, "Invalid texture pack %s", path.c_str());
+		close();
+		return false;
+	}
+	index.resize(header.entryCount);
+	if (!read(header.indexOffset, index.data(), header.entryCount * sizeof(IndexEntry)))
+	{
+		close();
+		return false;
+	}
+	if (!std::is_sorted(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.hash < b.hash; }))
+	{
+		WARN_LOG(RENDERER, "Texture pack %s: unsorted index", path.c_str());
+		close();
+		return false;
+	}
+	for (const IndexEntry& entry : index)
+		if (!validEntry(entry, length))
+		{
+			WARN_LOG(RENDERER, "Texture pack %s: invalid entry %08x", path.c_str(), entry.hash);
+			close();
+			return false;
+		}
+#ifdef HAVE_MMAP_TEXPACK
+	if (base != nullptr)
+		// Only the image data will be accessed from now on
+		madvise(base, length, MADV_RANDOM);
+#endif
+	NOTICE_LOG(RENDERER, "Texture pack %s: %d textures", path.c_str(), (int)index.size());
+
+	return true;
+}
+
+void TexturePack::close()
+{
+#ifdef HAVE_MMAP_TEXPACK
+	if (base != nullptr)
+		munmap(base, length);
+#endif
+	base = nullptr;
+	length = 0;
+	if (file != nullptr)
+		std::fclose(file);
+	file = nullptr;
+	index.clear();
+}
+
+const IndexEntry *TexturePack::find(u32 hash) const
+{
+	auto it = std::lower_bound(index.begin(), index.end(), hash, [](const IndexEntry& entry, u32 hash) {
+		return entry.hash < hash;
+	});
+	if (it == index.end() || it->hash != hash)
+		return nullptr;
+	return &*it;
+}
+
+bool TexturePack::read(u64 offset, void *dst, u32 size)
+{
+	if (offset > length || size > length - offset)
+		return false;
+	if (base != nullptr)
+	{
+		memcpy(dst, base + offset, size);
+		return true;
+	}
+	std::lock_guard<std::mutex> _(fileMutex);
+	std::fseek(file, offset, SEEK_SET);
+	return std::fread(dst, 1, size, file) == size;
+}
+
+u8 *TexturePack::load(const IndexEntry& entry)
+{
+	if (entry.offset > length || entry.size > length - entry.offset)
+		return nullptr;
+	u8 *data = (u8 *)malloc(entry.rawSize);
+	if (data == nullptr)
+		return nullptr;
+	if (entry.compression == Compression::None)
+	{
+		if (entry.size == entry.rawSize && read(entry.offset, data, entry.size))
+			return data;
+	}
+#ifdef HAVE_ZSTD
+	else if (entry.compression == Compression::Zstd)
+	{
+		const u8 *src;
+		std::vector<u8> buffer;
+		if (base != nullptr) {
+			src = base + entry.offset;
+		}
+		else
+		{
+			buffer.resize(entry.size);
+			if (!read(entry.offset, buffer.data(), entry.size)) {
+				free(data);
+				return nullptr;
+			}
+			src = buffer.data();
+		}
+		size_t rc = ZSTD_decompress(data, entry.rawSize, src, entry.size);
+		if (!ZSTD_isError(rc) && rc == entry.rawSize)
+			return data;
+		WARN_LOG(RENDERER, "Texture pack: decompression error for %08x: %s", entry.hash, ZSTD_getErrorName(rc));
+	}
+#endif
+	else
+	{
+		WARN_LOG(RENDERER, "Texture pack: unsupported compression %d for %08x", entry.compression, entry.hash);
+	}
+	free(data);
+	return nullptr;
+}
+
+}
@@ -0,0 +1,141 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Custom texture pack container.
+	A single file holding pre-decoded RGBA8 images, optionally compressed with zstd,
+	so that custom textures can be loaded without decoding PNG files.
+
+	Layout (little endian):
+		Header
+		image data, each image aligned on 16 bytes
+		IndexEntry[entryCount], sorted by hash
+
+	Images are stored bottom-up like the textures uploaded to the GPU.
+	Square power-of-two images include their full mipmap chain, smallest level first,
+	which is the layout expected by BaseTextureCacheData::UploadToGPU(mipmapsIncluded = true).
+	The largest level is then the last one.
+*/
+#pragma once
+#include "types.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace texpack
+{
+
+constexpr u32 Magic = 0x50544346;	// "FCTP"
+constexpr u32 Version = 1;
+constexpr const char *FileName = "textures.fctp";
+
+enum Compression : u8 {
+	None = 0,
+	Zstd = 1,
+};
+
+#pragma pack(push, 1)
+struct Header
+{
+	u32 magic;
+	u32 version;
+	u32 entryCount;
+	u32 reserved;
+	u64 indexOffset;
+	u64 reserved2;
+};
+static_assert(sizeof(Header) == 32, "Invalid header size");
+
+struct IndexEntry
+{
+	u32 hash;
+	u16 width;
+	u16 height;
+	u8 levels;			// number of mipmap levels included
+	u8 compression;
+	u16 reserved;
+	u32 size;			// size of the stored data
+	u64 offset;			// offset of the data in the file
+	u32 rawSize;		// size of the decompressed data
+	u32 reserved2;
+};
+static_assert(sizeof(IndexEntry) == 32, "Invalid index entry size");
+#pragma pack(pop)
+
+// Size in bytes of the RGBA8 mipmap chain of a square image of the given size, largest level excluded
+constexpr u32 mipmapChainSize(u32 size)
+{
+	u32 bytes = 0;
+	for (u32 dim = size / 2; dim != 0; dim /= 2)
+		bytes += dim * dim * 4;
+	return bytes;
+}
+
+// Read-only access to a texture pack. The file is memory mapped when possible.
+// All methods are thread-safe.
+class TexturePack
+{
+public:
+	~TexturePack() {
+		close();
+	}
+
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const {
+		return !index.empty();
+	}
+	size_t size() const {
+		return index.size();
+	}
+	// Returns the index entry of the given hash or nullptr if not found
+	const IndexEntry *find(u32 hash) const;
+	// Returns the decompressed image data of an entry, allocated with malloc, or nullptr on error
+	u8 *load(const IndexEntry& entry);
+
+private:
+	bool read(u64 offset, void *dst, u32 size);
+
+	std::vector<IndexEntry> index;
+	FILE *file = nullptr;
+	u8 *base = nullptr;
+	size_t length = 0;
+	std::mutex fileMutex;
+};
+
+// Builds a texture pack. Used by the texpack tool.
+class TexturePackWriter
+{
+public:
+	~TexturePackWriter();
+
+	// compressionLevel: 0 to store images uncompressed, otherwise the zstd compression level
+	bool create(const std::string& path, int compressionLevel = 0);
+	// Add a top-down RGBA8 image. Mipmaps are generated for square power-of-two images.
+	bool add(u32 hash, u32 width, u32 height, const u8 *rgba);
+	bool finish();
+
+private:
+	FILE *file = nullptr;
+	int compressionLevel = 0;
+	u64 offset = 0;
+	std::vector<IndexEntry> index;
+};
+
+}
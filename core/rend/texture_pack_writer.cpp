@@ -0,0 +1,163 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// No logging or host storage in this file so that it can be linked with the texpack tool
+#include "texture_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace texpack
+{
+
+TexturePackWriter::~TexturePackWriter()
+{
+	if (file != nullptr)
+		std::fclose(file);
+}
+
+bool TexturePackWriter::create(const std::string& path, int compressionLevel)
+{
+#ifndef HAVE_ZSTD
+	if (compressionLevel != 0)
+		return false;
+#endif
+	file = nowide::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	this->compressionLevel = compressionLevel;
+	index.clear();
+	Header header {};
+	offset = sizeof(header);
+
+	return std::fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+// Average each 2x2 block of a size x size image
+static void downsample(const u8 *src, u8 *dst, u32 size)
+{
+	const u32 stride = size * 4;
+	for (u32 y = 0; y < size / 2; y++)
+	{
+		const u8 *row0 = src + y * 2 * stride;
+		const u8 *row1 = row0 + stride;
+		for (u32 x = 0; x < size / 2; x++)
+		{
+			for (int c = 0; c < 4; c++)
+				*dst++ = (row0[c] + row0[c + 4] + row1[c] + row1[c + 4] + 2) / 4;
+			row0 += 8;
+			row1 += 8;
+		}
+	}
+}
+
+bool TexturePackWriter::add(u32 hash, u32 width, u32 height, const u8 *rgba)
+{
+	if (file == nullptr || width == 0 || height == 0 || width > 0xffff || height > 0xffff)
+		return false;
+	const bool mipmaps = width == height && width > 1 && (width & (width - 1)) == 0;
+	const u32 imageSize = width * height * 4;
+	const u32 chainSize = mipmaps ? mipmapChainSize(width) : 0;
+	std::vector<u8> raw(chainSize + imageSize);
+
+	// Largest level is last, flipped vertically
+	u8 *level0 = &raw[chainSize];
+	for (u32 y = 0; y < height; y++)
+		memcpy(level0 + (height - 1 - y) * width * 4, rgba + y * width * 4, width * 4);
+	IndexEntry entry {};
+	entry.hash = hash;
+	entry.width = width;
+	entry.height = height;
+	entry.levels = 1;
+	if (mipmaps)
+	{
+		u8 *src = level0;
+		for (u32 size = width; size > 1; size /= 2)
+		{
+			u8 *dst = src - (size / 2) * (size / 2) * 4;
+			downsample(src, dst, size);
+			src = dst;
+			entry.levels++;
+		}
+	}
+	entry.rawSize = raw.size();
+	entry.compression = Compression::None;
+	const u8 *data = raw.data();
+	entry.size = raw.size();
+#ifdef HAVE_ZSTD
+	std::vector<u8> compressed;
+	if (compressionLevel != 0)
+	{
+		compressed.resize(ZSTD_compressBound(raw.size()));
+		size_t rc = ZSTD_compress(compressed.data(), compressed.size(), raw.data(), raw.size(), compressionLevel);
+		if (ZSTD_isError(rc))
+			return false;
+		if (rc < raw.size())
+		{
+			entry.compression = Compression::Zstd;
+			entry.size = rc;
+			data = compressed.data();
+		}
+	}
+#endif
+	entry.offset = offset;
+	if (std::fwrite(data, 1, entry.size, file) != entry.size)
+		return false;
+	offset += entry.size;
+	// Align the next image
+	static const u8 padding[15] {};
+	const u32 padSize = (16 - (offset & 15)) & 15;
+	if (padSize != 0 && std::fwrite(padding, 1, padSize, file) != padSize)
+		return false;
+	offset += padSize;
+
+	auto it = std::lower_bound(index.begin(), index.end(), hash, [](const IndexEntry& entry, u32 hash) {
+		return entry.hash < hash;
+	});
+	if (it != index.end() && it->hash == hash)
+		// Replace the previous image. Its data is left unused.
+		*it = entry;
+	else
+		index.insert(it, entry);
+
+	return true;
+}
+
+bool TexturePackWriter::finish()
+{
+	if (file == nullptr)
+		return false;
+	bool success = std::fwrite(index.data(), sizeof(IndexEntry), index.size(), file) == index.size();
+	Header header {};
+	header.magic = Magic;
+	header.version = Version;
+	header.entryCount = index.size();
+	header.indexOffset = offset;
+	success = success
+			&& std::fseek(file, 0, SEEK_SET) == 0
+			&& std::fwrite(&header, sizeof(header), 1, file) == 1;
+	success = std::fclose(file) == 0 && success;
+	file = nullptr;
+
+	return success;
+}
+
+}
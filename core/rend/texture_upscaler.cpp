@@ -0,0 +1,330 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "texture_upscaler.h"
+#include "TexCache.h"
+#include "deps/xbrz/xbrz.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include "oslib/directory.h"
+#include "stdclass.h"
+#include "util/worker_thread.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <xxhash.h>
+#include <zstd.h>
+#ifndef _WIN32
+#include <utime.h>
+#endif
+
+TextureUpscaler texture_upscaler;
+
+TextureUpscaler::TextureUpscaler() = default;
+
+TextureUpscaler::~TextureUpscaler() {
+	Terminate();
+}
+
+void TextureUpscaler::upscaleAsync(BaseTextureCacheData *texture, const u32 *pixels, int width, int height, int factor, bool hasAlpha)
+{
+	auto job = std::make_shared<Job>();
+	job->texture = texture;
+	job->updates = texture->Updates;
+	job->generation = generation;
+	job->pixels.assign(pixels, pixels + width * height);
+	job->width = width;
+	job->height = height;
+	job->factor = factor;
+	job->hasAlpha = hasAlpha;
+
+	texture->custom_load_in_progress++;
+	pending++;
+	std::lock_guard<std::mutex> _(threadsMutex);
+	if (threads.empty())
+	{
+		// Leave a core to the emulator
+		const int hostThreads = std::max<int>(std::thread::hardware_concurrency() - 1, 1);
+		const int threadCount = std::clamp<int>(config::MaxThreads, 1, hostThreads);
+		for (int i = 0; i < threadCount; i++)
+			threads.push_back(std::make_unique<WorkerThread>("xBRZ"));
+	}
+	threads[nextThread++ % threads.size()]->run([this, job]() {
+		run(*job);
+	});
+}
+
+void TextureUpscaler::run(Job& job)
+{
+	BaseTextureCacheData *texture = job.texture;
+	// Skip cancelled jobs and textures updated since
+	if (job.generation == generation && job.updates == texture->Updates && !texture->dirty)
+	{
+		const u32 width = job.width * job.factor;
+		const u32 height = job.height * job.factor;
+		const bool diskCache = job.updates <= MaxCachedUpdates;
+		const u64 key = diskCache ? cacheKey(job) : 0;
+		u8 *data = diskCache ? loadCached(key, width, height) : nullptr;
+		if (data != nullptr)
+		{
+			cacheHits++;
+		}
+		else
+		{
+			data = (u8 *)malloc(width * height * 4);
+			if (data != nullptr)
+			{
+				xbrz::scale(job.factor, job.pixels.data(), (u32 *)data, job.width, job.height,
+						job.hasAlpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB);
+				if (isDirectX(config::RendererType))
+				{
+					// Custom textures are RGBA and converted to BGRA by DirectX renderers
+					u8 *p = data;
+					for (u32 i = 0; i < width * height; i++, p += 4)
+						std::swap(p[0], p[2]);
+				}
+				if (diskCache)
+					saveCached(key, width, height, data);
+			}
+		}
+		completed++;
+		if (data != nullptr && job.updates == texture->Updates && !texture->dirty)
+		{
+			free(texture->custom_image_data);
+			texture->custom_width = width;
+			texture->custom_height = height;
+			texture->custom_mipmaps = false;
+			texture->custom_image_data = data;
+		}
+		else
+		{
+			free(data);
+		}
+	}
+	pending--;
+	texture->custom_load_in_progress--;
+}
+
+void TextureUpscaler::Terminate()
+{
+	generation++;
+	std::vector<std::unique_ptr<WorkerThread>> stopping;
+	{
+		std::lock_guard<std::mutex> _(threadsMutex);
+		stopping.swap(threads);
+	}
+	// Cancelled jobs still in the queues complete immediately
+	for (auto& thread : stopping)
+		thread->stop();
+}
+
+TextureUpscaler::Stats TextureUpscaler::getStats() const
+{
+	Stats stats;
+	stats.pending = pending;
+	stats.completed = completed;
+	stats.cacheHits = cacheHits;
+	return stats;
+}
+
+void TextureUpscaler::resetStats()
+{
+	completed = 0;
+	cacheHits = 0;
+}
+
+u64 TextureUpscaler::cacheKey(const Job& job) const
+{
+	XXH64_state_t *state = XXH64_createState();
+	XXH64_reset(state, 7);
+	XXH64_update(state, job.pixels.data(), job.pixels.size() * sizeof(u32));
+	const u32 params[] { (u32)job.width, (u32)job.height, (u32)job.factor, job.hasAlpha, isDirectX(config::RendererType) };
+	XXH64_update(state, params, sizeof(params));
+	const u64 hash = XXH64_digest(state);
+	XXH64_freeState(state);
+	return hash;
+}
+
+std::string TextureUpscaler::cacheDir() const
+{
+	return cachePath.empty() ? hostfs::getTextureCachePath() : cachePath;
+}
+
+std::string TextureUpscaler::cacheFile(u64 key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.xbrz", (unsigned long long)key);
+	return cacheDir() + name;
+}
+
+u8 *TextureUpscaler::loadCached(u64 key, u32 width, u32 height)
+{
+	const std::string path = cacheFile(key);
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	if (f == nullptr)
+		return nullptr;
+	const size_t size = width * height * 4;
+	CacheHeader header;
+	std::vector<u8> compressed;
+	bool success = std::fread(&header, sizeof(header), 1, f) == 1
+			&& header.magic == Magic
+			&& header.version == Version
+			&& header.width == width
+			&& header.height == height
+			&& header.compressedSize <= ZSTD_compressBound(size);
+	if (success)
+	{
+		compressed.resize(header.compressedSize);
+		success = std::fread(compressed.data(), 1, compressed.size(), f) == compressed.size();
+	}
+	std::fclose(f);
+	u8 *data = nullptr;
+	if (success)
+	{
+		data = (u8 *)malloc(size);
+		if (data != nullptr && ZSTD_decompress(data, size, compressed.data(), compressed.size()) != size)
+		{
+			free(data);
+			data = nullptr;
+		}
+	}
+	if (data == nullptr)
+	{
+		WARN_LOG(RENDERER, "Invalid upscaled texture cache file %s", path.c_str());
+	}
+	else
+	{
+#ifndef _WIN32
+		// Keep the order of use across sessions
+		utime(path.c_str(), nullptr);
+#endif
+		useCached(key, sizeof(header) + header.compressedSize);
+	}
+
+	return data;
+}
+
+void TextureUpscaler::saveCached(u64 key, u32 width, u32 height, const u8 *data)
+{
+	const size_t size = width * height * 4;
+	std::vector<u8> compressed(ZSTD_compressBound(size));
+	const size_t rc = ZSTD_compress(compressed.data(), compressed.size(), data, size, 1);
+	if (ZSTD_isError(rc))
+	{
+		WARN_LOG(RENDERER, "Upscaled texture compression error: %s", ZSTD_getErrorName(rc));
+		return;
+	}
+	const std::string path = cacheFile(key);
+	const std::string dir = path.substr(0, path.find_last_of("/\\") + 1);
+	if (!file_exists(dir))
+		make_directory(dir);
+	// Write to a temporary file so that other threads or instances never see a partial file
+	const std::string tmpPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	FILE *f = nowide::fopen(tmpPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(RENDERER, "Can't create upscaled texture cache file %s", tmpPath.c_str());
+		return;
+	}
+	CacheHeader header{};
+	header.magic = Magic;
+	header.version = Version;
+	header.width = width;
+	header.height = height;
+	header.compressedSize = (u32)rc;
+	bool success = std::fwrite(&header, sizeof(header), 1, f) == 1
+			&& std::fwrite(compressed.data(), 1, rc, f) == rc;
+	success = std::fclose(f) == 0 && success;
+	if (success)
+		success = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+	if (success)
+	{
+		useCached(key, sizeof(header) + rc);
+	}
+	else
+	{
+		WARN_LOG(RENDERER, "Error writing upscaled texture cache file %s", path.c_str());
+		std::remove(tmpPath.c_str());
+	}
+}
+
+// List the existing cache files. cacheMutex must be held.
+void TextureUpscaler::scanCache()
+{
+	if (cacheScanned)
+		return;
+	cacheScanned = true;
+	const std::string dir = cacheDir();
+	DIR *d = flycast::opendir(dir.c_str());
+	if (d == nullptr)
+		return;
+	while (true)
+	{
+		dirent *entry = flycast::readdir(d);
+		if (entry == nullptr)
+			break;
+		const std::string name = entry->d_name;
+		if (name.length() != 21 || name.substr(16) != ".xbrz")
+			continue;
+		struct stat st;
+		if (flycast::stat((dir + name).c_str(), &st) != 0)
+			continue;
+		const u64 key = strtoull(name.substr(0, 16).c_str(), nullptr, 16);
+		cacheFiles[key] = CacheFile{ (u64)st.st_size, (u64)st.st_mtime };
+		cacheSize += st.st_size;
+		cacheClock = std::max(cacheClock, (u64)st.st_mtime);
+	}
+	flycast::closedir(d);
+}
+
+// Mark a cache file as the most recently used one and prune the cache if it's full
+void TextureUpscaler::useCached(u64 key, u64 size)
+{
+	std::lock_guard<std::mutex> _(cacheMutex);
+	scanCache();
+	CacheFile& file = cacheFiles[key];
+	cacheSize = cacheSize - file.size + size;
+	file.size = size;
+	file.lastUse = ++cacheClock;
+	if (cacheSize > maxCacheSize)
+		pruneCache();
+}
+
+// Delete the least recently used files until the cache is down to 3/4 of its maximum size.
+// cacheMutex must be held.
+void TextureUpscaler::pruneCache()
+{
+	std::vector<std::pair<u64, u64>> files;	// last use, key
+	files.reserve(cacheFiles.size());
+	for (const auto& [key, file] : cacheFiles)
+		files.emplace_back(file.lastUse, key);
+	std::sort(files.begin(), files.end());
+	const u64 targetSize = maxCacheSize / 4 * 3;
+	size_t deleted = 0;
+	for (const auto& [lastUse, key] : files)
+	{
+		if (cacheSize <= targetSize)
+			break;
+		nowide::remove(cacheFile(key).c_str());
+		cacheSize -= cacheFiles[key].size;
+		cacheFiles.erase(key);
+		deleted++;
+	}
+	INFO_LOG(RENDERER, "Upscaled texture cache pruned: %d files deleted", (int)deleted);
+}
@@ -0,0 +1,140 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Asynchronous xBRZ texture upscaling.
+	Textures are uploaded at their native resolution and upscaled by worker threads.
+	The result is handed over to the texture like a custom texture, and uploaded by the renderer
+	once available.
+	Upscaled textures are cached on disk, keyed by the xxHash of the native pixels,
+	so they are reused across sessions. Textures that are updated often aren't cached.
+	The least recently used cache files are deleted when the cache grows over its maximum size.
+
+	Cache file layout (little endian):
+		CacheHeader
+		zstd-compressed RGBA8 pixels [compressedSize]
+*/
+#pragma once
+#include "types.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BaseTextureCacheData;
+class WorkerThread;
+
+class TextureUpscaler
+{
+public:
+	static constexpr u32 Magic = 0x5a524258;	// "XBRZ"
+	static constexpr u32 Version = 1;
+	// Textures updated more often than this aren't cached on disk
+	static constexpr u32 MaxCachedUpdates = 3;
+	static constexpr u64 DefaultCacheSize = 512_MB;
+
+#pragma pack(push, 1)
+	struct CacheHeader
+	{
+		u32 magic;
+		u32 version;
+		u32 width;
+		u32 height;
+		u32 compressedSize;
+		u32 reserved;
+	};
+	static_assert(sizeof(CacheHeader) == 24, "Invalid cache header size");
+#pragma pack(pop)
+
+	struct Stats
+	{
+		u32 pending;		// jobs queued or running
+		u32 completed;		// jobs completed since the last reset
+		u32 cacheHits;		// completed jobs loaded from the disk cache
+	};
+
+	TextureUpscaler();
+	~TextureUpscaler();
+	// Upscale the native 32-bit pixels of a texture. The pixels are copied.
+	void upscaleAsync(BaseTextureCacheData *texture, const u32 *pixels, int width, int height, int factor, bool hasAlpha);
+	// Cancel the pending jobs and stop the worker threads
+	void Terminate();
+
+	Stats getStats() const;
+	void resetStats();
+
+	// Disk cache directory. Uses the default location if empty.
+	void setCachePath(const std::string& path) {
+		cachePath = path;
+	}
+	// Maximum size of the disk cache in bytes
+	void setCacheSize(u64 size) {
+		maxCacheSize = size;
+	}
+
+private:
+	struct Job
+	{
+		BaseTextureCacheData *texture;
+		u32 updates;		// texture->Updates when the job was queued
+		u32 generation;
+		std::vector<u32> pixels;
+		int width;
+		int height;
+		int factor;
+		bool hasAlpha;
+	};
+
+	void run(Job& job);
+	u64 cacheKey(const Job& job) const;
+	std::string cacheDir() const;
+	std::string cacheFile(u64 key) const;
+	u8 *loadCached(u64 key, u32 width, u32 height);
+	void saveCached(u64 key, u32 width, u32 height, const u8 *data);
+	void scanCache();
+	void useCached(u64 key, u64 size);
+	void pruneCache();
+
+	std::vector<std::unique_ptr<WorkerThread>> threads;
+	std::mutex threadsMutex;
+	std::atomic<u32> nextThread {};
+	std::atomic<u32> generation {};
+	std::string cachePath;
+
+	struct CacheFile
+	{
+		u64 size;
+		u64 lastUse;
+	};
+	// Disk cache index, protected by cacheMutex
+	std::mutex cacheMutex;
+	std::unordered_map<u64, CacheFile> cacheFiles;
+	bool cacheScanned = false;
+	u64 cacheSize = 0;
+	u64 maxCacheSize = DefaultCacheSize;
+	u64 cacheClock = 0;
+
+	std::atomic<u32> pending {};
+	std::atomic<u32> completed {};
+	std::atomic<u32> cacheHits {};
+};
+
+extern TextureUpscaler texture_upscaler;
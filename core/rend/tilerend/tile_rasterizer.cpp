@@ -0,0 +1,948 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "tile_rasterizer.h"
+#include "build.h"
+#include "cfg/option.h"
+#include "hw/pvr/pvr_regs.h"
+#include "rend/texconv.h"
+#include "profiler/frame_tracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if HOST_CPU == CPU_X64
+#include <emmintrin.h>
+#elif HOST_CPU == CPU_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace tilerend
+{
+
+void Texture::UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded)
+{
+	u32 bpp;
+	switch (tex_type)
+	{
+	case TextureType::_8888:
+		bpp = 4;
+		break;
+	case TextureType::_8:
+		bpp = 1;
+		break;
+	default:
+		bpp = 2;
+		break;
+	}
+	if (mipmapsIncluded)
+	{
+		// Only keep the largest level, which comes last
+		for (int dim = 1; dim < width; dim *= 2)
+			temp_tex_buffer += dim * dim * bpp;
+	}
+	const u32 size = width * height;
+	texWidth = width;
+	texHeight = height;
+	if (tex_type == TextureType::_8)
+	{
+		pixels.clear();
+		indices.assign(temp_tex_buffer, temp_tex_buffer + size);
+		return;
+	}
+	indices.clear();
+	pixels.resize(size);
+	if (tex_type == TextureType::_8888)
+	{
+		memcpy(pixels.data(), temp_tex_buffer, size * 4);
+		return;
+	}
+	const u16 *src = (const u16 *)temp_tex_buffer;
+	for (u32 i = 0; i < size; i++)
+	{
+		const u32 p = src[i];
+		u32 r, g, b, a;
+		switch (tex_type)
+		{
+		case TextureType::_5551:
+			r = (p >> 11) * 255 / 31;
+			g = ((p >> 6) & 31) * 255 / 31;
+			b = ((p >> 1) & 31) * 255 / 31;
+			a = (p & 1) * 255;
+			break;
+		case TextureType::_565:
+			r = (p >> 11) * 255 / 31;
+			g = ((p >> 5) & 63) * 255 / 63;
+			b = (p & 31) * 255 / 31;
+			a = 255;
+			break;
+		default: // _4444
+			r = (p >> 12) * 17;
+			g = ((p >> 8) & 15) * 17;
+			b = ((p >> 4) & 15) * 17;
+			a = (p & 15) * 17;
+			break;
+		}
+		pixels[i] = r | (g << 8) | (b << 16) | (a << 24);
+	}
+}
+
+bool Texture::Delete()
+{
+	if (!BaseTextureCacheData::Delete())
+		return false;
+	pixels = {};
+	indices = {};
+	texWidth = texHeight = 0;
+
+	return true;
+}
+
+void RenderState::update()
+{
+	for (int i = 0; i < 128; i++)
+	{
+		fogTable[i][0] = FOG_TABLE[i] & 0xff;
+		fogTable[i][1] = (FOG_TABLE[i] >> 8) & 0xff;
+	}
+	FOG_COL_RAM.getRGBColor(fogColRam);
+	FOG_COL_VERT.getRGBColor(fogColVert);
+	fogDensity = FOG_DENSITY.get();
+	ptAlphaRef = (PT_ALPHA_REF & 0xff) / 255.f;
+	shadowScale = FPU_SHAD_SCALE.scale_factor / 256.f;
+	cullValue = FPU_CULL_VAL;
+	memcpy(palette, palette32_ram, sizeof(palette));
+	fog = config::Fog;
+	modifierVolumes = config::ModifierVolumes;
+	clipping = config::Clipping;
+	textureFiltering = config::TextureFiltering;
+}
+
+//
+// Triangle setup
+//
+
+TileRasterizer::TileRasterizer(int threadCount) : pool("Flycast-tile", threadCount)
+{
+	tileBuffers.resize(pool.size());
+}
+
+void TileRasterizer::render(const rend_context& ctx, const RenderState& state, const std::vector<Tile>& tiles,
+		u32 *framebuffer, int width, int height)
+{
+	TRACE_SCOPE("Tile rasterizer");
+	this->ctx = &ctx;
+	this->state = &state;
+	this->tiles = &tiles;
+	this->framebuffer = framebuffer;
+	this->width = width;
+	this->height = height;
+	tilesX = (width + TileSize - 1) / TileSize;
+	tilesY = (height + TileSize - 1) / TileSize;
+	clipMinX = ctx.getFramebufferMinX();
+	clipMinY = ctx.getFramebufferMinY();
+	clipMaxX = std::min<int>(ctx.getFramebufferWidth(), width);
+	clipMaxY = std::min<int>(ctx.getFramebufferHeight(), height);
+
+	tileIndex.assign(tilesX * tilesY, -1);
+	if (bins.size() < tiles.size())
+		bins.resize(tiles.size());
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		bins[i].clear();
+		if (tiles[i].x < tilesX && tiles[i].y < tilesY)
+			tileIndex[tiles[i].y * tilesX + tiles[i].x] = i;
+	}
+
+	triangles.clear();
+	passes.clear();
+	RenderPass previous {};
+	for (const RenderPass& renderPass : ctx.render_passes)
+	{
+		Pass pass;
+		setupPolys(ctx, ctx.global_param_op, previous.op_count, renderPass.op_count);
+		pass.opEnd = triangles.size();
+		setupPolys(ctx, ctx.global_param_pt, previous.pt_count, renderPass.pt_count);
+		pass.ptEnd = triangles.size();
+		pass.mvoFirst = previous.mvo_count;
+		pass.mvoEnd = renderPass.mvo_count;
+		if (state.modifierVolumes)
+			setupModVols(ctx, previous.mvo_count, renderPass.mvo_count);
+		pass.mvEnd = triangles.size();
+		setupPolys(ctx, ctx.global_param_tr, previous.tr_count, renderPass.tr_count);
+		pass.trEnd = triangles.size();
+		pass.autosort = renderPass.autosort;
+		pass.zClear = renderPass.z_clear;
+		passes.push_back(pass);
+		previous = renderPass;
+	}
+	binTriangles();
+
+	pool.parallelFor(tiles.size(), [this](int task, int thread) {
+		renderTile(task, thread);
+	});
+}
+
+void TileRasterizer::setupPolys(const rend_context& ctx, const std::vector<PolyParam>& polys, u32 first, u32 end)
+{
+	end = std::min<u32>(end, polys.size());
+	for (u32 i = first; i < end; i++)
+	{
+		const PolyParam& pp = polys[i];
+		// TODO Naomi 2 transform and lighting
+		if (pp.count < 3 || pp.isNaomi2())
+			continue;
+		const u32 *idx = &ctx.idx[pp.first];
+		u32 stripPos = 0;
+		for (u32 j = 0; j < pp.count; j++)
+		{
+			if (idx[j] == ~0u)
+			{
+				// primitive restart
+				stripPos = 0;
+				continue;
+			}
+			if (++stripPos >= 3)
+				setupTriangle(pp, ctx.verts[idx[j - 2]], ctx.verts[idx[j - 1]], ctx.verts[idx[j]], (stripPos & 1) == 0);
+		}
+	}
+}
+
+void TileRasterizer::setupTriangle(const PolyParam& pp, const Vertex& v0, const Vertex& v1, const Vertex& v2, bool odd)
+{
+	Triangle tri;
+	tri.v[0] = &v0;
+	tri.v[1] = &v1;
+	tri.v[2] = &v2;
+	if (odd)
+		// restore the strip winding
+		std::swap(tri.v[0], tri.v[1]);
+	float x[3], y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = tri.v[i]->x;
+		y[i] = tri.v[i]->y;
+		tri.z[i] = tri.v[i]->z;
+	}
+	const float det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	const u32 cullMode = pp.isp.CullMode;
+	if (cullMode != 0 && std::abs(det) < state->cullValue)
+		return;
+	if ((cullMode == 2 && det < 0) || (cullMode == 3 && det > 0))
+		return;
+	tri.pp = &pp;
+	tri.param = 0;
+	if (setupEdges(tri, x, y, pp.tileclip))
+		triangles.push_back(tri);
+}
+
+void TileRasterizer::setupModVols(const rend_context& ctx, u32 first, u32 end)
+{
+	end = std::min<u32>(end, ctx.global_param_mvo.size());
+	for (u32 p = first; p < end; p++)
+	{
+		const ModifierVolumeParam& param = ctx.global_param_mvo[p];
+		if (param.isNaomi2())
+			continue;
+		const u32 last = std::min<u32>(param.first + param.count, ctx.modtrig.size());
+		for (u32 i = param.first; i < last; i++)
+		{
+			const ModTriangle& mt = ctx.modtrig[i];
+			Triangle tri;
+			const float x[3] { mt.x0, mt.x1, mt.x2 };
+			const float y[3] { mt.y0, mt.y1, mt.y2 };
+			tri.z[0] = mt.z0;
+			tri.z[1] = mt.z1;
+			tri.z[2] = mt.z2;
+			tri.pp = nullptr;
+			tri.v[0] = tri.v[1] = tri.v[2] = nullptr;
+			tri.param = p;
+			if (setupEdges(tri, x, y, 0))
+				triangles.push_back(tri);
+		}
+	}
+}
+
+bool TileRasterizer::setupEdges(Triangle& tri, const float x[3], const float y[3], u32 tileclip)
+{
+	tri.topLeft = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const int j = (i + 1) % 3;
+		const int k = (i + 2) % 3;
+		tri.a[i] = y[k] - y[j];
+		tri.b[i] = x[j] - x[k];
+		tri.c[i] = -(tri.a[i] * x[j] + tri.b[i] * y[j]);
+	}
+	float area = tri.a[0] * x[0] + tri.b[0] * y[0] + tri.c[0];
+	if (area < 0)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			tri.a[i] = -tri.a[i];
+			tri.b[i] = -tri.b[i];
+			tri.c[i] = -tri.c[i];
+		}
+		area = -area;
+	}
+	// also rejects NaNs
+	if (!(area > 0.f))
+		return false;
+	tri.invArea = 1.f / area;
+	for (int i = 0; i < 3; i++)
+	{
+		if (tri.a[i] > 0 || (tri.a[i] == 0 && tri.b[i] > 0))
+			tri.topLeft |= 1 << i;
+		// Sample at pixel centers
+		tri.c[i] += (tri.a[i] + tri.b[i]) * 0.5f;
+	}
+
+	const auto pixelMin = [](float v0, float v1, float v2) {
+		return (int)std::ceil(std::clamp(std::min({ v0, v1, v2 }) - 0.5f, -1.f, 4096.f));
+	};
+	const auto pixelMax = [](float v0, float v1, float v2) {
+		return (int)std::floor(std::clamp(std::max({ v0, v1, v2 }) - 0.5f, -1.f, 4096.f)) + 1;
+	};
+	tri.minX = std::max(clipMinX, pixelMin(x[0], x[1], x[2]));
+	tri.minY = std::max(clipMinY, pixelMin(y[0], y[1], y[2]));
+	tri.maxX = std::min(clipMaxX, pixelMax(x[0], x[1], x[2]));
+	tri.maxY = std::min(clipMaxY, pixelMax(y[0], y[1], y[2]));
+	tri.exclude[0] = tri.exclude[1] = tri.exclude[2] = tri.exclude[3] = 0;
+
+	const u32 clipMode = tileclip >> 28;
+	if (state->clipping && clipMode >= 2)
+	{
+		const int startX = (tileclip & 63) * 32;
+		const int endX = (((tileclip >> 6) & 63) + 1) * 32;
+		const int startY = ((tileclip >> 12) & 31) * 32;
+		const int endY = (((tileclip >> 17) & 31) + 1) * 32;
+		if (clipMode & 1)
+		{
+			// Only render outside the rectangle
+			tri.exclude[0] = startX;
+			tri.exclude[1] = startY;
+			tri.exclude[2] = endX;
+			tri.exclude[3] = endY;
+		}
+		else
+		{
+			tri.minX = std::max(tri.minX, startX);
+			tri.minY = std::max(tri.minY, startY);
+			tri.maxX = std::min(tri.maxX, endX);
+			tri.maxY = std::min(tri.maxY, endY);
+		}
+	}
+
+	return tri.minX < tri.maxX && tri.minY < tri.maxY;
+}
+
+void TileRasterizer::binTriangles()
+{
+	TRACE_SCOPE("Tile binning");
+	for (u32 t = 0; t < triangles.size(); t++)
+	{
+		const Triangle& tri = triangles[t];
+		const int tx0 = tri.minX / TileSize;
+		const int ty0 = tri.minY / TileSize;
+		const int tx1 = std::min((tri.maxX - 1) / TileSize, tilesX - 1);
+		const int ty1 = std::min((tri.maxY - 1) / TileSize, tilesY - 1);
+		const bool singleTile = tx0 == tx1 && ty0 == ty1;
+		for (int ty = ty0; ty <= ty1; ty++)
+		{
+			for (int tx = tx0; tx <= tx1; tx++)
+			{
+				const int index = tileIndex[ty * tilesX + tx];
+				if (index < 0)
+					continue;
+				if (!singleTile)
+				{
+					// Reject the tile if it's completely outside one of the edges
+					const float x0 = (float)(tx * TileSize);
+					const float y0 = (float)(ty * TileSize);
+					const float x1 = x0 + TileSize - 1;
+					const float y1 = y0 + TileSize - 1;
+					bool outside = false;
+					for (int i = 0; i < 3 && !outside; i++)
+					{
+						// corner with the highest edge function value
+						const float x = tri.a[i] >= 0 ? x1 : x0;
+						const float y = tri.b[i] >= 0 ? y1 : y0;
+						outside = tri.a[i] * x + tri.b[i] * y + tri.c[i] < 0;
+					}
+					if (outside)
+						continue;
+				}
+				bins[index].push_back(t);
+			}
+		}
+	}
+}
+
+//
+// Tile rendering
+//
+
+// Returns a 4-bit mask of the pixels inside the 3 edges, starting at edge values e and stepping by a.
+static inline u32 coverage4(const float e[3], const float a[3], u32 topLeft)
+{
+#if HOST_CPU == CPU_X64
+	const __m128 steps = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int i = 0; i < 3; i++)
+	{
+		const __m128 v = _mm_add_ps(_mm_set1_ps(e[i]), _mm_mul_ps(_mm_set1_ps(a[i]), steps));
+		const __m128 test = topLeft & (1 << i) ? _mm_cmpge_ps(v, _mm_setzero_ps()) : _mm_cmpgt_ps(v, _mm_setzero_ps());
+		inside = _mm_and_ps(inside, test);
+	}
+	return _mm_movemask_ps(inside);
+#elif HOST_CPU == CPU_ARM64
+	static const float stepValues[4] { 0.f, 1.f, 2.f, 3.f };
+	static const u32 bitValues[4] { 1, 2, 4, 8 };
+	const float32x4_t steps = vld1q_f32(stepValues);
+	uint32x4_t inside = vdupq_n_u32(~0u);
+	for (int i = 0; i < 3; i++)
+	{
+		const float32x4_t v = vmlaq_n_f32(vdupq_n_f32(e[i]), steps, a[i]);
+		const uint32x4_t test = topLeft & (1 << i) ? vcgeq_f32(v, vdupq_n_f32(0.f)) : vcgtq_f32(v, vdupq_n_f32(0.f));
+		inside = vandq_u32(inside, test);
+	}
+	return vaddvq_u32(vandq_u32(inside, vld1q_u32(bitValues)));
+#else
+	u32 mask = 0;
+	for (int p = 0; p < 4; p++)
+	{
+		bool inside = true;
+		for (int i = 0; i < 3 && inside; i++)
+		{
+			const float v = e[i] + a[i] * p;
+			inside = topLeft & (1 << i) ? v >= 0.f : v > 0.f;
+		}
+		mask |= (u32)inside << p;
+	}
+	return mask;
+#endif
+}
+
+static inline bool depthTest(u32 mode, float z, float depth)
+{
+	switch (mode)
+	{
+	case 0:
+		return false;
+	case 1:
+		return z < depth;
+	case 2:
+		return z == depth;
+	case 3:
+		return z <= depth;
+	case 4:
+		return z > depth;
+	case 5:
+		return z != depth;
+	case 6:
+		return z >= depth;
+	default:
+		return true;
+	}
+}
+
+static inline float blendFactor(u32 instr, bool srcFactor, const float src[4], const float dst[4], int c)
+{
+	switch (instr)
+	{
+	case 0:
+		return 0.f;
+	case 1:
+		return 1.f;
+	case 2:
+		return srcFactor ? dst[c] : src[c];
+	case 3:
+		return 1.f - (srcFactor ? dst[c] : src[c]);
+	case 4:
+		return src[3];
+	case 5:
+		return 1.f - src[3];
+	case 6:
+		return dst[3];
+	default:
+		return 1.f - dst[3];
+	}
+}
+
+static inline void unpackColor(u32 color, float rgba[4])
+{
+	for (int i = 0; i < 4; i++)
+		rgba[i] = ((color >> (i * 8)) & 0xff) / 255.f;
+}
+
+static inline u32 packColor(const float rgba[4])
+{
+	u32 color = 0;
+	for (int i = 0; i < 4; i++)
+		color |= (u32)(std::clamp(rgba[i], 0.f, 1.f) * 255.f + 0.5f) << (i * 8);
+	return color;
+}
+
+// Per-triangle shading state, following the OpenGL pixel pipeline
+struct TileRasterizer::Shading
+{
+	Shading(const TileRasterizer& rasterizer, const Triangle& tri, u32 listType)
+		: tri(tri), pp(*tri.pp), state(*rasterizer.state)
+	{
+		const rend_context& ctx = *rasterizer.ctx;
+		texture = pp.pcw.Texture ? (const Texture *)pp.texture : nullptr;
+		if (texture != nullptr && texture->pixels.empty() && texture->indices.empty())
+			texture = nullptr;
+		if (texture != nullptr)
+		{
+			bilinear = pp.tsp.FilterMode != 0;
+			if (state.textureFiltering == 1)
+				bilinear = false;
+			else if (state.textureFiltering == 2)
+				bilinear = true;
+			if (pp.tcw.PixelFmt == PixelPal4)
+				paletteIndex = pp.tcw.PalSelect << 4;
+			else
+				paletteIndex = (pp.tcw.PalSelect >> 4) << 8;
+		}
+		bumpMap = pp.tcw.PixelFmt == PixelBumpMap;
+		fogCtrl = state.fog ? pp.tsp.FogCtrl : 2;
+		colorClamp = pp.tsp.ColorClamp && (ctx.fog_clamp_min.full != 0 || ctx.fog_clamp_max.full != 0xffffffff);
+		if (colorClamp)
+		{
+			ctx.fog_clamp_min.getRGBAColor(clampMin);
+			ctx.fog_clamp_max.getRGBAColor(clampMax);
+		}
+		alphaTest = listType == ListType_Punch_Through;
+		if (!pp.pcw.Gouraud)
+		{
+			// flat shading uses the last vertex
+			for (int i = 0; i < 4; i++)
+			{
+				flatColor[i] = tri.v[2]->col[i] / 255.f;
+				flatOffset[i] = tri.v[2]->spc[i] / 255.f;
+			}
+		}
+	}
+
+	float fogFactor(float z) const
+	{
+		const float fz = std::clamp(state.fogDensity * z, 1.f, 255.9999f);
+		const int exp = (int)std::floor(std::log2(fz));
+		const float m = fz * 16.f / (float)(1 << exp) - 16.f;
+		const float fm = std::floor(m);
+		const int idx = std::clamp((int)fm + exp * 16, 0, 127);
+		const float frac = m - fm;
+		return (state.fogTable[idx][1] + (state.fogTable[idx][0] - state.fogTable[idx][1]) * frac) / 255.f;
+	}
+
+	u32 texel(int u, int v) const
+	{
+		const int w = texture->texWidth;
+		const int h = texture->texHeight;
+		u = wrap(u, w, pp.tsp.ClampU, pp.tsp.FlipU);
+		v = wrap(v, h, pp.tsp.ClampV, pp.tsp.FlipV);
+		if (!texture->indices.empty())
+			return state.palette[(paletteIndex + texture->indices[v * w + u]) & 1023];
+		else
+			return texture->pixels[v * w + u];
+	}
+
+	static int wrap(int c, int size, bool clamp, bool flip)
+	{
+		if (clamp)
+			return std::clamp(c, 0, size - 1);
+		if (flip)
+		{
+			c &= size * 2 - 1;
+			return c < size ? c : size * 2 - 1 - c;
+		}
+		return c & (size - 1);
+	}
+
+	void sample(float u, float v, float rgba[4]) const
+	{
+		const float fu = u * texture->texWidth;
+		const float fv = v * texture->texHeight;
+		if (!bilinear)
+		{
+			unpackColor(texel((int)std::floor(fu), (int)std::floor(fv)), rgba);
+			return;
+		}
+		const float su = fu - 0.5f;
+		const float sv = fv - 0.5f;
+		const float flu = std::floor(su);
+		const float flv = std::floor(sv);
+		const int iu = (int)flu;
+		const int iv = (int)flv;
+		const float du = su - flu;
+		const float dv = sv - flv;
+		float t00[4], t10[4], t01[4], t11[4];
+		unpackColor(texel(iu, iv), t00);
+		unpackColor(texel(iu + 1, iv), t10);
+		unpackColor(texel(iu, iv + 1), t01);
+		unpackColor(texel(iu + 1, iv + 1), t11);
+		for (int i = 0; i < 4; i++)
+		{
+			const float top = t00[i] + (t10[i] - t00[i]) * du;
+			const float bottom = t01[i] + (t11[i] - t01[i]) * du;
+			rgba[i] = top + (bottom - top) * dv;
+		}
+	}
+
+	// Compute the pixel color from the barycentric weights. Returns false if the pixel is discarded.
+	bool shade(const float w[3], float z, float color[4]) const
+	{
+		// perspective correction
+		float pw[3];
+		const float zw[3] { w[0] * tri.z[0], w[1] * tri.z[1], w[2] * tri.z[2] };
+		const float zsum = zw[0] + zw[1] + zw[2];
+		if (zsum != 0.f)
+		{
+			const float invSum = 1.f / zsum;
+			for (int i = 0; i < 3; i++)
+				pw[i] = zw[i] * invSum;
+		}
+		else
+		{
+			const float invSum = 1.f / (w[0] + w[1] + w[2]);
+			for (int i = 0; i < 3; i++)
+				pw[i] = w[i] * invSum;
+		}
+		float offset[4];
+		if (pp.pcw.Gouraud)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				color[c] = (pw[0] * tri.v[0]->col[c] + pw[1] * tri.v[1]->col[c] + pw[2] * tri.v[2]->col[c]) / 255.f;
+				offset[c] = (pw[0] * tri.v[0]->spc[c] + pw[1] * tri.v[1]->spc[c] + pw[2] * tri.v[2]->spc[c]) / 255.f;
+			}
+		}
+		else
+		{
+			memcpy(color, flatColor, sizeof(flatColor));
+			memcpy(offset, flatOffset, sizeof(flatOffset));
+		}
+		if (!pp.tsp.UseAlpha)
+			color[3] = 1.f;
+		if (fogCtrl == 3)
+		{
+			color[0] = state.fogColRam[0];
+			color[1] = state.fogColRam[1];
+			color[2] = state.fogColRam[2];
+			color[3] = fogFactor(z);
+		}
+		if (texture != nullptr)
+		{
+			const float u = pw[0] * tri.v[0]->u + pw[1] * tri.v[1]->u + pw[2] * tri.v[2]->u;
+			const float v = pw[0] * tri.v[0]->v + pw[1] * tri.v[1]->v + pw[2] * tri.v[2]->v;
+			float texcol[4];
+			sample(u, v, texcol);
+			if (bumpMap)
+			{
+				constexpr float PI = 3.1415926f;
+				const float s = PI / 2.f * (texcol[3] * 15.f * 16.f + texcol[0] * 15.f) / 255.f;
+				const float r = 2.f * PI * (texcol[1] * 15.f * 16.f + texcol[2] * 15.f) / 255.f;
+				texcol[3] = std::clamp(offset[3] + offset[0] * std::sin(s) + offset[1] * std::cos(s) * std::cos(r - 2.f * PI * offset[2]), 0.f, 1.f);
+				texcol[0] = texcol[1] = texcol[2] = 1.f;
+			}
+			else if (pp.tsp.IgnoreTexA)
+				texcol[3] = 1.f;
+			switch (pp.tsp.ShadInstr)
+			{
+			case 0:
+				memcpy(color, texcol, sizeof(texcol));
+				break;
+			case 1:
+				for (int c = 0; c < 3; c++)
+					color[c] *= texcol[c];
+				color[3] = texcol[3];
+				break;
+			case 2:
+				for (int c = 0; c < 3; c++)
+					color[c] += (texcol[c] - color[c]) * texcol[3];
+				break;
+			default:
+				for (int c = 0; c < 4; c++)
+					color[c] *= texcol[c];
+				break;
+			}
+			if (pp.pcw.Offset && !bumpMap)
+				for (int c = 0; c < 3; c++)
+					color[c] += offset[c];
+		}
+		if (colorClamp)
+			for (int c = 0; c < 4; c++)
+				color[c] = std::clamp(color[c], clampMin[c], clampMax[c]);
+		if (fogCtrl == 0)
+		{
+			const float fog = fogFactor(z);
+			for (int c = 0; c < 3; c++)
+				color[c] += (state.fogColRam[c] - color[c]) * fog;
+		}
+		else if (fogCtrl == 1 && pp.pcw.Offset && !bumpMap)
+		{
+			for (int c = 0; c < 3; c++)
+				color[c] += (state.fogColVert[c] - color[c]) * offset[3];
+		}
+		if (alphaTest)
+		{
+			const float alpha = std::floor(std::clamp(color[3], 0.f, 1.f) * 255.f + 0.5f) / 255.f;
+			if (state.ptAlphaRef > alpha)
+				return false;
+			color[3] = 1.f;
+		}
+		return true;
+	}
+
+	const Triangle& tri;
+	const PolyParam& pp;
+	const RenderState& state;
+	const Texture *texture;
+	bool bilinear = false;
+	bool bumpMap;
+	bool colorClamp;
+	bool alphaTest;
+	u32 fogCtrl;
+	int paletteIndex = 0;
+	float clampMin[4] {};
+	float clampMax[4] {};
+	float flatColor[4] {};
+	float flatOffset[4] {};
+};
+
+void TileRasterizer::renderTile(int tileNum, int thread)
+{
+	TileBuffers& buffers = tileBuffers[thread];
+	const std::vector<u32>& bin = bins[tileNum];
+	const Tile& tile = (*tiles)[tileNum];
+	if (tile.x >= tilesX || tile.y >= tilesY)
+		return;
+	const int tileX = tile.x * TileSize;
+	const int tileY = tile.y * TileSize;
+
+	memset(buffers.color, 0, sizeof(buffers.color));
+	memset(buffers.depth, 0, sizeof(buffers.depth));
+	memset(buffers.stencil, 0, sizeof(buffers.stencil));
+	memset(buffers.shadow, 0, sizeof(buffers.shadow));
+
+	size_t binIndex = 0;
+	for (size_t p = 0; p < passes.size(); p++)
+	{
+		const Pass& pass = passes[p];
+		if (p != 0 && pass.zClear)
+			memset(buffers.depth, 0, sizeof(buffers.depth));
+		for (; binIndex < bin.size() && bin[binIndex] < pass.opEnd; binIndex++)
+			drawTriangle(buffers, triangles[bin[binIndex]], tileX, tileY, ListType_Opaque, false);
+		for (; binIndex < bin.size() && bin[binIndex] < pass.ptEnd; binIndex++)
+			drawTriangle(buffers, triangles[bin[binIndex]], tileX, tileY, ListType_Punch_Through, false);
+		if (pass.mvEnd > pass.ptEnd)
+			drawModVols(buffers, pass, bin, binIndex, tileX, tileY);
+		while (binIndex < bin.size() && bin[binIndex] < pass.mvEnd)
+			binIndex++;
+		if (pass.autosort)
+		{
+			// Sort the translucent triangles back to front using their depth at the center of the tile area they cover
+			buffers.sorted.clear();
+			for (; binIndex < bin.size() && bin[binIndex] < pass.trEnd; binIndex++)
+			{
+				const Triangle& tri = triangles[bin[binIndex]];
+				const float x = (std::max(tri.minX, tileX) + std::min(tri.maxX, tileX + TileSize)) * 0.5f;
+				const float y = (std::max(tri.minY, tileY) + std::min(tri.maxY, tileY + TileSize)) * 0.5f;
+				float z = 0.f;
+				for (int i = 0; i < 3; i++)
+					z += (tri.a[i] * x + tri.b[i] * y + tri.c[i]) * tri.z[i];
+				z *= tri.invArea;
+				z = std::clamp(z, std::min({ tri.z[0], tri.z[1], tri.z[2] }), std::max({ tri.z[0], tri.z[1], tri.z[2] }));
+				buffers.sorted.emplace_back(z, bin[binIndex]);
+			}
+			std::stable_sort(buffers.sorted.begin(), buffers.sorted.end(),
+					[](const std::pair<float, u32>& a, const std::pair<float, u32>& b) { return a.first < b.first; });
+			for (const auto& sorted : buffers.sorted)
+				drawTriangle(buffers, triangles[sorted.second], tileX, tileY, ListType_Translucent, true);
+		}
+		else
+		{
+			for (; binIndex < bin.size() && bin[binIndex] < pass.trEnd; binIndex++)
+				drawTriangle(buffers, triangles[bin[binIndex]], tileX, tileY, ListType_Translucent, false);
+		}
+	}
+
+	const int w = std::min(TileSize, width - tileX);
+	const int h = std::min(TileSize, height - tileY);
+	for (int y = 0; y < h; y++)
+		memcpy(&framebuffer[(tileY + y) * width + tileX], &buffers.color[y * TileSize], w * sizeof(u32));
+}
+
+void TileRasterizer::drawTriangle(TileBuffers& buffers, const Triangle& tri, int tileX, int tileY, u32 listType, bool sorted)
+{
+	const int x0 = std::max(tri.minX, tileX);
+	const int y0 = std::max(tri.minY, tileY);
+	const int x1 = std::min(tri.maxX, tileX + TileSize);
+	const int y1 = std::min(tri.maxY, tileY + TileSize);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	const PolyParam& pp = *tri.pp;
+	const Shading shading(*this, tri, listType);
+
+	u32 depthMode;
+	bool depthWrite;
+	if (listType == ListType_Punch_Through)
+	{
+		depthMode = 6;
+		depthWrite = true;
+	}
+	else if (sorted)
+	{
+		depthMode = 6;
+		depthWrite = false;
+	}
+	else
+	{
+		depthMode = pp.isp.DepthMode;
+		depthWrite = !pp.isp.ZWriteDis;
+	}
+	const bool blend = pp.tsp.SrcInstr != 1 || pp.tsp.DstInstr != 0;
+	const u8 shadow = pp.pcw.Shadow;
+	const bool exclude = tri.exclude[2] != 0;
+
+	for (int y = y0; y < y1; y++)
+	{
+		float e[3];
+		for (int i = 0; i < 3; i++)
+			e[i] = tri.a[i] * x0 + tri.b[i] * y + tri.c[i];
+		for (int x = x0; x < x1; x += 4)
+		{
+			u32 mask = coverage4(e, tri.a, tri.topLeft);
+			if (x + 4 > x1)
+				mask &= (1 << (x1 - x)) - 1;
+			for (int bit = 0; mask != 0; bit++, mask >>= 1)
+			{
+				if ((mask & 1) == 0)
+					continue;
+				const int px = x + bit;
+				if (exclude && px >= tri.exclude[0] && px < tri.exclude[2] && y >= tri.exclude[1] && y < tri.exclude[3])
+					continue;
+				const float w[3] { e[0] + tri.a[0] * bit, e[1] + tri.a[1] * bit, e[2] + tri.a[2] * bit };
+				const float z = (w[0] * tri.z[0] + w[1] * tri.z[1] + w[2] * tri.z[2]) * tri.invArea;
+				const int pi = (y - tileY) * TileSize + px - tileX;
+				if (!depthTest(depthMode, z, buffers.depth[pi]))
+					continue;
+				float color[4];
+				if (!shading.shade(w, z, color))
+					continue;
+				if (blend)
+				{
+					float dst[4];
+					unpackColor(buffers.color[pi], dst);
+					float out[4];
+					for (int c = 0; c < 4; c++)
+						out[c] = color[c] * blendFactor(pp.tsp.SrcInstr, true, color, dst, c)
+								+ dst[c] * blendFactor(pp.tsp.DstInstr, false, color, dst, c);
+					buffers.color[pi] = packColor(out);
+				}
+				else
+				{
+					buffers.color[pi] = packColor(color);
+				}
+				if (depthWrite)
+					buffers.depth[pi] = z;
+				if (listType != ListType_Translucent)
+					buffers.shadow[pi] = shadow;
+			}
+			for (int i = 0; i < 3; i++)
+				e[i] += tri.a[i] * 4;
+		}
+	}
+}
+
+// Stencil bits: 0 inside the shadow, 1 inside the current volume, 2 touched by the current volume
+void TileRasterizer::drawModVols(TileBuffers& buffers, const Pass& pass, const std::vector<u32>& bin, size_t& binIndex, int tileX, int tileY)
+{
+	bool touched = false;
+	for (u32 p = pass.mvoFirst; p < pass.mvoEnd; p++)
+	{
+		const ModifierVolumeParam& param = ctx->global_param_mvo[p];
+		if (param.count == 0)
+			continue;
+		const bool orMode = !param.isp.VolumeLast && param.isp.DepthMode > 0;
+		for (; binIndex < bin.size() && bin[binIndex] < pass.mvEnd && triangles[bin[binIndex]].param == p; binIndex++)
+		{
+			const Triangle& tri = triangles[bin[binIndex]];
+			const int x0 = std::max(tri.minX, tileX);
+			const int y0 = std::max(tri.minY, tileY);
+			const int x1 = std::min(tri.maxX, tileX + TileSize);
+			const int y1 = std::min(tri.maxY, tileY + TileSize);
+			for (int y = y0; y < y1; y++)
+			{
+				float e[3];
+				for (int i = 0; i < 3; i++)
+					e[i] = tri.a[i] * x0 + tri.b[i] * y + tri.c[i];
+				for (int x = x0; x < x1; x += 4)
+				{
+					u32 mask = coverage4(e, tri.a, tri.topLeft);
+					if (x + 4 > x1)
+						mask &= (1 << (x1 - x)) - 1;
+					for (int bit = 0; mask != 0; bit++, mask >>= 1)
+					{
+						if ((mask & 1) == 0)
+							continue;
+						const float z = ((e[0] + tri.a[0] * bit) * tri.z[0] + (e[1] + tri.a[1] * bit) * tri.z[1]
+								+ (e[2] + tri.a[2] * bit) * tri.z[2]) * tri.invArea;
+						const int pi = (y - tileY) * TileSize + x + bit - tileX;
+						u8& stencil = buffers.stencil[pi];
+						stencil |= 4;
+						if (z > buffers.depth[pi])
+							stencil = orMode ? stencil | 2 : stencil ^ 2;
+						touched = true;
+					}
+					for (int i = 0; i < 3; i++)
+						e[i] += tri.a[i] * 4;
+				}
+			}
+		}
+		const u32 mode = param.isp.DepthMode;
+		if ((mode == 1 || mode == 2) && touched)
+		{
+			// Last triangle of the volume: update the shadow state of the pixels it touched
+			for (u8& stencil : buffers.stencil)
+			{
+				if ((stencil & 4) == 0)
+					continue;
+				const bool inside = mode == 1 ? (stencil & 3) != 0 : (stencil & 3) == 1;
+				stencil = inside ? 1 : 0;
+			}
+			touched = false;
+		}
+	}
+	for (int i = 0; i < TileSize * TileSize; i++)
+	{
+		if ((buffers.stencil[i] & 1) && buffers.shadow[i])
+		{
+			u32& color = buffers.color[i];
+			u32 shaded = color & 0xff000000;
+			for (int c = 0; c < 3; c++)
+				shaded |= (u32)(((color >> (c * 8)) & 0xff) * state->shadowScale) << (c * 8);
+			color = shaded;
+		}
+		buffers.stencil[i] = 0;
+	}
+}
+
+}
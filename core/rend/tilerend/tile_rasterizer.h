@@ -0,0 +1,181 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Software rasterizer working on 32x32 tiles like the PowerVR ISP/TSP.
+	Triangles are set up and binned into the tiles to render, then each tile is
+	rendered independently by a pool of threads into its own color, depth and stencil buffers.
+*/
+#pragma once
+#include "types.h"
+#include "hw/pvr/ta_ctx.h"
+#include "rend/TexCache.h"
+#include "util/task_pool.h"
+
+#include <string>
+#include <vector>
+
+namespace tilerend
+{
+
+constexpr int TileSize = 32;
+
+// Decoded texture in host memory
+class Texture final : public BaseTextureCacheData
+{
+public:
+	Texture(TSP tsp, TCW tcw) : BaseTextureCacheData(tsp, tcw) {
+	}
+	Texture(Texture&& other) : BaseTextureCacheData(std::move(other))
+	{
+		std::swap(pixels, other.pixels);
+		std::swap(indices, other.indices);
+		texWidth = other.texWidth;
+		texHeight = other.texHeight;
+	}
+
+	std::string GetId() override { return std::to_string((uintptr_t)this); }
+	void UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded = false) override;
+	// Only the RGBA and 8-bit palette index formats are kept
+	bool Force32BitTexture(TextureType type) const override { return true; }
+	bool Delete() override;
+
+	std::vector<u32> pixels;	// RGBA
+	std::vector<u8> indices;	// palette indices of textures using the palette at render time
+	u32 texWidth = 0;
+	u32 texHeight = 0;
+};
+
+class TextureCache final : public BaseTextureCache<Texture>
+{
+public:
+	void Cleanup() {
+		CollectCleanup();
+	}
+};
+
+// Rendering parameters that aren't part of the TA context
+struct RenderState
+{
+	u8 fogTable[128][2] {};
+	float fogColRam[3] {};
+	float fogColVert[3] {};
+	float fogDensity = 1.f;
+	float ptAlphaRef = 1.f;
+	float shadowScale = 0.5f;
+	float cullValue = 0.f;
+	u32 palette[1024] {};
+	bool fog = true;
+	bool modifierVolumes = true;
+	bool clipping = true;
+	int textureFiltering = 0;	// 0: as specified, 1: force nearest, 2: force linear
+
+	// Copy the pvr registers and settings
+	void update();
+};
+
+struct Tile
+{
+	u16 x;
+	u16 y;
+};
+
+class TileRasterizer
+{
+public:
+	// threadCount includes the calling thread. 0 uses all the host cpus.
+	TileRasterizer(int threadCount = 0);
+
+	// Render the given tiles of the context into a RGBA framebuffer of width x height pixels.
+	// Pixels outside the tiles are left untouched.
+	void render(const rend_context& ctx, const RenderState& state, const std::vector<Tile>& tiles,
+			u32 *framebuffer, int width, int height);
+
+	int threadCount() const {
+		return pool.size();
+	}
+
+private:
+	struct Triangle
+	{
+		// Edge functions a * x + b * y + c, positive inside.
+		// Edge i is opposite vertex i.
+		float a[3];
+		float b[3];
+		float c[3];
+		float invArea;
+		float z[3];			// 1/w
+		u32 topLeft;		// bit i set if edge i is a top or left edge
+		int minX, minY;		// pixel bounds, min inclusive, max exclusive
+		int maxX, maxY;
+		int exclude[4];		// pixels in this rectangle are discarded (tile clipping)
+		const PolyParam *pp;		// null for modifier volumes
+		const Vertex *v[3];
+		u32 param;			// modifier volume param index
+	};
+	struct Pass
+	{
+		u32 opEnd;		// triangle index ranges of each list
+		u32 ptEnd;
+		u32 mvEnd;
+		u32 trEnd;
+		u32 mvoFirst;	// modifier volume params
+		u32 mvoEnd;
+		bool autosort;
+		bool zClear;
+	};
+	struct TileBuffers
+	{
+		u32 color[TileSize * TileSize];
+		float depth[TileSize * TileSize];
+		u8 stencil[TileSize * TileSize];
+		u8 shadow[TileSize * TileSize];
+		std::vector<std::pair<float, u32>> sorted;
+	};
+	struct Shading;
+
+	void setupPolys(const rend_context& ctx, const std::vector<PolyParam>& polys, u32 first, u32 end);
+	void setupTriangle(const PolyParam& pp, const Vertex& v0, const Vertex& v1, const Vertex& v2, bool odd);
+	void setupModVols(const rend_context& ctx, u32 first, u32 end);
+	bool setupEdges(Triangle& tri, const float x[3], const float y[3], u32 tileclip);
+	void binTriangles();
+	void renderTile(int tileNum, int thread);
+	void drawTriangle(TileBuffers& buffers, const Triangle& tri, int tileX, int tileY, u32 listType, bool sorted);
+	void drawModVols(TileBuffers& buffers, const Pass& pass, const std::vector<u32>& bin, size_t& binIndex, int tileX, int tileY);
+
+	TaskPool pool;
+	const rend_context *ctx = nullptr;
+	const RenderState *state = nullptr;
+	const std::vector<Tile> *tiles = nullptr;
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	int clipMinX = 0;
+	int clipMinY = 0;
+	int clipMaxX = 0;
+	int clipMaxY = 0;
+	u32 *framebuffer = nullptr;
+	std::vector<Triangle> triangles;
+	std::vector<Pass> passes;
+	std::vector<int> tileIndex;
+	std::vector<std::vector<u32>> bins;
+	std::vector<TileBuffers> tileBuffers;
+};
+
+}
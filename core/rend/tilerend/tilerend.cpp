@@ -0,0 +1,179 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "tile_rasterizer.h"
+#include "hw/pvr/ta.h"
+#include "hw/pvr/pvr_mem.h"
+#include "hw/pvr/Renderer_if.h"
+#include "cfg/option.h"
+
+namespace tilerend
+{
+
+// Software renderer rendering the tiles listed in the region array at native resolution.
+// Used by headless (USE_HEADLESS) builds.
+class TileRenderer final : public Renderer
+{
+public:
+	bool Init() override {
+		return true;
+	}
+
+	void Term() override {
+		texCache.Clear();
+	}
+
+	void Process(TA_context *ctx) override
+	{
+		if (resetTextureCache) {
+			texCache.Clear();
+			resetTextureCache = false;
+		}
+		texCache.Cleanup();
+		state.update();
+		ta_parse(ctx, true);
+		getRegionTiles();
+	}
+
+	bool Render() override
+	{
+		const int width = (pvrrc.getFramebufferWidth() + TileSize - 1) / TileSize * TileSize;
+		const int height = (pvrrc.getFramebufferHeight() + TileSize - 1) / TileSize * TileSize;
+		std::vector<Tile> renderTiles = tiles;
+		if (renderTiles.empty())
+		{
+			for (int y = 0; y < height / TileSize; y++)
+				for (int x = 0; x < width / TileSize; x++)
+					renderTiles.push_back({ (u16)x, (u16)y });
+		}
+		frame.assign(width * height, 0);
+		rasterizer.render(pvrrc, state, renderTiles, frame.data(), width, height);
+
+		if (pvrrc.isRTT || config::EmulateFramebuffer)
+		{
+			FB_X_CLIP_type xClip = pvrrc.fb_X_CLIP;
+			FB_Y_CLIP_type yClip = pvrrc.fb_Y_CLIP;
+			xClip.min = std::min<u32>(xClip.min, width - 1);
+			xClip.max = std::min<u32>(xClip.max, width - 1);
+			yClip.min = std::min<u32>(yClip.min, height - 1);
+			yClip.max = std::min<u32>(yClip.max, height - 1);
+			WriteFramebuffer(width, height, (const u8 *)frame.data(), pvrrc.fb_W_SOF1 & VRAM_MASK,
+					pvrrc.fb_W_CTRL, pvrrc.fb_W_LINESTRIDE * 8, xClip, yClip);
+		}
+		if (pvrrc.isRTT)
+			return false;
+		frameWidth = width;
+		frameHeight = height;
+		lastFrame.swap(frame);
+		clearLastFrame = false;
+
+		return true;
+	}
+
+	void RenderFramebuffer(const FramebufferInfo& info) override
+	{
+		PixelBuffer<u32> pb;
+		int width, height;
+		ReadFramebuffer(info, pb, width, height);
+		lastFrame.assign(pb.data(), pb.data() + width * height);
+		frameWidth = width;
+		frameHeight = height;
+		clearLastFrame = false;
+	}
+
+	bool GetLastFrame(std::vector<u8>& data, int& width, int& height) override
+	{
+		if (clearLastFrame || lastFrame.empty())
+			return false;
+		if (width != 0)
+			height = width * frameHeight / frameWidth;
+		else if (height != 0)
+			width = height * frameWidth / frameHeight;
+		else
+		{
+			width = frameWidth;
+			height = frameHeight;
+		}
+		data.resize(width * height * 3);
+		u8 *dst = data.data();
+		for (int y = 0; y < height; y++)
+		{
+			const u32 *src = &lastFrame[(y * frameHeight / height) * frameWidth];
+			for (int x = 0; x < width; x++)
+			{
+				const u32 pixel = src[x * frameWidth / width];
+				*dst++ = pixel & 0xff;
+				*dst++ = (pixel >> 8) & 0xff;
+				*dst++ = (pixel >> 16) & 0xff;
+			}
+		}
+		return true;
+	}
+
+	BaseTextureCacheData *GetTexture(TSP tsp, TCW tcw) override
+	{
+		Texture *texture = texCache.getTextureCacheData(tsp, tcw);
+		if (texture->NeedsUpdate())
+		{
+			if (!texture->Update())
+				texture = nullptr;
+		}
+		else if (texture->IsCustomTextureAvailable())
+		{
+			texture->CheckCustomTexture();
+		}
+		return texture;
+	}
+
+private:
+	// Collect the distinct tiles of the region array
+	void getRegionTiles()
+	{
+		tiles.clear();
+		u32 addr;
+		u32 tileSize;
+		getRegionTileAddrAndSize(addr, tileSize);
+		u64 seen[64] {};
+		RegionArrayTile tile;
+		int maxTiles = 3000;
+		do {
+			tile.full = pvr_read32p<u32>(addr);
+			if ((seen[tile.Y] & (1ull << tile.X)) == 0)
+			{
+				seen[tile.Y] |= 1ull << tile.X;
+				tiles.push_back({ (u16)tile.X, (u16)tile.Y });
+			}
+			addr += tileSize;
+		} while (!tile.LastRegion && --maxTiles >= 0);
+	}
+
+	TextureCache texCache;
+	RenderState state;
+	TileRasterizer rasterizer;
+	std::vector<Tile> tiles;
+	std::vector<u32> frame;
+	std::vector<u32> lastFrame;
+	int frameWidth = 0;
+	int frameHeight = 0;
+};
+
+}
+
+Renderer *rend_TileRenderer() {
+	return new tilerend::TileRenderer();
+}
@@ -21,7 +21,10 @@
 #pragma once
 #include "../buffer.h"
 #include "../texture.h"
+#include "rend/pixel_buffer_sizer.h"
 
+#include <algorithm>
+#include <array>
 #include <memory>
 
 class OITBuffers
@@ -39,16 +42,22 @@ public:
 		if (!pixelBuffer)
 		{
 			pixelBufferSize = config::PixelBufferSize;
-			pixelBuffer = std::make_unique<BufferData>(std::min<vk::DeviceSize>(pixelBufferSize, context->GetMaxMemoryAllocationSize()),
+			// The configured size is the maximum. The actual size depends on the fragments used.
+			sizer.reset(std::min<vk::DeviceSize>(pixelBufferSize, context->GetMaxMemoryAllocationSize()));
+			pixelBuffer = std::make_unique<BufferData>(sizer.getSize(),
 					vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
 		}
 		if (!pixelCounter)
 		{
 			pixelCounter = std::make_unique<BufferData>(4,
-					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+					vk::MemoryPropertyFlagBits::eDeviceLocal);
 			pixelCounterReset = std::make_unique<BufferData>(4, vk::BufferUsageFlagBits::eTransferSrc);
 			const int zero = 0;
 			pixelCounterReset->upload(sizeof(zero), &zero);
+			counterReadback = std::make_unique<BufferData>(sizeof(u32) * MaxPasses * ReadbackSlots, vk::BufferUsageFlagBits::eTransferDst);
+			const std::array<u32, MaxPasses * ReadbackSlots> zeros {};
+			counterReadback->upload(sizeof(zeros), zeros.data());
 		}
 		// We need to wait until this buffer is not used before deleting it
 		context->WaitIdle();
@@ -74,11 +83,25 @@ public:
 	void OnNewFrame(vk::CommandBuffer commandBuffer)
 	{
 		firstFrameAfterInit = false;
+		readbackSlot = (readbackSlot + 1) % ReadbackSlots;
+		passIndex = 0;
+		// Fragment counts of the frame that last used this slot, which is complete by now
+		std::array<u32, MaxPasses> counts;
+		counterReadback->download(sizeof(counts), counts.data(), readbackSlot * sizeof(counts));
+		const u32 fragments = *std::max_element(counts.begin(), counts.end());
+		counts.fill(0);
+		counterReadback->upload(sizeof(counts), counts.data(), readbackSlot * sizeof(counts));
+
 		if (pixelBufferSize != config::PixelBufferSize)
 		{
 			pixelBufferSize = config::PixelBufferSize;
-			pixelBuffer = std::make_unique<BufferData>(std::min<vk::DeviceSize>(pixelBufferSize, VulkanContext::Instance()->GetMaxMemoryAllocationSize()),
-					vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+			sizer.reset(std::min<vk::DeviceSize>(pixelBufferSize, VulkanContext::Instance()->GetMaxMemoryAllocationSize()));
+			resizePixelBuffer();
+		}
+		else if (sizer.update(fragments))
+		{
+			INFO_LOG(RENDERER, "OIT: %d fragments. Resizing pixel buffer to %d MB", fragments, (int)(sizer.getSize() / 1_MB));
+			resizePixelBuffer();
 		}
 	}
 
@@ -88,17 +111,50 @@ public:
     	commandBuffer.copyBuffer(*pixelCounterReset->buffer, *pixelCounter->buffer, copy);
 	}
 
+	// Copy the fragment count of the render pass that just ended so that it can be read a few frames later
+	void ReadbackPixelCounter(vk::CommandBuffer commandBuffer)
+	{
+		vk::MemoryBarrier shaderBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+				{}, shaderBarrier, nullptr, nullptr);
+		const u32 slot = readbackSlot * MaxPasses + std::min(passIndex++, MaxPasses - 1);
+		vk::BufferCopy copy(0, slot * sizeof(u32), sizeof(u32));
+		commandBuffer.copyBuffer(*pixelCounter->buffer, *counterReadback->buffer, copy);
+		// The counter is reset by the next pass
+		vk::MemoryBarrier copyBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eHostRead);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+				{}, copyBarrier, nullptr, nullptr);
+	}
+
+	// Size of the pixel buffer in bytes
+	u64 getPixelBufferSize() const {
+		return sizer.getSize();
+	}
+
 	void Term()
 	{
 		pixelBuffer.reset();
 		pixelCounter.reset();
 		pixelCounterReset.reset();
+		counterReadback.reset();
 		abufferPointer.reset();
+		pixelBufferStats.bufferSize = 0;
 	}
 
 	bool isFirstFrameAfterInit() const { return firstFrameAfterInit; }
 
 private:
+	void resizePixelBuffer()
+	{
+		// The buffer may still be used by the frames in flight
+		VulkanContext::Instance()->WaitIdle();
+		pixelBuffer = std::make_unique<BufferData>(sizer.getSize(),
+				vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	}
+
+	static constexpr u32 MaxPasses = 16;
+	static constexpr u32 ReadbackSlots = 4;
+
 	std::unique_ptr<BufferData> pixelBuffer;
 	std::unique_ptr<BufferData> pixelCounter;
 	std::unique_ptr<BufferData> pixelCounterReset;
@@ -107,4 +163,8 @@ private:
 	int maxWidth = 0;
 	int maxHeight = 0;
 	int64_t pixelBufferSize = 0;
+	PixelBufferSizer sizer;
+	std::unique_ptr<BufferData> counterReadback;
+	u32 readbackSlot = 0;
+	u32 passIndex = 0;
 };
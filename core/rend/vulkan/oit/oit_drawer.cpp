@@ -304,8 +304,6 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 
 	OITDescriptorSets::FragmentShaderUniforms fragUniforms = MakeFragmentUniforms<OITDescriptorSets::FragmentShaderUniforms>();
 	fragUniforms.shade_scale_factor = FPU_SHAD_SCALE.scale_factor / 256.f;
-	// sizeof(Pixel) == 16
-	fragUniforms.pixelBufferSize = std::min<u64>(config::PixelBufferSize, GetContext()->GetMaxMemoryAllocationSize()) / 16;
 	fragUniforms.viewportWidth = maxWidth;
 	dithering = config::EmulateFramebuffer && pvrrc.fb_W_CTRL.fb_dither && pvrrc.fb_W_CTRL.fb_packmode <= 3;
 	if (dithering)
@@ -335,6 +333,7 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 
 	bool firstFrameAfterInit = oitBuffers->isFirstFrameAfterInit();
 	oitBuffers->OnNewFrame(cmdBuffer);
+	fragUniforms.pixelBufferSize = oitBuffers->getPixelBufferSize() / PixelBufferSizer::FragmentSize;
 
 	if (VulkanContext::Instance()->hasProvokingVertex())
 	{
@@ -474,6 +473,7 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 		}
 
 		cmdBuffer.endRenderPass();
+		oitBuffers->ReadbackPixelCounter(cmdBuffer);
 		previous_pass = current_pass;
     }
     curMainBuffer = nullptr;
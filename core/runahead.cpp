@@ -0,0 +1,195 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "runahead.h"
+#include "cfg/option.h"
+#include "emulator.h"
+#include "serialize.h"
+#include "stdclass.h"
+#include "hw/mem/mem_watch.h"
+#include "hw/pvr/Renderer_if.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/modules/mmu.h"
+
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace runahead
+{
+
+static bool enabled;
+static bool aheadFrames;
+static std::vector<u8> state;
+
+static std::mutex statsMutex;
+static struct {
+	u32 frames;
+	u32 aheadFrames;
+	u64 frameTime;
+	u64 aheadTime;
+	u64 saveTime;
+	u64 restoreTime;
+	u64 pages;
+} totals;
+// For the periodic log
+static decltype(totals) logTotals;
+
+void init()
+{
+	const bool wasEnabled = enabled;
+	enabled = config::RunAhead > 0 && !config::GGPOEnable
+			&& !settings.network.online && !settings.naomi.multiboard;
+	if (wasEnabled && !enabled)
+	{
+		// Stop watching memory writes. Pages protected for code blocks are also unlocked
+		// so the code cache must be flushed.
+		memwatch::unprotect();
+		memwatch::reset();
+		emu.getSh4Executor()->ResetCache();
+		state = {};
+	}
+	if (enabled)
+		// no frame is being rendered yet
+		rend_allow_rollback();
+	if (enabled != wasEnabled)
+		INFO_LOG(COMMON, "Run-ahead %s", enabled ? "enabled" : "disabled");
+}
+
+bool active() {
+	return enabled;
+}
+
+bool runningAhead() {
+	return aheadFrames;
+}
+
+static void saveState()
+{
+	Serializer dryrun(nullptr, std::numeric_limits<size_t>::max(), true);
+	dc_serialize(dryrun);
+	if (dryrun.size() > state.size())
+		state.resize(dryrun.size());
+	Serializer ser(state.data(), state.size(), true);
+	dc_serialize(ser);
+	// Start saving the pages written from now on
+	memwatch::checkpoint();
+}
+
+static size_t restoreState()
+{
+	// wait until the render thread is done with vram
+	rend_start_rollback();
+	const size_t pages = memwatch::restore();
+	if (mmu_enabled())
+		mmu_flush_table();
+	Deserializer deser(state.data(), state.size(), true);
+	dc_deserialize(deser);
+	mmu_set_state();
+	rend_allow_rollback();
+
+	return pages;
+}
+
+// Restores normal emulation when leaving scope, including on error
+struct AheadScope
+{
+	~AheadScope() {
+		rend_enable_renderer(true);
+		settings.aica.muteAudio = false;
+		aheadFrames = false;
+	}
+};
+
+bool runFrame(const std::function<bool()>& emulateFrame)
+{
+	const int frames = config::RunAhead;
+	u64 t0 = getTimeUs();
+	bool complete;
+	{
+		AheadScope _;
+		rend_enable_renderer(false);
+		complete = emulateFrame();
+	}
+	if (!complete)
+		return false;
+
+	u64 t1 = getTimeUs();
+	saveState();
+	u64 t2 = getTimeUs();
+
+	{
+		AheadScope _;
+		aheadFrames = true;
+		settings.aica.muteAudio = true;
+		for (int i = 1; i <= frames && complete; i++)
+		{
+			rend_enable_renderer(i == frames);
+			complete = emulateFrame();
+		}
+	}
+	u64 t3 = getTimeUs();
+
+	// Always go back to the saved state, even when interrupted
+	const size_t pages = restoreState();
+	u64 t4 = getTimeUs();
+
+	std::lock_guard<std::mutex> _(statsMutex);
+	for (auto *t : { &totals, &logTotals })
+	{
+		t->frames++;
+		t->aheadFrames += frames;
+		t->frameTime += t1 - t0;
+		t->saveTime += t2 - t1;
+		t->aheadTime += t3 - t2;
+		t->restoreTime += t4 - t3;
+		t->pages += pages;
+	}
+	if (logTotals.frames == 3600)
+	{
+		DEBUG_LOG(COMMON, "Run-ahead: frame %d us, %d frames ahead %d us, save %d us, restore %d us (%d pages)",
+				(int)(logTotals.frameTime / logTotals.frames), frames, (int)(logTotals.aheadTime / logTotals.frames),
+				(int)(logTotals.saveTime / logTotals.frames), (int)(logTotals.restoreTime / logTotals.frames),
+				(int)(logTotals.pages / logTotals.frames));
+		logTotals = {};
+	}
+
+	return complete;
+}
+
+Stats getStats()
+{
+	std::lock_guard<std::mutex> _(statsMutex);
+	Stats stats {};
+	stats.frames = totals.frames;
+	if (totals.frames != 0)
+	{
+		stats.frameMs = totals.frameTime / 1000.f / totals.frames;
+		stats.saveMs = totals.saveTime / 1000.f / totals.frames;
+		stats.restoreMs = totals.restoreTime / 1000.f / totals.frames;
+		stats.extraMs = (totals.saveTime + totals.aheadTime + totals.restoreTime) / 1000.f / totals.frames;
+		stats.dirtyPages = totals.pages / totals.frames;
+	}
+	if (totals.aheadFrames != 0)
+		stats.aheadMs = totals.aheadTime / 1000.f / totals.aheadFrames;
+	totals = {};
+
+	return stats;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Run-ahead: hide the game's own input lag by showing a frame emulated in the future.
+	For each displayed frame:
+		- emulate the next frame without rendering it
+		- save the emulator state
+		- emulate config::RunAhead more frames with audio muted and only render the last one
+		- restore the saved state
+	Only the registers and devices are serialized. Memory is restored using the dirty pages
+	saved by the memory watchers (see hw/mem/mem_watch.h), like for GGPO rollbacks.
+*/
+#pragma once
+#include "types.h"
+
+#include <functional>
+
+namespace runahead
+{
+
+struct Stats
+{
+	u32 frames;			// displayed frames
+	float frameMs;		// average time to emulate the next frame
+	float aheadMs;		// average time to emulate one frame ahead
+	float extraMs;		// average run-ahead overhead per displayed frame, including save and restore
+	float saveMs;
+	float restoreMs;
+	u32 dirtyPages;		// average number of memory pages restored
+};
+
+// Enable or disable run-ahead according to the config when the emulator starts
+void init();
+// True if run-ahead is enabled. Emulation must then be stopped at each vblank.
+bool active();
+// True while emulating frames ahead
+bool runningAhead();
+
+// Run one frame with run-ahead.
+// emulateFrame must emulate up to the next vblank and return false if interrupted.
+// Returns false if the last frame was interrupted.
+bool runFrame(const std::function<bool()>& emulateFrame);
+
+// Returns the stats since the last call
+Stats getStats();
+
+}
@@ -797,6 +797,7 @@ static int suspendEventFilter(void *userdata, SDL_Event *event)
 
 void sdl_window_create()
 {
+#ifndef NO_REND
 	if (SDL_WasInit(SDL_INIT_VIDEO) == 0)
 	{
 		if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
@@ -807,6 +808,7 @@ void sdl_window_create()
 		SDL_Vulkan_LoadLibrary("libvulkan.dylib");
 #endif
 	}
+#endif
 	sdlDeInit.initialized = true;
 	initRenderApi();
 	// ImGui copy & paste
@@ -821,7 +823,7 @@ void sdl_window_create()
 void sdl_window_destroy()
 {
 #ifndef __SWITCH__
-	if (!settings.naomi.slave && settings.naomi.drivingSimSlave == 0)
+	if (window != nullptr && !settings.naomi.slave && settings.naomi.drivingSimSlave == 0)
 	{
 		get_window_state();
 		cfgSaveInt("window", "left", windowPos.x);
@@ -221,6 +221,15 @@ u64 getTimeMs()
 	return std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
 }
 
+u64 getTimeUs()
+{
+	using the_clock = std::chrono::steady_clock;
+	std::chrono::time_point<the_clock> now = the_clock::now();
+	static std::chrono::time_point<the_clock> start = now;
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+}
+
 #ifdef _WIN32
 static struct tm *localtime_r(const time_t *_clock, struct tm *_result)
 {
@@ -202,6 +202,7 @@ public:
 };
 
 u64 getTimeMs();
+u64 getTimeUs();
 std::string timeToISO8601(time_t time);
 
 class ThreadRunner
@@ -21,89 +21,360 @@
 #include "oslib/oslib.h"
 #include "oslib/storage.h"
 #include "cfg/option.h"
+#include "json.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace nlohmann;
 
 static bool operator<(const GameMedia &left, const GameMedia &right)
 {
 	return left.name < right.name;
 }
 
-void GameScanner::insert_game(const GameMedia& game)
+static bool isGameFile(const std::string& extension)
 {
-	LockGuard _(mutex);
-	game_list.insert(std::upper_bound(game_list.begin(), game_list.end(), game), game);
+	return extension == "cdi" || extension == "cue" || extension == "gdi" || extension == "chd"
+			|| extension == "zip" || extension == "7z"
+			|| extension == "bin" || extension == "lst" || extension == "dat";
 }
 
-void GameScanner::insert_arcade_game(const GameMedia& game)
+void GameScanIndex::load(const std::string& path)
 {
-	arcade_game_list.insert(std::upper_bound(arcade_game_list.begin(), arcade_game_list.end(), game), game);
+	dirs.clear();
+	FILE *f = nowide::fopen(path.c_str(), "rt");
+	if (f == nullptr)
+		return;
+	std::string all_data;
+	char buf[4096];
+	while (true)
+	{
+		int s = fread(buf, 1, sizeof(buf), f);
+		if (s <= 0)
+			break;
+		all_data.append(buf, s);
+	}
+	fclose(f);
+	try {
+		json v = json::parse(all_data);
+		for (const auto& item : v.items())
+		{
+			const json& jdir = item.value();
+			Directory dir;
+			dir.updateTime = jdir.at("update_time").get<u64>();
+			dir.subdirs = jdir.at("subdirs").get<std::vector<std::string>>();
+			for (const json& jfile : jdir.at("files"))
+			{
+				File file;
+				file.name = jfile.at("name").get<std::string>();
+				file.path = jfile.at("path").get<std::string>();
+				dir.files.push_back(std::move(file));
+			}
+			dirs[item.key()] = std::move(dir);
+		}
+	} catch (const json::exception& e) {
+		WARN_LOG(COMMON, "Corrupted game index %s: %s", path.c_str(), e.what());
+		dirs.clear();
+	}
 }
 
-void GameScanner::add_game_directory(const std::string& path)
+void GameScanIndex::save(const std::string& path) const
 {
-	hostfs::DirectoryTree tree(path);
-	std::string emptyParentPath;
-	for (const hostfs::FileInfo& item : tree)
+	json v = json::object();
+	for (const auto& [dirPath, dir] : dirs)
 	{
-		if (!running)
-			break;
+		json files = json::array();
+		for (const File& file : dir.files)
+			files.push_back({
+				{ "name", file.name },
+				{ "path", file.path },
+			});
+		v[dirPath] = {
+			{ "update_time", dir.updateTime },
+			{ "subdirs", dir.subdirs },
+			{ "files", files },
+		};
+	}
+	FILE *f = nowide::fopen(path.c_str(), "wt");
+	if (f == nullptr)
+	{
+		WARN_LOG(COMMON, "Can't save game index to %s: error %d", path.c_str(), errno);
+		return;
+	}
+	std::string serialized = v.dump();
+	fwrite(serialized.c_str(), 1, serialized.size(), f);
+	fclose(f);
+}
+
+// Notifies when files are added, removed or updated in the watched directories
+class DirectoryWatcher
+{
+public:
+	DirectoryWatcher(std::function<void()> onChange) : onChange(onChange)
+	{
+#if defined(__linux__) && !defined(__ANDROID__)
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd == -1) {
+			WARN_LOG(COMMON, "inotify_init1 failed: errno %d", errno);
+			return;
+		}
+		running = true;
+		thread = std::thread([this]() { run(); });
+#endif
+	}
+
+	~DirectoryWatcher()
+	{
+#if defined(__linux__) && !defined(__ANDROID__)
+		running = false;
+		if (thread.joinable())
+			thread.join();
+		if (fd != -1)
+			close(fd);
+#endif
+	}
 
-		if (game_list.empty())
+	void watch(const std::vector<std::string>& dirs)
+	{
+#if defined(__linux__) && !defined(__ANDROID__)
+		if (fd == -1)
+			return;
+		std::lock_guard<std::mutex> _(mutex);
+		for (int wd : watches)
+			inotify_rm_watch(fd, wd);
+		watches.clear();
+		for (const std::string& dir : dirs)
 		{
-			// This won't work for android content uris
-			size_t slash = get_last_slash_pos(item.path);
-			std::string parentPath;
-			if (slash != 0 && slash != std::string::npos)
-				parentPath = item.path.substr(0, slash);
-			else
-				parentPath = item.path;
-			if (parentPath != emptyParentPath)
+			int wd = inotify_add_watch(fd, dir.c_str(),
+					IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR);
+			if (wd == -1)
 			{
-				++empty_folders_scanned;
-				emptyParentPath = parentPath;
-				if (empty_folders_scanned > 1000)
-					content_path_looks_incorrect = true;
+				// Likely reached max_user_watches
+				WARN_LOG(COMMON, "inotify_add_watch(%s) failed: errno %d", dir.c_str(), errno);
+				break;
 			}
+			watches.push_back(wd);
 		}
-		else
+		DEBUG_LOG(COMMON, "Watching %d content directories", (int)watches.size());
+#endif
+	}
+
+private:
+#if defined(__linux__) && !defined(__ANDROID__)
+	void run()
+	{
+		ThreadName _("DirWatcher");
+		bool pending = false;
+		while (running)
 		{
-			content_path_looks_incorrect = false;
+			pollfd pfd { fd, POLLIN, 0 };
+			int rc = poll(&pfd, 1, 500);
+			if (rc > 0 && (pfd.revents & POLLIN))
+			{
+				alignas(inotify_event) char buf[4096];
+				while (read(fd, buf, sizeof(buf)) > 0)
+					;
+				pending = true;
+			}
+			else if (rc == 0 && pending)
+			{
+				// Wait until the directories are quiet before notifying
+				pending = false;
+				DEBUG_LOG(COMMON, "Content directory changed");
+				onChange();
+			}
 		}
+	}
 
-		if (item.name.substr(0, 2) == "._")
-			// Ignore Mac OS turds
-			continue;
-		std::string fileName(item.name);
-		std::string gameName(get_file_basename(item.name));
-		std::string extension = get_file_extension(item.name);
-		if (extension == "zip" || extension == "7z")
+	int fd = -1;
+	std::vector<int> watches;
+	std::mutex mutex;
+	std::atomic<bool> running {};
+	std::thread thread;
+#endif
+	std::function<void()> onChange;
+};
+
+GameScanner::GameScanner()
+{
+	watcher = std::make_unique<DirectoryWatcher>([this]() {
+		dirty = true;
+	});
+}
+
+GameScanner::~GameScanner()
+{
+	stop();
+	watcher.reset();
+}
+
+// Insert the games into the sorted list. Inserting games one by one is quadratic with large libraries.
+void GameScanner::insert_games(std::vector<GameMedia>& list, std::vector<GameMedia> games)
+{
+	std::stable_sort(games.begin(), games.end());
+	const size_t mid = list.size();
+	list.insert(list.end(), std::make_move_iterator(games.begin()), std::make_move_iterator(games.end()));
+	std::inplace_merge(list.begin(), list.begin() + mid, list.end());
+}
+
+void GameScanner::add_game_file(const GameScanIndex::File& file, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames)
+{
+	std::string fileName(file.name);
+	std::string gameName(get_file_basename(file.name));
+	std::string extension = get_file_extension(file.name);
+	if (extension == "zip" || extension == "7z")
+	{
+		string_tolower(gameName);
+		auto it = arcade_games.find(gameName);
+		if (it == arcade_games.end())
+			return;
+		gameName = it->second->description;
+		fileName = fileName + " (" + gameName + ")";
+		arcadeGames.push_back(GameMedia{ fileName, file.path, file.name, gameName });
+		return;
+	}
+	else if (extension == "bin" || extension == "lst" || extension == "dat")
+	{
+		if (!config::HideLegacyNaomiRoms)
+			arcadeGames.push_back(GameMedia{ fileName, file.path, file.name, gameName });
+		return;
+	}
+	else if (extension == "chd" || extension == "gdi")
+	{
+		// Hide arcade gdroms
+		std::string basename = gameName;
+		string_tolower(basename);
+		if (arcade_gdroms.count(basename) != 0)
+			return;
+	}
+	else if (extension != "cdi" && extension != "cue")
+		return;
+	games.push_back(GameMedia{ fileName, file.path, file.name, gameName });
+}
+
+// Returns true if the directory content was found in the index.
+bool GameScanner::scan_directory(const std::string& path, GameScanIndex::Directory& dir)
+{
+	hostfs::FileInfo info = hostfs::storage().getFileInfo(path);
+	auto it = index.dirs.find(path);
+	const GameScanIndex::Directory *cached = it != index.dirs.end() ? &it->second : nullptr;
+	if (cached != nullptr && info.updateTime != 0 && cached->updateTime == info.updateTime)
+	{
+		dir = *cached;
+		return true;
+	}
+	dir.updateTime = info.updateTime;
+	for (const hostfs::FileInfo& entry : hostfs::storage().listContent(path))
+	{
+		if (!running)
+			break;
+		if (entry.isDirectory)
 		{
-			string_tolower(gameName);
-			auto it = arcade_games.find(gameName);
-			if (it == arcade_games.end())
-				continue;
-			gameName = it->second->description;
-			fileName = fileName + " (" + gameName + ")";
-			insert_arcade_game(GameMedia{ fileName, item.path, item.name, gameName });
+			dir.subdirs.push_back(entry.path);
 			continue;
 		}
-		else if (extension == "bin" || extension == "lst" || extension == "dat")
-		{
-			if (!config::HideLegacyNaomiRoms)
-				insert_arcade_game(GameMedia{ fileName, item.path, item.name, gameName });
+		if (entry.name.substr(0, 2) == "._")
+			// Ignore Mac OS turds
 			continue;
-		}
-		else if (extension == "chd" || extension == "gdi")
+		std::string extension = get_file_extension(entry.name);
+		if (!isGameFile(extension))
+			continue;
+		GameScanIndex::File file;
+		file.name = entry.name;
+		file.path = entry.path;
+		dir.files.push_back(std::move(file));
+	}
+	return false;
+}
+
+void GameScanner::scan_directories(GameScanIndex& newIndex, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames)
+{
+	std::deque<std::string> queue;
+	std::unordered_set<std::string> visited;
+	for (const auto& path : config::ContentPath.get())
+		queue.push_back(path);
+	std::mutex queueMutex;
+	std::condition_variable cond;
+	int busy = 0;
+
+	const auto& worker = [&]() {
+		ThreadName _("GameScanner");
+		std::unique_lock<std::mutex> lock(queueMutex);
+		while (running)
 		{
-			// Hide arcade gdroms
-			std::string basename = gameName;
-			string_tolower(basename);
-			if (arcade_gdroms.count(basename) != 0)
+			if (queue.empty())
+			{
+				if (busy == 0)
+					break;
+				cond.wait_for(lock, std::chrono::milliseconds(100));
 				continue;
+			}
+			std::string path = std::move(queue.front());
+			queue.pop_front();
+			if (!visited.insert(path).second)
+				continue;
+			busy++;
+			lock.unlock();
+
+			GameScanIndex::Directory dir;
+			bool ok = true;
+			bool cached = false;
+			try {
+				cached = scan_directory(path, dir);
+			} catch (const hostfs::StorageException& e) {
+				ok = false;
+			}
+			std::vector<GameMedia> dirGames;
+			std::vector<GameMedia> dirArcadeGames;
+			if (ok)
+				for (const GameScanIndex::File& file : dir.files)
+					add_game_file(file, dirGames, dirArcadeGames);
+			if (progressive && !dirGames.empty())
+			{
+				LockGuard _(mutex);
+				insert_games(game_list, dirGames);
+			}
+
+			lock.lock();
+			busy--;
+			if (ok)
+			{
+				stats.directories++;
+				if (cached)
+					stats.cachedDirectories++;
+				stats.files += dir.files.size();
+				if (games.empty() && dirGames.empty())
+				{
+					if (!dir.files.empty() && ++empty_folders_scanned > 1000)
+						content_path_looks_incorrect = true;
+				}
+				else {
+					content_path_looks_incorrect = false;
+				}
+				games.insert(games.end(), dirGames.begin(), dirGames.end());
+				arcadeGames.insert(arcadeGames.end(), dirArcadeGames.begin(), dirArcadeGames.end());
+				queue.insert(queue.end(), dir.subdirs.begin(), dir.subdirs.end());
+				newIndex.dirs[path] = std::move(dir);
+			}
+			cond.notify_all();
 		}
-		else if (extension != "cdi" && extension != "cue")
-			continue;
-		insert_game(GameMedia{ fileName, item.path, item.name, gameName });
-	}
+		cond.notify_all();
+	};
+	// Directory listing is mostly I/O bound, especially on network shares
+	unsigned threadCount = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& thread : threads)
+		thread.join();
 }
 
 void GameScanner::stop()
@@ -116,14 +387,22 @@ void GameScanner::stop()
 		scan_thread->join();
 }
 
+void GameScanner::wait()
+{
+	LockGuard _(threadMutex);
+	if (scan_thread && scan_thread->joinable())
+		scan_thread->join();
+}
+
 void GameScanner::fetch_game_list()
 {
 	LockGuard _(threadMutex);
-	if (scan_done || running)
+	if (running || (scan_done && !dirty))
 		return;
 	if (scan_thread && scan_thread->joinable())
 		scan_thread->join();
 	running = true;
+	dirty = false;
 	scan_thread = std::make_unique<std::thread>([this]()
 		{
 			ThreadName _("GameScanner");
@@ -135,43 +414,62 @@ void GameScanner::fetch_game_list()
 					if (game->gdrom_name != nullptr)
 						arcade_gdroms.insert(game->gdrom_name);
 				}
+			u64 startTime = getTimeMs();
+			stats = {};
+			if (!indexLoaded)
 			{
-				LockGuard _(mutex);
-				game_list.clear();
+				index.load(get_index_path());
+				indexLoaded = true;
 			}
-			arcade_game_list.clear();
-			for (const auto& path : config::ContentPath.get())
 			{
-				try {
-					add_game_directory(path);
-				} catch (const hostfs::StorageException& e) {
-					// ignore
-				}
-				if (!running)
-					break;
+				LockGuard _(mutex);
+				// Show the games as they're found if the list is empty.
+				// Otherwise the current list is kept until the scan completes.
+				progressive = game_list.empty();
 			}
+			GameScanIndex newIndex;
+			std::vector<GameMedia> games;
+			std::vector<GameMedia> arcadeGames;
+			scan_directories(newIndex, games, arcadeGames);
+			std::stable_sort(games.begin(), games.end());
+			std::stable_sort(arcadeGames.begin(), arcadeGames.end());
+
 			std::string dcbios = hostfs::findFlash("dc_", "%bios.bin;%boot.bin");
 			{
 				const std::vector<std::string>& cdromDrives = hostfs::getCdromDrives();
-				LockGuard _(mutex);
+				std::vector<GameMedia> list;
+				// Dreamcast BIOS
+				if (!dcbios.empty())
+					list.push_back({ "Dreamcast BIOS" });
 				// CD-ROM devices
-				for (auto it = cdromDrives.rbegin(); it != cdromDrives.rend(); ++it)
+				for (const std::string& drive : cdromDrives)
 				{
 					std::string name;
-					if (it->substr(0, 4) == "\\\\.\\")
-						name = it->substr(4);
+					if (drive.substr(0, 4) == "\\\\.\\")
+						name = drive.substr(4);
 					else
-						name = *it;
-					game_list.insert(game_list.begin(), { name, *it, name, "", true });
+						name = drive;
+					list.push_back({ name, drive, name, "", true });
 				}
-				// Dreamcast BIOS
-				if (!dcbios.empty())
-					game_list.insert(game_list.begin(), { "Dreamcast BIOS" });
+				list.insert(list.end(), games.begin(), games.end());
 				// Arcade games
-				game_list.insert(game_list.end(), arcade_game_list.begin(), arcade_game_list.end());
+				list.insert(list.end(), arcadeGames.begin(), arcadeGames.end());
+				LockGuard _(mutex);
+				game_list = std::move(list);
 			}
+			stats.time = getTimeMs() - startTime;
 			if (running)
+			{
+				INFO_LOG(COMMON, "Game scan: %d directories (%d unchanged), %d files in %d ms",
+						stats.directories, stats.cachedDirectories, stats.files, (int)stats.time);
+				index = std::move(newIndex);
+				index.save(get_index_path());
+				std::vector<std::string> dirs;
+				for (const auto& it : index.dirs)
+					dirs.push_back(it.first);
+				watcher->watch(dirs);
 				scan_done = true;
+			}
 			running = false;
 		});
 }
@@ -18,6 +18,7 @@
  */
 #pragma once
 #include "types.h"
+#include "stdclass.h"
 #include "hw/naomi/naomi_roms.h"
 #include <vector>
 #include <mutex>
@@ -25,6 +26,7 @@
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
 
 struct GameMedia
 {
@@ -35,28 +37,58 @@ struct GameMedia
 	bool device = false;	// Corresponds to a physical cdrom device
 };
 
+// Persistent index of the scanned content directories.
+// Unchanged directories aren't listed again.
+struct GameScanIndex
+{
+	struct File
+	{
+		std::string name;
+		std::string path;
+	};
+	struct Directory
+	{
+		u64 updateTime = 0;
+		std::vector<std::string> subdirs;
+		std::vector<File> files;
+	};
+	std::unordered_map<std::string, Directory> dirs;
+
+	void load(const std::string& path);
+	void save(const std::string& path) const;
+};
+
+class DirectoryWatcher;
+
 class GameScanner
 {
 	std::vector<GameMedia> game_list;
-	std::vector<GameMedia> arcade_game_list;
 	std::mutex mutex;
 	std::mutex threadMutex;
 	std::unique_ptr<std::thread> scan_thread;
-	bool scan_done = false;
-	bool running = false;
+	std::atomic<bool> scan_done {};
+	std::atomic<bool> running {};
+	std::atomic<bool> dirty {};
+	bool progressive = false;
 	std::unordered_map<std::string, const Game*> arcade_games;
 	std::unordered_set<std::string> arcade_gdroms;
+	GameScanIndex index;
+	bool indexLoaded = false;
+	std::string indexPath;
+	std::unique_ptr<DirectoryWatcher> watcher;
 	using LockGuard = std::lock_guard<std::mutex>;
 
-	void insert_game(const GameMedia& game);
-	void insert_arcade_game(const GameMedia& game);
-	void add_game_directory(const std::string& path);
+	void insert_games(std::vector<GameMedia>& list, std::vector<GameMedia> games);
+	void add_game_file(const GameScanIndex::File& file, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames);
+	void scan_directories(GameScanIndex& newIndex, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames);
+	bool scan_directory(const std::string& path, GameScanIndex::Directory& dir);
+	std::string get_index_path() const {
+		return indexPath.empty() ? get_writable_data_path("gamelist-index.json") : indexPath;
+	}
 
 public:
-	~GameScanner()
-	{
-		stop();
-	}
+	GameScanner();
+	~GameScanner();
 	void refresh()
 	{
 		stop();
@@ -65,6 +97,22 @@ public:
 
 	void stop();
 	void fetch_game_list();
+	// Wait for the current scan to complete
+	void wait();
+	// Use another index file. The default is gamelist-index.json in the data directory.
+	void setIndexPath(const std::string& path)
+	{
+		stop();
+		indexPath = path;
+		indexLoaded = false;
+	}
+
+	struct {
+		u32 directories;
+		u32 cachedDirectories;
+		u32 files;
+		u64 time;	// ms
+	} stats {};
 
 	std::mutex& get_mutex() { return mutex; }
 	const std::vector<GameMedia>& get_game_list() { return game_list; }
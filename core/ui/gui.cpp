@@ -44,6 +44,7 @@
 #endif
 #include "boxart/boxart.h"
 #include "profiler/fc_profiler.h"
+#include "profiler/frame_tracer.h"
 #include "hw/naomi/card_reader.h"
 #include "oslib/resources.h"
 #include "achievements/achievements.h"
@@ -53,6 +54,12 @@
 #include <stb_image_write.h>
 #include "hw/pvr/Renderer_if.h"
 #include "hw/mem/addrspace.h"
+#include "rend/pixel_buffer_sizer.h"
+#include "rend/texture_upscaler.h"
+#include "hw/pvr/frame_pacer.h"
+#include "hw/pvr/elan.h"
+#include "hw/pvr/ta_capture.h"
+#include "runahead.h"
 #if defined(USE_SDL)
 #include "sdl/sdl.h"
 #include "sdl/dreamlink.h"
@@ -1648,6 +1655,9 @@ static void gui_debug_tab()
 		ImGui::InputText("Log Server", &config::LogServer.get(), ImGuiInputTextFlags_CharsNoBlank, nullptr, nullptr);
         ImGui::SameLine();
         ShowHelpMarker("Log to this hostname[:port] with UDP. Default port is 31667.");
+		OptionCheckbox("Asynchronous Logging", config::LogAsync,
+				"Write warning, info and debug messages from a background thread. "
+				"Messages may be dropped if too many are logged.");
 	}
 #if FC_PROFILER
 	ImGui::Spacing();
@@ -2347,6 +2357,19 @@ static void gui_settings_video()
 	    	ImGui::Unindent();
     	}
 #endif
+    	OptionCheckbox("Frame Pacing", config::FramePacing,
+    			"Emulate each frame at a steady rate based on the emulated refresh rate instead of waiting for audio. "
+    			"Reduces stuttering when the display refresh rate differs from the game's (59.94 Hz content on a 60 Hz display for example)");
+    	ImGui::Indent();
+    	{
+    		DisabledScope scope(!config::FramePacing || config::ThreadedRendering);
+    		OptionCheckbox("Late Input Polling", config::LateLatchInput,
+    				"Read inputs right before emulating each frame to reduce input lag. Requires Frame Pacing and single-threaded emulation");
+    	}
+    	ImGui::Unindent();
+    	OptionSlider("Run-Ahead", config::RunAhead, 0, 4,
+    			"Number of frames emulated ahead of the displayed one to hide the game input lag. "
+    			"Each frame costs a full frame of emulation. Disabled in netplay");
     	OptionCheckbox("Show VMU In-game", config::FloatVMUs, "Show the VMU LCD screens while in-game");
     	OptionCheckbox("Full Framebuffer Emulation", config::EmulateFramebuffer,
     			"Fully accurate VRAM framebuffer emulation. Helps games that directly access the framebuffer for special effects. "
@@ -2419,7 +2442,7 @@ static void gui_settings_video()
 
         ImGui::Text("Pixel Buffer Size");
         ImGui::SameLine();
-        ShowHelpMarker("The size of the pixel buffer. May need to be increased when upscaling by a large factor.");
+        ShowHelpMarker("The maximum size of the pixel buffer. The buffer is resized as needed up to this size. May need to be increased when upscaling by a large factor.");
 
         OptionSlider("Maximum Layers", config::PerPixelLayers, 8, 128,
         		"Maximum number of transparent layers. May need to be increased for some complex scenes. Decreasing it may improve performance.");
@@ -2588,6 +2611,9 @@ static void gui_settings_audio()
 		ImGui::SameLine();
 		ShowHelpMarker("Sets the maximum audio latency. Not supported by all audio drivers.");
     }
+	OptionCheckbox("Dynamic Rate Control", config::AudioRateControl,
+			"Slightly adjust the audio rate to keep the audio buffer half full instead of waiting for audio. "
+			"Requires VSync. Not supported by all audio drivers.");
 
 	AudioBackend *backend = nullptr;
 	std::string backend_name = config::AudioBackend;
@@ -2832,6 +2858,11 @@ static void gui_settings_advanced()
 		OptionRadioButton("Interpreter", config::DynarecEnabled, false,
 			"Use the interpreter. Very slow but may help in case of a dynarec problem");
 		ImGui::Columns(1, NULL, false);
+		{
+			DisabledScope _{config::DynarecEnabled};
+			OptionCheckbox("Cached Interpreter", config::CachedInterpreter,
+					"Decode instructions once and cache them. Faster than the plain interpreter");
+		}
 
 		OptionSlider("SH4 Clock", config::Sh4Clock, 100, 300,
 				"Over/Underclock the main SH4 CPU. Default is 200 MHz. Other values may crash, freeze or trigger unexpected nuclear reactions.",
@@ -2898,6 +2929,35 @@ static void gui_settings_advanced()
 		}
         OptionCheckbox("Dump Textures", config::DumpTextures,
         		"Dump all textures into data/texdump/<game id>");
+        OptionCheckbox("Frame Tracer", config::FrameTracer,
+        		"Record a timeline of the last frames. Use Save Trace to write it to flycast_trace.json");
+        {
+        	DisabledScope scope(!config::FrameTracer || !game_started);
+        	if (ImGui::Button("Save Trace"))
+        	{
+        		std::string path = get_writable_data_path("flycast_trace.json");
+        		if (tracer::save(path))
+        			os_notify("Trace saved", 2000, path.c_str());
+        		else
+        			os_notify("Trace not saved", 2000);
+        	}
+        	ImGui::SameLine();
+        	ShowHelpMarker("Save the last 120 frames in the Chrome trace format. Open it with https://ui.perfetto.dev");
+        }
+        {
+        	DisabledScope scope(!game_started || !settings.platform.isNaomi2());
+        	if (ImGui::Button("Capture Elan Frame"))
+        		elan::startCapture(get_writable_data_path("flycast_elan.bin"));
+        	ImGui::SameLine();
+        	ShowHelpMarker("Save the Naomi 2 geometry commands of the next frame to flycast_elan.bin. Used by the Elan replay benchmark");
+        }
+        {
+        	DisabledScope scope(!game_started || settings.platform.isNaomi2());
+        	if (ImGui::Button("Capture TA Frame"))
+        		tacapture::start(get_writable_data_path("flycast_ta_frame.bin"));
+        	ImGui::SameLine();
+        	ShowHelpMarker("Save the display lists, registers and video memory of the next frame to flycast_ta_frame.bin. Used by the TA replay benchmark");
+        }
         bool logToFile = cfgLoadBool("log", "LogToFile", false);
 		if (ImGui::Checkbox("Log to File", &logToFile))
 			cfgSaveBool("log", "LogToFile", logToFile);
@@ -3694,6 +3754,10 @@ void gui_display_ui()
 static u64 LastFPSTime;
 static int lastFrameCount = 0;
 static float fps = -1;
+static u32 peakFragments;
+static FramePacer::Stats frameStats;
+static runahead::Stats runAheadStats;
+static TextureUpscaler::Stats upscalerStats;
 
 static std::string getFPSNotification()
 {
@@ -3704,10 +3768,38 @@ static std::string getFPSNotification()
 			fps = ((float)MainFrameCount - lastFrameCount) * 1000.f / (now - LastFPSTime);
 			LastFPSTime = now;
 			lastFrameCount = MainFrameCount;
+			peakFragments = pixelBufferStats.peakFragments.exchange(0);
+			frameStats = framePacer.getStats();
+			framePacer.resetStats();
+			runAheadStats = runahead::getStats();
+			upscalerStats = texture_upscaler.getStats();
+			texture_upscaler.resetStats();
 		}
 		if (fps >= 0.f && fps < 9999.f) {
-			char text[32];
-			snprintf(text, sizeof(text), "F:%4.1f%s", fps, settings.input.fastForwardMode ? " >>" : "");
+			char text[128];
+			float fill;
+			u32 underruns;
+			int len;
+			if (GetAudioBufferState(fill, underruns))
+				len = snprintf(text, sizeof(text), "F:%4.1f A:%3d%% U:%u", fps, (int)(fill * 100.f), underruns);
+			else
+				len = snprintf(text, sizeof(text), "F:%4.1f", fps);
+			// Per-pixel renderers: peak fragments per frame / pixel buffer capacity, in millions
+			const u64 bufferSize = pixelBufferStats.bufferSize;
+			if (bufferSize != 0)
+				len += snprintf(text + len, sizeof(text) - len, " P:%.1f/%.1fM", peakFragments / 1e6f,
+						bufferSize / PixelBufferSizer::FragmentSize / 1e6f);
+			// Frame pacing: emulated frame time standard deviation in ms and late frames
+			if (config::FramePacing && frameStats.frames != 0)
+				len += snprintf(text + len, sizeof(text) - len, " J:%.2f L:%u", frameStats.stdDevMs, frameStats.lateFrames);
+			// Run-ahead: extra emulation time per displayed frame in ms
+			if (runAheadStats.frames != 0)
+				len += snprintf(text + len, sizeof(text) - len, " R:+%.1f", runAheadStats.extraMs);
+			// Texture upscaling: pending jobs and disk cache hit rate
+			if (config::TextureUpscale > 1 && (upscalerStats.pending != 0 || upscalerStats.completed != 0))
+				len += snprintf(text + len, sizeof(text) - len, " X:%u %d%%", upscalerStats.pending,
+						upscalerStats.completed == 0 ? 0 : (int)(upscalerStats.cacheHits * 100 / upscalerStats.completed));
+			snprintf(text + len, sizeof(text) - len, "%s", settings.input.fastForwardMode ? " >>" : "");
 
 			return std::string(text);
 		}
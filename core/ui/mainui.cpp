@@ -19,6 +19,7 @@
 
 #include "mainui.h"
 #include "hw/pvr/Renderer_if.h"
+#include "hw/pvr/frame_pacer.h"
 #include "gui.h"
 #include "oslib/oslib.h"
 #include "wsi/context.h"
@@ -90,11 +91,15 @@ void mainui_loop(bool forceStart)
 	{
 		fc_profiler::startThread("main");
 
-		mainui_rend_frame();
+		const bool rendered = mainui_rend_frame() && !gui_is_open();
 		if (imguiDriver == nullptr)
 			forceReinit = true;
 		else
+		{
 			imguiDriver->present();
+			if (rendered)
+				framePacer.presented();
+		}
 
 		if (config::RendererType != currentRenderer || forceReinit)
 		{
@@ -0,0 +1,102 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//
+// Bounded lock-free byte queue with a single producer and a single consumer thread.
+// Reads and writes are partial: they transfer as many bytes as possible and return the count.
+//
+template<size_t Capacity>
+class ByteRing
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+	// Producer side
+	size_t write(const uint8_t *data, size_t len)
+	{
+		const size_t wc = writeCursor.load(std::memory_order_relaxed);
+		len = std::min(len, Capacity - (wc - readCursor.load(std::memory_order_acquire)));
+		const size_t idx = wc & (Capacity - 1);
+		const size_t chunk = std::min(len, Capacity - idx);
+		memcpy(&buffer[idx], data, chunk);
+		memcpy(&buffer[0], data + chunk, len - chunk);
+		writeCursor.store(wc + len, std::memory_order_release);
+		return len;
+	}
+
+	bool push(uint8_t b) {
+		return write(&b, 1) == 1;
+	}
+
+	// Consumer side
+	size_t read(uint8_t *data, size_t len)
+	{
+		const size_t rc = readCursor.load(std::memory_order_relaxed);
+		len = std::min(len, writeCursor.load(std::memory_order_acquire) - rc);
+		const size_t idx = rc & (Capacity - 1);
+		const size_t chunk = std::min(len, Capacity - idx);
+		memcpy(data, &buffer[idx], chunk);
+		memcpy(data + chunk, &buffer[0], len - chunk);
+		readCursor.store(rc + len, std::memory_order_release);
+		return len;
+	}
+
+	// Returns -1 if empty
+	int pop()
+	{
+		uint8_t b;
+		if (read(&b, 1) == 0)
+			return -1;
+		return b;
+	}
+
+	// Can be called by both sides
+	size_t size() const
+	{
+		// read cursor first so that it can't be ahead of the write cursor
+		const size_t rc = readCursor.load(std::memory_order_acquire);
+		return writeCursor.load(std::memory_order_acquire) - rc;
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	static constexpr size_t capacity() {
+		return Capacity;
+	}
+
+	// Must not be called while the producer or consumer is running
+	void clear()
+	{
+		readCursor = 0;
+		writeCursor = 0;
+	}
+
+private:
+	std::array<uint8_t, Capacity> buffer;
+	// Free-running cursors. Kept on separate cache lines to avoid false sharing.
+	alignas(64) std::atomic<size_t> readCursor { 0 };
+	alignas(64) std::atomic<size_t> writeCursor { 0 };
+};
@@ -0,0 +1,200 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include "oslib/oslib.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Fixed pool of threads running parallel loops.
+// The tasks of a loop are split evenly between the threads. Each thread runs its own tasks in order
+// and, once done, steals the remaining tasks of the other threads starting from the end.
+//
+class TaskPool
+{
+public:
+	using Function = std::function<void(int task, int thread)>;
+
+	// threadCount includes the calling thread. 0 uses all the host cpus.
+	TaskPool(const char *name, int threadCount = 0) : name(name)
+	{
+		if (threadCount <= 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		queues = std::make_unique<Queue[]>(threadCount);
+		this->threadCount = threadCount;
+	}
+	~TaskPool() {
+		stop();
+	}
+
+	int size() const {
+		return threadCount;
+	}
+
+	// Run func for each task in [0, count) and wait for completion.
+	// The calling thread is thread 0. Must not be called concurrently or recursively.
+	void parallelFor(int count, const Function& func)
+	{
+		if (count <= 0)
+			return;
+		if (threadCount == 1 || count == 1)
+		{
+			for (int i = 0; i < count; i++)
+				func(i, 0);
+			return;
+		}
+		start();
+		for (int i = 0; i < threadCount; i++)
+		{
+			const u32 begin = (u64)count * i / threadCount;
+			const u32 end = (u64)count * (i + 1) / threadCount;
+			queues[i].range = makeRange(begin, end);
+		}
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			function = &func;
+			pending = threadCount - 1;
+			generation++;
+		}
+		startCond.notify_all();
+
+		runTasks(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCond.wait(lock, [this]() { return pending == 0; });
+		function = nullptr;
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			exiting = true;
+		}
+		startCond.notify_all();
+		for (std::thread& thread : threads)
+			thread.join();
+		threads.clear();
+		exiting = false;
+	}
+
+private:
+	struct alignas(64) Queue {
+		// begin in the low word, end in the high word
+		std::atomic<u64> range { 0 };
+	};
+
+	static u64 makeRange(u32 begin, u32 end) {
+		return begin | ((u64)end << 32);
+	}
+
+	void start()
+	{
+		if (!threads.empty())
+			return;
+		for (int i = 1; i < threadCount; i++)
+			threads.emplace_back(&TaskPool::threadLoop, this, i);
+	}
+
+	void threadLoop(int index)
+	{
+		ThreadName _(name);
+		u64 lastGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				startCond.wait(lock, [&]() { return exiting || generation != lastGeneration; });
+				if (exiting)
+					break;
+				lastGeneration = generation;
+			}
+			runTasks(index);
+			bool done;
+			{
+				std::lock_guard<std::mutex> _(mutex);
+				done = --pending == 0;
+			}
+			if (done)
+				doneCond.notify_one();
+		}
+	}
+
+	void runTasks(int index)
+	{
+		const Function& func = *function;
+		int task;
+		while ((task = popFront(queues[index])) >= 0)
+			func(task, index);
+		// Steal from the other threads, starting with the next one
+		for (int i = 1; i < threadCount; i++)
+		{
+			Queue& victim = queues[(index + i) % threadCount];
+			while ((task = popBack(victim)) >= 0)
+				func(task, index);
+		}
+	}
+
+	static int popFront(Queue& queue)
+	{
+		u64 range = queue.range.load(std::memory_order_relaxed);
+		while (true)
+		{
+			const u32 begin = (u32)range;
+			const u32 end = range >> 32;
+			if (begin >= end)
+				return -1;
+			if (queue.range.compare_exchange_weak(range, makeRange(begin + 1, end), std::memory_order_acquire))
+				return begin;
+		}
+	}
+
+	static int popBack(Queue& queue)
+	{
+		u64 range = queue.range.load(std::memory_order_relaxed);
+		while (true)
+		{
+			const u32 begin = (u32)range;
+			const u32 end = range >> 32;
+			if (begin >= end)
+				return -1;
+			if (queue.range.compare_exchange_weak(range, makeRange(begin, end - 1), std::memory_order_acquire))
+				return end - 1;
+		}
+	}
+
+	const char * const name;
+	int threadCount;
+	std::unique_ptr<Queue[]> queues;
+	std::vector<std::thread> threads;
+	const Function *function = nullptr;
+	std::mutex mutex;
+	std::condition_variable startCond;
+	std::condition_variable doneCond;
+	u64 generation = 0;
+	int pending = 0;
+	bool exiting = false;
+};
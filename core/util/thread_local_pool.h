@@ -0,0 +1,114 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//
+// Per-thread objects written by their owner thread and read by other threads.
+// Objects are never freed since other threads may keep a pointer to them.
+// When a thread exits, its object is released and reused by the next thread that needs one.
+// A thread has at most one object per type T, so there should be only one pool per type.
+//
+template<typename T>
+class ThreadLocalPool
+{
+public:
+	// Returns the object of the calling thread, reusing a released one or creating a new one if needed.
+	// When the thread gets its object, onAcquire(T&, bool created) is called with the pool locked.
+	template<typename Func>
+	T *get(Func&& onAcquire)
+	{
+		Holder& holder = threadHolder();
+		if (holder.entry == nullptr)
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			bool created = false;
+			for (Entry *entry : entries)
+				if (!entry->inUse)
+				{
+					holder.entry = entry;
+					break;
+				}
+			if (holder.entry == nullptr)
+			{
+				holder.entry = new Entry();
+				entries.push_back(holder.entry);
+				created = true;
+			}
+			holder.entry->inUse = true;
+			onAcquire(holder.entry->object, created);
+		}
+		return &holder.entry->object;
+	}
+
+	T *get() {
+		return get([](T&, bool) {});
+	}
+
+	// Returns the object of the calling thread, or nullptr if it doesn't have one yet
+	T *current() const
+	{
+		Entry *entry = threadHolder().entry;
+		return entry != nullptr ? &entry->object : nullptr;
+	}
+
+	// Returns all objects, including released ones
+	std::vector<T *> objects()
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		std::vector<T *> v;
+		v.reserve(entries.size());
+		for (Entry *entry : entries)
+			v.push_back(&entry->object);
+		return v;
+	}
+
+	// Locks the pool so that objects aren't acquired meanwhile
+	std::unique_lock<std::mutex> lock() {
+		return std::unique_lock<std::mutex>(mutex);
+	}
+
+private:
+	struct Entry
+	{
+		T object;
+		std::atomic<bool> inUse { false };
+	};
+
+	struct Holder
+	{
+		Entry *entry = nullptr;
+
+		~Holder() {
+			if (entry != nullptr)
+				entry->inUse = false;
+		}
+	};
+
+	static Holder& threadHolder()
+	{
+		static thread_local Holder holder;
+		return holder;
+	}
+
+	std::mutex mutex;
+	std::vector<Entry *> entries;
+};
@@ -136,7 +136,7 @@ static LONG WINAPI exceptionHandler(EXCEPTION_POINTERS *ep)
 	// texture protection in VRAM
 	if (VramLockedWrite(address))
 		return EXCEPTION_CONTINUE_EXECUTION;
-#if FEAT_SHREC == DYNAREC_JIT
+#if FEAT_SHREC != DYNAREC_NONE
 	// FPCB jump table protection
 	if (addrspace::bm_lockedWrite(address))
 		return EXCEPTION_CONTINUE_EXECUTION;
@@ -0,0 +1,79 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "headless.h"
+#include "ui/imgui_driver.h"
+
+HeadlessContext theHeadlessContext;
+
+// ImGui driver that draws nothing
+class HeadlessDriver final : public ImGuiDriver
+{
+public:
+	void newFrame() override {
+		// ImGui requires a built font atlas
+		unsigned char *pixels;
+		int width, height;
+		ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+
+	void renderDrawData(ImDrawData *drawData, bool gui_open) override {
+	}
+
+	void present() override {
+	}
+
+	ImTextureID getTexture(const std::string& name) override {
+		auto it = textures.find(name);
+		if (it != textures.end())
+			return it->second;
+		else
+			return ImTextureID{};
+	}
+
+	ImTextureID updateTexture(const std::string& name, const u8 *data, int width, int height, bool nearestSampling) override
+	{
+		ImTextureID& id = textures[name];
+		if (id == ImTextureID{})
+			id = (ImTextureID)(uintptr_t)++lastId;
+		return id;
+	}
+
+	void deleteTexture(const std::string& name) override {
+		textures.erase(name);
+	}
+
+private:
+	std::unordered_map<std::string, ImTextureID> textures;
+	uintptr_t lastId = 0;
+};
+
+bool HeadlessContext::init()
+{
+	instance = this;
+	imguiDriver = std::unique_ptr<ImGuiDriver>(new HeadlessDriver());
+	NOTICE_LOG(RENDERER, "Headless context initialized");
+
+	return true;
+}
+
+void HeadlessContext::term()
+{
+	imguiDriver.reset();
+	instance = nullptr;
+}
@@ -0,0 +1,41 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "context.h"
+
+// Graphics context of headless (USE_HEADLESS) builds.
+// Frames are rendered in software and are only available as screenshots.
+class HeadlessContext : public GraphicsContext
+{
+public:
+	bool init();
+	void term() override;
+
+	std::string getDriverName() override {
+		return "Software";
+	}
+	std::string getDriverVersion() override {
+		return "";
+	}
+	bool isAMD() override {
+		return false;
+	}
+};
+
+extern HeadlessContext theHeadlessContext;
@@ -22,9 +22,14 @@
 #include "context.h"
 #include "cfg/option.h"
 
+#ifdef USE_OPENGL
 #include "gl_context.h"
+#endif
 #include "rend/dx9/dxcontext.h"
 #include "rend/dx11/dx11context.h"
+#ifdef NO_REND
+#include "headless.h"
+#endif
 #ifdef USE_VULKAN
 #include "rend/vulkan/vulkan_context.h"
 
@@ -86,6 +91,12 @@ void initRenderApi(void *window, void *display)
 		if (theDX11Context.init())
 			return;
 	}
+#endif
+#ifdef NO_REND
+	config::RendererType = RenderType::Software;
+	theHeadlessContext.setWindow(window, display);
+	if (theHeadlessContext.init())
+		return;
 #endif
 	die("Cannot initialize the graphics API");
 }
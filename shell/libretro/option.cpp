@@ -24,6 +24,7 @@ namespace config {
 // Dynarec
 
 Option<bool> DynarecEnabled("", true);
+Option<bool> CachedInterpreter("", true);
 IntOption Sh4Clock(CORE_OPTION_NAME "_sh4clock", 200);
 
 // General
@@ -36,6 +37,7 @@ Option<bool> AutoLoadState("");
 Option<bool> AutoSaveState("");
 Option<int, false> SavestateSlot("");
 Option<bool> ForceFreePlay(CORE_OPTION_NAME "_force_freeplay", true);
+Option<int> RunAhead("");	// Done by the frontend
 
 // Sound
 
@@ -46,6 +48,7 @@ Option<int> AudioBufferSize("", 5644);	// 128 ms
 Option<int> AudioBufferSize("", 2822);	// 64 ms
 #endif
 Option<bool> AutoLatency("");
+Option<bool> AudioRateControl("");
 
 OptionString AudioBackend("", "auto");
 Option<bool> VmuSound(CORE_OPTION_NAME "_vmu_sound", false);
@@ -84,6 +87,8 @@ Option<int> AutoSkipFrame(CORE_OPTION_NAME "_auto_skip_frame", 0);
 Option<int> RenderResolution("", 480);
 Option<bool> VSync("", true);
 Option<bool> ThreadedRendering(CORE_OPTION_NAME "_threaded_rendering", true);
+Option<bool> FramePacing("");
+Option<bool> LateLatchInput("");
 Option<int> AnisotropicFiltering(CORE_OPTION_NAME "_anisotropic_filtering");
 Option<int> TextureFiltering(CORE_OPTION_NAME "_texture_filtering");
 Option<bool> PowerVR2Filter(CORE_OPTION_NAME "_pvr2_filtering");
@@ -100,6 +105,7 @@ Option<bool> SerialPTY("");
 Option<bool> UseReios(CORE_OPTION_NAME "_hle_bios");
 
 Option<bool> OpenGlChecks("", false);
+Option<bool> FrameTracer("");
 Option<bool> FastGDRomLoad(CORE_OPTION_NAME "_gdrom_fast_loading", false);
 Option<bool> RamMod32MB(CORE_OPTION_NAME "_dc_32mb_mod", false);
 
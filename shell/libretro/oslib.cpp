@@ -150,6 +150,12 @@ std::string getTextureDumpPath()
 			+ "texdump" + std::string(path_default_slash());
 }
 
+std::string getTextureCachePath()
+{
+	return std::string(game_dir_no_slash) + std::string(path_default_slash())
+			+ "texcache" + std::string(path_default_slash());
+}
+
 std::string getScreenshotsPath()
 {
 	// Unfortunately retroarch doesn't expose its "screenshots" path
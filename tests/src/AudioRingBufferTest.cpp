@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+#include "audio/audiostream.h"
+#include <future>
+
+class AudioRingBufferTest : public ::testing::Test
+{
+};
+
+TEST_F(AudioRingBufferTest, Basic)
+{
+	RingBuffer ring;
+	u8 data[8] { 1, 2, 3, 4, 5, 6, 7, 8 };
+	u8 out[8] {};
+	ASSERT_FALSE(ring.write(data, 1));
+	ASSERT_EQ(0u, ring.capacity());
+
+	ring.setCapacity(8);
+	ASSERT_EQ(7u, ring.capacity());
+	ASSERT_EQ(0u, ring.size());
+	ASSERT_FALSE(ring.write(data, 8));
+	ASSERT_TRUE(ring.write(data, 5));
+	ASSERT_EQ(5u, ring.size());
+	ASSERT_FALSE(ring.read(out, 6));
+	ASSERT_TRUE(ring.read(out, 4));
+	ASSERT_EQ(0, memcmp(data, out, 4));
+	ASSERT_EQ(1u, ring.size());
+	// wrap around
+	ASSERT_TRUE(ring.write(data, 6));
+	ASSERT_EQ(7u, ring.size());
+	ASSERT_FALSE(ring.write(data, 1));
+	ASSERT_TRUE(ring.read(out, 7));
+	ASSERT_EQ(5, out[0]);
+	ASSERT_EQ(0, memcmp(data, &out[1], 6));
+	ASSERT_EQ(0u, ring.size());
+}
+
+TEST_F(AudioRingBufferTest, MultiThread)
+{
+	RingBuffer ring;
+	ring.setCapacity(SAMPLE_COUNT * 4 * 3 + 1);
+	constexpr u32 Chunks = 200;
+	std::future<bool> consumer = std::async(std::launch::async, [&]() {
+		u32 frames[SAMPLE_COUNT / 2];
+		u32 next = 0;
+		while (next < Chunks * SAMPLE_COUNT)
+		{
+			if (!ring.read((u8 *)frames, sizeof(frames)))
+				continue;
+			for (u32 frame : frames)
+				if (frame != next++)
+					return false;
+		}
+		return true;
+	});
+	u32 frames[SAMPLE_COUNT];
+	u32 next = 0;
+	for (u32 i = 0; i < Chunks; i++)
+	{
+		for (u32& frame : frames)
+			frame = next++;
+		while (!ring.write((const u8 *)frames, sizeof(frames)))
+			;
+	}
+	ASSERT_TRUE(consumer.get());
+	ASSERT_EQ(0u, ring.size());
+}
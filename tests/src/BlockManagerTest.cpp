@@ -0,0 +1,237 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/sh4/dyna/ngen.h"
+#include "hw/mem/addrspace.h"
+#include "oslib/oslib.h"
+
+#if FEAT_SHREC != DYNAREC_NONE
+class BlockManagerTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 PAGE_ADDR = 0x8C010000;
+	static constexpr u32 ChainLength = 1024;
+	static constexpr u32 ChainBlockSize = 64;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		emu.dc_reset(true);
+		os_InstallFaultHandler();
+		ctx = &p_sh4rcb->cntx;
+		schedId = sh4_sched_register(0, &stopCallback, this);
+		recompiler = Sh4Recompiler::Instance;
+		ASSERT_NE(nullptr, recompiler);
+		// start from an empty cache with all pages unlocked
+		recompiler->Reset(true);
+	}
+	void TearDown() override
+	{
+		recompiler->Reset(true);
+		sh4_sched_unregister(schedId);
+		os_UninstallFaultHandler();
+	}
+
+	static int stopCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		BlockManagerTest *test = (BlockManagerTest *)arg;
+		if (test->ctx->pc != test->stopPc)
+			return 100000;
+		test->recompiler->Stop();
+		return 0;
+	}
+
+	// Writes: mov #imm, rn; bra .; nop
+	void writeMovImm(u32 addr, u32 reg, u8 imm)
+	{
+		addrspace::write16(addr, 0xE000 | (reg << 8) | imm);
+		addrspace::write16(addr + 2, 0xAFFE);
+		addrspace::write16(addr + 4, 0x0009);
+	}
+
+	// Writes and runs a chain of ChainLength blocks jumping to each other, the last one ending with an infinite loop.
+	// Returns the address following the chain.
+	u32 runChain(u32 addr)
+	{
+		const u32 start = addr;
+		for (u32 i = 0; i < ChainLength; i++, addr += ChainBlockSize)
+		{
+			for (u32 j = 0; j < 30; j += 2)
+			{
+				addrspace::write16(addr + j * 2, 0x301C);		// add r1, r0
+				addrspace::write16(addr + j * 2 + 2, 0x220A);	// xor r0, r2
+			}
+			addrspace::write16(addr + 60, i == ChainLength - 1 ? 0xAFFE : 0xA000);	// bra . / bra next
+			addrspace::write16(addr + 62, 0x0009);	// nop
+		}
+		run(start, addr - 4 - start);
+		return addr;
+	}
+
+	// Runs until the final infinite loop
+	void run(u32 pc, u32 loopOffset = 2)
+	{
+		stopPc = pc + loopOffset;
+		ctx->pc = pc;
+		sh4_sched_request(schedId, 100000);
+		recompiler->Start();
+		recompiler->Run();
+	}
+
+	Sh4Context *ctx = nullptr;
+	Sh4Recompiler *recompiler = nullptr;
+	int schedId = -1;
+	u32 stopPc = 0;
+};
+
+// Host writes only discard the blocks they overlap and keep the page protected
+TEST_F(BlockManagerTest, HostWrite)
+{
+	writeMovImm(PAGE_ADDR, 0, 1);
+	writeMovImm(PAGE_ADDR + 0x800, 1, 2);
+	run(PAGE_ADDR);
+	run(PAGE_ADDR + 0x800);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_EQ(2u, ctx->r[1]);
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR) != nullptr);
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR + 0x800) != nullptr);
+
+	const u16 code[] {
+		0xE103,	// mov #3, r1
+		0xAFFE,	// bra .
+	};
+	WriteMemBlock_nommu_ptr(PAGE_ADDR + 0x800, (const u32 *)code, sizeof(code));
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR) != nullptr);
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR + 0x800) == nullptr);
+	ASSERT_TRUE(bm_IsRamPageProtected(PAGE_ADDR));
+
+	run(PAGE_ADDR + 0x800);
+	ASSERT_EQ(3u, ctx->r[1]);
+	run(PAGE_ADDR);
+	ASSERT_EQ(1u, ctx->r[0]);
+}
+
+// A page with code and data being written to is unprotected, and code changes only discard the modified blocks
+TEST_F(BlockManagerTest, CodeAndData)
+{
+	const u16 code[] {
+		0x2452,	// mov.l r5, @r4
+		0xE001,	// mov #1, r0
+		0xAFFE,	// bra .
+		0x0009,	// nop
+	};
+	for (u32 i = 0; i < std::size(code); i++)
+		addrspace::write16(PAGE_ADDR + i * 2, code[i]);
+	writeMovImm(PAGE_ADDR + 0x400, 1, 3);
+	run(PAGE_ADDR + 0x400);
+	ASSERT_EQ(3u, ctx->r[1]);
+	ASSERT_TRUE(bm_IsRamPageProtected(PAGE_ADDR));
+
+	bm_Periodical_1s();
+	ctx->r[4] = PAGE_ADDR + 0x800;
+	ctx->r[5] = 0x12345678;
+	run(PAGE_ADDR, 4);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_EQ(0x12345678u, addrspace::read32(PAGE_ADDR + 0x800));
+	ASSERT_FALSE(bm_IsRamPageProtected(PAGE_ADDR));
+	bm_Periodical_1s();
+	// all the blocks in the page
+	ASSERT_EQ(3u, bm_GetDiscardRate());
+
+	// Blocks are now checked
+	run(PAGE_ADDR + 0x400);
+	ASSERT_EQ(3u, ctx->r[1]);
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR + 0x400) != nullptr);
+	addrspace::write16(PAGE_ADDR + 0x400, 0xE104);	// mov #4, r1
+	run(PAGE_ADDR + 0x400);
+	ASSERT_EQ(4u, ctx->r[1]);
+	// Other blocks are kept
+	ASSERT_TRUE(bm_GetBlock(PAGE_ADDR + 4) != nullptr);
+}
+
+// Code overwritten by the cpu is discarded but the page can be protected again
+TEST_F(BlockManagerTest, CodeWrite)
+{
+	const u32 target = PAGE_ADDR + 0x2000;
+	writeMovImm(target, 0, 1);
+	run(target);
+	ASSERT_EQ(1u, ctx->r[0]);
+
+	const u32 pc = PAGE_ADDR + 0x4000;
+	addrspace::write16(pc, 0x2451);		// mov.w r5, @r4
+	addrspace::write16(pc + 2, 0xAFFE);	// bra .
+	addrspace::write16(pc + 4, 0x0009);	// nop
+	ctx->r[4] = target;
+	ctx->r[5] = 0xE005;					// mov #5, r0
+	run(pc);
+	ASSERT_TRUE(bm_GetBlock(target) == nullptr);
+	ASSERT_TRUE(bm_IsRamPageProtected(target));
+
+	run(target);
+	ASSERT_EQ(5u, ctx->r[0]);
+	ASSERT_TRUE(bm_GetBlock(target) != nullptr);
+}
+
+// When the code cache is full, only its oldest region is evicted and the blocks linked to it are unlinked
+TEST_F(BlockManagerTest, CodeRegionEviction)
+{
+	const u32 target = PAGE_ADDR;
+	writeMovImm(target, 0, 1);
+	run(target);
+	RuntimeBlockInfoPtr targetBlock = bm_GetBlock(target);
+	ASSERT_TRUE(targetBlock != nullptr);
+
+	// Fill the first region of the cache (the 10 MB cache has 8 regions)
+	u32 addr = 0x8C100000;
+	RuntimeBlockInfoPtr keptBlock;
+	do {
+		addr = runChain(addr);
+		keptBlock = bm_GetBlock(addr - ChainBlockSize);
+		ASSERT_TRUE(keptBlock != nullptr);
+	} while ((u8 *)keptBlock->code - (u8 *)targetBlock->code < (ptrdiff_t)2_MB);
+
+	// Block in another region jumping to the target
+	const u32 link = PAGE_ADDR + 0x100;
+	addrspace::write16(link, 0xE102);		// mov #2, r1
+	addrspace::write16(link + 2, 0xAF7D);	// bra target
+	addrspace::write16(link + 4, 0x0009);	// nop
+	ctx->r[0] = 0;
+	run(link, target + 2 - link);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_EQ(2u, ctx->r[1]);
+	RuntimeBlockInfoPtr linkBlock = bm_GetBlock(link);
+	ASSERT_TRUE(linkBlock != nullptr);
+	// Only some dynarecs link blocks
+	const bool linked = linkBlock->pBranchBlock == targetBlock.get();
+
+	// Fill the cache until the first region is evicted
+	while (bm_GetBlock(target) != nullptr)
+	{
+		ASSERT_LT(addr, 0x8CF00000u);
+		addr = runChain(addr);
+	}
+	ASSERT_TRUE(targetBlock->pre_refs.empty());
+	ASSERT_TRUE(linkBlock->pBranchBlock == nullptr);
+	// Blocks in other regions are kept
+	ASSERT_EQ(linkBlock, bm_GetBlock(link));
+	ASSERT_EQ(keptBlock, bm_GetBlock(keptBlock->addr));
+
+	// The target is compiled again
+	ctx->r[0] = 0;
+	ctx->r[1] = 0;
+	run(link, target + 2 - link);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_EQ(2u, ctx->r[1]);
+	ASSERT_TRUE(bm_GetBlock(target) != nullptr);
+	if (linked) {
+		ASSERT_EQ(bm_GetBlock(target).get(), linkBlock->pBranchBlock);
+	}
+}
+#endif
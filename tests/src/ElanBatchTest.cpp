@@ -0,0 +1,211 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "build.h"
+#include "hw/pvr/elan_batch.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/elan_struct.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace elan;
+
+class ElanBatchTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		std::mt19937 gen(42);
+		std::uniform_real_distribution<float> pos(-100.f, 100.f);
+		for (auto& v : vertices)
+		{
+			v.vtx.header.full = gen();
+			v.vtx.x = pos(gen);
+			v.vtx.y = pos(gen);
+			v.vtx.z = pos(gen);
+			v.rgb.argb0 = gen();
+			v.rgb.argb1 = gen();
+		}
+		// special values
+		vertices[2].vtx.x = 0.f;
+		vertices[3].vtx.x = -0.f;
+		vertices[5].vtx.y = std::numeric_limits<float>::quiet_NaN();
+		vertices[6].vtx.z = std::numeric_limits<float>::infinity();
+		vertices[7].vtx.header.full = 0x80ff7f01;
+		vertices[9].vtx.header.full = 0x00818000;
+	}
+
+	void unpack(const batch::Functions& funcs, u32 stride, u32 count, batch::Vertices& out) {
+		funcs.unpack((const u8 *)&vertices[0], stride, count, out);
+	}
+
+	static void compare(const std::vector<float>& ref, const std::vector<float>& actual, u32 count)
+	{
+		ASSERT_EQ(0, memcmp(ref.data(), actual.data(), count * sizeof(float)));
+	}
+
+	static constexpr u32 Count = 100;
+	// vertex with 2 colors: 24 bytes
+	struct {
+		N2_VERTEX vtx;
+		PackedRGB rgb;
+	} vertices[Count];
+	static_assert(sizeof(vertices[0]) == sizeof(N2_VERTEX_VR), "Unexpected vertex size");
+};
+
+TEST_F(ElanBatchTest, Unpack)
+{
+	batch::Vertices ref;
+	batch::Vertices actual;
+	for (u32 stride : { sizeof(N2_VERTEX), sizeof(N2_VERTEX_VR), sizeof(N2_VERTEX_VU), sizeof(N2_VERTEX_VUR), sizeof(N2_VERTEX_VUB) })
+	{
+		const u32 maxCount = Count * sizeof(N2_VERTEX_VR) / stride;
+		for (u32 count : { 0u, 1u, 3u, 4u, 5u, 7u, 8u, 9u, 17u, maxCount })
+		{
+			unpack(batch::scalar, stride, count, ref);
+			unpack(batch::simd, stride, count, actual);
+			ASSERT_EQ(count, actual.count);
+			compare(ref.x, actual.x, count);
+			compare(ref.y, actual.y, count);
+			compare(ref.z, actual.z, count);
+			compare(ref.nx, actual.nx, count);
+			compare(ref.ny, actual.ny, count);
+			compare(ref.nz, actual.nz, count);
+			for (int i = 0; i < 3; i++)
+			{
+				ASSERT_EQ(ref.min[i], actual.min[i]) << "stride " << stride << " count " << count;
+				ASSERT_EQ(ref.max[i], actual.max[i]) << "stride " << stride << " count " << count;
+			}
+		}
+	}
+	// Same as the per-vertex conversion
+	unpack(batch::simd, sizeof(N2_VERTEX_VR), Count, actual);
+	float min[3] = { 1e38f, 1e38f, 1e38f };
+	float max[3] = { -1e38f, -1e38f, -1e38f };
+	for (u32 i = 0; i < Count; i++)
+	{
+		const N2_VERTEX& v = vertices[i].vtx;
+		ASSERT_EQ(v.x, actual.x[i]);
+		ASSERT_EQ((int8_t)v.header.nx / 127.f, actual.nx[i]);
+		ASSERT_EQ((int8_t)v.header.ny / 127.f, actual.ny[i]);
+		ASSERT_EQ((int8_t)v.header.nz / 127.f, actual.nz[i]);
+		const float pos[3] { v.x, v.y, v.z };
+		for (int j = 0; j < 3; j++)
+		{
+			min[j] = std::min(min[j], pos[j]);
+			max[j] = std::max(max[j], pos[j]);
+		}
+	}
+	ASSERT_EQ(1.f / 127.f, actual.nx[7]);
+	ASSERT_EQ(1.f, actual.ny[7]);
+	ASSERT_EQ(-1.f / 127.f, actual.nz[7]);
+	ASSERT_EQ(-128.f / 127.f, actual.ny[9]);
+	ASSERT_EQ(-1.f, actual.nz[9]);
+	for (int j = 0; j < 3; j++)
+	{
+		ASSERT_EQ(min[j], actual.min[j]);
+		ASSERT_EQ(max[j], actual.max[j]);
+	}
+	// NaN is ignored, infinity isn't
+	ASSERT_FALSE(std::isnan(actual.min[1]));
+	ASSERT_EQ(std::numeric_limits<float>::infinity(), actual.max[2]);
+}
+
+TEST_F(ElanBatchTest, NearDistances)
+{
+	const float plane[4] { 0.25f, -0.5f, 0.75f, 10.f };
+	batch::Vertices ref;
+	batch::Vertices actual;
+	for (u32 count : { 0u, 1u, 3u, 4u, 5u, 8u, 17u, Count })
+	{
+		unpack(batch::scalar, sizeof(N2_VERTEX_VR), count, ref);
+		unpack(batch::simd, sizeof(N2_VERTEX_VR), count, actual);
+		batch::ClipTest refTest = batch::scalar.nearDistances(ref, plane, 0.001f);
+		batch::ClipTest test = batch::simd.nearDistances(actual, plane, 0.001f);
+		ASSERT_EQ(refTest.anyInside, test.anyInside) << "count " << count;
+		ASSERT_EQ(refTest.allInside, test.allInside) << "count " << count;
+		ASSERT_EQ(refTest.anyOutside, test.anyOutside) << "count " << count;
+		ASSERT_EQ(refTest.allOutside, test.allOutside) << "count " << count;
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+		compare(ref.dist, actual.dist, count);
+#else
+		// the compiler may fuse the scalar multiply-adds
+		for (u32 i = 0; i < count; i++)
+			if (!std::isnan(ref.dist[i]))
+				ASSERT_FLOAT_EQ(ref.dist[i], actual.dist[i]);
+#endif
+	}
+	// Same as the per-vertex clipping code
+	for (u32 i = 0; i < Count; i++)
+	{
+		const N2_VERTEX& v = vertices[i].vtx;
+		float z = v.x * plane[0] + v.y * plane[1] + v.z * plane[2] + plane[3];
+		float dist = -z - 0.001f;
+		if (std::isnan(dist))
+			ASSERT_TRUE(std::isnan(ref.dist[i]));
+		else
+			ASSERT_EQ(dist, ref.dist[i]);
+	}
+}
+
+TEST_F(ElanBatchTest, ClipTest)
+{
+	// Only z matters
+	const float plane[4] { 0.f, 0.f, 1.f, 0.f };
+	for (auto& v : vertices)
+	{
+		v.vtx.x = v.vtx.y = 0.f;
+		v.vtx.z = -10.f;
+	}
+	for (const batch::Functions *funcs : { &batch::scalar, &batch::simd })
+	{
+		batch::Vertices v;
+		for (u32 count : { 1u, 6u, Count })
+		{
+			funcs->unpack((const u8 *)&vertices[0], sizeof(N2_VERTEX_VR), count, v);
+			batch::ClipTest test = funcs->nearDistances(v, plane, 1.f);
+			ASSERT_TRUE(test.anyInside);
+			ASSERT_TRUE(test.allInside);
+			ASSERT_FALSE(test.anyOutside);
+			ASSERT_FALSE(test.allOutside);
+			ASSERT_EQ(9.f, v.dist[count - 1]);
+		}
+		// behind the near plane
+		vertices[Count - 1].vtx.z = -0.5f;
+		funcs->unpack((const u8 *)&vertices[0], sizeof(N2_VERTEX_VR), Count, v);
+		batch::ClipTest test = funcs->nearDistances(v, plane, 1.f);
+		ASSERT_TRUE(test.anyInside);
+		ASSERT_FALSE(test.allInside);
+		ASSERT_TRUE(test.anyOutside);
+		ASSERT_FALSE(test.allOutside);
+
+		// on the plane: inside
+		vertices[Count - 1].vtx.z = -1.f;
+		funcs->unpack((const u8 *)&vertices[0], sizeof(N2_VERTEX_VR), Count, v);
+		test = funcs->nearDistances(v, plane, 1.f);
+		ASSERT_TRUE(test.allInside);
+		ASSERT_FALSE(test.anyOutside);
+
+		// NaN is neither inside nor outside
+		vertices[Count - 1].vtx.z = std::numeric_limits<float>::quiet_NaN();
+		funcs->unpack((const u8 *)&vertices[0], sizeof(N2_VERTEX_VR), Count, v);
+		test = funcs->nearDistances(v, plane, 1.f);
+		ASSERT_TRUE(test.anyInside);
+		ASSERT_FALSE(test.allInside);
+		ASSERT_FALSE(test.anyOutside);
+		ASSERT_FALSE(test.allOutside);
+
+		// all outside
+		for (auto& vtx : vertices)
+			vtx.vtx.z = 5.f;
+		funcs->unpack((const u8 *)&vertices[0], sizeof(N2_VERTEX_VR), Count, v);
+		test = funcs->nearDistances(v, plane, 1.f);
+		ASSERT_FALSE(test.anyInside);
+		ASSERT_TRUE(test.allOutside);
+		for (auto& vtx : vertices)
+			vtx.vtx.z = -10.f;
+	}
+}
@@ -0,0 +1,223 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/pvr/elan.h"
+#include "hw/pvr/elan_capture.h"
+#include "hw/pvr/pvr_regs.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/elan_struct.h"
+#include "hw/mem/addrspace.h"
+#include "stdclass.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+
+using namespace elan;
+
+class ElanReplayTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+		path = (std::filesystem::temp_directory_path() / "flycast_elan_test.bin").string();
+	}
+	void TearDown() override {
+		std::remove(path.c_str());
+	}
+
+	template<typename T>
+	T& alloc(u32 size = sizeof(T))
+	{
+		T& t = *(T *)&frame.ram[ramTop];
+		memset(&t, 0, size);
+		ramTop += size;
+		return t;
+	}
+
+	void link(u32 offset, u32 size)
+	{
+		capture::Event& event = frame.events.emplace_back();
+		event = {};
+		event.type = capture::Command;
+		Link& link = *(Link *)event.data;
+		link.pcw.naomi2 = 1;
+		link.pcw.n2Command = elan::PCW::link;
+		link.offset = offset;
+		link.vramAddress = 0x09000000;
+		link.size = size;
+	}
+
+	// Models made of an instance matrix and lists of colored triangle strips.
+	// Some lists cross the near plane.
+	void makeFrame(int models, int listsPerModel, u32 vertices)
+	{
+		std::mt19937 gen(42);
+		std::uniform_real_distribution<float> xy(-10.f, 10.f);
+		std::uniform_real_distribution<float> z(-50.f, -2.f);
+
+		frame.pvrRegs.assign(pvr_regs, pvr_regs + pvr_RegSize);
+		frame.state.clear();
+		frame.ram.assign(ERAM_SIZE_MAX, 0);
+		frame.events.clear();
+		ramTop = 0;
+		for (int m = 0; m < models; m++)
+		{
+			const u32 start = ramTop;
+			InstanceMatrix& mat = alloc<InstanceMatrix>();
+			mat.pcw.naomi2 = 1;
+			mat.pcw.n2Command = elan::PCW::matrixOrLight;
+			mat.id1 = 0xf;
+			mat.id2 = 0x7f;
+			// identity
+			mat.tm00 = -1.f;
+			mat.tm11 = 1.f;
+			mat.tm22 = -1.f;
+			mat.lm00 = mat.lm11 = mat.lm22 = 1.f;
+			mat._near = 1.f;
+			mat._far = 1000.f;
+			for (int l = 0; l < listsPerModel; l++)
+			{
+				ICHList& list = alloc<ICHList>(sizeof(ICHList) + vertices * sizeof(N2_VERTEX_VR));
+				list.pcw.naomi2 = 1;
+				list.pcw.n2Command = elan::PCW::ich;
+				list.pcw.gouraud = 1;
+				list.flags = ICHList::VTX_TYPE_VR;
+				list.vtxCount = vertices;
+				N2_VERTEX_VR *vtx = (N2_VERTEX_VR *)(&list + 1);
+				const bool crossing = l % 4 == 0;
+				for (u32 i = 0; i < vertices; i++)
+				{
+					vtx[i].header.full = gen() & 0xffffff;
+					vtx[i].header.strip = 1;
+					vtx[i].header.endOfStrip = i % 8 == 7;
+					vtx[i].x = xy(gen);
+					vtx[i].y = xy(gen);
+					vtx[i].z = crossing && (i & 1) ? -0.5f : z(gen);
+					vtx[i].rgb.argb0 = gen();
+					vtx[i].rgb.argb1 = gen();
+				}
+			}
+			link(start, ramTop - start);
+		}
+	}
+
+	std::unique_ptr<TA_context> replay() {
+		return std::unique_ptr<TA_context>(elan::replay(frame));
+	}
+
+	capture::Frame frame;
+	u32 ramTop = 0;
+	std::string path;
+};
+
+TEST_F(ElanReplayTest, SaveLoad)
+{
+	makeFrame(2, 3, 16);
+	frame.state = { 1, 2, 3 };
+	capture::Event& event = frame.events.emplace_back();
+	event = {};
+	event.type = capture::ListContinuation;
+	ASSERT_TRUE(frame.save(path));
+	// Trailing zeros aren't saved
+	ASSERT_LT(std::filesystem::file_size(path), ramTop + pvr_RegSize + 1024);
+
+	capture::Frame loaded;
+	ASSERT_TRUE(loaded.load(path));
+	ASSERT_EQ(frame.pvrRegs, loaded.pvrRegs);
+	ASSERT_EQ(frame.state, loaded.state);
+	ASSERT_EQ(frame.ram, loaded.ram);
+	ASSERT_EQ(frame.events.size(), loaded.events.size());
+	ASSERT_EQ(0, memcmp(frame.events.data(), loaded.events.data(), frame.events.size() * sizeof(capture::Event)));
+
+	// Corrupted sizes
+	const u32 sizes[] { 0x7fffffff, 0xffffffff };
+	for (u32 size : sizes)
+		for (size_t offset : { offsetof(capture::Header, stateSize), offsetof(capture::Header, eventCount) })
+		{
+			ASSERT_TRUE(frame.save(path));
+			FILE *f = std::fopen(path.c_str(), "r+b");
+			std::fseek(f, offset, SEEK_SET);
+			std::fwrite(&size, sizeof(size), 1, f);
+			std::fclose(f);
+			ASSERT_FALSE(loaded.load(path));
+			ASSERT_TRUE(loaded.state.empty());
+		}
+	// Truncated file
+	ASSERT_TRUE(frame.save(path));
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	ASSERT_FALSE(loaded.load(path));
+
+	// Invalid file
+	FILE *f = std::fopen(path.c_str(), "wb");
+	std::fputs("not an elan capture", f);
+	std::fclose(f);
+	ASSERT_FALSE(loaded.load(path));
+	ASSERT_TRUE(loaded.events.empty());
+}
+
+TEST_F(ElanReplayTest, Replay)
+{
+	constexpr int Models = 4;
+	constexpr int Lists = 8;
+	constexpr u32 Vertices = 32;
+	makeFrame(Models, Lists, Vertices);
+	// A list behind the camera, which is dropped
+	N2_VERTEX_VR *vtx = (N2_VERTEX_VR *)(&frame.ram[sizeof(InstanceMatrix) + sizeof(ICHList)]);
+	for (u32 i = 0; i < Vertices; i++)
+		vtx[i].z = 5.f;
+
+	std::unique_ptr<TA_context> ctx = replay();
+	ASSERT_NE(nullptr, ctx);
+	const rend_context& rend = ctx->rend;
+	// plus the background polygon
+	ASSERT_EQ((size_t)(Models * Lists - 1 + 1), rend.global_param_op.size());
+	// 4 strips per list linked with degenerate triangles
+	ASSERT_EQ(4u, rend.global_param_op[1].first);
+	ASSERT_EQ(Vertices + 3 * 2, rend.global_param_op[1].count);
+	ASSERT_GE(rend.verts.size(), (Models * Lists - 1) * Vertices);
+	// One instance matrix per model
+	ASSERT_GE(rend.matrices.size(), (size_t)Models);
+	// Nothing leaked into the emulator state
+	ASSERT_EQ(nullptr, ta_ctx);
+	ASSERT_EQ(0, memcmp(pvr_regs, frame.pvrRegs.data(), pvr_RegSize));
+
+	// Deterministic
+	std::unique_ptr<TA_context> ctx2 = replay();
+	ASSERT_EQ(rend.verts.size(), ctx2->rend.verts.size());
+	ASSERT_EQ(0, memcmp(rend.verts.data(), ctx2->rend.verts.data(), rend.verts.size() * sizeof(Vertex)));
+	ASSERT_EQ(rend.global_param_op.size(), ctx2->rend.global_param_op.size());
+}
+
+// Uses the capture file in FLYCAST_ELAN_CAPTURE if set, or a synthetic frame
+TEST_F(ElanReplayTest, DISABLED_Benchmark)
+{
+	const char *capturePath = std::getenv("FLYCAST_ELAN_CAPTURE");
+	if (capturePath != nullptr)
+		ASSERT_TRUE(frame.load(capturePath));
+	else
+		makeFrame(50, 20, 64);
+	constexpr int Frames = 20;
+	u64 vertices = 0;
+	u64 polys = 0;
+	u64 start = getTimeUs();
+	for (int i = 0; i < Frames; i++)
+	{
+		std::unique_ptr<TA_context> ctx = replay();
+		ASSERT_NE(nullptr, ctx);
+		const rend_context& rend = ctx->rend;
+		vertices += rend.verts.size();
+		polys += rend.global_param_op.size() + rend.global_param_pt.size() + rend.global_param_tr.size()
+				+ rend.global_param_mvo.size() + rend.global_param_mvo_tr.size();
+	}
+	const double seconds = std::max<u64>(getTimeUs() - start, 1) / 1e6;
+	printf("Elan replay: %d events, %.2f ms/frame, %.1f Mvertices/s, %.2f Mpolys/s\n", (int)frame.events.size(),
+			seconds * 1000 / Frames, vertices / seconds / 1e6, polys / seconds / 1e6);
+}
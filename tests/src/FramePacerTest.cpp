@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/pvr/frame_pacer.h"
+
+#include <cmath>
+
+// Simulated time: sleeping advances the clock instantly
+class SimClock : public FramePacer::Clock
+{
+public:
+	u64 now() override {
+		return time;
+	}
+	void sleepUntil(u64 t) override
+	{
+		if (t > time)
+			time = t;
+		sleeps++;
+	}
+
+	u64 time = 1'000'000'000;
+	int sleeps = 0;
+};
+
+class FramePacerTest : public ::testing::Test
+{
+protected:
+	static constexpr double NtscRate = 59.94;
+	static constexpr u64 NtscPeriod = 16683350;		// 1e9 / 59.94 rounded
+	static constexpr u64 DisplayPeriod60 = 16666667;
+
+	// Emulate a frame taking the given time, then hit vblank
+	bool frame(u64 emulationTime, bool vsync = false)
+	{
+		clock.time += emulationTime;
+		return pacer.vblank(vsync);
+	}
+
+	SimClock clock;
+	FramePacer pacer { &clock };
+};
+
+TEST_F(FramePacerTest, SteadyRate)
+{
+	pacer.setFrameRate(NtscRate);
+	ASSERT_FALSE(frame(0));
+	const u64 start = clock.time;
+	// Emulation is faster than real time, with a varying frame cost
+	for (int i = 0; i < 600; i++)
+		ASSERT_TRUE(frame(i % 3 == 0 ? 12'000'000 : 4'000'000));
+	ASSERT_EQ(600 * NtscPeriod, clock.time - start);
+
+	FramePacer::Stats stats = pacer.getStats();
+	ASSERT_EQ(600u, stats.frames);
+	ASSERT_EQ(0u, stats.lateFrames);
+	ASSERT_LT(std::abs(stats.meanMs - NtscPeriod / 1e6), 1e-6);
+	ASSERT_LT(stats.stdDevMs, 1e-6);
+	ASSERT_LT(std::abs(stats.maxMs - NtscPeriod / 1e6), 1e-6);
+
+	pacer.resetStats();
+	ASSERT_EQ(0u, pacer.getStats().frames);
+}
+
+TEST_F(FramePacerTest, CatchUp)
+{
+	pacer.setFrameRate(NtscRate);
+	frame(0);
+	const u64 start = clock.time;
+	for (int i = 0; i < 10; i++)
+		frame(1'000'000);
+	// One slow frame is compensated by the following ones
+	ASSERT_FALSE(frame(NtscPeriod + 18'000'000));
+	ASSERT_FALSE(frame(1'000'000));
+	for (int i = 0; i < 20; i++)
+		frame(1'000'000);
+	ASSERT_EQ(32 * NtscPeriod, clock.time - start);
+
+	FramePacer::Stats stats = pacer.getStats();
+	ASSERT_EQ(32u, stats.frames);
+	ASSERT_EQ(1u, stats.lateFrames);
+	ASSERT_GE(stats.maxMs, (NtscPeriod + 18'000'000) / 1e6);
+	ASSERT_GE(stats.stdDevMs, 0.5);
+}
+
+TEST_F(FramePacerTest, Resync)
+{
+	pacer.setFrameRate(60.0);
+	frame(0);
+	frame(1'000'000);
+	// Way too late to catch up
+	ASSERT_FALSE(frame(100'000'000));
+	const u64 resync = clock.time;
+	// The following frames are paced from the late frame
+	ASSERT_TRUE(frame(1'000'000));
+	ASSERT_EQ(resync + DisplayPeriod60, clock.time);
+	ASSERT_EQ(1u, pacer.getStats().lateFrames);
+
+	// No catch up after a reset
+	pacer.reset();
+	clock.time += 1'000'000'000;
+	ASSERT_FALSE(frame(0));
+	ASSERT_TRUE(frame(0));
+	ASSERT_EQ(1u, pacer.getStats().lateFrames);
+}
+
+TEST_F(FramePacerTest, DisplayEstimate)
+{
+	ASSERT_EQ(0u, pacer.getDisplayPeriod());
+	for (int i = 0; i < 120; i++)
+	{
+		clock.time += DisplayPeriod60;
+		pacer.presented();
+	}
+	ASSERT_EQ(DisplayPeriod60, pacer.getDisplayPeriod());
+	// A skipped refresh doesn't affect the estimate
+	clock.time += DisplayPeriod60 * 2;
+	pacer.presented();
+	ASSERT_EQ(DisplayPeriod60, pacer.getDisplayPeriod());
+	// Neither does a long pause
+	clock.time += 2'000'000'000;
+	pacer.presented();
+	ASSERT_EQ(DisplayPeriod60, pacer.getDisplayPeriod());
+
+	// Refresh rate change
+	for (int i = 0; i < 300; i++)
+	{
+		clock.time += 6944444;
+		pacer.presented();
+	}
+	ASSERT_LT(std::abs((double)pacer.getDisplayPeriod() - 6944444), 1000.0);
+}
+
+TEST_F(FramePacerTest, DisplayLocked)
+{
+	pacer.setFrameRate(NtscRate);
+	for (int i = 0; i < 60; i++)
+	{
+		clock.time += DisplayPeriod60;
+		pacer.presented();
+	}
+	// 60 Hz display, 59.94 Hz content: vsync paces the emulation
+	ASSERT_TRUE(pacer.isDisplayLocked(true));
+	ASSERT_FALSE(pacer.isDisplayLocked(false));
+	frame(0, true);
+	for (int i = 0; i < 60; i++)
+		ASSERT_FALSE(frame(DisplayPeriod60, true));
+	ASSERT_EQ(0, clock.sleeps);
+
+	// Without vsync the pacer takes over
+	ASSERT_FALSE(frame(1'000'000));
+	ASSERT_TRUE(frame(1'000'000));
+	ASSERT_EQ(1, clock.sleeps);
+
+	// PAL content on a 60 Hz display isn't locked
+	pacer.setFrameRate(50.0);
+	ASSERT_FALSE(pacer.isDisplayLocked(true));
+	ASSERT_TRUE(frame(1'000'000, true));
+}
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "profiler/frame_tracer.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+class FrameTracerTest : public ::testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		config::FrameTracer = false;
+		tracer::frameMark();
+		remove(path.c_str());
+	}
+
+	std::string readFile()
+	{
+		std::string s;
+		FILE *f = fopen(path.c_str(), "rt");
+		if (f == nullptr)
+			return s;
+		char buf[1024];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			s.append(buf, n);
+		fclose(f);
+		return s;
+	}
+
+	std::string path = "frame_tracer_test.json";
+};
+
+TEST_F(FrameTracerTest, Disabled)
+{
+	config::FrameTracer = false;
+	tracer::frameMark();
+	ASSERT_FALSE(tracer::enabled());
+	{
+		TRACE_SCOPE("Not recorded");
+	}
+	tracer::frameMark();
+	ASSERT_FALSE(tracer::save(path));
+}
+
+TEST_F(FrameTracerTest, Save)
+{
+	config::FrameTracer = true;
+	tracer::setThreadName("Emu thread");
+	tracer::frameMark();
+	ASSERT_TRUE(tracer::enabled());
+	for (int i = 0; i < 3; i++)
+	{
+		{
+			TRACE_SCOPE("Main scope");
+		}
+		std::thread thread([]() {
+			ThreadName _("Other thread");
+			TRACE_SCOPE("Thread scope");
+		});
+		thread.join();
+		tracer::frameMark();
+	}
+	ASSERT_TRUE(tracer::save(path));
+	// still recording after saving
+	ASSERT_TRUE(tracer::enabled());
+
+	std::string json = readFile();
+	ASSERT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"Main scope\",\"ph\":\"X\""));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"Thread scope\",\"ph\":\"X\""));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"Emulated frame\",\"ph\":\"X\""));
+	ASSERT_NE(std::string::npos, json.find("\"args\":{\"name\":\"Emu thread\"}"));
+	ASSERT_NE(std::string::npos, json.find("\"args\":{\"name\":\"Other thread\"}"));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"vblank\",\"ph\":\"i\""));
+	ASSERT_EQ("\n]}\n", json.substr(json.size() - 4));
+}
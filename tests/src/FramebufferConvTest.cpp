@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/fbconv.h"
+#include "rend/TexCache.h"
+#include "hw/pvr/pvr_mem.h"
+#include "hw/pvr/Renderer_if.h"
+#include "hw/mem/addrspace.h"
+#include "emulator.h"
+#include "stdclass.h"
+#include <random>
+
+class FramebufferConvTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		std::mt19937 gen(42);
+		for (auto& b : src)
+			b = (u8)gen();
+		// make sure rounding limits are tested
+		src[0] = src[1] = src[2] = src[3] = 0xff;
+		src[4] = src[5] = src[6] = src[7] = 0;
+		src[8] = 0xfb; src[9] = 0xfc; src[10] = 0xf8; src[11] = 0xf7;
+	}
+
+	template<typename T, typename F>
+	void compare(F convert, int size)
+	{
+		std::vector<T> ref(Pixels * size);
+		std::vector<T> actual(Pixels * size);
+		// all lengths up to 2 vectors + tail, then the whole buffer
+		for (int count : { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 23, 31, Pixels })
+		{
+			std::fill(ref.begin(), ref.end(), 0xa5);
+			std::fill(actual.begin(), actual.end(), 0xa5);
+			convert(fbconv::scalar, ref.data(), count);
+			convert(fbconv::simd, actual.data(), count);
+			ASSERT_EQ(ref, actual) << "count " << count;
+		}
+	}
+
+	static constexpr int Pixels = 640;
+	u8 src[Pixels * 4];
+};
+
+TEST_F(FramebufferConvTest, Read)
+{
+	for (bool bgra : { false, true })
+	{
+		for (u32 concat : { 0, 3, 7 })
+		{
+			compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+				conv.read0555((const u16 *)src, dst, count, concat, bgra);
+			}, 1);
+			compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+				conv.read565((const u16 *)src, dst, count, concat, bgra);
+			}, 1);
+		}
+		compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+			conv.read888(src, dst, count, bgra);
+		}, 1);
+		compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+			conv.readC888((const u32 *)src, dst, count, bgra);
+		}, 1);
+	}
+	// Reference values
+	const u16 px565 = 0xf81f;
+	u32 out;
+	fbconv::scalar.read565(&px565, &out, 1, 7, false);
+	ASSERT_EQ(0xffff03ffu, out);
+	fbconv::scalar.read565(&px565, &out, 1, 7, true);
+	ASSERT_EQ(0xffff03ffu, out);
+	const u16 px0555 = 0x7c00;
+	fbconv::scalar.read0555(&px0555, &out, 1, 0, false);
+	ASSERT_EQ(0xff0000f8u, out);
+	fbconv::scalar.read0555(&px0555, &out, 1, 0, true);
+	ASSERT_EQ(0xfff80000u, out);
+}
+
+TEST_F(FramebufferConvTest, Write)
+{
+	for (bool bgra : { false, true })
+	{
+		for (bool round : { false, true })
+		{
+			for (u16 kval : { 0, 0x8000 })
+				compare<u16>([&](const fbconv::Converters& conv, u16 *dst, int count) {
+					conv.write0555(src, dst, count, round, kval, bgra);
+				}, 1);
+			compare<u16>([&](const fbconv::Converters& conv, u16 *dst, int count) {
+				conv.write565(src, dst, count, round, bgra);
+			}, 1);
+			compare<u16>([&](const fbconv::Converters& conv, u16 *dst, int count) {
+				conv.write4444(src, dst, count, round, bgra);
+			}, 1);
+			for (u8 threshold : { 0, 1, 0x80, 0xff })
+				compare<u16>([&](const fbconv::Converters& conv, u16 *dst, int count) {
+					conv.write1555(src, dst, count, round, threshold, bgra);
+				}, 1);
+		}
+		compare<u8>([&](const fbconv::Converters& conv, u8 *dst, int count) {
+			conv.write888(src, dst, count, bgra);
+		}, 3);
+		for (u32 kval : { 0u, 0x5a000000u })
+			compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+				conv.write0888(src, dst, count, kval, bgra);
+			}, 1);
+		compare<u32>([&](const fbconv::Converters& conv, u32 *dst, int count) {
+			conv.write8888(src, dst, count, bgra);
+		}, 1);
+	}
+	// Reference values
+	const u8 rgba[] { 0xff, 0x84, 0x03, 0x80 };
+	u16 out;
+	fbconv::scalar.write565(rgba, &out, 1, false, false);
+	ASSERT_EQ((0x1f << 11) | (0x21 << 5) | 0, out);
+	fbconv::scalar.write565(rgba, &out, 1, true, false);
+	ASSERT_EQ((0x1f << 11) | (0x21 << 5) | 0, out);
+	fbconv::scalar.write0555(rgba, &out, 1, true, 0x8000, true);
+	ASSERT_EQ(0x8000 | (0 << 10) | (0x11 << 5) | 0x1f, out);
+	fbconv::scalar.write1555(rgba, &out, 1, false, 0x81, false);
+	ASSERT_EQ((0x1f << 10) | (0x10 << 5) | 0, out);
+}
+
+TEST_F(FramebufferConvTest, DISABLED_Benchmark)
+{
+	// 640x480 framebuffer
+	constexpr int Lines = 480;
+	std::vector<u16> dst16(Pixels);
+	std::vector<u32> dst32(Pixels);
+	for (const fbconv::Converters *conv : { &fbconv::scalar, &fbconv::simd })
+	{
+		u64 start = getTimeUs();
+		for (int i = 0; i < Lines; i++)
+			conv->write565(src, dst16.data(), Pixels, true, false);
+		u64 write = getTimeUs() - start;
+		start = getTimeUs();
+		for (int i = 0; i < Lines; i++)
+			conv->read565(dst16.data(), dst32.data(), Pixels, 0, false);
+		u64 read = getTimeUs() - start;
+		printf("%s: 640x480 write565 %d us, read565 %d us\n", conv == &fbconv::scalar ? "scalar" : "simd",
+				(int)write, (int)read);
+	}
+}
+
+class FramebufferVramTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+	}
+};
+
+TEST_F(FramebufferVramTest, WriteRead565)
+{
+	constexpr u32 Width = 64;
+	constexpr u32 Height = 8;
+	constexpr u32 Address = 0x200000;
+	std::vector<u8> pixels(Width * Height * 4);
+	std::mt19937 gen(1);
+	for (auto& b : pixels)
+		b = (u8)gen();
+
+	FB_W_CTRL_type fb_w_ctrl {};
+	fb_w_ctrl.fb_packmode = 1;
+	FB_X_CLIP_type xclip {};
+	xclip.max = Width - 1;
+	FB_Y_CLIP_type yclip {};
+	yclip.max = Height - 1;
+	WriteFramebuffer<0, 1, 2, 3>(Width, Height, pixels.data(), Address, fb_w_ctrl, Width * 2, xclip, yclip);
+
+	for (u32 i = 0; i < Width * Height; i++)
+	{
+		const u8 *p = &pixels[i * 4];
+		u16 ref = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+		ASSERT_EQ(ref, pvr_read32p<u16>(Address + i * 2)) << "pixel " << i;
+	}
+
+	FramebufferInfo info {};
+	info.fb_r_ctrl.fb_depth = fbde_565;
+	info.fb_r_size.fb_x_size = Width / 2 - 1;
+	info.fb_r_size.fb_y_size = Height - 1;
+	info.fb_r_size.fb_modulus = 1;
+	info.fb_r_sof1 = Address;
+	PixelBuffer<u32> pb;
+	int width, height;
+	ReadFramebuffer<RGBAPacker>(info, pb, width, height);
+	ASSERT_EQ((int)Width, width);
+	ASSERT_EQ((int)Height, height);
+	for (u32 i = 0; i < Width * Height; i++)
+	{
+		u16 src = pvr_read32p<u16>(Address + i * 2);
+		u32 ref = RGBAPacker::pack(((src >> 11) & 0x1f) << 3, ((src >> 5) & 0x3f) << 2, (src & 0x1f) << 3, 0xff);
+		ASSERT_EQ(ref, pb.data()[i]) << "pixel " << i;
+	}
+}
@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "ui/game_scanner.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+class GameScannerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		root = fs::temp_directory_path() / "flycast_scanner_test";
+		fs::remove_all(root);
+		fs::create_directories(root / "content");
+		indexPath = (root / "index.json").string();
+		savedContentPath = config::ContentPath.get();
+		config::ContentPath.set({ (root / "content").string() });
+	}
+	void TearDown() override
+	{
+		config::ContentPath.set(savedContentPath);
+		fs::remove_all(root);
+	}
+
+	static void createFile(const fs::path& path)
+	{
+		FILE *f = std::fopen(path.string().c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		std::fputs("not a disk image", f);
+		std::fclose(f);
+	}
+
+	// Content tree of dirCount x dirCount directories with filesPerDir disk images each
+	void createTree(int dirCount, int filesPerDir)
+	{
+		for (int i = 0; i < dirCount; i++)
+			for (int j = 0; j < dirCount; j++)
+			{
+				fs::path dir = root / "content" / ("dir" + std::to_string(i)) / ("sub" + std::to_string(j));
+				fs::create_directories(dir);
+				for (int k = 0; k < filesPerDir; k++)
+					createFile(dir / ("game" + std::to_string(k) + ".gdi"));
+			}
+	}
+
+	// A directory listing is only refreshed if its update time changed,
+	// which has a 1-second resolution
+	void touch(const fs::path& dir)
+	{
+		timeOffset += 10;
+		fs::last_write_time(dir, fs::file_time_type::clock::now() + std::chrono::seconds(timeOffset));
+	}
+
+	static void scan(GameScanner& scanner)
+	{
+		scanner.refresh();
+		scanner.fetch_game_list();
+		scanner.wait();
+	}
+
+	fs::path root;
+	std::string indexPath;
+	std::vector<std::string> savedContentPath;
+	int timeOffset = 0;
+};
+
+TEST_F(GameScannerTest, IndexSaveLoad)
+{
+	GameScanIndex index;
+	GameScanIndex::Directory& dir = index.dirs["/games"];
+	dir.updateTime = 1234567890123ull;
+	dir.subdirs = { "/games/a", "/games/b" };
+	GameScanIndex::File file;
+	file.name = "game.chd";
+	file.path = "/games/game.chd";
+	dir.files.push_back(file);
+	index.dirs["/games/a"];
+	index.save(indexPath);
+
+	GameScanIndex loaded;
+	loaded.load(indexPath);
+	ASSERT_EQ(2u, loaded.dirs.size());
+	const GameScanIndex::Directory& ldir = loaded.dirs["/games"];
+	ASSERT_EQ(dir.updateTime, ldir.updateTime);
+	ASSERT_EQ(dir.subdirs, ldir.subdirs);
+	ASSERT_EQ(1u, ldir.files.size());
+	ASSERT_EQ(file.name, ldir.files[0].name);
+	ASSERT_EQ(file.path, ldir.files[0].path);
+	ASSERT_TRUE(loaded.dirs["/games/a"].files.empty());
+
+	// Corrupted index
+	FILE *f = std::fopen(indexPath.c_str(), "wb");
+	std::fputs("{ \"/games\": { \"update_time\": ", f);
+	std::fclose(f);
+	loaded.load(indexPath);
+	ASSERT_TRUE(loaded.dirs.empty());
+
+	// Missing index
+	std::remove(indexPath.c_str());
+	loaded.load(indexPath);
+	ASSERT_TRUE(loaded.dirs.empty());
+}
+
+TEST_F(GameScannerTest, SkipUnchanged)
+{
+	createTree(2, 3);
+	GameScanner scanner;
+	scanner.setIndexPath(indexPath);
+	scan(scanner);
+	// content, dir0, dir1 and 4 subdirectories
+	ASSERT_EQ(7u, scanner.stats.directories);
+	ASSERT_EQ(0u, scanner.stats.cachedDirectories);
+	ASSERT_EQ(12u, scanner.stats.files);
+	ASSERT_TRUE(fs::exists(indexPath));
+
+	// Nothing changed
+	scan(scanner);
+	ASSERT_EQ(7u, scanner.stats.directories);
+	ASSERT_EQ(7u, scanner.stats.cachedDirectories);
+	ASSERT_EQ(12u, scanner.stats.files);
+
+	// New file: only its directory is listed again
+	const fs::path dir = root / "content" / "dir1" / "sub0";
+	createFile(dir / "new.gdi");
+	touch(dir);
+	scan(scanner);
+	ASSERT_EQ(7u, scanner.stats.directories);
+	ASSERT_EQ(6u, scanner.stats.cachedDirectories);
+	ASSERT_EQ(13u, scanner.stats.files);
+	{
+		std::lock_guard<std::mutex> _(scanner.get_mutex());
+		int count = 0;
+		for (const GameMedia& game : scanner.get_game_list())
+			if (game.fileName == "new.gdi")
+				count++;
+		ASSERT_EQ(1, count);
+	}
+
+	// Deleted file
+	fs::remove(dir / "game0.gdi");
+	touch(dir);
+	scan(scanner);
+	ASSERT_EQ(12u, scanner.stats.files);
+
+	// The index is reused by a new session
+	GameScanner scanner2;
+	scanner2.setIndexPath(indexPath);
+	scan(scanner2);
+	ASSERT_EQ(7u, scanner2.stats.cachedDirectories);
+}
+
+TEST_F(GameScannerTest, DISABLED_Benchmark)
+{
+	// 10,000 disk images in 100 directories
+	createTree(10, 100);
+	u64 fullTime;
+	{
+		GameScanner scanner;
+		scanner.setIndexPath(indexPath);
+		scan(scanner);
+		ASSERT_EQ(10000u, scanner.stats.files);
+		fullTime = scanner.stats.time;
+	}
+	// New session with the index
+	GameScanner scanner;
+	scanner.setIndexPath(indexPath);
+	scan(scanner);
+	ASSERT_EQ(10000u, scanner.stats.files);
+	ASSERT_EQ(scanner.stats.directories, scanner.stats.cachedDirectories);
+	printf("Game scan of 10000 files: full %d ms, incremental %d ms\n", (int)fullTime, (int)scanner.stats.time);
+}
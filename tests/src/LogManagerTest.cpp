@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "log/LogManager.h"
+#include "log/InMemoryListener.h"
+#include "stdclass.h"
+#include <string>
+#include <thread>
+
+class LogManagerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		LogManager::Init();
+		logManager = LogManager::GetInstance();
+		logManager->EnableListener(LogListener::CONSOLE_LISTENER, false);
+		logManager->EnableListener(LogListener::FILE_LISTENER, false);
+		logManager->EnableListener(LogListener::NETWORK_LISTENER, false);
+		logManager->SetLogLevel(LogTypes::LINFO);
+		logManager->SetEnable(LogTypes::COMMON, true);
+	}
+	void TearDown() override {
+		LogManager::Shutdown();
+	}
+
+	std::string lastLine()
+	{
+		std::vector<std::string> lines = InMemoryListener::getInstance()->getLog();
+		return lines.empty() ? std::string() : lines.back();
+	}
+
+	LogManager *logManager = nullptr;
+};
+
+TEST_F(LogManagerTest, Async)
+{
+	logManager->SetAsync(true);
+	ASSERT_TRUE(logManager->IsAsync());
+	std::thread thread([]() {
+		for (int i = 0; i < 100; i++)
+			GenericLog(LogTypes::LINFO, LogTypes::COMMON, __FILE__, __LINE__, "thread %d", i);
+	});
+	thread.join();
+	GenericLog(LogTypes::LINFO, LogTypes::COMMON, __FILE__, __LINE__, "hello %s", "world");
+	logManager->Flush();
+	ASSERT_NE(std::string::npos, lastLine().find("I[COMMON]: hello world"));
+
+	// Errors aren't queued
+	GenericLog(LogTypes::LERROR, LogTypes::COMMON, __FILE__, __LINE__, "error");
+	ASSERT_NE(std::string::npos, lastLine().find("E[COMMON]: error"));
+
+	// Disabling async mode writes the pending messages
+	GenericLog(LogTypes::LWARNING, LogTypes::COMMON, __FILE__, __LINE__, "pending");
+	logManager->SetAsync(false);
+	ASSERT_NE(std::string::npos, lastLine().find("W[COMMON]: pending"));
+}
+
+TEST_F(LogManagerTest, Overflow)
+{
+	logManager->SetAsync(true);
+	const std::string longText(900, 'x');
+	const u64 dropped = logManager->GetDroppedCount();
+	for (int i = 0; i < 1000; i++)
+		GenericLog(LogTypes::LINFO, LogTypes::COMMON, __FILE__, __LINE__, "%s", longText.c_str());
+	ASSERT_LT(dropped, logManager->GetDroppedCount());
+	logManager->Flush();
+
+	GenericLog(LogTypes::LINFO, LogTypes::COMMON, __FILE__, __LINE__, "after overflow");
+	logManager->Flush();
+	ASSERT_NE(std::string::npos, lastLine().find("after overflow"));
+}
+
+TEST_F(LogManagerTest, DISABLED_Benchmark)
+{
+	constexpr int Count = 10000;
+	for (bool async : { false, true })
+	{
+		logManager->SetAsync(async);
+		u64 start = getTimeUs();
+		for (int i = 0; i < Count; i++)
+			GenericLog(LogTypes::LINFO, LogTypes::COMMON, __FILE__, __LINE__, "message %d value %x", i, i * 3);
+		u64 time = getTimeUs() - start;
+		logManager->Flush();
+		printf("%s: %.0f ns per log call\n", async ? "async" : "sync", time * 1000.0 / Count);
+	}
+	logManager->SetAsync(false);
+}
@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/mem_watch.h"
+
+#include <set>
+#include <vector>
+
+// Watcher over a plain buffer, where page protection is only recorded
+class TestWatcher : public memwatch::Watcher<TestWatcher>
+{
+	friend class memwatch::Watcher<TestWatcher>;
+
+public:
+	static constexpr u32 Size = 16 * PAGE_SIZE;
+
+	TestWatcher() : memory(Size) {}
+
+	void *getMemPage(u32 addr) {
+		return &memory[addr];
+	}
+
+	// Simulates a write, faulting if the page is protected
+	void write(u32 addr, u8 value)
+	{
+		if (locked.count(addr & ~PAGE_MASK) != 0)
+			ASSERT_TRUE(hit(&memory[addr]));
+		memory[addr] = value;
+	}
+
+	std::vector<u8> memory;
+	std::set<u32> locked;
+
+protected:
+	void protectMem(u32 addr, u32 size)
+	{
+		size = std::min(Size - addr, size);
+		for (u32 a = addr; a < addr + size; a += PAGE_SIZE)
+			locked.insert(a);
+	}
+
+	void unprotectMem(u32 addr, u32 size)
+	{
+		size = std::min(Size - addr, size);
+		for (u32 a = addr; a < addr + size; a += PAGE_SIZE)
+			locked.erase(a);
+	}
+
+	u32 getMemOffset(void *p)
+	{
+		if ((u8 *)p < &memory[0] || (u8 *)p >= &memory[0] + Size)
+			return -1;
+		return (u32)((u8 *)p - &memory[0]);
+	}
+};
+
+class MemWatchTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		watcher.reset();
+		for (u32 i = 0; i < TestWatcher::Size; i++)
+			watcher.memory[i] = (u8)(i / PAGE_SIZE);
+		watcher.protect();
+	}
+
+	TestWatcher watcher;
+};
+
+TEST_F(MemWatchTest, Restore)
+{
+	ASSERT_EQ(16u, watcher.locked.size());
+	// Written before the checkpoint: not restored
+	watcher.write(0, 0xff);
+	ASSERT_EQ(15u, watcher.locked.size());
+	watcher.checkpoint();
+	ASSERT_EQ(16u, watcher.locked.size());
+
+	watcher.write(PAGE_SIZE + 1, 0xaa);
+	watcher.write(PAGE_SIZE + 2, 0xbb);
+	watcher.write(5 * PAGE_SIZE, 0xcc);
+	ASSERT_EQ(14u, watcher.locked.size());
+	ASSERT_EQ(2u, watcher.restore());
+	ASSERT_EQ(0xff, watcher.memory[0]);
+	ASSERT_EQ(1, watcher.memory[PAGE_SIZE + 1]);
+	ASSERT_EQ(1, watcher.memory[PAGE_SIZE + 2]);
+	ASSERT_EQ(5, watcher.memory[5 * PAGE_SIZE]);
+	// All pages are watched again
+	ASSERT_EQ(16u, watcher.locked.size());
+
+	// Restoring again only restores what has been written since
+	watcher.write(2 * PAGE_SIZE, 0x11);
+	ASSERT_EQ(1u, watcher.restore());
+	ASSERT_EQ(2, watcher.memory[2 * PAGE_SIZE]);
+	ASSERT_EQ(0u, watcher.restore());
+}
+
+TEST_F(MemWatchTest, RestoreRelockedPage)
+{
+	watcher.checkpoint();
+	watcher.write(3 * PAGE_SIZE, 0x33);
+	// The page is locked again by someone else (code block or texture)
+	watcher.locked.insert(3 * PAGE_SIZE);
+	ASSERT_EQ(1u, watcher.restore());
+	ASSERT_EQ(3, watcher.memory[3 * PAGE_SIZE]);
+	ASSERT_EQ(1u, watcher.locked.count(3 * PAGE_SIZE));
+	ASSERT_EQ(0u, watcher.restore());
+}
+
+TEST_F(MemWatchTest, HitRange)
+{
+	watcher.checkpoint();
+	// Direct host write over 3 pages, not page aligned
+	watcher.hit(PAGE_SIZE + 16, 2 * PAGE_SIZE);
+	ASSERT_EQ(13u, watcher.locked.size());
+	ASSERT_EQ(0u, watcher.locked.count(3 * PAGE_SIZE));
+	memset(&watcher.memory[PAGE_SIZE + 16], 0xee, 2 * PAGE_SIZE);
+	ASSERT_EQ(3u, watcher.restore());
+	ASSERT_EQ(1, watcher.memory[PAGE_SIZE + 16]);
+	ASSERT_EQ(3, watcher.memory[3 * PAGE_SIZE]);
+}
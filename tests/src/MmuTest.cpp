@@ -155,6 +155,109 @@ TEST_F(MmuTest, TestMiss)
 	ASSERT_EQ(MmuError::TLB_MISS, err);
 }
 
+// Cached translations are updated when the TLB changes
+TEST_F(MmuTest, TestTranslationCache)
+{
+	u32 pa;
+	for (int i = 0; i < 2; i++)
+	{
+		UTLB[i].Address.VPN = (0x02000000 + i * 0x1000) >> 10;
+		UTLB[i].Address.ASID = 1;
+		UTLB[i].Data.SZ0 = 1;
+		UTLB[i].Data.V = 1;
+		UTLB[i].Data.PR = 3;
+		UTLB[i].Data.D = 1;
+		UTLB[i].Data.PPN = (0x0C000000 + i * 0x1000) >> 10;
+		UTLB_Sync(i);
+	}
+	CCN_PTEH.ASID = 1;
+	// alternate between the 2 pages so that they're served from the cache
+	for (int i = 0; i < 4; i++)
+	{
+		MmuError err = mmu_data_translation<MMU_TT_DREAD>(0x02000010 + (i & 1) * 0x1000, pa);
+		ASSERT_EQ(MmuError::NONE, err);
+		ASSERT_EQ(0x0C000010u + (i & 1) * 0x1000, pa);
+	}
+
+	// same pages for another asid
+	UTLB[2] = UTLB[0];
+	UTLB[2].Address.ASID = 2;
+	UTLB[2].Data.PPN = 0x0D000000 >> 10;
+	UTLB_Sync(2);
+	CCN_PTEH.ASID = 2;
+	MmuError err = mmu_data_translation<MMU_TT_DREAD>(0x02000020, pa);
+	ASSERT_EQ(MmuError::NONE, err);
+	ASSERT_EQ(0x0D000020u, pa);
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02001020, pa);
+	ASSERT_EQ(MmuError::TLB_MISS, err);
+	CCN_PTEH.ASID = 1;
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02001020, pa);
+	ASSERT_EQ(MmuError::NONE, err);
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02000020, pa);
+	ASSERT_EQ(MmuError::NONE, err);
+	ASSERT_EQ(0x0C000020u, pa);
+
+	// remapped page
+	UTLB[1].Data.PPN = 0x0E000000 >> 10;
+	UTLB_Sync(1);
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02000030, pa);
+	ASSERT_EQ(MmuError::NONE, err);
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02001030, pa);
+	ASSERT_EQ(MmuError::NONE, err);
+	ASSERT_EQ(0x0E000030u, pa);
+
+	// flush
+	mmu_flush_table();
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02000030, pa);
+	ASSERT_EQ(MmuError::TLB_MISS, err);
+}
+
+// 1k pages sharing the same 4k page aren't mixed up
+TEST_F(MmuTest, Test1kPages)
+{
+	u32 pa;
+	for (int i = 0; i < 2; i++)
+	{
+		UTLB[i].Address.VPN = (0x02000400 + i * 0x400) >> 10;
+		UTLB[i].Address.ASID = 1;
+		UTLB[i].Data.SZ0 = 0;
+		UTLB[i].Data.SZ1 = 0;
+		UTLB[i].Data.V = 1;
+		UTLB[i].Data.PR = 3;
+		UTLB[i].Data.D = 1;
+		UTLB[i].Data.PPN = (0x0C000400 + i * 0x01000400) >> 10;
+		UTLB_Sync(i);
+	}
+	// 4k page
+	UTLB[2] = UTLB[0];
+	UTLB[2].Address.VPN = 0x03000000 >> 10;
+	UTLB[2].Data.SZ0 = 1;
+	UTLB[2].Data.PPN = 0x0E000000 >> 10;
+	UTLB_Sync(2);
+	CCN_PTEH.ASID = 1;
+
+	// switch pages so that lookups don't only hit the last used entry
+	for (int i = 0; i < 2; i++)
+	{
+		MmuError err = mmu_data_translation<MMU_TT_DREAD>(0x02000410, pa);
+		ASSERT_EQ(MmuError::NONE, err);
+		ASSERT_EQ(0x0C000410u, pa);
+		err = mmu_data_translation<MMU_TT_DREAD>(0x03000010, pa);
+		ASSERT_EQ(MmuError::NONE, err);
+		ASSERT_EQ(0x0E000010u, pa);
+		err = mmu_data_translation<MMU_TT_DREAD>(0x02000810, pa);
+		ASSERT_EQ(MmuError::NONE, err);
+		ASSERT_EQ(0x0D000810u, pa);
+		err = mmu_data_translation<MMU_TT_DREAD>(0x03000010, pa);
+		ASSERT_EQ(MmuError::NONE, err);
+	}
+	// unmapped 1k page
+	MmuError err = mmu_data_translation<MMU_TT_DREAD>(0x02000010, pa);
+	ASSERT_EQ(MmuError::TLB_MISS, err);
+	err = mmu_data_translation<MMU_TT_DREAD>(0x02000C10, pa);
+	ASSERT_EQ(MmuError::TLB_MISS, err);
+}
+
 TEST_F(MmuTest, TestErrors)
 {
 #ifndef FAST_MMU
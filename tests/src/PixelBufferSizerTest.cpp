@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/pixel_buffer_sizer.h"
+
+class PixelBufferSizerTest : public ::testing::Test
+{
+protected:
+	static constexpr u64 fragments(u64 bytes) {
+		return bytes / PixelBufferSizer::FragmentSize;
+	}
+};
+
+TEST_F(PixelBufferSizerTest, Grow)
+{
+	PixelBufferSizer sizer;
+	sizer.reset(1_GB);
+	ASSERT_EQ(PixelBufferSizer::InitialSize, sizer.getSize());
+	ASSERT_EQ(PixelBufferSizer::InitialSize, pixelBufferStats.bufferSize.load());
+	ASSERT_FALSE(sizer.update(fragments(64_MB)));
+	// overflow
+	ASSERT_TRUE(sizer.update(fragments(200_MB)));
+	ASSERT_EQ(304_MB, sizer.getSize());
+	ASSERT_EQ(304_MB, pixelBufferStats.bufferSize.load());
+	// capped to the max size
+	ASSERT_TRUE(sizer.update(fragments(900_MB)));
+	ASSERT_EQ(1_GB, sizer.getSize());
+	ASSERT_FALSE(sizer.update(fragments(2_GB)));
+	ASSERT_EQ(1_GB, sizer.getSize());
+}
+
+TEST_F(PixelBufferSizerTest, Shrink)
+{
+	PixelBufferSizer sizer;
+	sizer.reset(4_GB);
+	ASSERT_TRUE(sizer.update(fragments(1_GB)));
+	ASSERT_EQ(1536_MB, sizer.getSize());
+	// no shrinking while a frame uses more than a third of the buffer
+	for (int i = 0; i < PixelBufferSizer::ShrinkDelay * 3; i++)
+		ASSERT_FALSE(sizer.update(fragments(i % 100 == 0 ? 600_MB : 10_MB)));
+	// shrink after a while
+	int i = 0;
+	for (; i < PixelBufferSizer::ShrinkDelay; i++)
+		if (sizer.update(fragments(i == 10 ? 100_MB : 10_MB)))
+			break;
+	ASSERT_EQ(PixelBufferSizer::ShrinkDelay - 1, i);
+	ASSERT_EQ(160_MB, sizer.getSize());
+	// down to the min size
+	for (i = 0; i < PixelBufferSizer::ShrinkDelay; i++)
+		if (sizer.update(0))
+			break;
+	ASSERT_EQ(PixelBufferSizer::MinSize, sizer.getSize());
+	for (i = 0; i < PixelBufferSizer::ShrinkDelay * 2; i++)
+		ASSERT_FALSE(sizer.update(0));
+}
+
+TEST_F(PixelBufferSizerTest, SmallMax)
+{
+	PixelBufferSizer sizer;
+	sizer.reset(32_MB);
+	ASSERT_EQ(32_MB, sizer.getSize());
+	ASSERT_FALSE(sizer.update(fragments(100_MB)));
+	for (int i = 0; i < PixelBufferSizer::ShrinkDelay * 2; i++)
+		ASSERT_FALSE(sizer.update(0));
+	ASSERT_EQ(32_MB, sizer.getSize());
+}
+
+TEST_F(PixelBufferSizerTest, PeakStats)
+{
+	pixelBufferStats.peakFragments = 0;
+	PixelBufferSizer sizer;
+	sizer.reset(1_GB);
+	sizer.update(1000);
+	sizer.update(5000);
+	sizer.update(2000);
+	ASSERT_EQ(5000u, pixelBufferStats.peakFragments.exchange(0));
+	sizer.update(10);
+	ASSERT_EQ(10u, pixelBufferStats.peakFragments.load());
+}
@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/mem/addrspace.h"
+#include "hw/mem/mem_watch.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include "stdclass.h"
+
+#include <vector>
+
+class RamDmaTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 START_PC = 0x8C010000;
+	static constexpr u32 DMA_ADDR = 0x8C100000;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		emu.dc_reset(true);
+		os_InstallFaultHandler();
+		ctx = &p_sh4rcb->cntx;
+		schedId = sh4_sched_register(0, &stopCallback, this);
+	}
+	void TearDown() override
+	{
+		sh4_sched_unregister(schedId);
+		os_UninstallFaultHandler();
+	}
+
+	static int stopCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		RamDmaTest *test = (RamDmaTest *)arg;
+		if (test->ctx->pc != START_PC + 2)
+			return 100000;
+		test->sh4->Stop();
+		return 0;
+	}
+
+	void run(Sh4Executor *executor)
+	{
+		sh4 = executor;
+		ctx->pc = START_PC;
+		sh4_sched_request(schedId, 100000);
+		sh4->Start();
+		sh4->Run();
+	}
+
+	Sh4Context *ctx = nullptr;
+	Sh4Executor *sh4 = nullptr;
+	int schedId = -1;
+};
+
+TEST_F(RamDmaTest, DirectPointer)
+{
+	u8 *p = GetRamDmaPtr(DMA_ADDR, 10240);
+	ASSERT_NE(nullptr, p);
+	ASSERT_EQ(&mem_b[DMA_ADDR & RAM_MASK], p);
+	// mirrors
+	ASSERT_EQ(p, GetRamDmaPtr(DMA_ADDR & 0x1fffffff, 10240));
+	ASSERT_EQ(p, GetRamDmaPtr((DMA_ADDR & 0x1fffffff) + RAM_SIZE, 10240));
+	// past the end of RAM
+	ASSERT_EQ(nullptr, GetRamDmaPtr(0x8C000000 + RAM_SIZE - 32, 64));
+	// not in RAM
+	ASSERT_EQ(nullptr, GetRamDmaPtr(0xA05F8000, 32));
+	ASSERT_EQ(nullptr, GetRamDmaPtr(0x04000000, 32));
+	ASSERT_EQ(nullptr, GetRamDmaPtr(0xFF000000, 32));
+
+	std::vector<u32> data(10240 / 4);
+	for (u32 i = 0; i < data.size(); i++)
+		data[i] = i * 0x01010101;
+	WriteMemBlock_nommu_ptr(DMA_ADDR, data.data(), data.size() * 4);
+	for (u32 i = 0; i < data.size(); i++)
+		ASSERT_EQ(data[i], addrspace::read32(DMA_ADDR + i * 4));
+}
+
+#if FEAT_SHREC != DYNAREC_NONE
+TEST_F(RamDmaTest, CodeInvalidation)
+{
+	Sh4Executor *cached = Get_Sh4CachedInterpreter();
+	cached->Init();
+
+	addrspace::write16(START_PC, 0xE001);		// mov #1, r0
+	addrspace::write16(START_PC + 2, 0xAFFE);	// bra .
+	addrspace::write16(START_PC + 4, 0x0009);	// nop
+	run(cached);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_TRUE(bm_IsRamPageProtected(START_PC));
+
+	// DMA over the code
+	const u16 code[] {
+		0xE002,	// mov #2, r0
+		0xAFFE,	// bra .
+	};
+	WriteMemBlock_nommu_ptr(START_PC, (const u32 *)code, sizeof(code));
+	// host writes don't unprotect the page
+	ASSERT_TRUE(bm_IsRamPageProtected(START_PC));
+	run(cached);
+	ASSERT_EQ(2u, ctx->r[0]);
+
+	cached->Term();
+	delete cached;
+}
+
+// Pages written by DMA are saved by the memory watcher for rollbacks and run-ahead
+TEST_F(RamDmaTest, MemoryWatcher)
+{
+	Sh4Executor *cached = Get_Sh4CachedInterpreter();
+	cached->Init();
+
+	addrspace::write16(START_PC, 0xE001);		// mov #1, r0
+	addrspace::write16(START_PC + 2, 0xAFFE);	// bra .
+	addrspace::write16(START_PC + 4, 0x0009);	// nop
+	run(cached);
+	ASSERT_EQ(1u, ctx->r[0]);
+	std::vector<u32> saved(10240 / 4);
+	for (u32 i = 0; i < saved.size(); i++)
+		saved[i] = addrspace::read32(DMA_ADDR + i * 4);
+
+	config::GGPOEnable.set(true);
+	memwatch::protect();
+	// DMA over the code and over data
+	const u16 code[] {
+		0xE002,	// mov #2, r0
+		0xAFFE,	// bra .
+	};
+	WriteMemBlock_nommu_ptr(START_PC, (const u32 *)code, sizeof(code));
+	std::vector<u32> data(saved.size(), 0x12345678);
+	WriteMemBlock_nommu_ptr(DMA_ADDR, data.data(), data.size() * 4);
+	run(cached);
+	ASSERT_EQ(2u, ctx->r[0]);
+	ASSERT_EQ(0x12345678u, addrspace::read32(DMA_ADDR));
+
+	// The code page and the 3 data pages
+	ASSERT_EQ(4u, memwatch::ramWatcher.restore());
+	for (u32 i = 0; i < saved.size(); i++)
+		ASSERT_EQ(saved[i], addrspace::read32(DMA_ADDR + i * 4));
+	run(cached);
+	ASSERT_EQ(1u, ctx->r[0]);
+
+	memwatch::unprotect();
+	memwatch::reset();
+	config::GGPOEnable.set(false);
+	cached->Term();
+	delete cached;
+}
+#endif
+
+TEST_F(RamDmaTest, DISABLED_Throughput)
+{
+	// Same chunk size as GD-ROM DMA
+	constexpr u32 ChunkSize = 10240;
+	constexpr u32 TotalSize = 64_MB;
+	std::vector<u32> src(ChunkSize / 4, 0x12345678);
+	std::vector<u8> bounce(ChunkSize);
+
+	// Bounce buffer then word writes: what the non-RAM path does
+	u64 start = getTimeUs();
+	for (u32 done = 0; done < TotalSize; done += ChunkSize)
+	{
+		memcpy(bounce.data(), src.data(), ChunkSize);
+		const u32 dst = DMA_ADDR + done % (2_MB);
+		for (u32 i = 0; i < ChunkSize; i += 4)
+			addrspace::write32(dst + i, *(const u32 *)&bounce[i]);
+	}
+	const u64 slowTime = std::max<u64>(getTimeUs() - start, 1);
+
+	start = getTimeUs();
+	for (u32 done = 0; done < TotalSize; done += ChunkSize)
+		WriteMemBlock_nommu_ptr(DMA_ADDR + done % (2_MB), src.data(), ChunkSize);
+	const u64 directTime = std::max<u64>(getTimeUs() - start, 1);
+
+	ASSERT_EQ(0x12345678u, addrspace::read32(DMA_ADDR));
+	printf("Bounce + word writes %.0f MB/s, direct %.0f MB/s\n",
+			(double)TotalSize / slowTime, (double)TotalSize / directTime);
+}
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "hw/sh4/sh4_mem.h"
+#include "emulator.h"
+#include "stdclass.h"
+
+class RamViewTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+	}
+};
+
+TEST_F(RamViewTest, Read)
+{
+	WriteMem32_nommu(0x0C001000, 0x12345678);
+	WriteMem16_nommu(0x0C001004, 0xABCD);
+	WriteMem8_nommu(0x0C001006, 0x42);
+
+	RamView ram;
+	ASSERT_EQ(0x12345678u, ram.read<u32>(0x1000));
+	ASSERT_EQ(0xABCDu, ram.read<u16>(0x1004));
+	ASSERT_EQ(0x42u, ram.read<u8>(0x1006));
+
+	u8 buf[8];
+	ASSERT_EQ(7u, ram.read(0x1000, buf, 7));
+	ASSERT_EQ(0x78, buf[0]);
+	ASSERT_EQ(0xCD, buf[4]);
+	ASSERT_EQ(0x42, buf[6]);
+
+	// out of bounds
+	ASSERT_EQ(0u, ram.read(RAM_SIZE - 2, buf, 4));
+	ASSERT_EQ(0u, ram.read(0xFFFFFFFF, buf, 2));
+	ASSERT_EQ(4u, ram.read(RAM_SIZE - 4, buf, 4));
+}
+
+TEST_F(RamViewTest, ReadMemBlock)
+{
+	for (u32 i = 0; i < 16; i++)
+		WriteMem8_nommu(0x0C002000 + i, i);
+	u8 buf[16];
+	// main RAM and its mirrors
+	ReadMemBlock_nommu(0x0C002000, buf, sizeof(buf));
+	for (u32 i = 0; i < 16; i++)
+		ASSERT_EQ(i, buf[i]);
+	memset(buf, 0, sizeof(buf));
+	ReadMemBlock_nommu(0x0C002000 + RAM_SIZE, buf, sizeof(buf));
+	for (u32 i = 0; i < 16; i++)
+		ASSERT_EQ(i, buf[i]);
+	// other areas go through the handlers
+	WriteMem32_nommu(0x05000000, 0xCAFEBABE);
+	ReadMemBlock_nommu(0x05000000, buf, 4);
+	ASSERT_EQ(0xCAFEBABEu, *(u32 *)&buf[0]);
+}
+
+TEST_F(RamViewTest, DISABLED_Benchmark)
+{
+	// Emulates the access pattern of achievement memrefs: many small reads spread over RAM
+	constexpr u32 Reads = 1'000'000;
+	u32 sum = 0;
+	u64 start = getTimeUs();
+	for (u32 i = 0; i < Reads; i++)
+		sum += ReadMem32_nommu(0x0C000000 + ((i * 4099 * 4) & (RAM_MASK & ~3)));
+	u64 handlerTime = getTimeUs() - start;
+
+	RamView ram;
+	u32 sum2 = 0;
+	start = getTimeUs();
+	for (u32 i = 0; i < Reads; i++)
+		sum2 += ram.read<u32>((i * 4099 * 4) & (RAM_MASK & ~3));
+	u64 viewTime = getTimeUs() - start;
+
+	ASSERT_EQ(sum, sum2);
+	printf("%d reads: handlers %d us, view %d us\n", Reads, (int)handlerTime, (int)viewTime);
+}
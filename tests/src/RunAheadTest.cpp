@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "runahead.h"
+#include "cfg/option.h"
+#include "hw/gdrom/gdrom_if.h"
+#include "hw/gdrom/gdromv3.h"
+#include "hw/holly/sb.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/mem/addrspace.h"
+#include "oslib/oslib.h"
+
+#include <vector>
+
+#if FEAT_SHREC != DYNAREC_NONE
+class RunAheadTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 LOOP_PC = 0x8C010000;
+	static constexpr u32 DMA_ADDR = 0x8C100000;
+	static constexpr u32 DMA_SECTORS = 3;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		emu.dc_reset(true);
+		os_InstallFaultHandler();
+		ctx = &p_sh4rcb->cntx;
+		schedId = sh4_sched_register(0, &stopCallback, this);
+		sh4 = Get_Sh4CachedInterpreter();
+		sh4->Init();
+		config::RunAhead.set(1);
+		runahead::init();
+	}
+	void TearDown() override
+	{
+		config::RunAhead.set(0);
+		runahead::init();
+		sh4->Term();
+		delete sh4;
+		sh4_sched_unregister(schedId);
+		os_UninstallFaultHandler();
+	}
+
+	static int stopCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		((RunAheadTest *)arg)->sh4->Stop();
+		return 0;
+	}
+
+	// Runs the cpu for the given number of cycles
+	void run(u32 pc, int cycles)
+	{
+		ctx->pc = pc;
+		sh4_sched_request(schedId, cycles);
+		sh4->Start();
+		sh4->Run();
+	}
+
+	// Reads sectors with the SPI_CD_READ packet command in DMA mode, then starts the GD-ROM DMA to dst
+	void startGdromDma(u32 dst, u32 sectors)
+	{
+		WriteMem_gdrom(GD_FEATURES_Write, 1, 1);	// DMA
+		WriteMem_gdrom(GD_COMMAND_Write, ATA_SPI_PACKET, 1);
+		const u16 packet[6] {
+			SPI_CD_READ | (0x20 << 8),	// FAD, user data
+			0,
+			150,						// start FAD
+			0,
+			0,
+			(u16)sectors,
+		};
+		for (u16 w : packet)
+			WriteMem_gdrom(GD_DATA, w, 2);
+
+		addrspace::write32(0xA0000000 | SB_GDSTAR_addr, dst & 0x1fffffe0);
+		addrspace::write32(0xA0000000 | SB_GDLEN_addr, sectors * 2048);
+		addrspace::write32(0xA0000000 | SB_GDDIR_addr, 1);
+		addrspace::write32(0xA0000000 | SB_GDEN_addr, 1);
+		addrspace::write32(0xA0000000 | SB_GDST_addr, 1);
+	}
+
+	Sh4Context *ctx = nullptr;
+	Sh4Executor *sh4 = nullptr;
+	int schedId = -1;
+};
+
+// Memory written by a GD-ROM DMA while running ahead is restored
+TEST_F(RunAheadTest, GdromDma)
+{
+	ASSERT_TRUE(runahead::active());
+	addrspace::write16(LOOP_PC, 0xAFFE);		// bra .
+	addrspace::write16(LOOP_PC + 2, 0x0009);	// nop
+	// Code and data in the DMA destination
+	addrspace::write16(DMA_ADDR, 0xE001);		// mov #1, r0
+	addrspace::write16(DMA_ADDR + 2, 0xAFFE);	// bra .
+	addrspace::write16(DMA_ADDR + 4, 0x0009);	// nop
+	for (u32 i = 8; i < DMA_SECTORS * 2048; i += 4)
+		addrspace::write32(DMA_ADDR + i, i * 0x01010101);
+
+	std::vector<u8> savedRam;
+	u32 aheadData = ~0;
+	bool complete = runahead::runFrame([&]() {
+		if (!runahead::runningAhead())
+		{
+			run(DMA_ADDR, 200000);
+			savedRam.assign(&mem_b[0], &mem_b[0] + RAM_SIZE);
+		}
+		else
+		{
+			// No disc: the DMA writes zeros
+			startGdromDma(DMA_ADDR, DMA_SECTORS);
+			run(LOOP_PC, 200000);
+			aheadData = addrspace::read32(DMA_ADDR + 8);
+		}
+		return true;
+	});
+	ASSERT_TRUE(complete);
+	ASSERT_EQ(1u, ctx->r[0]);
+	ASSERT_EQ(0u, aheadData);
+	ASSERT_EQ(0u, SB_GDST);
+
+	ASSERT_EQ(RAM_SIZE, savedRam.size());
+	ASSERT_EQ(0, memcmp(savedRam.data(), &mem_b[0], RAM_SIZE));
+	ASSERT_EQ(1u, runahead::getStats().frames);
+
+	// The code overwritten ahead is valid again
+	ctx->r[0] = 0;
+	run(DMA_ADDR, 200000);
+	ASSERT_EQ(1u, ctx->r[0]);
+}
+#endif
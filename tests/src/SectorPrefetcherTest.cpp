@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "imgread/common.h"
+#include "imgread/sector_prefetch.h"
+#include "imgread/isofs.h"
+#include "imgread/iso9660.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Each 2048-byte sector is filled with its FAD
+class FakeTrackFile : public TrackFile
+{
+public:
+	FakeTrackFile(int delayUs = 0) : delayUs(delayUs) {}
+
+	bool Read(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type) override
+	{
+		if (delayUs != 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+		*sector_type = SECFMT_2048_MODE1;
+		for (u32 i = 0; i < 2048; i += 4)
+			*(u32 *)&dst[i] = FAD;
+		return true;
+	}
+
+private:
+	int delayUs;
+};
+
+// ISO 9660 image with a single file in the root directory. Concurrent reads are detected.
+class IsoTrackFile : public TrackFile
+{
+public:
+	static constexpr u32 RootLba = 20;
+	static constexpr u32 FileLba = 30;
+	static constexpr u32 FileSize = 10000;
+
+	IsoTrackFile(std::atomic<bool>& concurrentRead) : concurrentRead(concurrentRead) {}
+
+	bool Read(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode, SubcodeFormat *subcode_type) override
+	{
+		if (readers++ != 0)
+			concurrentRead = true;
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+		*sector_type = SECFMT_2048_MODE1;
+		memset(dst, 0, 2048);
+		const u32 lba = FAD - 150;
+		if (lba == 16)
+		{
+			iso9660_pvd_t *pvd = (iso9660_pvd_t *)dst;
+			pvd->type = 1;
+			memcpy(pvd->id, ISO_STANDARD_ID, strlen(ISO_STANDARD_ID));
+			pvd->version = 1;
+			pvd->root_directory_record.extent = iso733(RootLba);
+			pvd->root_directory_record.size = iso733(2048);
+		}
+		else if (lba == RootLba)
+		{
+			iso9660_dir_t *dir = (iso9660_dir_t *)dst;
+			const char name[] = "1ST_READ.BIN;1";
+			dir->length = offsetof(iso9660_dir_t, filename.str) + 1 + strlen(name);
+			dir->extent = iso733(FileLba);
+			dir->size = iso733(FileSize);
+			dir->filename.len = strlen(name);
+			memcpy(&dir->filename.str[1], name, strlen(name));
+		}
+		else
+		{
+			for (u32 i = 0; i < 2048; i += 4)
+				*(u32 *)&dst[i] = FAD;
+		}
+		readers--;
+		return true;
+	}
+
+private:
+	static iso733_t iso733(u32 v) {
+		// both-byte order
+		return v | ((u64)__builtin_bswap32(v) << 32);
+	}
+
+	std::atomic<bool>& concurrentRead;
+	std::atomic<int> readers {};
+};
+
+class SectorPrefetcherTest : public ::testing::Test
+{
+protected:
+	void SetUp() override {
+		setupDisc(0);
+	}
+	void setupDisc(int delayUs)
+	{
+		Track track;
+		track.file = new FakeTrackFile(delayUs);
+		track.StartFAD = 150;
+		track.EndFAD = 10000;
+		track.CTRL = 4;
+		disc.tracks.push_back(track);
+		disc.type = CdRom;
+	}
+	void checkSectors(const u8 *data, u32 fad, u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+			for (u32 j = 0; j < 2048; j += 4)
+				ASSERT_EQ(fad + i, *(const u32 *)&data[i * 2048 + j]);
+	}
+
+	Disc disc;
+	u8 subcode[96];
+};
+
+TEST_F(SectorPrefetcherTest, Sequential)
+{
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	std::vector<u8> data(16 * 2048);
+	prefetcher.prefetch(200, 1000, 2048);
+	for (u32 fad = 200; fad < 1200; fad += 16)
+	{
+		ASSERT_EQ(16u, prefetcher.read(fad, 16, data.data(), 2048, false, subcode));
+		checkSectors(data.data(), fad, 16);
+	}
+	prefetcher.term();
+}
+
+TEST_F(SectorPrefetcherTest, Random)
+{
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	std::vector<u8> data(8 * 2048);
+	const u32 fads[] { 300, 308, 150, 5000, 5004, 5012, 400, 9000, 312 };
+	for (u32 fad : fads)
+	{
+		ASSERT_EQ(8u, prefetcher.read(fad, 8, data.data(), 2048, false, subcode));
+		checkSectors(data.data(), fad, 8);
+	}
+}
+
+TEST_F(SectorPrefetcherTest, EndOfDisc)
+{
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	std::vector<u8> data(16 * 2048);
+	ASSERT_EQ(16u, prefetcher.read(9980, 16, data.data(), 2048, true, subcode));
+	checkSectors(data.data(), 9980, 16);
+	ASSERT_EQ(5u, prefetcher.read(9996, 16, data.data(), 2048, true, subcode));
+	checkSectors(data.data(), 9996, 5);
+}
+
+TEST_F(SectorPrefetcherTest, SlowStorage)
+{
+	disc.tracks[0].Destroy();
+	disc.tracks.clear();
+	setupDisc(50);
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	std::vector<u8> data(16 * 2048);
+	prefetcher.prefetch(1000, 256, 2048);
+	for (u32 fad = 1000; fad < 1256; fad += 16)
+	{
+		ASSERT_EQ(16u, prefetcher.read(fad, 16, data.data(), 2048, false, subcode));
+		checkSectors(data.data(), fad, 16);
+		// emulated transfer time
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+}
+
+TEST_F(SectorPrefetcherTest, Ready)
+{
+	disc.tracks[0].Destroy();
+	disc.tracks.clear();
+	setupDisc(50);
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	std::vector<u8> data(16 * 2048);
+	// Not read yet: the read is started in the background
+	ASSERT_FALSE(prefetcher.ready(3000, 16, 2048));
+	while (!prefetcher.ready(3000, 16, 2048))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	ASSERT_EQ(16u, prefetcher.read(3000, 16, data.data(), 2048, false, subcode));
+	checkSectors(data.data(), 3000, 16);
+	// Past the end of the disc
+	while (!prefetcher.ready(10001, 1, 2048))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	ASSERT_EQ(0u, prefetcher.read(10001, 1, data.data(), 2048, true, subcode));
+	prefetcher.term();
+	// Not running
+	ASSERT_TRUE(prefetcher.ready(3000, 16, 2048));
+}
+
+TEST_F(SectorPrefetcherTest, IsoFsDuringPrefetch)
+{
+	disc.tracks[0].Destroy();
+	disc.tracks.clear();
+	std::atomic<bool> concurrentRead {};
+	Track track;
+	track.file = new IsoTrackFile(concurrentRead);
+	track.StartFAD = 150;
+	track.EndFAD = 10000;
+	track.CTRL = 4;
+	disc.tracks.push_back(track);
+
+	SectorPrefetcher prefetcher;
+	prefetcher.init(&disc);
+	// Read-ahead in progress on the I/O thread
+	prefetcher.prefetch(2000, 256, 2048);
+	IsoFs isofs(150, [&](u32 fad, u32 count, u8 *dst) {
+		prefetcher.read(fad, count, dst, 2048, false, subcode);
+	});
+	std::unique_ptr<IsoFs::Directory> root(isofs.getRoot());
+	ASSERT_NE(nullptr, root);
+	std::unique_ptr<IsoFs::Entry> entry(root->getEntry("1ST_READ.BIN"));
+	ASSERT_NE(nullptr, entry);
+	ASSERT_FALSE(entry->isDirectory());
+	IsoFs::File *file = (IsoFs::File *)entry.get();
+	ASSERT_EQ(IsoTrackFile::FileSize, file->getSize());
+	std::vector<u8> data(file->getSize());
+	ASSERT_EQ(IsoTrackFile::FileSize, file->read(data.data(), data.size()));
+	const u32 fad = 150 + IsoTrackFile::FileLba;
+	checkSectors(data.data(), fad, IsoTrackFile::FileSize / 2048);
+	// Partial last sector
+	ASSERT_EQ(fad + 4, *(const u32 *)&data[4 * 2048]);
+	prefetcher.term();
+
+	ASSERT_FALSE(concurrentRead);
+}
@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/mem/addrspace.h"
+#include "oslib/oslib.h"
+#include "stdclass.h"
+
+class Sh4CachedInterpreterTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 START_PC = 0x8C010000;
+	static constexpr u32 SPIN_PC = START_PC + 12;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		emu.dc_reset(true);
+		// needed to catch writes to protected code pages
+		os_InstallFaultHandler();
+		ctx = &p_sh4rcb->cntx;
+		schedId = sh4_sched_register(0, &stopCallback, this);
+	}
+	void TearDown() override
+	{
+		sh4_sched_unregister(schedId);
+		os_UninstallFaultHandler();
+	}
+
+	// Stops the cpu once it reaches the final infinite loop
+	static int stopCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		Sh4CachedInterpreterTest *test = (Sh4CachedInterpreterTest *)arg;
+		if (test->ctx->pc != test->stopPc)
+			return 100000;
+		test->sh4->Stop();
+		return 0;
+	}
+
+	void run(Sh4Executor *executor, u32 pc, u32 stopPc)
+	{
+		sh4 = executor;
+		this->stopPc = stopPc;
+		ctx->pc = pc;
+		sh4_sched_request(schedId, 100000);
+		sh4->Start();
+		sh4->Run();
+	}
+
+	// r2 = sum(1..r1)
+	void writeLoop()
+	{
+		const u16 code[] {
+			0xE000,	// mov #0, r0
+			0xE200,	// mov #0, r2
+			0x7001,	// add #1, r0
+			0x320C,	// add r0, r2
+			0x3010,	// cmp/eq r1, r0
+			0x8BFB,	// bf -5
+			0xAFFE,	// bra .
+			0x0009,	// nop
+		};
+		for (u32 i = 0; i < std::size(code); i++)
+			addrspace::write16(START_PC + i * 2, code[i]);
+	}
+
+	u64 runLoop(Sh4Executor *executor, u32 iterations)
+	{
+		ctx->r[1] = iterations;
+		u64 start = getTimeUs();
+		run(executor, START_PC, SPIN_PC);
+		u64 time = getTimeUs() - start;
+		EXPECT_EQ(iterations, ctx->r[0]);
+		EXPECT_EQ((u32)((u64)iterations * (iterations + 1) / 2), ctx->r[2]);
+		return time;
+	}
+
+	Sh4Context *ctx = nullptr;
+	Sh4Executor *sh4 = nullptr;
+	int schedId = -1;
+	u32 stopPc = 0;
+};
+
+TEST_F(Sh4CachedInterpreterTest, Loop)
+{
+	writeLoop();
+	Sh4Executor *interpreter = Get_Sh4Interpreter();
+	interpreter->Init();
+	Sh4Executor *cached = Get_Sh4CachedInterpreter();
+	cached->Init();
+
+	runLoop(interpreter, 1000);
+	runLoop(cached, 1000);
+	// run again from the cache
+	runLoop(cached, 12345);
+
+	constexpr u32 Iterations = 10000000;
+	const double instructions = 2.0 + 4.0 * Iterations;
+	u64 interpTime = runLoop(interpreter, Iterations);
+	u64 cachedTime = runLoop(cached, Iterations);
+	printf("Interpreter %.1f MIPS, cached interpreter %.1f MIPS\n",
+			instructions / std::max<u64>(interpTime, 1), instructions / std::max<u64>(cachedTime, 1));
+
+	cached->Term();
+	delete cached;
+	interpreter->Term();
+	delete interpreter;
+}
+
+#if FEAT_SHREC != DYNAREC_NONE
+TEST_F(Sh4CachedInterpreterTest, SelfModifyingCode)
+{
+	Sh4Executor *cached = Get_Sh4CachedInterpreter();
+	cached->Init();
+
+	// Code is modified by the host
+	addrspace::write16(START_PC, 0xE001);		// mov #1, r0
+	addrspace::write16(START_PC + 2, 0xAFFE);	// bra .
+	addrspace::write16(START_PC + 4, 0x0009);	// nop
+	run(cached, START_PC, START_PC + 2);
+	ASSERT_EQ(1u, ctx->r[0]);
+	addrspace::write16(START_PC, 0xE002);		// mov #2, r0
+	run(cached, START_PC, START_PC + 2);
+	ASSERT_EQ(2u, ctx->r[0]);
+
+	// Code modifies the next instruction in the same block. Use another page since the first one
+	// isn't protected anymore.
+	const u32 pc = START_PC + 0x2000;
+	addrspace::write16(pc, 0x2451);			// mov.w r5, @r4
+	addrspace::write16(pc + 2, 0xE001);		// mov #1, r0
+	addrspace::write16(pc + 4, 0xAFFE);		// bra .
+	addrspace::write16(pc + 6, 0x0009);		// nop
+	ctx->r[4] = pc + 2;
+	ctx->r[5] = 0xE003;						// mov #3, r0
+	run(cached, pc, pc + 4);
+	ASSERT_EQ(3u, ctx->r[0]);
+
+	cached->Term();
+	delete cached;
+}
+#endif
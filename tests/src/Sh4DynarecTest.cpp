@@ -0,0 +1,215 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/dyna/ngen.h"
+#include "hw/mem/addrspace.h"
+#include "oslib/oslib.h"
+
+#ifdef TARGET_NO_JIT
+static_assert(FEAT_SHREC == DYNAREC_VM, "TARGET_NO_JIT builds must use the bytecode backend");
+#endif
+
+#if FEAT_SHREC != DYNAREC_NONE
+// Runs the same code with the interpreter and the dynarec backend and compares the results
+class Sh4DynarecTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 START_PC = 0x8C010000;
+	static constexpr u32 DATA_ADDR = 0x8C020000;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		emu.dc_reset(true);
+		os_InstallFaultHandler();
+		ctx = &p_sh4rcb->cntx;
+		schedId = sh4_sched_register(0, &stopCallback, this);
+	}
+	void TearDown() override
+	{
+		sh4_sched_unregister(schedId);
+		os_UninstallFaultHandler();
+	}
+
+	static int stopCallback(int tag, int sch_cycl, int jitter, void *arg)
+	{
+		Sh4DynarecTest *test = (Sh4DynarecTest *)arg;
+		if (test->ctx->pc != test->spinPc)
+			return 100000;
+		test->sh4->Stop();
+		return 0;
+	}
+
+	template<size_t N>
+	void writeCode(const u16 (&code)[N], u32 spinOffset)
+	{
+		for (u32 i = 0; i < N; i++)
+			addrspace::write16(START_PC + i * 2, code[i]);
+		spinPc = START_PC + spinOffset;
+	}
+
+	// Integer, memory, fpu and subroutine calls
+	void writeLoop()
+	{
+		static const u16 code[] {
+			0xE000,	// mov #0, r0
+			0xE200,	// mov #0, r2
+			0x7001,	// loop: add #1, r0
+			0x320C,	// add r0, r2
+			0x6303,	// mov r0, r3
+			0x4300,	// shll r3
+			0x2432,	// mov.l r3, @r4
+			0x6542,	// mov.l @r4, r5
+			0x352C,	// add r2, r5
+			0x0357,	// mul.l r5, r3
+			0x405A,	// lds r0, fpul
+			0xF02D,	// float fpul, fr0
+			0xF100,	// fadd fr0, fr1
+			0xB004,	// bsr sub
+			0x0009,	// nop
+			0x3010,	// cmp/eq r1, r0
+			0x8BF0,	// bf loop
+			0xAFFE,	// bra .
+			0x0009,	// nop
+			0x061A,	// sub: sts macl, r6
+			0x000B,	// rts
+			0x0009,	// nop
+		};
+		writeCode(code, 0x22);
+	}
+
+	// Shifts, byte and word memory accesses, extensions, 64-bit multiply, carry,
+	// delayed conditional branches and fpu division
+	void writeOps()
+	{
+		static const u16 code[] {
+			0xE000,	// mov #0, r0
+			0xE200,	// mov #0, r2
+			0x6943,	// mov r4, r9
+			0x7908,	// add #8, r9
+			0x7001,	// loop: add #1, r0
+			0x6303,	// mov r0, r3
+			0x4318,	// shll8 r3
+			0x230B,	// or r0, r3
+			0xE5FD,	// mov #-3, r5
+			0x6633,	// mov r3, r6
+			0x465C,	// shad r5, r6
+			0x6733,	// mov r3, r7
+			0x475D,	// shld r5, r7
+			0x2430,	// mov.b r3, @r4
+			0x6840,	// mov.b @r4, r8
+			0x2931,	// mov.w r3, @r9
+			0x6A91,	// mov.w @r9, r10
+			0x6B8C,	// extu.b r8, r11
+			0x6CAF,	// exts.w r10, r12
+			0x32BC,	// add r11, r2
+			0x32CC,	// add r12, r2
+			0x326C,	// add r6, r2
+			0x227A,	// xor r7, r2
+			0x363D,	// dmuls.l r3, r6
+			0x0D0A,	// sts mach, r13
+			0x3767,	// cmp/gt r6, r7
+			0x0E29,	// movt r14
+			0x32EE,	// addc r14, r2
+			0x8D01,	// bt/s skip
+			0x7201,	// add #1, r2
+			0x7210,	// add #16, r2
+			0x405A,	// skip: lds r0, fpul
+			0xF22D,	// float fpul, fr2
+			0xF320,	// fadd fr2, fr3
+			0xF43C,	// fmov fr3, fr4
+			0xF423,	// fdiv fr2, fr4
+			0xF43D,	// ftrc fr4, fpul
+			0x055A,	// sts fpul, r5
+			0x325C,	// add r5, r2
+			0x3010,	// cmp/eq r1, r0
+			0x8BDA,	// bf loop
+			0xAFFE,	// bra .
+			0x0009,	// nop
+		};
+		writeCode(code, 0x52);
+	}
+
+	struct Result
+	{
+		u32 r[16];
+		f32 fr[16];
+		u64 mac;
+		u32 T;
+		u32 data[2];
+
+		bool operator==(const Result& other) const {
+			return memcmp(this, &other, sizeof(Result)) == 0;
+		}
+	};
+
+	Result run(Sh4Executor *executor, u32 iterations)
+	{
+		memset(ctx->r, 0, sizeof(ctx->r));
+		ctx->r[1] = iterations;
+		ctx->r[4] = DATA_ADDR;
+		std::fill(std::begin(ctx->fr), std::end(ctx->fr), 0.f);
+		ctx->mac.full = 0;
+		addrspace::write32(DATA_ADDR, 0);
+		addrspace::write32(DATA_ADDR + 8, 0);
+		ctx->pc = START_PC;
+		sh4 = executor;
+		sh4_sched_request(schedId, 100000);
+		sh4->Start();
+		sh4->Run();
+
+		Result res;
+		memset(&res, 0, sizeof(res));
+		memcpy(res.r, ctx->r, sizeof(res.r));
+		memcpy(res.fr, ctx->fr, sizeof(res.fr));
+		res.mac = ctx->mac.full;
+		res.T = ctx->sr.T;
+		res.data[0] = addrspace::read32(DATA_ADDR);
+		res.data[1] = addrspace::read32(DATA_ADDR + 8);
+		return res;
+	}
+
+	void compare()
+	{
+		Sh4Executor *interpreter = Get_Sh4Interpreter();
+		interpreter->Init();
+		Sh4Executor *recompiler = Sh4Recompiler::Instance;
+		ASSERT_NE(nullptr, recompiler);
+
+		for (u32 iterations : { 1, 100, 12345 })
+		{
+			Result ref = run(interpreter, iterations);
+			ASSERT_EQ(iterations, ref.r[0]);
+			// first run compiles the blocks, second one uses the linked blocks
+			ASSERT_TRUE(ref == run(recompiler, iterations)) << "iterations " << iterations;
+			ASSERT_TRUE(ref == run(recompiler, iterations)) << "iterations " << iterations;
+		}
+
+		interpreter->Term();
+		delete interpreter;
+	}
+
+	Sh4Context *ctx = nullptr;
+	Sh4Executor *sh4 = nullptr;
+	int schedId = -1;
+	u32 spinPc = 0;
+};
+
+TEST_F(Sh4DynarecTest, Loop)
+{
+	writeLoop();
+	compare();
+}
+
+TEST_F(Sh4DynarecTest, Ops)
+{
+	writeOps();
+	compare();
+}
+#endif
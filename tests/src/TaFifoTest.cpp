@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/pvr/ta.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/ta_structs.h"
+#include "hw/holly/sb.h"
+#include "hw/mem/addrspace.h"
+#include "stdclass.h"
+#include <random>
+
+class TaFifoTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+	}
+
+	SQBuffer& add()
+	{
+		trace.emplace_back();
+		SQBuffer& sqb = trace.back();
+		for (u8& b : sqb.data)
+			b = (u8)gen();
+		return sqb;
+	}
+
+	PCW& pcw(SQBuffer& sqb) {
+		return *(PCW *)&sqb.data[0];
+	}
+
+	void polygon(u32 listType, bool v64, int strips, int vertices)
+	{
+		PCW& header = pcw(add());
+		header.full = 0;
+		header.ParaType = ParamType_Polygon_or_Modifier_Volume;
+		header.ListType = listType;
+		header.Texture = v64;
+		header.Col_Type = v64 ? 1 : 0;
+		for (int s = 0; s < strips; s++)
+			for (int i = 0; i < vertices; i++)
+			{
+				PCW& vtx = pcw(add());
+				vtx.ParaType = ParamType_Vertex_Parameter;
+				vtx.EndOfStrip = i == vertices - 1;
+				if (v64)
+					add();	// 2nd half
+			}
+	}
+
+	void sprite(u32 listType, int count)
+	{
+		PCW& header = pcw(add());
+		header.full = 0;
+		header.ParaType = ParamType_Sprite;
+		header.ListType = listType;
+		header.Texture = 1;
+		for (int i = 0; i < count; i++)
+		{
+			PCW& vtx = pcw(add());
+			vtx.ParaType = ParamType_Vertex_Parameter;
+			vtx.EndOfStrip = 1;
+			add();
+		}
+	}
+
+	void modVol(u32 listType, int count)
+	{
+		PCW& header = pcw(add());
+		header.full = 0;
+		header.ParaType = ParamType_Polygon_or_Modifier_Volume;
+		header.ListType = listType;
+		for (int i = 0; i < count; i++)
+		{
+			PCW& vtx = pcw(add());
+			vtx.ParaType = ParamType_Vertex_Parameter;
+			add();
+		}
+	}
+
+	void endOfList() {
+		pcw(add()).full = ParamType_End_Of_List << 29;
+	}
+
+	// Display lists of a typical frame
+	void makeTrace(int polygons)
+	{
+		trace.clear();
+		for (int i = 0; i < polygons; i++)
+			polygon(ListType_Opaque, i & 1, 2, 6);
+		opaqueEnd = trace.size();
+		endOfList();
+		modVol(ListType_Opaque_Modifier_Volume, 12);
+		endOfList();
+		for (int i = 0; i < polygons / 2; i++)
+		{
+			polygon(ListType_Translucent, i & 1, 1, 4);
+			sprite(ListType_Translucent, 2);
+		}
+		endOfList();
+		for (int i = 0; i < polygons / 4; i++)
+			polygon(ListType_Punch_Through, false, 1, 4);
+		endOfList();
+	}
+
+	struct Result
+	{
+		std::vector<u8> data;
+		u32 istnrm;
+		u32 isterr;
+	};
+
+	// Send the trace by DMA in chunks of the given sizes, or with store queues if empty
+	Result run(const std::vector<u32>& dmaSizes)
+	{
+		SB_ISTNRM = 0;
+		SB_ISTERR = 0;
+		ta_vtx_ListInit(false);
+		if (dmaSizes.empty())
+		{
+			for (const SQBuffer& sqb : trace)
+				ta_vtx_data32(&sqb);
+		}
+		else
+		{
+			u32 i = 0;
+			for (u32 size : dmaSizes)
+			{
+				ta_vtx_data(&trace[i], size);
+				i += size;
+			}
+		}
+		Result res;
+		res.data.assign(ta_tad.thd_root, ta_tad.thd_data);
+		res.istnrm = SB_ISTNRM;
+		res.isterr = SB_ISTERR;
+		return res;
+	}
+
+	std::vector<SQBuffer> trace;
+	size_t opaqueEnd = 0;
+	std::mt19937 gen { 42 };
+};
+
+TEST_F(TaFifoTest, BulkMatchesStoreQueues)
+{
+	makeTrace(50);
+	const Result ref = run({});
+	ASSERT_EQ(trace.size() * sizeof(SQBuffer), ref.data.size());
+	constexpr u32 ListEnds = (1 << 7) | (1 << 8) | (1 << 9) | (1 << 21);
+	ASSERT_EQ(ListEnds, ref.istnrm & ListEnds);
+
+	// single DMA
+	Result res = run({ (u32)trace.size() });
+	ASSERT_EQ(ref.data, res.data);
+	ASSERT_EQ(ref.istnrm, res.istnrm);
+	ASSERT_EQ(ref.isterr, res.isterr);
+
+	// random DMA sizes, which may end in the middle of a 64-byte parameter
+	std::vector<u32> sizes;
+	for (u32 total = 0; total < trace.size(); )
+	{
+		u32 size = std::min<u32>(gen() % 17 + 1, trace.size() - total);
+		sizes.push_back(size);
+		total += size;
+	}
+	res = run(sizes);
+	ASSERT_EQ(ref.data, res.data);
+	ASSERT_EQ(ref.istnrm, res.istnrm);
+	ASSERT_EQ(ref.isterr, res.isterr);
+}
+
+TEST_F(TaFifoTest, ListEndInterrupt)
+{
+	makeTrace(10);
+	SB_ISTNRM = 0;
+	ta_vtx_ListInit(false);
+	// The opaque list end interrupt must only be raised once its end of list is received
+	ta_vtx_data(&trace[0], opaqueEnd);
+	ASSERT_EQ(0u, SB_ISTNRM & (1 << 7));
+	ta_vtx_data(&trace[opaqueEnd], 1);
+	ASSERT_NE(0u, SB_ISTNRM & (1 << 7));
+	ASSERT_EQ(0u, SB_ISTNRM & (1 << 8));
+}
+
+TEST_F(TaFifoTest, DISABLED_Benchmark)
+{
+	makeTrace(2000);
+	constexpr int Frames = 20;
+	const double mb = (double)trace.size() * sizeof(SQBuffer) * Frames / 1024 / 1024;
+	u64 start = getTimeUs();
+	for (int i = 0; i < Frames; i++)
+		run({});
+	u64 sqTime = getTimeUs() - start;
+	start = getTimeUs();
+	for (int i = 0; i < Frames; i++)
+		run({ (u32)trace.size() });
+	u64 dmaTime = getTimeUs() - start;
+	printf("TA throughput: 32-byte writes %.0f MB/s, bulk DMA %.0f MB/s\n",
+			mb * 1e6 / std::max<u64>(sqTime, 1), mb * 1e6 / std::max<u64>(dmaTime, 1));
+}
@@ -0,0 +1,390 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "hw/pvr/ta.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/ta_capture.h"
+#include "hw/pvr/ta_structs.h"
+#include "hw/pvr/pvr_mem.h"
+#include "hw/pvr/pvr_regs.h"
+#include "hw/pvr/Renderer_if.h"
+#include "hw/mem/addrspace.h"
+#include "stdclass.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+
+Renderer *rend_norend();
+Renderer *rend_TileRenderer();
+
+class TaReplayTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 RegionBase = 0x100000;
+	static constexpr u32 TextureBase = 0x400000;
+	static constexpr u32 TextureSize = 64 * 64 * 2;
+	static constexpr int Textures = 16;
+
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+		path = (std::filesystem::temp_directory_path() / "flycast_ta_test.bin").string();
+	}
+	void TearDown() override {
+		std::remove(path.c_str());
+	}
+
+	u8 *add()
+	{
+		taData.resize(taData.size() + 32);
+		u8 *p = &taData[taData.size() - 32];
+		memset(p, 0, 32);
+		return p;
+	}
+
+	// Triangle strips with a random position and color
+	void polygon(u32 listType, bool textured, int strips, int vertices)
+	{
+		TA_PolyParam0& param = *(TA_PolyParam0 *)add();
+		param.pcw.ParaType = ParamType_Polygon_or_Modifier_Volume;
+		param.pcw.ListType = listType;
+		param.pcw.Gouraud = 1;
+		param.pcw.Texture = textured;
+		param.isp.DepthMode = 6;
+		param.tsp.SrcInstr = 1;
+		if (listType == ListType_Translucent)
+		{
+			param.tsp.UseAlpha = 1;
+			param.tsp.SrcInstr = 4;
+			param.tsp.DstInstr = 5;
+		}
+		if (textured)
+		{
+			param.tsp.TexU = 3;
+			param.tsp.TexV = 3;
+			param.tsp.FilterMode = 1;
+			param.tcw.PixelFmt = Pixel565;
+			param.tcw.TexAddr = (TextureBase + nextTexture++ % Textures * TextureSize) >> 3;
+		}
+		std::uniform_real_distribution<float> x(0.f, 600.f);
+		std::uniform_real_distribution<float> y(0.f, 440.f);
+		std::uniform_real_distribution<float> delta(0.f, 40.f);
+		std::uniform_real_distribution<float> z(0.01f, 1.f);
+		for (int s = 0; s < strips; s++)
+		{
+			const float x0 = x(gen);
+			const float y0 = y(gen);
+			for (int i = 0; i < vertices; i++)
+			{
+				u8 *p = add();
+				PCW& pcw = *(PCW *)p;
+				pcw.ParaType = ParamType_Vertex_Parameter;
+				pcw.EndOfStrip = i == vertices - 1;
+				TA_Vertex3& vtx = *(TA_Vertex3 *)(p + 4);
+				vtx.xyz[0] = x0 + delta(gen);
+				vtx.xyz[1] = y0 + delta(gen);
+				vtx.xyz[2] = z(gen);
+				vtx.u = (i & 1) ? 1.f : 0.f;
+				vtx.v = (i & 2) ? 1.f : 0.f;
+				vtx.BaseCol = gen();
+				vtx.OffsCol = 0;
+			}
+		}
+	}
+
+	void endOfList()
+	{
+		PCW& pcw = *(PCW *)add();
+		pcw.ParaType = ParamType_End_Of_List;
+	}
+
+	// Registers, region array, textures and TA data of a 640x480 frame
+	void makeScene(int polygons)
+	{
+		REGION_BASE = RegionBase;
+		FPU_PARAM_CFG &= ~(1 << 21);	// type 1 region array
+		ISP_FEED_CFG &= ~1;				// auto-sort
+		FB_X_CLIP.full = 0;
+		FB_X_CLIP.max = 639;
+		FB_Y_CLIP.full = 0;
+		FB_Y_CLIP.max = 479;
+		SCALER_CTL.full = 0;
+		SCALER_CTL.vscalefactor = 0x400;
+		FB_W_SOF1 = 0x600000;
+		FB_W_CTRL.full = 1;				// 565
+		FB_W_LINESTRIDE.stride = 640 * 2 / 8;
+		TA_GLOB_TILE_CLIP.tile_x_num = 19;
+		TA_GLOB_TILE_CLIP.tile_y_num = 14;
+
+		constexpr u32 EmptyList = 0x80000000;
+		u32 addr = RegionBase;
+		for (u32 y = 0; y < 15; y++)
+			for (u32 x = 0; x < 20; x++)
+			{
+				RegionArrayTile tile{};
+				tile.X = x;
+				tile.Y = y;
+				tile.LastRegion = x == 19 && y == 14;
+				pvr_write32p<u32>(addr, tile.full);
+				pvr_write32p<u32>(addr + 4, 0);
+				pvr_write32p<u32>(addr + 8, EmptyList);
+				pvr_write32p<u32>(addr + 12, 0);
+				pvr_write32p<u32>(addr + 16, EmptyList);
+				addr += 5 * 4;
+			}
+		for (u32 i = 0; i < Textures * TextureSize; i++)
+			vram[TextureBase + i] = (u8)gen();
+
+		taData.clear();
+		for (int i = 0; i < polygons; i++)
+			polygon(ListType_Opaque, i & 1, 2, 8);
+		endOfList();
+		for (int i = 0; i < polygons / 2; i++)
+			polygon(ListType_Translucent, true, 1, 4);
+		endOfList();
+		for (int i = 0; i < polygons / 4; i++)
+			polygon(ListType_Punch_Through, true, 1, 4);
+		endOfList();
+	}
+
+	// Same as rend_start_render()
+	TA_context *makeContext()
+	{
+		TA_context *ctx = tactx_Alloc();
+		ctx->Reset();
+		memcpy(ctx->tad.thd_root, taData.data(), taData.size());
+		ctx->tad.thd_data = ctx->tad.thd_root + taData.size();
+		FillBGP(ctx);
+		rend_context& rend = ctx->rend;
+		rend.isRTT = false;
+		rend.clearFramebuffer = true;
+		rend.fb_W_SOF1 = FB_W_SOF1;
+		rend.fb_W_CTRL.full = FB_W_CTRL.full;
+		rend.ta_GLOB_TILE_CLIP = TA_GLOB_TILE_CLIP;
+		rend.scaler_ctl = SCALER_CTL;
+		rend.fb_X_CLIP = FB_X_CLIP;
+		rend.fb_Y_CLIP = FB_Y_CLIP;
+		rend.fb_W_LINESTRIDE = FB_W_LINESTRIDE.stride;
+		rend.fog_clamp_min = FOG_CLAMP_MIN;
+		rend.fog_clamp_max = FOG_CLAMP_MAX;
+		rend.framebufferWidth = 640;
+		rend.framebufferHeight = 480;
+		return ctx;
+	}
+
+	// Record the scene with the capture hooks
+	void capture(int polygons)
+	{
+		makeScene(polygons);
+		TA_context *ctx = makeContext();
+		tacapture::start(path);
+		tacapture::frameStart(ctx);
+		process(rend.get(), ctx);
+		tacapture::frameProcessed(ctx);
+		tacapture::release(ctx);
+		ASSERT_TRUE(frame.load(path));
+	}
+
+	static void process(Renderer *r, TA_context *ctx)
+	{
+		renderer = r;
+		_pvrrc = ctx;
+		r->Process(ctx);
+	}
+
+	static void render(Renderer *r, TA_context *ctx)
+	{
+		renderer = r;
+		_pvrrc = ctx;
+		r->Render();
+	}
+
+	struct RendererDeleter
+	{
+		void operator()(Renderer *r) const
+		{
+			r->Term();
+			delete r;
+			if (renderer == r)
+				renderer = nullptr;
+			_pvrrc = nullptr;
+		}
+	};
+	using RendererPtr = std::unique_ptr<Renderer, RendererDeleter>;
+
+	static RendererPtr createRenderer(Renderer *r)
+	{
+		r->Init();
+		return RendererPtr(r);
+	}
+
+	RendererPtr rend = createRenderer(rend_norend());
+	tacapture::Frame frame;
+	std::vector<u8> taData;
+	int nextTexture = 0;
+	std::mt19937 gen { 42 };
+	std::string path;
+};
+
+TEST_F(TaReplayTest, Capture)
+{
+	constexpr int Polygons = 40;
+	makeScene(Polygons);
+	TA_context *ctx = makeContext();
+
+	// Skipped frames aren't captured
+	tacapture::start(path);
+	tacapture::frameStart(ctx);
+	tacapture::frameSkipped(ctx);
+	process(rend.get(), ctx);
+	tacapture::frameProcessed(ctx);
+	ASSERT_FALSE(std::filesystem::exists(path));
+
+	tacapture::frameStart(ctx);
+	process(rend.get(), ctx);
+	tacapture::frameProcessed(ctx);
+	tacapture::release(ctx);
+	ASSERT_TRUE(frame.load(path));
+
+	ASSERT_EQ(VRAM_SIZE, frame.vramSize);
+	ASSERT_EQ(0, memcmp(pvr_regs, frame.pvrRegs.data(), pvr_RegSize));
+	ASSERT_EQ(1u, frame.passes.size());
+	ASSERT_EQ(taData, frame.passes[0]);
+	ASSERT_EQ(640u, frame.settings.framebufferWidth);
+	ASSERT_EQ(480u, frame.settings.framebufferHeight);
+	ASSERT_EQ(FB_W_SOF1, frame.settings.fbWSof1);
+	// Only the pages used by the frame
+	auto hasPage = [this](u32 addr) {
+		return std::find(frame.pageOffsets.begin(), frame.pageOffsets.end(), addr & ~(tacapture::PageSize - 1)) != frame.pageOffsets.end();
+	};
+	ASSERT_TRUE(hasPage(pvr_map32(RegionBase)));
+	ASSERT_TRUE(hasPage(TextureBase));
+	ASSERT_FALSE(hasPage(FB_W_SOF1));
+	ASSERT_LT(frame.pageOffsets.size(), VRAM_SIZE / tacapture::PageSize / 8);
+	ASSERT_EQ(frame.pageOffsets.size() * tacapture::PageSize, frame.pages.size());
+
+	// Only once
+	ctx = makeContext();
+	std::remove(path.c_str());
+	tacapture::frameStart(ctx);
+	tacapture::frameProcessed(ctx);
+	tacapture::release(ctx);
+	ASSERT_FALSE(std::filesystem::exists(path));
+
+	// Invalid file
+	FILE *f = std::fopen(path.c_str(), "wb");
+	std::fputs("not a TA capture", f);
+	std::fclose(f);
+	ASSERT_FALSE(frame.load(path));
+	ASSERT_TRUE(frame.passes.empty());
+
+	// vram too large
+	tacapture::Header header{};
+	header.magic = tacapture::Magic;
+	header.version = tacapture::Version;
+	header.vramSize = 0x80000000;
+	header.pvrRegsSize = pvr_RegSize;
+	header.passCount = 1;
+	header.pageCount = header.vramSize / tacapture::PageSize;
+	f = std::fopen(path.c_str(), "wb");
+	std::fwrite(&header, sizeof(header), 1, f);
+	const std::vector<u8> zeros(sizeof(tacapture::RenderSettings) + pvr_RegSize + 4);
+	std::fwrite(zeros.data(), 1, zeros.size(), f);
+	std::fclose(f);
+	ASSERT_FALSE(frame.load(path));
+}
+
+TEST_F(TaReplayTest, Replay)
+{
+	constexpr int Polygons = 40;
+	capture(Polygons);
+
+	// Clobber what the frame uses
+	std::vector<u8> textures(&vram[TextureBase], &vram[TextureBase + Textures * TextureSize]);
+	memset(&vram[TextureBase], 0, Textures * TextureSize);
+	const u32 regionBase = pvr_map32(RegionBase);
+	memset(&vram[regionBase & ~(tacapture::PageSize - 1)], 0, tacapture::PageSize);
+	REGION_BASE = 0;
+	FB_X_CLIP.full = 0;
+
+	TA_context *ctx = tacapture::prepare(frame);
+	ASSERT_NE(nullptr, ctx);
+	ASSERT_EQ(0, memcmp(&vram[TextureBase], textures.data(), textures.size()));
+	ASSERT_EQ((u32)RegionBase, REGION_BASE);
+	ASSERT_EQ(639u, ctx->rend.fb_X_CLIP.max);
+	ASSERT_EQ(640u, ctx->rend.framebufferWidth);
+
+	process(rend.get(), ctx);
+	const rend_context& rc = ctx->rend;
+	// one per strip plus the background polygon
+	ASSERT_EQ((size_t)Polygons * 2 + 1, rc.global_param_op.size());
+	ASSERT_EQ((size_t)Polygons / 2, rc.global_param_tr.size());
+	ASSERT_EQ((size_t)Polygons / 4, rc.global_param_pt.size());
+	ASSERT_EQ(1u, rc.render_passes.size());
+
+	// Render with the software renderer
+	RendererPtr tileRenderer = createRenderer(rend_TileRenderer());
+	TA_context *ctx2 = tacapture::prepare(frame);
+	process(tileRenderer.get(), ctx2);
+	ASSERT_EQ(rc.verts.size(), ctx2->rend.verts.size());
+	ASSERT_EQ(rc.idx.size(), ctx2->rend.idx.size());
+	ASSERT_NE(nullptr, ctx2->rend.global_param_tr[0].texture);
+	render(tileRenderer.get(), ctx2);
+	std::vector<u8> pixels;
+	int width = 0;
+	int height = 0;
+	ASSERT_TRUE(tileRenderer->GetLastFrame(pixels, width, height));
+	ASSERT_EQ(640, width);
+	ASSERT_EQ(480, height);
+	ASSERT_NE(pixels.end(), std::find_if(pixels.begin(), pixels.end(), [](u8 v) { return v != 0; }));
+
+	tacapture::release(ctx);
+	tacapture::release(ctx2);
+}
+
+// Uses the capture file in FLYCAST_TA_CAPTURE if set, or a synthetic frame
+TEST_F(TaReplayTest, DISABLED_Benchmark)
+{
+	const char *capturePath = std::getenv("FLYCAST_TA_CAPTURE");
+	if (capturePath != nullptr)
+		ASSERT_TRUE(frame.load(capturePath));
+	else
+		capture(2000);
+
+	constexpr int Frames = 20;
+	for (bool software : { false, true })
+	{
+		RendererPtr r = createRenderer(software ? rend_TileRenderer() : rend_norend());
+		u64 prepareTime = 0;
+		u64 processTime = 0;
+		u64 renderTime = 0;
+		size_t vertices = 0;
+		for (int i = 0; i < Frames; i++)
+		{
+			u64 start = getTimeUs();
+			TA_context *ctx = tacapture::prepare(frame);
+			ASSERT_NE(nullptr, ctx);
+			u64 now = getTimeUs();
+			prepareTime += now - start;
+			start = now;
+			process(r.get(), ctx);
+			now = getTimeUs();
+			processTime += now - start;
+			start = now;
+			render(r.get(), ctx);
+			renderTime += getTimeUs() - start;
+			vertices = ctx->rend.verts.size();
+			tacapture::release(ctx);
+		}
+		printf("TA replay (%s): %d vertices, %d vram pages, prepare %.2f ms, process %.2f ms, render %.2f ms per frame\n",
+				software ? "tile renderer" : "norend", (int)vertices, (int)frame.pageOffsets.size(),
+				prepareTime / 1000.0 / Frames, processTime / 1000.0 / Frames, renderTime / 1000.0 / Frames);
+	}
+}
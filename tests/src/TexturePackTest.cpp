@@ -0,0 +1,193 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/texture_pack.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+using namespace texpack;
+
+class TexturePackTest : public ::testing::Test
+{
+protected:
+	void SetUp() override {
+		path = (std::filesystem::temp_directory_path() / "flycast_texpack_test.fctp").string();
+	}
+	void TearDown() override {
+		std::remove(path.c_str());
+	}
+
+	// Top-down image where each pixel is its coordinates
+	static std::vector<u8> image(u32 width, u32 height)
+	{
+		std::vector<u8> data(width * height * 4);
+		for (u32 y = 0; y < height; y++)
+			for (u32 x = 0; x < width; x++)
+			{
+				u8 *p = &data[(y * width + x) * 4];
+				p[0] = x;
+				p[1] = y;
+				p[2] = 0x80;
+				p[3] = 0xff;
+			}
+		return data;
+	}
+
+	std::string path;
+};
+
+TEST_F(TexturePackTest, RoundTrip)
+{
+	TexturePackWriter writer;
+	ASSERT_TRUE(writer.create(path));
+	ASSERT_TRUE(writer.add(0x1234, 64, 64, image(64, 64).data()));
+	ASSERT_TRUE(writer.add(0x12, 30, 10, image(30, 10).data()));
+	ASSERT_TRUE(writer.add(0xffffffff, 1, 1, image(1, 1).data()));
+	ASSERT_TRUE(writer.finish());
+
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path));
+	ASSERT_EQ(3u, pack.size());
+	ASSERT_EQ(nullptr, pack.find(0x1235));
+
+	// Non-square: single level, stored bottom-up
+	const IndexEntry *entry = pack.find(0x12);
+	ASSERT_NE(nullptr, entry);
+	ASSERT_EQ(30, entry->width);
+	ASSERT_EQ(10, entry->height);
+	ASSERT_EQ(1, entry->levels);
+	ASSERT_EQ(30u * 10 * 4, entry->rawSize);
+	u8 *data = pack.load(*entry);
+	ASSERT_NE(nullptr, data);
+	ASSERT_EQ(0, data[0]);		// x
+	ASSERT_EQ(9, data[1]);		// y
+	ASSERT_EQ(29, data[(9 * 30 + 29) * 4]);
+	ASSERT_EQ(0, data[(9 * 30 + 29) * 4 + 1]);
+	free(data);
+
+	// Square: full mipmap chain, smallest level first
+	entry = pack.find(0x1234);
+	ASSERT_NE(nullptr, entry);
+	ASSERT_EQ(7, entry->levels);
+	ASSERT_EQ(mipmapChainSize(64) + 64 * 64 * 4, entry->rawSize);
+	data = pack.load(*entry);
+	ASSERT_NE(nullptr, data);
+	// 1x1 level is the average of the whole image
+	ASSERT_EQ(32, data[0]);
+	ASSERT_EQ(32, data[1]);
+	ASSERT_EQ(0x80, data[2]);
+	ASSERT_EQ(0xff, data[3]);
+	// 2x2 level, top-right quadrant is last
+	ASSERT_EQ(48, data[4 + 3 * 4]);
+	ASSERT_EQ(16, data[4 + 3 * 4 + 1]);
+	// largest level
+	const u8 *level0 = data + mipmapChainSize(64);
+	ASSERT_EQ(5, level0[(0 * 64 + 5) * 4]);
+	ASSERT_EQ(63, level0[(0 * 64 + 5) * 4 + 1]);
+	free(data);
+
+	entry = pack.find(0xffffffff);
+	ASSERT_NE(nullptr, entry);
+	ASSERT_EQ(1, entry->levels);
+	ASSERT_EQ(4u, entry->rawSize);
+}
+
+TEST_F(TexturePackTest, Replace)
+{
+	TexturePackWriter writer;
+	ASSERT_TRUE(writer.create(path));
+	ASSERT_TRUE(writer.add(42, 16, 16, image(16, 16).data()));
+	ASSERT_TRUE(writer.add(42, 8, 4, image(8, 4).data()));
+	ASSERT_TRUE(writer.finish());
+
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path));
+	ASSERT_EQ(1u, pack.size());
+	ASSERT_EQ(8, pack.find(42)->width);
+}
+
+#ifdef HAVE_ZSTD
+TEST_F(TexturePackTest, Compression)
+{
+	const std::vector<u8> src = image(256, 256);
+	TexturePackWriter writer;
+	ASSERT_TRUE(writer.create(path, 3));
+	ASSERT_TRUE(writer.add(1, 256, 256, src.data()));
+	ASSERT_TRUE(writer.finish());
+
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path));
+	const IndexEntry *entry = pack.find(1);
+	ASSERT_NE(nullptr, entry);
+	ASSERT_EQ(Compression::Zstd, entry->compression);
+	ASSERT_LT(entry->size, entry->rawSize);
+	u8 *data = pack.load(*entry);
+	ASSERT_NE(nullptr, data);
+	const u8 *level0 = data + mipmapChainSize(256);
+	for (u32 y = 0; y < 256; y++)
+		ASSERT_EQ(0, memcmp(&src[y * 256 * 4], &level0[(255 - y) * 256 * 4], 256 * 4)) << "line " << y;
+	free(data);
+}
+#endif
+
+TEST_F(TexturePackTest, Invalid)
+{
+	TexturePack pack;
+	ASSERT_FALSE(pack.open(path));
+	FILE *f = std::fopen(path.c_str(), "wb");
+	ASSERT_NE(nullptr, f);
+	std::fputs("not a texture pack, not a texture pack", f);
+	std::fclose(f);
+	ASSERT_FALSE(pack.open(path));
+	ASSERT_FALSE(pack.isOpen());
+}
+
+TEST_F(TexturePackTest, InvalidEntry)
+{
+	TexturePackWriter writer;
+	ASSERT_TRUE(writer.create(path));
+	ASSERT_TRUE(writer.add(1, 16, 16, image(16, 16).data()));
+	ASSERT_TRUE(writer.add(2, 30, 10, image(30, 10).data()));
+	ASSERT_TRUE(writer.finish());
+
+	Header header;
+	FILE *f = std::fopen(path.c_str(), "rb");
+	ASSERT_NE(nullptr, f);
+	ASSERT_EQ(1u, std::fread(&header, sizeof(header), 1, f));
+	std::fclose(f);
+	IndexEntry entries[2];
+	auto writeIndex = [&]() {
+		FILE *f = std::fopen(path.c_str(), "r+b");
+		std::fseek(f, header.indexOffset, SEEK_SET);
+		std::fwrite(entries, sizeof(entries), 1, f);
+		std::fclose(f);
+	};
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path));
+	memcpy(entries, pack.find(1), sizeof(entries));
+	pack.close();
+
+	// raw size doesn't match the image size
+	entries[0].rawSize -= 4;
+	writeIndex();
+	ASSERT_FALSE(pack.open(path));
+	entries[0].rawSize += 4;
+
+	// data offset wraps around
+	const u64 offset = entries[1].offset;
+	entries[1].offset = ~0ull - 8;
+	writeIndex();
+	ASSERT_FALSE(pack.open(path));
+	entries[1].offset = offset;
+
+	// mipmaps of a non-square image
+	entries[1].levels = 2;
+	entries[1].rawSize += mipmapChainSize(entries[1].width);
+	writeIndex();
+	ASSERT_FALSE(pack.open(path));
+	entries[1].levels = 1;
+	entries[1].rawSize = 30 * 10 * 4;
+
+	writeIndex();
+	ASSERT_TRUE(pack.open(path));
+}
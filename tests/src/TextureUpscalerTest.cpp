@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/TexCache.h"
+#include "rend/texture_upscaler.h"
+#include "deps/xbrz/xbrz.h"
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+class UpscalerTexture final : public BaseTextureCacheData
+{
+public:
+	UpscalerTexture() : BaseTextureCacheData(TSP{}, TCW{}) {
+		Updates = 1;
+		dirty = 0;
+	}
+	~UpscalerTexture() override {
+		free(custom_image_data);
+	}
+
+	std::string GetId() override {
+		return "";
+	}
+	void UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded) override {
+	}
+};
+
+class TextureUpscalerTest : public ::testing::Test
+{
+protected:
+	static constexpr int Width = 16;
+	static constexpr int Height = 8;
+	static constexpr int Factor = 2;
+
+	void SetUp() override
+	{
+		cachePath = (std::filesystem::temp_directory_path() / "flycast_texcache_test").string() + "/";
+		std::filesystem::remove_all(cachePath);
+		pixels.resize(Width * Height);
+		for (int y = 0; y < Height; y++)
+			for (int x = 0; x < Width; x++)
+				pixels[y * Width + x] = 0xff000000 | ((x & 4) ? 0xffffff : 0) | (y * 16);
+	}
+	void TearDown() override {
+		std::filesystem::remove_all(cachePath);
+	}
+
+	static void wait(UpscalerTexture& texture)
+	{
+		for (int i = 0; i < 500 && texture.custom_load_in_progress != 0; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		ASSERT_EQ(0, texture.custom_load_in_progress);
+	}
+
+	std::vector<u32> upscaled() const
+	{
+		std::vector<u32> data(Width * Factor * Height * Factor);
+		xbrz::scale(Factor, pixels.data(), data.data(), Width, Height, xbrz::ColorFormat::RGB);
+		return data;
+	}
+
+	std::string cachePath;
+	std::vector<u32> pixels;
+};
+
+TEST_F(TextureUpscalerTest, Upscale)
+{
+	TextureUpscaler upscaler;
+	upscaler.setCachePath(cachePath);
+	UpscalerTexture texture;
+	upscaler.upscaleAsync(&texture, pixels.data(), Width, Height, Factor, false);
+	wait(texture);
+
+	ASSERT_TRUE(texture.IsCustomTextureAvailable());
+	ASSERT_EQ((u32)(Width * Factor), texture.custom_width);
+	ASSERT_EQ((u32)(Height * Factor), texture.custom_height);
+	ASSERT_FALSE(texture.custom_mipmaps);
+	std::vector<u32> data = upscaled();
+	ASSERT_EQ(0, memcmp(data.data(), texture.custom_image_data, data.size() * 4));
+
+	TextureUpscaler::Stats stats = upscaler.getStats();
+	ASSERT_EQ(0u, stats.pending);
+	ASSERT_EQ(1u, stats.completed);
+	ASSERT_EQ(0u, stats.cacheHits);
+	upscaler.resetStats();
+	ASSERT_EQ(0u, upscaler.getStats().completed);
+}
+
+TEST_F(TextureUpscalerTest, DiskCache)
+{
+	{
+		TextureUpscaler upscaler;
+		upscaler.setCachePath(cachePath);
+		UpscalerTexture texture;
+		upscaler.upscaleAsync(&texture, pixels.data(), Width, Height, Factor, false);
+		wait(texture);
+		ASSERT_EQ(0u, upscaler.getStats().cacheHits);
+	}
+	// New session
+	TextureUpscaler upscaler;
+	upscaler.setCachePath(cachePath);
+	UpscalerTexture texture;
+	upscaler.upscaleAsync(&texture, pixels.data(), Width, Height, Factor, false);
+	wait(texture);
+	ASSERT_EQ(1u, upscaler.getStats().cacheHits);
+	ASSERT_TRUE(texture.IsCustomTextureAvailable());
+	std::vector<u32> data = upscaled();
+	ASSERT_EQ(0, memcmp(data.data(), texture.custom_image_data, data.size() * 4));
+
+	// Different pixels don't hit the cache
+	UpscalerTexture other;
+	pixels[0] ^= 0xffffff;
+	upscaler.upscaleAsync(&other, pixels.data(), Width, Height, Factor, false);
+	wait(other);
+	ASSERT_EQ(1u, upscaler.getStats().cacheHits);
+	ASSERT_EQ(2u, upscaler.getStats().completed);
+}
+
+TEST_F(TextureUpscalerTest, StaleTexture)
+{
+	TextureUpscaler upscaler;
+	upscaler.setCachePath(cachePath);
+	UpscalerTexture texture;
+	// Overwritten by the game before the job runs
+	texture.dirty = 1;
+	upscaler.upscaleAsync(&texture, pixels.data(), Width, Height, Factor, false);
+	wait(texture);
+	ASSERT_FALSE(texture.IsCustomTextureAvailable());
+	ASSERT_EQ(0u, upscaler.getStats().pending);
+	ASSERT_EQ(0u, upscaler.getStats().completed);
+}
+
+TEST_F(TextureUpscalerTest, FrequentUpdates)
+{
+	TextureUpscaler upscaler;
+	upscaler.setCachePath(cachePath);
+	UpscalerTexture texture;
+	texture.Updates = TextureUpscaler::MaxCachedUpdates + 1;
+	upscaler.upscaleAsync(&texture, pixels.data(), Width, Height, Factor, false);
+	wait(texture);
+	ASSERT_TRUE(texture.IsCustomTextureAvailable());
+	// Not saved to disk
+	ASSERT_FALSE(std::filesystem::exists(cachePath) && !std::filesystem::is_empty(cachePath));
+}
+
+TEST_F(TextureUpscalerTest, CachePruning)
+{
+	TextureUpscaler upscaler;
+	upscaler.setCachePath(cachePath);
+	auto upscale = [&](u32 variant) {
+		std::vector<u32> data = pixels;
+		data[0] ^= variant;
+		UpscalerTexture texture;
+		upscaler.upscaleAsync(&texture, data.data(), Width, Height, Factor, false);
+		wait(texture);
+	};
+	auto cacheSize = [&]() {
+		u64 size = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(cachePath))
+			size += entry.file_size();
+		return size;
+	};
+	for (u32 i = 1; i <= 3; i++)
+		upscale(i);
+	const u64 maxSize = cacheSize();
+	upscaler.setCacheSize(maxSize);
+	// Most recently used
+	upscale(1);
+	ASSERT_EQ(1u, upscaler.getStats().cacheHits);
+
+	upscale(4);
+	ASSERT_LE(cacheSize(), maxSize);
+	upscale(1);
+	ASSERT_EQ(2u, upscaler.getStats().cacheHits);
+	// Least recently used
+	upscale(2);
+	ASSERT_EQ(2u, upscaler.getStats().cacheHits);
+}
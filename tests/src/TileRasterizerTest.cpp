@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/tilerend/tile_rasterizer.h"
+#include <chrono>
+#include <random>
+
+using namespace tilerend;
+
+class TileRasterizerTest : public ::testing::Test
+{
+protected:
+	static constexpr int Width = 640;
+	static constexpr int Height = 480;
+
+	void SetUp() override
+	{
+		ctx.fb_X_CLIP.full = 0;
+		ctx.fb_X_CLIP.max = Width - 1;
+		ctx.fb_Y_CLIP.full = 0;
+		ctx.fb_Y_CLIP.max = Height - 1;
+		ctx.scaler_ctl.full = 0;
+		ctx.scaler_ctl.vscalefactor = 0x400;
+		ctx.fb_W_LINESTRIDE = 0;
+		ctx.fog_clamp_min.full = 0;
+		ctx.fog_clamp_max.full = 0xffffffff;
+		state.fog = false;
+		for (int y = 0; y < Height / TileSize; y++)
+			for (int x = 0; x < Width / TileSize; x++)
+				tiles.push_back({ (u16)x, (u16)y });
+	}
+
+	// Add a triangle strip with the given blending to the translucent list
+	void addStrip(const std::vector<Vertex>& vertices, u32 srcInstr, u32 dstInstr)
+	{
+		PolyParam pp;
+		pp.init();
+		pp.first = ctx.idx.size();
+		pp.count = vertices.size();
+		pp.isp.DepthMode = 7;
+		pp.isp.ZWriteDis = 1;
+		pp.tsp.UseAlpha = 1;
+		pp.tsp.SrcInstr = srcInstr;
+		pp.tsp.DstInstr = dstInstr;
+		pp.pcw.Gouraud = 1;
+		for (const Vertex& v : vertices)
+		{
+			ctx.idx.push_back(ctx.verts.size());
+			ctx.verts.push_back(v);
+		}
+		ctx.global_param_tr.push_back(pp);
+	}
+
+	static Vertex vertex(float x, float y, float z, u32 color)
+	{
+		Vertex v {};
+		v.x = x;
+		v.y = y;
+		v.z = z;
+		memcpy(v.col, &color, sizeof(color));
+		return v;
+	}
+
+	void endPass()
+	{
+		RenderPass pass {};
+		pass.op_count = ctx.global_param_op.size();
+		pass.pt_count = ctx.global_param_pt.size();
+		pass.tr_count = ctx.global_param_tr.size();
+		pass.autosort = false;
+		pass.z_clear = true;
+		ctx.render_passes.push_back(pass);
+	}
+
+	std::vector<u32> render(TileRasterizer& rasterizer)
+	{
+		std::vector<u32> framebuffer(Width * Height, 0xdeadbeef);
+		rasterizer.render(ctx, state, tiles, framebuffer.data(), Width, Height);
+		return framebuffer;
+	}
+
+	rend_context ctx {};
+	RenderState state;
+	std::vector<Tile> tiles;
+};
+
+TEST_F(TileRasterizerTest, Coverage)
+{
+	// quad made of 2 triangles sharing a diagonal, blended additively
+	addStrip({ vertex(8.f, 8.f, 1.f, 0xff000040), vertex(40.f, 8.f, 1.f, 0xff000040),
+			vertex(8.f, 40.f, 1.f, 0xff000040), vertex(40.f, 40.f, 1.f, 0xff000040) }, 1, 1);
+	endPass();
+	TileRasterizer rasterizer(1);
+	std::vector<u32> fb = render(rasterizer);
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 64; x++)
+		{
+			const u32 pixel = fb[y * Width + x];
+			if (x >= 8 && x < 40 && y >= 8 && y < 40)
+				// covered exactly once
+				ASSERT_EQ(0x40u, pixel & 0xffffff) << "x " << x << " y " << y;
+			else
+				ASSERT_EQ(0u, pixel) << "x " << x << " y " << y;
+		}
+}
+
+TEST_F(TileRasterizerTest, Culling)
+{
+	// counter-clockwise triangle
+	addStrip({ vertex(8.f, 8.f, 1.f, 0xffffffff), vertex(8.f, 40.f, 1.f, 0xffffffff), vertex(40.f, 8.f, 1.f, 0xffffffff) }, 1, 0);
+	endPass();
+	TileRasterizer rasterizer(1);
+	ctx.global_param_tr[0].isp.CullMode = 3;
+	ASSERT_NE(0u, render(rasterizer)[10 * Width + 10]);
+	ctx.global_param_tr[0].isp.CullMode = 2;
+	ASSERT_EQ(0u, render(rasterizer)[10 * Width + 10]);
+}
+
+// Multi-threaded rendering gives the same result
+TEST_F(TileRasterizerTest, Deterministic)
+{
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> x(-20.f, Width + 20.f);
+	std::uniform_real_distribution<float> y(-20.f, Height + 20.f);
+	std::uniform_real_distribution<float> d(-40.f, 40.f);
+	std::uniform_real_distribution<float> z(0.001f, 1.f);
+	for (int i = 0; i < 2000; i++)
+	{
+		const float cx = x(gen);
+		const float cy = y(gen);
+		addStrip({ vertex(cx + d(gen), cy + d(gen), z(gen), (u32)gen()), vertex(cx + d(gen), cy + d(gen), z(gen), (u32)gen()),
+				vertex(cx + d(gen), cy + d(gen), z(gen), (u32)gen()) }, 4, 5);
+	}
+	endPass();
+	TileRasterizer single(1);
+	const std::vector<u32> expected = render(single);
+
+	TileRasterizer multi(4);
+	for (int i = 0; i < 3; i++)
+		ASSERT_EQ(expected, render(multi));
+
+	for (int threads : { 1, 2, 4, 0 })
+	{
+		TileRasterizer rasterizer(threads);
+		render(rasterizer);
+		const auto start = std::chrono::steady_clock::now();
+		constexpr int Frames = 5;
+		for (int i = 0; i < Frames; i++)
+			render(rasterizer);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%d threads: %.1f Mpixels/s\n", rasterizer.threadCount(), Width * Height * Frames / seconds / 1e6);
+	}
+}
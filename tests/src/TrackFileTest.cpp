@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "imgread/common.h"
+#include "stdclass.h"
+
+class TrackFileTest : public ::testing::Test
+{
+protected:
+	static constexpr u32 Sectors = 4096;
+	static constexpr u32 StartFAD = 150;
+
+	// Creates a raw mode 1 track where each sector user data is filled with its FAD
+	FILE *createTrack()
+	{
+		FILE *f = std::tmpfile();
+		if (f == nullptr)
+			return nullptr;
+		u8 sector[2352] {};
+		for (u32 i = 0; i < Sectors; i++)
+		{
+			sector[15] = 1;
+			for (u32 j = 16; j < 16 + 2048; j += 4)
+				*(u32 *)&sector[j] = StartFAD + i;
+			if (std::fwrite(sector, 1, sizeof(sector), f) != sizeof(sector))
+			{
+				std::fclose(f);
+				return nullptr;
+			}
+		}
+		std::fflush(f);
+		return f;
+	}
+
+	Disc *createDisc(TrackFile *file)
+	{
+		Disc *disc = new Disc();
+		Track track;
+		track.file = file;
+		track.StartFAD = StartFAD;
+		track.EndFAD = StartFAD + Sectors - 1;
+		track.CTRL = 4;
+		disc->tracks.push_back(track);
+		disc->type = CdRom;
+		return disc;
+	}
+};
+
+TEST_F(TrackFileTest, Read)
+{
+	FILE *f1 = createTrack();
+	FILE *f2 = createTrack();
+	ASSERT_NE(nullptr, f1);
+	ASSERT_NE(nullptr, f2);
+	std::unique_ptr<TrackFile> raw = std::make_unique<RawTrackFile>(f1, 0, StartFAD, 2352);
+	std::unique_ptr<TrackFile> track(createRawTrackFile(f2, 0, StartFAD, StartFAD + Sectors - 1, 2352));
+
+	u8 data1[2352];
+	u8 data2[2352];
+	u8 subcode[96];
+	SectorFormat secfmt1, secfmt2;
+	SubcodeFormat subfmt;
+	for (u32 fad : { StartFAD, StartFAD + 1, StartFAD + 1000, StartFAD + Sectors - 1, StartFAD + 10 })
+	{
+		ASSERT_TRUE(raw->Read(fad, data1, &secfmt1, subcode, &subfmt));
+		ASSERT_TRUE(track->Read(fad, data2, &secfmt2, subcode, &subfmt));
+		ASSERT_EQ(secfmt1, secfmt2);
+		ASSERT_EQ(0, memcmp(data1, data2, sizeof(data1)));
+		ASSERT_EQ(fad, *(u32 *)&data2[16]);
+	}
+	// past the end of file
+	ASSERT_FALSE(track->Read(StartFAD + Sectors, data2, &secfmt2, subcode, &subfmt));
+}
+
+// Two tracks in the same file
+TEST_F(TrackFileTest, TrackExtent)
+{
+	FILE *f1 = createTrack();
+	FILE *f2 = createTrack();
+	ASSERT_NE(nullptr, f1);
+	ASSERT_NE(nullptr, f2);
+	constexpr u32 Split = 1000;
+	std::unique_ptr<TrackFile> track1(createRawTrackFile(f1, 0, StartFAD, StartFAD + Split - 1, 2352));
+	std::unique_ptr<TrackFile> track2(createRawTrackFile(f2, Split * 2352, StartFAD + Split, StartFAD + Sectors - 1, 2352));
+
+	u8 data[2352];
+	u8 subcode[96];
+	SectorFormat secfmt;
+	SubcodeFormat subfmt;
+	for (u32 fad : { StartFAD, StartFAD + Split - 1 })
+	{
+		ASSERT_TRUE(track1->Read(fad, data, &secfmt, subcode, &subfmt));
+		ASSERT_EQ(fad, *(u32 *)&data[16]);
+	}
+	for (u32 fad : { StartFAD + Split, StartFAD + Sectors - 1 })
+	{
+		ASSERT_TRUE(track2->Read(fad, data, &secfmt, subcode, &subfmt));
+		ASSERT_EQ(fad, *(u32 *)&data[16]);
+	}
+	ASSERT_FALSE(track2->Read(StartFAD + Sectors, data, &secfmt, subcode, &subfmt));
+}
+
+TEST_F(TrackFileTest, ReadSectors)
+{
+	FILE *f = createTrack();
+	ASSERT_NE(nullptr, f);
+	std::unique_ptr<Disc> disc(createDisc(createRawTrackFile(f, 0, StartFAD, StartFAD + Sectors - 1, 2352)));
+
+	std::vector<u8> data(64 * 2048);
+	for (u32 fad : { StartFAD, StartFAD + 64, StartFAD + 2000, StartFAD + Sectors - 64 })
+	{
+		ASSERT_EQ(64u, disc->ReadSectors(fad, 64, data.data(), 2048));
+		for (u32 i = 0; i < 64; i++)
+			for (u32 j = 0; j < 2048; j += 4)
+				ASSERT_EQ(fad + i, *(u32 *)&data[i * 2048 + j]);
+	}
+	// end of disc
+	ASSERT_EQ(10u, disc->ReadSectors(StartFAD + Sectors - 10, 64, data.data(), 2048, true));
+}
+
+TEST_F(TrackFileTest, DISABLED_Benchmark)
+{
+	FILE *f1 = createTrack();
+	FILE *f2 = createTrack();
+	ASSERT_NE(nullptr, f1);
+	ASSERT_NE(nullptr, f2);
+	std::unique_ptr<Disc> rawDisc(createDisc(new RawTrackFile(f1, 0, StartFAD, 2352)));
+	std::unique_ptr<Disc> disc(createDisc(createRawTrackFile(f2, 0, StartFAD, StartFAD + Sectors - 1, 2352)));
+
+	// Sequential reads of 16 sectors, as done by the GD-ROM drive
+	std::vector<u8> data(16 * 2048);
+	constexpr int Loops = 20;
+	u64 start = getTimeUs();
+	for (int l = 0; l < Loops; l++)
+		for (u32 fad = StartFAD; fad < StartFAD + Sectors; fad += 16)
+			rawDisc->ReadSectors(fad, 16, data.data(), 2048);
+	u64 rawTime = getTimeUs() - start;
+
+	start = getTimeUs();
+	for (int l = 0; l < Loops; l++)
+		for (u32 fad = StartFAD; fad < StartFAD + Sectors; fad += 16)
+			disc->ReadSectors(fad, 16, data.data(), 2048);
+	u64 time = getTimeUs() - start;
+
+	const double mb = (double)Loops * Sectors * 2048 / 1024 / 1024;
+	printf("Read %.0f MB: stdio %.1f MB/s, track file %.1f MB/s\n", mb,
+			mb * 1e6 / std::max<u64>(rawTime, 1), mb * 1e6 / std::max<u64>(time, 1));
+}
@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "util/byte_ring.h"
+#include <future>
+#include <thread>
+
+class ByteRingTest : public ::testing::Test
+{
+};
+
+TEST_F(ByteRingTest, Basic)
+{
+	ByteRing<8> ring;
+	ASSERT_TRUE(ring.empty());
+	ASSERT_EQ(-1, ring.pop());
+	ASSERT_TRUE(ring.push(42));
+	ASSERT_EQ(1u, ring.size());
+	ASSERT_EQ(42, ring.pop());
+	ASSERT_TRUE(ring.empty());
+
+	const uint8_t data[] { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	uint8_t out[10] {};
+	// partial write
+	ASSERT_EQ(8u, ring.write(data, sizeof(data)));
+	ASSERT_FALSE(ring.push(0));
+	ASSERT_EQ(3u, ring.read(out, 3));
+	ASSERT_EQ(0, memcmp(data, out, 3));
+	// wrap around
+	ASSERT_EQ(3u, ring.write(data, 3));
+	ASSERT_EQ(8u, ring.size());
+	ASSERT_EQ(8u, ring.read(out, sizeof(out)));
+	ASSERT_EQ(0, memcmp(&data[3], out, 5));
+	ASSERT_EQ(0, memcmp(data, &out[5], 3));
+	ASSERT_TRUE(ring.empty());
+	ASSERT_EQ(0u, ring.read(out, sizeof(out)));
+
+	ring.push(1);
+	ring.clear();
+	ASSERT_TRUE(ring.empty());
+}
+
+TEST_F(ByteRingTest, MultiThread)
+{
+	ByteRing<64> ring;
+	constexpr size_t Size = 100'000;
+	std::future<bool> consumer = std::async(std::launch::async, [&]() {
+		uint8_t buf[37];
+		size_t count = 0;
+		while (count < Size)
+		{
+			size_t len = ring.read(buf, sizeof(buf));
+			if (len == 0)
+				std::this_thread::yield();
+			for (size_t i = 0; i < len; i++)
+				if (buf[i] != (uint8_t)(count++ * 7))
+					return false;
+		}
+		return true;
+	});
+	uint8_t buf[23];
+	size_t count = 0;
+	while (count < Size)
+	{
+		size_t len = std::min(sizeof(buf), Size - count);
+		for (size_t i = 0; i < len; i++)
+			buf[i] = (uint8_t)((count + i) * 7);
+		len = ring.write(buf, len);
+		if (len == 0)
+			std::this_thread::yield();
+		count += len;
+	}
+	ASSERT_TRUE(consumer.get());
+	ASSERT_TRUE(ring.empty());
+}
@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include "util/task_pool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+class TaskPoolTest : public ::testing::Test
+{
+};
+
+TEST_F(TaskPoolTest, AllTasksRunOnce)
+{
+	TaskPool pool("Test", 4);
+	ASSERT_EQ(4, pool.size());
+	for (int count : { 1, 2, 3, 4, 5, 17, 1000 })
+	{
+		std::vector<std::atomic<int>> runs(count);
+		pool.parallelFor(count, [&](int task, int thread) {
+			ASSERT_GE(thread, 0);
+			ASSERT_LT(thread, 4);
+			runs[task]++;
+		});
+		for (int i = 0; i < count; i++)
+			ASSERT_EQ(1, runs[i]) << "task " << i << " count " << count;
+	}
+	// restart
+	pool.stop();
+	std::atomic<int> sum = 0;
+	pool.parallelFor(100, [&](int task, int thread) {
+		sum += task;
+	});
+	ASSERT_EQ(4950, sum);
+}
+
+// Threads that are done help the others
+TEST_F(TaskPoolTest, Stealing)
+{
+	TaskPool pool("Test", 2);
+	std::atomic<int> thread1Tasks = 0;
+	// Thread 0 owns tasks [0, 8) and is stuck on the first one
+	pool.parallelFor(16, [&](int task, int thread) {
+		if (task == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		if (thread == 1)
+			thread1Tasks++;
+	});
+	ASSERT_GE(thread1Tasks, 15);
+}
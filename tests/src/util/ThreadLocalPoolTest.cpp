@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "util/thread_local_pool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// A thread has one object per type, so each test uses its own type
+class ThreadLocalPoolTest : public ::testing::Test
+{
+};
+
+TEST_F(ThreadLocalPoolTest, Reuse)
+{
+	struct Object
+	{
+		int value = 0;
+		int acquired = 0;
+	};
+	ThreadLocalPool<Object> pool;
+	ASSERT_EQ(nullptr, pool.current());
+	Object *main = pool.get();
+	ASSERT_EQ(main, pool.get());
+	ASSERT_EQ(main, pool.current());
+
+	Object *first = nullptr;
+	std::thread([&]() {
+		first = pool.get([](Object& o, bool created) {
+			ASSERT_TRUE(created);
+			o.acquired++;
+		});
+		first->value = 42;
+	}).join();
+	ASSERT_NE(main, first);
+
+	// The object of the exited thread is reused, keeping its content
+	Object *second = nullptr;
+	std::thread([&]() {
+		second = pool.get([](Object& o, bool created) {
+			ASSERT_FALSE(created);
+			o.acquired++;
+		});
+	}).join();
+	ASSERT_EQ(first, second);
+	ASSERT_EQ(42, second->value);
+	ASSERT_EQ(2, second->acquired);
+	ASSERT_EQ(2u, pool.objects().size());
+}
+
+TEST_F(ThreadLocalPoolTest, Concurrent)
+{
+	struct Object
+	{
+		int value = 0;
+	};
+	ThreadLocalPool<Object> pool;
+	constexpr int Threads = 8;
+	std::vector<Object *> objects(Threads);
+	std::vector<std::thread> threads;
+	std::atomic<int> ready {};
+	for (int i = 0; i < Threads; i++)
+		threads.emplace_back([&, i]() {
+			objects[i] = pool.get();
+			// Keep all threads alive so they get distinct objects
+			ready++;
+			while (ready < Threads)
+				std::this_thread::yield();
+		});
+	for (auto& thread : threads)
+		thread.join();
+	for (int i = 0; i < Threads; i++)
+		for (int j = i + 1; j < Threads; j++)
+			ASSERT_NE(objects[i], objects[j]);
+	ASSERT_EQ((size_t)Threads, pool.objects().size());
+}
@@ -0,0 +1,127 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+	Packs a directory of custom textures (<hash>.png or .jpg) into a single texture pack file.
+	Usage: texpack [-z <level>] <textures directory> [<output file>]
+	The default output file is textures.fctp in the textures directory, where Flycast will look for it.
+*/
+#include "rend/texture_pack.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#include <stb_image.h>
+
+namespace fs = std::filesystem;
+
+static void usage()
+{
+	fprintf(stderr, "Usage: texpack [-z <level>] <textures directory> [<output file>]\n");
+	fprintf(stderr, "  -z <level>  compress textures with zstd at the given level (1-22)\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int level = 0;
+	int arg = 1;
+	if (arg + 1 < argc && std::string(argv[arg]) == "-z")
+	{
+		level = atoi(argv[arg + 1]);
+		if (level < 1 || level > 22)
+			usage();
+		arg += 2;
+	}
+	if (arg >= argc || argc - arg > 2)
+		usage();
+	const fs::path dir(argv[arg]);
+	const fs::path output = arg + 1 < argc ? fs::path(argv[arg + 1]) : dir / texpack::FileName;
+
+	std::vector<std::pair<u32, fs::path>> files;
+	std::error_code ec;
+	for (const auto& item : fs::recursive_directory_iterator(dir, ec))
+	{
+		if (!item.is_regular_file())
+			continue;
+		std::string extension = item.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension != ".jpg" && extension != ".jpeg" && extension != ".png")
+			continue;
+		const std::string basename = item.path().stem().string();
+		char *endptr;
+		u32 hash = (u32)strtoll(basename.c_str(), &endptr, 16);
+		if (endptr - basename.c_str() < (ptrdiff_t)basename.length())
+		{
+			fprintf(stderr, "Skipping %s: invalid hash\n", item.path().string().c_str());
+			continue;
+		}
+		files.emplace_back(hash, item.path());
+	}
+	if (ec)
+	{
+		fprintf(stderr, "Can't read directory %s: %s\n", dir.string().c_str(), ec.message().c_str());
+		return 1;
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "No texture found in %s\n", dir.string().c_str());
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	texpack::TexturePackWriter writer;
+	if (!writer.create(output.string(), level))
+	{
+		fprintf(stderr, "Can't create %s\n", output.string().c_str());
+		return 1;
+	}
+	int count = 0;
+	for (const auto& [hash, path] : files)
+	{
+		int width, height, n;
+		u8 *data = stbi_load(path.string().c_str(), &width, &height, &n, STBI_rgb_alpha);
+		if (data == nullptr)
+		{
+			fprintf(stderr, "Skipping %s: %s\n", path.string().c_str(), stbi_failure_reason());
+			continue;
+		}
+		const bool success = writer.add(hash, width, height, data);
+		stbi_image_free(data);
+		if (!success)
+		{
+			fprintf(stderr, "Error adding %s\n", path.string().c_str());
+			return 1;
+		}
+		count++;
+		if (count % 100 == 0)
+			printf("%d/%d\r", count, (int)files.size());
+	}
+	if (!writer.finish())
+	{
+		fprintf(stderr, "Error writing %s\n", output.string().c_str());
+		return 1;
+	}
+	printf("%d textures written to %s\n", count, output.string().c_str());
+
+	return 0;
+}